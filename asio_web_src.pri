@@ -5,13 +5,54 @@ HEADERS += \
     $$PWD/src/asio_web/webserver.h \
     $$PWD/src/asio_web/websocketclientconnection.h \
     $$PWD/src/asio_web/websocketstream.h \
-    $$PWD/src/asio_web/websocketclient.h
+    $$PWD/src/asio_web/websocketclient.h \
+    $$PWD/src/asio_web/websockethub.h \
+    $$PWD/src/asio_web/outboundqueue.h \
+    $$PWD/src/asio_web/timerwheel.h \
+    $$PWD/src/asio_web/websocketheartbeat.h \
+    $$PWD/src/asio_web/utf8validator.h \
+    $$PWD/src/asio_web/sha1.h \
+    $$PWD/src/asio_web/websockethandshake.h \
+    $$PWD/src/asio_web/sslclientcontext.h \
+    $$PWD/src/asio_web/happyeyeballs.h \
+    $$PWD/src/asio_web/httpheaders.h \
+    $$PWD/src/asio_web/httpresponseparser.h \
+    $$PWD/src/asio_web/httpclient.h \
+    $$PWD/src/asio_web/proxyupstream.h \
+    $$PWD/src/asio_web/proxyresponsehandler.h \
+    $$PWD/src/asio_web/clientstream.h \
+    $$PWD/src/asio_web/sslservercontext.h \
+    $$PWD/src/asio_web/hpack.h \
+    $$PWD/src/asio_web/http2channel.h \
+    $$PWD/src/asio_web/http2connection.h \
+    $$PWD/src/asio_web/memorystream.h \
+    $$PWD/src/asio_web/admissioncontrol.h
 
 SOURCES += \
     $$PWD/src/asio_web/clientconnection.cpp \
     $$PWD/src/asio_web/responsehandler.cpp \
-    $$PWD/src/asio_web/sslwebsocketclient.cpp \
     $$PWD/src/asio_web/webserver.cpp \
     $$PWD/src/asio_web/websocketclientconnection.cpp \
     $$PWD/src/asio_web/websocketstream.cpp \
-    $$PWD/src/asio_web/websocketclient.cpp
+    $$PWD/src/asio_web/websocketclient.cpp \
+    $$PWD/src/asio_web/websockethub.cpp \
+    $$PWD/src/asio_web/outboundqueue.cpp \
+    $$PWD/src/asio_web/timerwheel.cpp \
+    $$PWD/src/asio_web/websocketheartbeat.cpp \
+    $$PWD/src/asio_web/utf8validator.cpp \
+    $$PWD/src/asio_web/sha1.cpp \
+    $$PWD/src/asio_web/websockethandshake.cpp \
+    $$PWD/src/asio_web/sslclientcontext.cpp \
+    $$PWD/src/asio_web/happyeyeballs.cpp \
+    $$PWD/src/asio_web/httpheaders.cpp \
+    $$PWD/src/asio_web/httpresponseparser.cpp \
+    $$PWD/src/asio_web/httpclient.cpp \
+    $$PWD/src/asio_web/proxyupstream.cpp \
+    $$PWD/src/asio_web/proxyresponsehandler.cpp \
+    $$PWD/src/asio_web/clientstream.cpp \
+    $$PWD/src/asio_web/sslservercontext.cpp \
+    $$PWD/src/asio_web/hpack.cpp \
+    $$PWD/src/asio_web/http2channel.cpp \
+    $$PWD/src/asio_web/http2connection.cpp \
+    $$PWD/src/asio_web/memorystream.cpp \
+    $$PWD/src/asio_web/admissioncontrol.cpp
@@ -0,0 +1,194 @@
+#include "admissioncontrol.h"
+
+// system includes
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+namespace {
+std::string serializeResponse(std::string_view status, int retryAfter)
+{
+    std::string response{"HTTP/1.1 "};
+    response += status;
+    response += "\r\n"
+                "Connection: close\r\n"
+                "Content-Length: 0\r\n";
+    if (retryAfter > 0)
+    {
+        response += "Retry-After: ";
+        response += std::to_string(retryAfter);
+        response += "\r\n";
+    }
+    response += "\r\n";
+    return response;
+}
+} // namespace
+
+AdmissionControl::Ticket::Ticket(Ticket &&other) noexcept :
+    m_control{std::exchange(other.m_control, nullptr)},
+    m_slot{other.m_slot}
+{}
+
+AdmissionControl::Ticket &AdmissionControl::Ticket::operator=(Ticket &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_control = std::exchange(other.m_control, nullptr);
+        m_slot = other.m_slot;
+    }
+    return *this;
+}
+
+void AdmissionControl::Ticket::release()
+{
+    if (const auto control = std::exchange(m_control, nullptr))
+        control->release(m_slot);
+}
+
+AdmissionControl::AdmissionControl(const AdmissionSettings &settings) :
+    m_settings{settings},
+    m_burst{settings.requestBurst > 0.f ? settings.requestBurst : settings.requestsPerSecond},
+    m_epoch{std::chrono::steady_clock::now()},
+    m_serviceUnavailableResponse{serializeResponse("503 Service Unavailable", settings.retryAfter)},
+    m_tooManyRequestsResponse{serializeResponse("429 Too Many Requests", settings.retryAfter)}
+{
+    // without a per address limit there is nothing to track
+    if (m_settings.maxConnectionsPerAddress <= 0 && !limitsRequests())
+        return;
+
+    const auto size = std::bit_ceil(std::max(m_settings.trackedAddresses, probeLength));
+    m_entries = std::make_unique<Entry[]>(size);
+    m_mask = size - 1;
+
+    // the slots of an address can not be predicted from outside
+    m_seed = uint64_t(m_epoch.time_since_epoch().count()) | 1;
+}
+
+AdmissionControl::Result AdmissionControl::admit(const asio::ip::address &address, Ticket &ticket)
+{
+    if (m_settings.maxConnections > 0 && m_connections >= std::size_t(m_settings.maxConnections))
+        return Result::TooManyConnections;
+
+    uint32_t slot{noSlot};
+
+    if (m_settings.maxConnectionsPerAddress > 0 && tracked(address))
+    {
+        const auto time = now();
+        if (const auto entry = lookup(address, time))
+        {
+            if (entry->connections >= std::min<int>(m_settings.maxConnectionsPerAddress, UINT16_MAX))
+                return Result::TooManyFromAddress;
+
+            touch(*entry, time);
+            entry->connections++;
+            slot = uint32_t(entry - m_entries.get());
+        }
+    }
+
+    m_connections++;
+    ticket = Ticket{*this, slot};
+    return Result::Admitted;
+}
+
+bool AdmissionControl::takeRequest(const asio::ip::address &address)
+{
+    if (!limitsRequests() || !tracked(address))
+        return true;
+
+    const auto time = now();
+    const auto entry = lookup(address, time);
+    if (!entry)
+        return true;
+
+    touch(*entry, time);
+    if (entry->tokens < 1.f)
+        return false;
+
+    entry->tokens -= 1.f;
+    return true;
+}
+
+bool AdmissionControl::tracked(const asio::ip::address &address) const
+{
+    return m_entries && !(m_settings.exemptLoopback && address.is_loopback());
+}
+
+AdmissionControl::Entry *AdmissionControl::lookup(const asio::ip::address &address, uint32_t now)
+{
+    Key key{};
+    if (address.is_v4())
+    {
+        // v4 mapped, so both families share the table
+        key[10] = key[11] = 0xff;
+        const auto bytes = address.to_v4().to_bytes();
+        std::copy(std::begin(bytes), std::end(bytes), std::begin(key) + 12);
+    }
+    else
+    {
+        const auto bytes = address.to_v6().to_bytes();
+        const auto prefix = address.to_v6().is_v4_mapped() ? bytes.size() : 8;
+        std::copy(std::begin(bytes), std::begin(bytes) + prefix, std::begin(key));
+    }
+
+    uint64_t words[2];
+    std::memcpy(words, key.data(), sizeof(words));
+    uint64_t hash = (words[0] ^ m_seed) * 0x9e3779b97f4a7c15ull;
+    hash = (hash ^ (hash >> 29) ^ words[1]) * 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 32;
+
+    Entry *free{};
+    for (std::size_t i = 0; i < probeLength; i++)
+    {
+        auto &entry = m_entries[(hash + i) & m_mask];
+        if (entry.lastSeen && entry.key == key)
+        {
+            // a bucket left alone until its expiry would be full again anyway
+            if (expired(entry, now))
+                entry.tokens = m_burst;
+            return &entry;
+        }
+
+        if (!free && (!entry.lastSeen || expired(entry, now)))
+            free = &entry;
+    }
+
+    if (free)
+        *free = Entry{.key = key, .lastSeen = now, .tokens = m_burst, .connections = 0};
+
+    return free;
+}
+
+bool AdmissionControl::expired(const Entry &entry, uint32_t now) const
+{
+    return !entry.connections &&
+           now - entry.lastSeen >= std::chrono::duration_cast<std::chrono::milliseconds>(m_settings.expiry).count();
+}
+
+void AdmissionControl::touch(Entry &entry, uint32_t now) const
+{
+    // the bucket is refilled for the time since lastSeen before it moves on
+    const auto elapsed = now - entry.lastSeen;
+    entry.tokens = std::min(m_burst, entry.tokens + elapsed * m_settings.requestsPerSecond / 1000.f);
+    entry.lastSeen = now;
+}
+
+uint32_t AdmissionControl::now() const
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+    // 0 marks a slot never used, wraps after 49 days
+    return std::max<uint32_t>(uint32_t(elapsed), 1);
+}
+
+void AdmissionControl::release(uint32_t slot)
+{
+    m_connections--;
+
+    if (slot == noSlot)
+        return;
+
+    auto &entry = m_entries[slot];
+    touch(entry, now());
+    entry.connections--;
+}
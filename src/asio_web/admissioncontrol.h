@@ -0,0 +1,127 @@
+#pragma once
+
+// system includes
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// esp-idf includes
+#include <asio.hpp>
+
+enum class AdmissionRejection : uint8_t
+{
+    Respond, // 503 for a connection, 429 for a request, then closed
+    Close,   // closed without a response
+};
+
+// Limits for clients opening connections or sending requests without bound,
+// 0 disables a limit
+struct AdmissionSettings
+{
+    int maxConnections{};              // http, websocket and HTTP/2 connections together
+    int maxConnectionsPerAddress{};
+    float requestsPerSecond{};         // per address, refilled into a token bucket
+    float requestBurst{};              // size of the bucket, requestsPerSecond if 0
+    std::size_t trackedAddresses{256}; // slots of the address table, rounded up to a power of two
+    std::chrono::seconds expiry{60};   // an address without connections is forgotten after this
+    AdmissionRejection rejection{AdmissionRejection::Respond};
+    int retryAfter{1};                 // seconds, sent with the 503 and the 429, 0 leaves the header out
+    bool exemptLoopback{true};         // no per address limits for local clients and unix sockets
+};
+
+// Counts connections and request tokens per remote address in a table of
+// fixed size with open addressing. An address is looked up in a few slots
+// after its hash, an entry without connections is reused once it expired.
+// An address which finds no slot is only limited by maxConnections. IPv6
+// addresses are counted per /64, the block a single host usually gets.
+// Not locked, it belongs to the Webserver and its thread.
+class AdmissionControl
+{
+public:
+    enum class Result : uint8_t
+    {
+        Admitted,
+        TooManyConnections,
+        TooManyFromAddress,
+    };
+
+    // keeps an admitted connection counted until it is destroyed, moves on
+    // with the stream when the connection switches to websocket or HTTP/2
+    class Ticket
+    {
+    public:
+        Ticket() = default;
+        Ticket(Ticket &&other) noexcept;
+        Ticket &operator=(Ticket &&other) noexcept;
+        ~Ticket() { release(); }
+
+        void release();
+
+    private:
+        friend class AdmissionControl;
+
+        Ticket(AdmissionControl &control, uint32_t slot) : m_control{&control}, m_slot{slot} {}
+
+        AdmissionControl *m_control{};
+        uint32_t m_slot{};
+    };
+
+    explicit AdmissionControl(const AdmissionSettings &settings);
+
+    const AdmissionSettings &settings() const { return m_settings; }
+
+    bool limitsConnections() const { return m_settings.maxConnections > 0 || m_settings.maxConnectionsPerAddress > 0; }
+    bool limitsRequests() const { return m_settings.requestsPerSecond > 0.f; }
+
+    // a connection from address, counted as long as the ticket lives
+    Result admit(const asio::ip::address &address, Ticket &ticket);
+
+    // takes a token from the bucket of address, false if it is empty
+    bool takeRequest(const asio::ip::address &address);
+
+    std::size_t connections() const { return m_connections; }
+
+    // serialized once, written as they are
+    std::string_view serviceUnavailableResponse() const { return m_serviceUnavailableResponse; }
+    std::string_view tooManyRequestsResponse() const { return m_tooManyRequestsResponse; }
+
+private:
+    using Key = std::array<uint8_t, 16>;
+
+    struct Entry
+    {
+        Key key;
+        uint32_t lastSeen; // ms since m_epoch, 0 for a slot never used
+        float tokens;
+        uint16_t connections;
+    };
+
+    static constexpr uint32_t noSlot = UINT32_MAX;
+    static constexpr std::size_t probeLength = 8;
+
+    bool tracked(const asio::ip::address &address) const;
+    Entry *lookup(const asio::ip::address &address, uint32_t now);
+    bool expired(const Entry &entry, uint32_t now) const;
+    void touch(Entry &entry, uint32_t now) const;
+    uint32_t now() const;
+
+    void release(uint32_t slot);
+
+    const AdmissionSettings m_settings;
+    const float m_burst;
+
+    std::unique_ptr<Entry[]> m_entries;
+    std::size_t m_mask{};
+    uint64_t m_seed{};
+
+    const std::chrono::steady_clock::time_point m_epoch;
+
+    std::size_t m_connections{};
+
+    const std::string m_serviceUnavailableResponse;
+    const std::string m_tooManyRequestsResponse;
+};
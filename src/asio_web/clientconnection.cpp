@@ -1,6 +1,7 @@
 #include "clientconnection.h"
 
 // system includes
+#include <algorithm>
 #include <cstdio>
 #include <utility>
 
@@ -13,17 +14,26 @@
 
 // local includes
 #include "webserver.h"
+#include "http2connection.h"
 #include "responsehandler.h"
 #include "websocketclientconnection.h"
 
 namespace {
 constexpr const char * const TAG = "ASIO_WEB";
+
+constexpr std::string_view websocketBadRequest{"HTTP/1.1 400 Bad Request\r\n"
+                                               "Connection: close\r\n"
+                                               "Sec-WebSocket-Version: 13\r\n"
+                                               "Content-Length: 0\r\n"
+                                               "\r\n"};
 } // namespace
 
-ClientConnection::ClientConnection(Webserver &webserver, asio::ip::tcp::socket socket) :
+ClientConnection::ClientConnection(Webserver &webserver, ClientStream &&stream, AdmissionControl::Ticket &&admission) :
     m_webserver{webserver},
-    m_socket{std::move(socket)},
-    m_remote_endpoint{m_socket.remote_endpoint()}
+    m_stream{std::move(stream)},
+    m_remote_endpoint{[&](){ std::error_code ec; return m_stream.remote_endpoint(ec); }()},
+    m_admission{std::move(admission)},
+    m_deadlineTimer{m_webserver.timerWheel(), [](void *context){ static_cast<ClientConnection *>(context)->deadlineExpired(); }, this}
 {
     ESP_LOGI(TAG, "new client (%s:%hi)",
              m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
@@ -41,16 +51,57 @@ ClientConnection::~ClientConnection()
 
 void ClientConnection::start()
 {
+    if (const auto ssl = m_stream.sslStream())
+    {
+        armDeadline(Deadline::Handshake);
+
+        ssl->async_handshake(asio::ssl::stream_base::server,
+                             [this, self=shared_from_this()](std::error_code ec)
+                             { handshakeFinished(ec); });
+        return;
+    }
+
+    armDeadline(Deadline::RequestHeader);
+
+    doRead();
+}
+
+void ClientConnection::handshakeFinished(std::error_code ec)
+{
+    if (ec)
+    {
+        ESP_LOGI(TAG, "handshake failed: %s (%s:%hi)", ec.message().c_str(),
+                 m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        std::error_code close_error;
+        m_stream.close(close_error);
+        return;
+    }
+
+    if (m_stream.alpnProtocol() == "h2")
+    {
+        startHttp2();
+        return;
+    }
+
+    armDeadline(Deadline::RequestHeader);
+
     doRead();
 }
 
+void ClientConnection::startHttp2()
+{
+    armDeadline(Deadline::None);
+
+    std::make_shared<Http2Connection>(m_webserver, std::move(m_stream), std::move(m_parsingBuffer), std::move(m_admission))->start();
+}
+
 void ClientConnection::responseFinished(std::error_code ec)
 {
     if (ec)
     {
         ESP_LOGW(TAG, "error: %i (%s:%hi)", ec.value(),
                  m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-        m_socket.close();
+        m_stream.close();
         return;
     }
 
@@ -59,10 +110,20 @@ void ClientConnection::responseFinished(std::error_code ec)
 //        ESP_LOGD(TAG, "state changed to RequestLine");
         m_state = State::RequestLine;
 
+        // a pipelined request may already wait in the buffer
+        if (!m_parsingBuffer.empty())
+        {
+            armDeadline(Deadline::RequestHeader);
+            parseBufferedLines();
+            return;
+        }
+
+        armDeadline(Deadline::KeepAlive);
+
         doRead();
     }
     else
-        m_socket.close();
+        m_stream.close();
 }
 
 void ClientConnection::upgradeWebsocket()
@@ -70,12 +131,81 @@ void ClientConnection::upgradeWebsocket()
 //    ESP_LOGD(TAG, "state changed to RequestLine");
     m_state = State::WebSocket;
 
-    std::make_shared<WebsocketClientConnection>(m_webserver, std::move(m_socket), std::move(m_parsingBuffer), std::move(m_responseHandler))->start();
+    armDeadline(Deadline::None);
+
+    std::make_shared<WebsocketClientConnection>(m_webserver, std::move(m_stream), std::move(m_parsingBuffer), std::move(m_responseHandler),
+                                                std::move(m_admission))->start();
+}
+
+void ClientConnection::armDeadline(Deadline deadline)
+{
+    m_deadline = deadline;
+
+    const auto timeout = [&]() -> std::chrono::milliseconds {
+        switch (deadline)
+        {
+        case Deadline::Handshake:     return m_webserver.handshakeTimeout();
+        case Deadline::RequestHeader: return m_webserver.requestHeaderTimeout();
+        case Deadline::RequestBody:   return m_webserver.requestBodyTimeout();
+        case Deadline::KeepAlive:     return m_webserver.keepAliveTimeout();
+        default:                      return {};
+        }
+    }();
+
+    if (timeout.count() > 0)
+        m_deadlineTimer.expiresAfter(timeout);
+    else
+        m_deadlineTimer.cancel();
+}
+
+void ClientConnection::deadlineExpired()
+{
+    ESP_LOGI(TAG, "%s timeout (%s:%hi)",
+             m_deadline == Deadline::Handshake ? "handshake" :
+             m_deadline == Deadline::RequestHeader ? "request header" :
+             m_deadline == Deadline::RequestBody ? "request body" :
+             m_deadline == Deadline::KeepAlive ? "keep-alive" : "unknown",
+             m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+    m_deadline = Deadline::None;
+
+    std::error_code ec;
+    m_stream.close(ec);
+}
+
+void ClientConnection::pauseReading()
+{
+    m_readingPaused = true;
+}
+
+void ClientConnection::resumeReading()
+{
+    if (!m_readingPaused)
+        return;
+
+    m_readingPaused = false;
+
+    if (m_readDeferred)
+    {
+        m_readDeferred = false;
+        doRead();
+    }
+}
+
+std::string ClientConnection::takeBufferedData()
+{
+    return std::exchange(m_parsingBuffer, {});
 }
 
 void ClientConnection::doRead()
 {
-    m_socket.async_read_some(asio::buffer(m_receiveBuffer, max_length),
+    if (m_readingPaused)
+    {
+        m_readDeferred = true;
+        return;
+    }
+
+    m_stream.async_read_some(asio::buffer(m_receiveBuffer, max_length),
                              [this, self=shared_from_this()](std::error_code ec, std::size_t length)
                              { readyRead(ec, length); });
 }
@@ -89,48 +219,62 @@ void ClientConnection::readyRead(std::error_code ec, std::size_t length)
         return;
     }
 
+    // first bytes of the next request on a kept alive connection
+    if (m_deadline == Deadline::KeepAlive)
+        armDeadline(Deadline::RequestHeader);
+
     if (m_state == State::RequestBody)
     {
         if (!m_responseHandler)
         {
             ESP_LOGW(TAG, "invalid response handler (%s:%hi)",
                      m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-            m_socket.close();
+            m_stream.close();
             return;
         }
 
-        if (!m_requestBodySize)
-            goto requestFinished;
-        else
+        const auto size = std::min(length, m_requestBodySize);
+        if (size)
         {
-            if (length <= m_requestBodySize)
-            {
-                m_responseHandler->requestBodyReceived({m_receiveBuffer, length});
-                m_requestBodySize -= length;
-                length = 0;
-
-                if (!m_requestBodySize)
-                    goto requestFinished;
-            }
-            else
-            {
-                m_responseHandler->requestBodyReceived({m_receiveBuffer, m_requestBodySize});
-                // TODO how to erase from m_receiveBuffer ?
-                m_requestBodySize = 0;
-                goto requestFinished;
-            }
-
-requestFinished:
-//            ESP_LOGV(TAG, "state changed to Response");
-            m_state = State::Response;
+            m_responseHandler->requestBodyReceived({m_receiveBuffer, size});
+            m_requestBodySize -= size;
+        }
 
-            m_responseHandler->sendResponse();
+        if (m_requestBodySize)
+        {
+            doRead();
+            return;
         }
+
+        // whatever follows the body belongs to the next request
+        m_parsingBuffer.append(m_receiveBuffer + size, length - size);
+        requestFinished();
+        return;
     }
 
 //    ESP_LOGV(TAG, "received: %zd \"%.*s\"", length, length, m_receiveBuffer);
     m_parsingBuffer.append(m_receiveBuffer, length);
 
+    // h2c with prior knowledge starts with the connection preface instead of a request
+    if (m_state == State::RequestLine && !m_stream.http2() && m_webserver.http2Settings().priorKnowledge)
+    {
+        constexpr auto preface = Http2Connection::preface;
+        const auto size = std::min(m_parsingBuffer.size(), preface.size());
+        if (std::string_view{m_parsingBuffer}.substr(0, size) == preface.substr(0, size))
+        {
+            if (size == preface.size())
+                startHttp2();
+            else
+                doRead();
+            return;
+        }
+    }
+
+    parseBufferedLines();
+}
+
+void ClientConnection::parseBufferedLines()
+{
     bool shouldDoRead{true};
 
     while (true)
@@ -147,7 +291,10 @@ requestFinished:
         m_parsingBuffer.erase(std::begin(m_parsingBuffer), std::next(std::begin(m_parsingBuffer), line.size() + newLine.size()));
 
         if (!readyReadLine(line))
+        {
             shouldDoRead = false;
+            break;
+        }
     }
 
     if (shouldDoRead)
@@ -185,11 +332,18 @@ bool ClientConnection::parseRequestLine(std::string_view line)
 {
 //    ESP_LOGV(TAG, "%.*s", line.size(), line.data());
 
+    // every HTTP/2 stream comes through here as well
+    if (!m_webserver.admissionControl().takeRequest(m_remote_endpoint.address()))
+    {
+        rejectRequest();
+        return false;
+    }
+
     if (const auto index = line.find(' '); index == std::string::npos)
     {
         ESP_LOGW(TAG, "invalid request line (1): \"%.*s\" (%s:%hi)", line.size(), line.data(),
                  m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-        m_socket.close();
+        m_stream.close();
         return false;
     }
     else
@@ -201,7 +355,7 @@ bool ClientConnection::parseRequestLine(std::string_view line)
         {
             ESP_LOGW(TAG, "invalid request line (2): \"%.*s\" (%s:%hi)", line.size(), line.data(),
                      m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-            m_socket.close();
+            m_stream.close();
             return false;
         }
         else
@@ -218,13 +372,15 @@ bool ClientConnection::parseRequestLine(std::string_view line)
                 ESP_LOGW(TAG, "invalid response handler method=\"%.*s\" path=\"%.*s\" protocol=\"%.*s\" (%s:%hi)",
                          method.size(), method.data(), path.size(), path.data(), protocol.size(), protocol.data(),
                          m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-                m_socket.close();
+                m_stream.close();
                 return false;
             }
 
 //            ESP_LOGV(TAG, "state changed to RequestHeaders");
             m_state = State::RequestHeaders;
 
+            m_websocketUpgrade.reset();
+
             return true;
         }
     }
@@ -241,7 +397,7 @@ bool ClientConnection::parseRequestHeader(std::string_view line)
         {
             ESP_LOGW(TAG, "invalid request header: %zd \"%.*s\" (%s:%hi)", line.size(), line.size(), line.data(),
                      m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-            m_socket.close();
+            m_stream.close();
             return false;
         }
         else
@@ -257,7 +413,7 @@ bool ClientConnection::parseRequestHeader(std::string_view line)
                 {
                     ESP_LOGW(TAG, "invalid Content-Length %.*s %.*s", value.size(), value.data(),
                              parsed.error().size(), parsed.error().data());
-                    m_socket.close();
+                    m_stream.close();
                     return false;
                 }
                 else
@@ -268,10 +424,12 @@ bool ClientConnection::parseRequestHeader(std::string_view line)
             {
                 ESP_LOGW(TAG, "invalid response handler (%s:%hi)",
                          m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-                m_socket.close();
+                m_stream.close();
                 return false;
             }
 
+            m_websocketUpgrade.headerReceived(key, value);
+
             m_responseHandler->requestHeaderReceived(key, value);
             return true;
         }
@@ -282,7 +440,7 @@ bool ClientConnection::parseRequestHeader(std::string_view line)
         {
             ESP_LOGW(TAG, "invalid response handler (%s:%hi)",
                      m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
-            m_socket.close();
+            m_stream.close();
             return false;
         }
 
@@ -291,6 +449,8 @@ bool ClientConnection::parseRequestHeader(std::string_view line)
 //            ESP_LOGV(TAG, "state changed to RequestBody");
             m_state = State::RequestBody;
 
+            armDeadline(Deadline::RequestBody);
+
             if (!m_parsingBuffer.empty())
             {
                 if (m_parsingBuffer.size() <= m_requestBodySize)
@@ -318,12 +478,100 @@ bool ClientConnection::parseRequestHeader(std::string_view line)
         else
         {
 requestFinished:
-//            ESP_LOGV(TAG, "state changed to Response");
-            m_state = State::Response;
-
-            m_responseHandler->sendResponse();
+            requestFinished();
 
             return false;
         }
     }
 }
+
+void ClientConnection::requestFinished()
+{
+//    ESP_LOGV(TAG, "state changed to Response");
+    m_state = State::Response;
+
+    armDeadline(Deadline::None);
+
+    if (m_websocketUpgrade.requested() && m_responseHandler->acceptsWebsocketUpgrade())
+        acceptWebsocket();
+    else
+        m_responseHandler->sendResponse();
+}
+
+void ClientConnection::rejectRequest()
+{
+    ESP_LOGI(TAG, "too many requests (%s:%hi)",
+             m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+    m_state = State::Response;
+
+    armDeadline(Deadline::None);
+
+    const auto &admissionControl = m_webserver.admissionControl();
+    if (admissionControl.settings().rejection == AdmissionRejection::Close)
+    {
+        std::error_code ec;
+        m_stream.close(ec);
+        return;
+    }
+
+    const auto response = admissionControl.tooManyRequestsResponse();
+    asio::async_write(m_stream,
+                      asio::buffer(response.data(), response.size()),
+                      [this, self=shared_from_this()](std::error_code ec, std::size_t length)
+                      { std::error_code close_error; m_stream.close(close_error); });
+}
+
+void ClientConnection::acceptWebsocket()
+{
+    if (!m_websocketUpgrade.valid())
+    {
+        ESP_LOGW(TAG, "invalid websocket upgrade request (%s:%hi)",
+                 m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+        asio::async_write(m_stream,
+                          asio::buffer(websocketBadRequest.data(), websocketBadRequest.size()),
+                          [this, self=shared_from_this()](std::error_code ec, std::size_t length)
+                          { std::error_code close_error; m_stream.close(close_error); });
+        return;
+    }
+
+    WebsocketUpgradeRequest::ResponseBuffer response;
+    const auto size = m_websocketUpgrade.writeResponse(response);
+
+    // the 101 response practically always fits into the socket send buffer,
+    // only if it does not the rest has to be copied for an async write
+    std::error_code ec;
+    const std::size_t written = m_stream.tryWrite(asio::buffer(response.data(), size), ec);
+
+    if (ec)
+    {
+        ESP_LOGW(TAG, "error: %i (%s:%hi)", ec.value(),
+                 m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        m_stream.close(ec);
+        return;
+    }
+
+    if (written == size)
+    {
+        upgradeWebsocket();
+        return;
+    }
+
+    m_upgradeResponse.assign(response.data() + written, size - written);
+
+    asio::async_write(m_stream,
+                      asio::buffer(m_upgradeResponse.data(), m_upgradeResponse.size()),
+                      [this, self=shared_from_this()](std::error_code ec, std::size_t length)
+                      {
+                          if (ec)
+                          {
+                              ESP_LOGW(TAG, "error: %i (%s:%hi)", ec.value(),
+                                       m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+                              m_stream.close(ec);
+                              return;
+                          }
+
+                          upgradeWebsocket();
+                      });
+}
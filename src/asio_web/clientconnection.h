@@ -8,47 +8,84 @@
 // esp-idf includes
 #include <asio.hpp>
 
+// local includes
+#include "admissioncontrol.h"
+#include "clientstream.h"
+#include "timerwheel.h"
+#include "websockethandshake.h"
+
 class Webserver;
 class ResponseHandler;
 
 class ClientConnection : public std::enable_shared_from_this<ClientConnection>
 {
 public:
-    ClientConnection(Webserver &webserver, asio::ip::tcp::socket socket);
+    // the ticket counts the connection for the admission control, empty for HTTP/2 streams
+    ClientConnection(Webserver &webserver, ClientStream &&stream, AdmissionControl::Ticket &&admission = {});
     ~ClientConnection();
 
     Webserver &webserver() { return m_webserver; }
     const Webserver &webserver() const { return m_webserver; }
 
-    asio::ip::tcp::socket &socket() { return m_socket; }
-    const asio::ip::tcp::socket &socket() const { return m_socket; }
+    ClientStream &stream() { return m_stream; }
+    const ClientStream &stream() const { return m_stream; }
 
     const asio::ip::tcp::endpoint &remote_endpoint() const { return m_remote_endpoint; }
 
+    // tls connections handshake first, the request is read afterwards
     void start();
     void responseFinished(std::error_code ec);
     void upgradeWebsocket();
 
+    // for handlers which forward the request body somewhere slower, no
+    // more of it is read until resumeReading()
+    void pauseReading();
+    void resumeReading();
+
+    // bytes received after the request, for handlers which take the socket over
+    std::string takeBufferedData();
+
 private:
+    enum class Deadline { None, Handshake, RequestHeader, RequestBody, KeepAlive };
+    void armDeadline(Deadline deadline);
+    void deadlineExpired();
+
+    void handshakeFinished(std::error_code ec);
+    void startHttp2();
+
     void doRead();
     void readyRead(std::error_code ec, std::size_t length);
+    void parseBufferedLines();
     bool readyReadLine(std::string_view line);
     bool parseRequestLine(std::string_view line);
     bool parseRequestHeader(std::string_view line);
+    void requestFinished();
+    void rejectRequest();
+    void acceptWebsocket();
 
     Webserver &m_webserver;
-    asio::ip::tcp::socket m_socket;
+    ClientStream m_stream;
     const asio::ip::tcp::endpoint m_remote_endpoint;
+    AdmissionControl::Ticket m_admission;
 
     static constexpr const std::size_t max_length = 1024;
     char m_receiveBuffer[max_length];
 
     std::string m_parsingBuffer;
 
+    bool m_readingPaused{};
+    bool m_readDeferred{};
+
     enum class State { RequestLine, RequestHeaders, RequestBody, Response, WebSocket };
     State m_state { State::RequestLine };
 
     std::size_t m_requestBodySize{};
 
     std::unique_ptr<ResponseHandler> m_responseHandler;
+
+    WebsocketUpgradeRequest m_websocketUpgrade;
+    std::string m_upgradeResponse; // only if the 101 response could not be written at once
+
+    TimerWheel::Timer m_deadlineTimer;
+    Deadline m_deadline{Deadline::None};
 };
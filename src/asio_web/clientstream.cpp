@@ -0,0 +1,96 @@
+#include "clientstream.h"
+
+// system includes
+#include <type_traits>
+
+// local includes
+#include "sslclientcontext.h"
+
+bool ClientStream::secure() const
+{
+    if (const auto channel = std::get_if<Http2Channel>(&m_stream))
+        return channel->secure();
+    return std::holds_alternative<SslStream>(m_stream);
+}
+
+std::string_view ClientStream::alpnProtocol()
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    if (const auto ssl = sslStream())
+    {
+        const unsigned char *data{};
+        unsigned int length{};
+        SSL_get0_alpn_selected(ssl->native_handle(), &data, &length);
+        if (data)
+            return {reinterpret_cast<const char *>(data), length};
+    }
+#endif
+    return {};
+}
+
+asio::ip::tcp::endpoint ClientStream::remote_endpoint(std::error_code &ec) const
+{
+    return std::visit([&](const auto &stream){
+        const auto endpoint = lowestLayer(stream).remote_endpoint(ec);
+        if constexpr (std::is_same_v<std::remove_const_t<decltype(endpoint)>, asio::ip::tcp::endpoint>)
+            return endpoint;
+        else
+            return asio::ip::tcp::endpoint{asio::ip::address_v4::loopback(), 0};
+    }, m_stream);
+}
+
+bool ClientStream::is_open() const
+{
+    return std::visit([](const auto &stream){ return lowestLayer(stream).is_open(); }, m_stream);
+}
+
+void ClientStream::close(std::error_code &ec)
+{
+    std::visit([&](auto &stream){ lowestLayer(stream).close(ec); }, m_stream);
+}
+
+void ClientStream::shutdown(std::error_code &ec)
+{
+    std::visit([&](auto &stream){ lowestLayer(stream).shutdown(asio::ip::tcp::socket::shutdown_both, ec); }, m_stream);
+}
+
+void ClientStream::shutdownSend(std::error_code &ec)
+{
+    std::visit([&](auto &stream){ lowestLayer(stream).shutdown(asio::ip::tcp::socket::shutdown_send, ec); }, m_stream);
+}
+
+std::size_t ClientStream::tryWrite(asio::const_buffer buffer, std::error_code &ec)
+{
+    const auto write = [&](auto &socket) -> std::size_t {
+        // the synchronous operations of the owner keep their mode
+        const bool wasNonBlocking = socket.non_blocking();
+        if (!wasNonBlocking)
+        {
+            socket.non_blocking(true, ec);
+            if (ec)
+                return 0;
+        }
+
+        const auto written = socket.write_some(buffer, ec);
+        if (ec == asio::error::would_block)
+            ec = {};
+
+        if (!wasNonBlocking)
+        {
+            std::error_code restore_error;
+            socket.non_blocking(false, restore_error);
+        }
+
+        return written;
+    };
+
+    if (const auto socket = std::get_if<asio::ip::tcp::socket>(&m_stream))
+        return write(*socket);
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    if (const auto socket = std::get_if<LocalSocket>(&m_stream))
+        return write(*socket);
+#endif
+
+    ec = {};
+    return 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+
+// esp-idf includes
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+// local includes
+#include "http2channel.h"
+#include "memorystream.h"
+
+// The transport of a ClientConnection or WebsocketClientConnection, a plain
+// tcp or unix domain socket, a tls stream over tcp, a stream of an HTTP/2 connection
+// (only for ClientConnection) or an in-memory pipe for benchmarks and
+// tests. Models asio's AsyncReadStream and AsyncWriteStream, so handlers
+// write with asio::async_write() without knowing which one it is.
+// Dispatching is a switch over the alternatives, no virtual call and no
+// allocation per operation.
+class ClientStream
+{
+public:
+    using executor_type = asio::any_io_executor;
+    using SslStream = asio::ssl::stream<asio::ip::tcp::socket>;
+
+    explicit ClientStream(asio::ip::tcp::socket &&socket) :
+        m_stream{std::in_place_type<asio::ip::tcp::socket>, std::move(socket)}
+    {}
+
+    ClientStream(asio::ip::tcp::socket &&socket, asio::ssl::context &context) :
+        m_stream{std::in_place_type<SslStream>, std::move(socket), context}
+    {}
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    using LocalSocket = asio::local::stream_protocol::socket;
+
+    explicit ClientStream(LocalSocket &&socket) :
+        m_stream{std::in_place_type<LocalSocket>, std::move(socket)}
+    {}
+#endif
+
+    explicit ClientStream(Http2Channel &&channel) :
+        m_stream{std::in_place_type<Http2Channel>, std::move(channel)}
+    {}
+
+    explicit ClientStream(MemoryStream &&stream) :
+        m_stream{std::in_place_type<MemoryStream>, std::move(stream)}
+    {}
+
+    executor_type get_executor() { return std::visit([](auto &stream){ return stream.get_executor(); }, m_stream); }
+
+    template<typename MutableBufferSequence, typename ReadToken>
+    auto async_read_some(const MutableBufferSequence &buffers, ReadToken &&token)
+    {
+        return asio::async_initiate<ReadToken, void(std::error_code, std::size_t)>([this](auto handler, const MutableBufferSequence &buffers){
+            std::visit([&](auto &stream){ stream.async_read_some(buffers, std::move(handler)); }, m_stream);
+        }, token, buffers);
+    }
+
+    template<typename ConstBufferSequence, typename WriteToken>
+    auto async_write_some(const ConstBufferSequence &buffers, WriteToken &&token)
+    {
+        return asio::async_initiate<WriteToken, void(std::error_code, std::size_t)>([this](auto handler, const ConstBufferSequence &buffers){
+            std::visit([&](auto &stream){ stream.async_write_some(buffers, std::move(handler)); }, m_stream);
+        }, token, buffers);
+    }
+
+    bool secure() const;
+    // nullptr for plain connections and HTTP/2 streams
+    SslStream *sslStream() { return std::get_if<SslStream>(&m_stream); }
+
+    bool http2() const { return std::holds_alternative<Http2Channel>(m_stream); }
+
+    // the protocol selected with alpn, empty for plain connections or if the client offered none
+    std::string_view alpnProtocol();
+
+    // unix domain socket peers have no address, they show up as 127.0.0.1:0
+    asio::ip::tcp::endpoint remote_endpoint(std::error_code &ec) const;
+
+    // applied to the socket below, ignored for HTTP/2 streams and pipes.
+    // tcp options fail on unix domain sockets.
+    template<typename SettableSocketOption>
+    void set_option(const SettableSocketOption &option, std::error_code &ec)
+    {
+        std::visit([&](auto &stream){ lowestLayer(stream).set_option(option, ec); }, m_stream);
+    }
+
+    bool is_open() const;
+    void close(std::error_code &ec);
+    void close() { std::error_code ec; close(ec); asio::detail::throw_error(ec, "close"); }
+
+    // the tcp socket only, no tls close_notify is sent
+    void shutdown(std::error_code &ec);
+    void shutdownSend(std::error_code &ec);
+
+    // writes what fits into the socket send buffer without blocking, for
+    // small responses which are written from a temporary. Always 0 without
+    // a plain socket, a tls record could not be retried partially.
+    std::size_t tryWrite(asio::const_buffer buffer, std::error_code &ec);
+
+private:
+    // the tcp socket, channels and pipes have the socket operations themselves
+    template<typename Stream>
+    static auto &lowestLayer(Stream &stream)
+    {
+        if constexpr (requires { stream.lowest_layer(); })
+            return stream.lowest_layer();
+        else
+            return stream;
+    }
+
+    std::variant<asio::ip::tcp::socket, SslStream, Http2Channel, MemoryStream
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+                 , LocalSocket
+#endif
+                 > m_stream;
+};
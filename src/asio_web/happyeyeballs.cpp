@@ -0,0 +1,148 @@
+#include "happyeyeballs.h"
+
+// system includes
+#include <algorithm>
+
+// esp-idf includes
+#include <esp_log.h>
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEB";
+} // namespace
+
+HappyEyeballsConnector::HappyEyeballsConnector(asio::io_context &io_context, Callback callback, void *context) :
+    m_io_context{io_context},
+    m_callback{callback},
+    m_context{context},
+    m_timer{io_context}
+{
+}
+
+void HappyEyeballsConnector::connect(const std::vector<asio::ip::tcp::endpoint> &endpoints)
+{
+    cancel();
+
+    m_endpoints = interleave(endpoints);
+    m_next = 0;
+    m_lastError = asio::error::host_not_found;
+    m_connecting = true;
+
+    if (!startAttempt())
+    {
+        // never call back from within connect()
+        asio::post(m_io_context, [this, guard=m_generation, generation=*m_generation](){
+            if (*guard == generation)
+                finish(m_lastError, 0);
+        });
+    }
+}
+
+void HappyEyeballsConnector::cancel()
+{
+    if (!m_connecting)
+        return;
+
+    m_connecting = false;
+    ++*m_generation;
+    m_timer.cancel();
+    closeAll();
+}
+
+std::vector<asio::ip::tcp::endpoint> HappyEyeballsConnector::interleave(const std::vector<asio::ip::tcp::endpoint> &endpoints)
+{
+    if (endpoints.empty())
+        return {};
+
+    const bool firstV6 = endpoints.front().address().is_v6();
+
+    std::vector<asio::ip::tcp::endpoint> first, second;
+    for (const auto &endpoint : endpoints)
+        (endpoint.address().is_v6() == firstV6 ? first : second).push_back(endpoint);
+
+    std::vector<asio::ip::tcp::endpoint> result;
+    result.reserve(endpoints.size());
+    for (std::size_t i = 0; i < std::max(first.size(), second.size()); i++)
+    {
+        if (i < first.size())
+            result.push_back(first[i]);
+        if (i < second.size())
+            result.push_back(second[i]);
+    }
+
+    return result;
+}
+
+bool HappyEyeballsConnector::startAttempt()
+{
+    if (m_next >= m_endpoints.size())
+        return false;
+
+    const auto &endpoint = m_endpoints[m_next++];
+    ESP_LOGD(TAG, "connecting to %s:%hu", endpoint.address().to_string().c_str(), endpoint.port());
+
+    const std::size_t index = m_sockets.size();
+    auto &socket = m_sockets.emplace_back(m_io_context);
+    m_pending++;
+    socket.async_connect(endpoint, [this, guard=m_generation, generation=*m_generation, index](const std::error_code &error){
+        if (*guard == generation)
+            onAttempt(index, error);
+    });
+
+    // the next attempt does not wait for this one to time out
+    if (m_next < m_endpoints.size())
+    {
+        m_timer.expires_after(m_attemptDelay);
+        m_timer.async_wait([this, guard=m_generation, generation=*m_generation](const std::error_code &error){
+            if (!error && *guard == generation)
+                startAttempt();
+        });
+    }
+    else
+        m_timer.cancel();
+
+    return true;
+}
+
+void HappyEyeballsConnector::onAttempt(std::size_t index, const std::error_code &error)
+{
+    m_pending--;
+
+    if (!error)
+    {
+        finish(error, index);
+        return;
+    }
+
+    ESP_LOGD(TAG, "attempt %zu failed: %s", index, error.message().c_str());
+    m_lastError = error;
+
+    // a failed attempt starts the next one right away
+    if (!startAttempt() && !m_pending)
+        finish(m_lastError, 0);
+}
+
+void HappyEyeballsConnector::finish(const std::error_code &error, std::size_t winner)
+{
+    m_connecting = false;
+    ++*m_generation;
+    m_timer.cancel();
+
+    asio::ip::tcp::socket socket{m_io_context};
+    if (!error)
+        socket = std::move(m_sockets[winner]);
+
+    closeAll();
+
+    m_callback(m_context, error, std::move(socket));
+}
+
+void HappyEyeballsConnector::closeAll()
+{
+    for (auto &socket : m_sockets)
+    {
+        std::error_code close_error;
+        socket.close(close_error);
+    }
+    m_sockets.clear();
+    m_pending = 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// system includes
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// Happy eyeballs (RFC 8305) tcp connector. Instead of trying the resolved
+// endpoints one after another, where an unreachable address family costs
+// a whole tcp timeout, a new attempt is started every attemptDelay (or as
+// soon as the previous one failed) while the earlier ones keep running.
+// The first connected socket wins, all others are closed.
+// Like TimerWheel::Timer the callback is a function pointer plus context.
+class HappyEyeballsConnector
+{
+public:
+    using Callback = void (*)(void *context, const std::error_code &error, asio::ip::tcp::socket &&socket);
+
+    static constexpr std::chrono::milliseconds defaultAttemptDelay{250};
+
+    HappyEyeballsConnector(asio::io_context &io_context, Callback callback, void *context);
+    ~HappyEyeballsConnector() { cancel(); }
+
+    HappyEyeballsConnector(const HappyEyeballsConnector &) = delete;
+    HappyEyeballsConnector &operator=(const HappyEyeballsConnector &) = delete;
+
+    std::chrono::milliseconds attemptDelay() const { return m_attemptDelay; }
+    void setAttemptDelay(std::chrono::milliseconds attemptDelay) { m_attemptDelay = attemptDelay; }
+
+    // the callback is invoked exactly once, with the connected socket or
+    // the error of the last attempt, unless cancel() is called before
+    void connect(const std::vector<asio::ip::tcp::endpoint> &endpoints);
+    void cancel();
+
+    bool connecting() const { return m_connecting; }
+
+    // RFC 8305 section 4: alternates the address families, starting with
+    // the one of the first endpoint (getaddrinfo sorts by RFC 6724 already)
+    static std::vector<asio::ip::tcp::endpoint> interleave(const std::vector<asio::ip::tcp::endpoint> &endpoints);
+
+private:
+    bool startAttempt();
+    void onAttempt(std::size_t index, const std::error_code &error);
+    void finish(const std::error_code &error, std::size_t winner);
+    void closeAll();
+
+    asio::io_context &m_io_context;
+    const Callback m_callback;
+    void * const m_context;
+
+    std::chrono::milliseconds m_attemptDelay{defaultAttemptDelay};
+    // the timer wheel is too coarse for the attempt delay
+    asio::steady_timer m_timer;
+
+    std::vector<asio::ip::tcp::endpoint> m_endpoints;
+    std::size_t m_next{};
+
+    // one per started attempt, a deque does not move them while connecting
+    std::deque<asio::ip::tcp::socket> m_sockets;
+    std::size_t m_pending{};
+    std::error_code m_lastError;
+
+    // completions of an earlier connect() or of cancelled attempts are
+    // ignored. Shared with the pending completions because closing the
+    // sockets only aborts them, they may still run after the destructor.
+    const std::shared_ptr<uint32_t> m_generation{std::make_shared<uint32_t>()};
+    bool m_connecting{};
+};
@@ -0,0 +1,434 @@
+#include "hpack.h"
+
+// system includes
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace {
+constexpr std::array<std::pair<std::string_view, std::string_view>, HpackTable::staticEntries> staticTable {{
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+    {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+    {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""},
+    {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+    {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+    {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""},
+    {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""},
+    {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""},
+    {"last-modified", ""}, {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+    {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""}, {"retry-after", ""},
+    {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""},
+    {"user-agent", ""}, {"vary", ""}, {"via", ""}, {"www-authenticate", ""},
+}};
+
+// bit lengths of the huffman codes of RFC 7541 Appendix B, the code is
+// canonical so the codes themselves follow from the lengths
+constexpr uint8_t huffmanLengths[257] {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6, 5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5, 6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23, 24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23, 21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25, 19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23, 26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+constexpr std::size_t maxHuffmanLength{30};
+constexpr uint16_t huffmanEos{256};
+
+struct HuffmanTable
+{
+    uint32_t codes[257]{};
+
+    // symbols ordered by code, per length the first code and where its
+    // symbols start
+    uint16_t symbols[257]{};
+    uint32_t firstCode[maxHuffmanLength + 1]{};
+    uint16_t firstIndex[maxHuffmanLength + 1]{};
+    uint16_t count[maxHuffmanLength + 1]{};
+};
+
+constexpr HuffmanTable makeHuffmanTable()
+{
+    HuffmanTable table;
+
+    for (const auto length : huffmanLengths)
+        table.count[length]++;
+
+    uint32_t code{};
+    uint16_t index{};
+    for (std::size_t length = 1; length <= maxHuffmanLength; length++)
+    {
+        code <<= 1;
+        table.firstCode[length] = code;
+        table.firstIndex[length] = index;
+
+        for (uint16_t symbol = 0; symbol < 257; symbol++)
+            if (huffmanLengths[symbol] == length)
+            {
+                table.codes[symbol] = code++;
+                table.symbols[index++] = symbol;
+            }
+    }
+
+    return table;
+}
+
+constexpr HuffmanTable huffman = makeHuffmanTable();
+
+static_assert(huffman.codes['0'] == 0x0);
+static_assert(huffman.codes['a'] == 0x3);
+static_assert(huffman.codes[huffmanEos] == 0x3fffffff);
+
+void encodeString(std::string_view str, std::string &out)
+{
+    if (const auto size = hpack::huffmanEncodedSize(str); size < str.size())
+    {
+        hpack::encodeInteger(size, 7, 0x80, out);
+        hpack::huffmanEncode(str, out);
+    }
+    else
+    {
+        hpack::encodeInteger(str.size(), 7, 0x00, out);
+        out += str;
+    }
+}
+} // namespace
+
+const HpackHeader *HpackTable::get(std::size_t index) const
+{
+    if (!index)
+        return nullptr;
+
+    if (index <= staticEntries)
+    {
+        // built once, the static table is shared by all connections
+        static const auto entries = [](){
+            std::array<HpackHeader, staticEntries> entries;
+            for (std::size_t i = 0; i < staticEntries; i++)
+                entries[i] = HpackHeader{std::string{staticTable[i].first}, std::string{staticTable[i].second}};
+            return entries;
+        }();
+        return &entries[index - 1];
+    }
+
+    index -= staticEntries + 1;
+    if (index >= m_entries.size())
+        return nullptr;
+    return &m_entries[index];
+}
+
+std::size_t HpackTable::find(std::string_view name, std::string_view value, bool &valueMatches) const
+{
+    std::size_t nameIndex{};
+
+    for (std::size_t i = 0; i < staticEntries; i++)
+        if (staticTable[i].first == name)
+        {
+            if (staticTable[i].second == value)
+            {
+                valueMatches = true;
+                return i + 1;
+            }
+            if (!nameIndex)
+                nameIndex = i + 1;
+        }
+
+    for (std::size_t i = 0; i < m_entries.size(); i++)
+        if (m_entries[i].name == name)
+        {
+            if (m_entries[i].value == value)
+            {
+                valueMatches = true;
+                return staticEntries + 1 + i;
+            }
+            if (!nameIndex)
+                nameIndex = staticEntries + 1 + i;
+        }
+
+    valueMatches = false;
+    return nameIndex;
+}
+
+void HpackTable::insert(std::string_view name, std::string_view value)
+{
+    const auto size = entrySize(name, value);
+
+    // an entry larger than the table empties it (RFC 7541 4.4)
+    if (size > m_maxSize)
+    {
+        m_entries.clear();
+        m_size = 0;
+        return;
+    }
+
+    evict(m_maxSize - size);
+    m_entries.push_front(HpackHeader{std::string{name}, std::string{value}});
+    m_size += size;
+}
+
+void HpackTable::setMaxSize(std::size_t maxSize)
+{
+    m_maxSize = maxSize;
+    evict(maxSize);
+}
+
+void HpackTable::evict(std::size_t required)
+{
+    while (m_size > required && !m_entries.empty())
+    {
+        m_size -= entrySize(m_entries.back().name, m_entries.back().value);
+        m_entries.pop_back();
+    }
+}
+
+bool HpackDecoder::decode(std::string_view block, std::vector<HpackHeader> &headers, std::size_t maxHeaderListSize)
+{
+    const auto first = headers.size();
+    std::size_t listSize{};
+
+    while (!block.empty())
+    {
+        const uint8_t byte = block.front();
+
+        if (byte & 0x80)
+        {
+            // indexed header field
+            uint64_t index;
+            if (!hpack::decodeInteger(block, 7, index))
+                return fail("invalid index");
+            const auto entry = m_table.get(index);
+            if (!entry)
+                return fail("index out of range");
+            headers.push_back(*entry);
+        }
+        else if ((byte & 0xe0) == 0x20)
+        {
+            // dynamic table size update, only in front of the first field
+            uint64_t size;
+            if (!hpack::decodeInteger(block, 5, size))
+                return fail("invalid table size");
+            if (headers.size() != first)
+                return fail("table size update after a header field");
+            if (size > m_maxTableSize)
+                return fail("table size above the limit");
+            m_table.setMaxSize(size);
+            continue;
+        }
+        else
+        {
+            // literal, with incremental indexing (01), without (0000) or never indexed (0001)
+            const bool index = (byte & 0xc0) == 0x40;
+
+            uint64_t nameIndex;
+            if (!hpack::decodeInteger(block, index ? 6 : 4, nameIndex))
+                return fail("invalid name index");
+
+            HpackHeader header;
+            if (nameIndex)
+            {
+                const auto entry = m_table.get(nameIndex);
+                if (!entry)
+                    return fail("name index out of range");
+                header.name = entry->name;
+            }
+            else if (!readString(block, header.name))
+                return false;
+
+            if (!readString(block, header.value))
+                return false;
+
+            if (index)
+                m_table.insert(header.name, header.value);
+
+            headers.push_back(std::move(header));
+        }
+
+        listSize += HpackTable::entrySize(headers.back().name, headers.back().value);
+        if (listSize > maxHeaderListSize)
+            return fail("header list too large");
+    }
+
+    return true;
+}
+
+bool HpackDecoder::readString(std::string_view &block, std::string &str)
+{
+    if (block.empty())
+        return fail("missing string");
+
+    const bool huffmanCoded = uint8_t(block.front()) & 0x80;
+
+    uint64_t length;
+    if (!hpack::decodeInteger(block, 7, length))
+        return fail("invalid string length");
+    if (length > block.size())
+        return fail("string exceeds the block");
+
+    const auto data = block.substr(0, length);
+    block.remove_prefix(length);
+
+    if (!huffmanCoded)
+    {
+        str = data;
+        return true;
+    }
+
+    if (!hpack::huffmanDecode(data, str))
+        return fail("invalid huffman code");
+    return true;
+}
+
+void HpackEncoder::setPeerMaxTableSize(std::size_t size)
+{
+    size = std::min(size, m_maxTableSize);
+    if (size == m_table.maxSize())
+        return;
+
+    m_table.setMaxSize(size);
+    m_sizeUpdatePending = true;
+}
+
+void HpackEncoder::encode(std::string_view name, std::string_view value, std::string &out, bool index)
+{
+    if (m_sizeUpdatePending)
+    {
+        hpack::encodeInteger(m_table.maxSize(), 5, 0x20, out);
+        m_sizeUpdatePending = false;
+    }
+
+    bool valueMatches;
+    const auto found = m_table.find(name, value, valueMatches);
+    if (found && valueMatches)
+    {
+        hpack::encodeInteger(found, 7, 0x80, out);
+        return;
+    }
+
+    index = index && HpackTable::entrySize(name, value) <= m_table.maxSize();
+
+    if (index)
+        hpack::encodeInteger(found, 6, 0x40, out);
+    else
+        hpack::encodeInteger(found, 4, 0x00, out);
+
+    if (!found)
+        encodeString(name, out);
+    encodeString(value, out);
+
+    if (index)
+        m_table.insert(name, value);
+}
+
+namespace hpack {
+void encodeInteger(uint64_t value, uint8_t prefixBits, uint8_t flags, std::string &out)
+{
+    const uint8_t max = (1 << prefixBits) - 1;
+    if (value < max)
+    {
+        out += char(flags | value);
+        return;
+    }
+
+    out += char(flags | max);
+    value -= max;
+    while (value >= 0x80)
+    {
+        out += char((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += char(value);
+}
+
+bool decodeInteger(std::string_view &in, uint8_t prefixBits, uint64_t &value)
+{
+    if (in.empty())
+        return false;
+
+    const uint8_t max = (1 << prefixBits) - 1;
+    value = uint8_t(in.front()) & max;
+    in.remove_prefix(1);
+    if (value < max)
+        return true;
+
+    for (unsigned shift = 0; !in.empty(); shift += 7)
+    {
+        // nothing we accept needs more than 32 bits
+        if (shift > 28)
+            return false;
+
+        const uint8_t byte = in.front();
+        in.remove_prefix(1);
+        value += uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+std::size_t huffmanEncodedSize(std::string_view str)
+{
+    std::size_t bits{};
+    for (const uint8_t ch : str)
+        bits += huffmanLengths[ch];
+    return (bits + 7) / 8;
+}
+
+void huffmanEncode(std::string_view str, std::string &out)
+{
+    uint64_t buffer{};
+    unsigned bits{};
+
+    for (const uint8_t ch : str)
+    {
+        buffer = (buffer << huffmanLengths[ch]) | huffman.codes[ch];
+        bits += huffmanLengths[ch];
+
+        while (bits >= 8)
+        {
+            bits -= 8;
+            out += char(buffer >> bits);
+        }
+    }
+
+    // padded with the most significant bits of eos, all ones
+    if (bits)
+        out += char((buffer << (8 - bits)) | (0xff >> bits));
+}
+
+bool huffmanDecode(std::string_view in, std::string &out)
+{
+    out.clear();
+
+    uint32_t code{};
+    std::size_t length{};
+
+    for (const uint8_t byte : in)
+    {
+        for (int bit = 7; bit >= 0; bit--)
+        {
+            code = (code << 1) | ((byte >> bit) & 1);
+            length++;
+
+            if (code - huffman.firstCode[length] < huffman.count[length])
+            {
+                const auto symbol = huffman.symbols[huffman.firstIndex[length] + code - huffman.firstCode[length]];
+                if (symbol == huffmanEos)
+                    return false;
+                out += char(symbol);
+                code = 0;
+                length = 0;
+            }
+            else if (length == maxHuffmanLength)
+                return false;
+        }
+    }
+
+    // at most 7 bits of padding, which have to be a prefix of eos
+    return length < 8 && code == (uint32_t(1) << length) - 1;
+}
+} // namespace hpack
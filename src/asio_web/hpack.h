@@ -0,0 +1,105 @@
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Header compression of HTTP/2 (RFC 7541). Both directions keep a dynamic
+// table, bounded by the size announced in SETTINGS_HEADER_TABLE_SIZE, the
+// oldest entries are evicted first.
+
+struct HpackHeader
+{
+    std::string name;
+    std::string value;
+};
+
+class HpackTable
+{
+public:
+    explicit HpackTable(std::size_t maxSize) : m_maxSize{maxSize} {}
+
+    static constexpr std::size_t staticEntries{61};
+
+    // 32 bytes overhead per entry (RFC 7541 4.1)
+    static std::size_t entrySize(std::string_view name, std::string_view value) { return name.size() + value.size() + 32; }
+
+    // 1 based, static table first, then the dynamic one newest first
+    const HpackHeader *get(std::size_t index) const;
+
+    // 0 if not found, otherwise the index of an entry with this name and
+    // if possible with the value as well
+    std::size_t find(std::string_view name, std::string_view value, bool &valueMatches) const;
+
+    void insert(std::string_view name, std::string_view value);
+
+    std::size_t size() const { return m_size; }
+    std::size_t maxSize() const { return m_maxSize; }
+    void setMaxSize(std::size_t maxSize);
+
+private:
+    void evict(std::size_t required);
+
+    std::deque<HpackHeader> m_entries; // newest first
+    std::size_t m_size{};
+    std::size_t m_maxSize;
+};
+
+class HpackDecoder
+{
+public:
+    // the table size we announce, the encoder may pick anything below it
+    explicit HpackDecoder(std::size_t maxTableSize = 4096) :
+        m_table{maxTableSize}, m_maxTableSize{maxTableSize}
+    {}
+
+    // decodes one complete header block, fails if the block is malformed
+    // or the headers are larger than maxHeaderListSize (sizes as in the
+    // table). A failure is a connection error, the table is out of sync.
+    bool decode(std::string_view block, std::vector<HpackHeader> &headers, std::size_t maxHeaderListSize);
+
+    std::string_view error() const { return m_error; }
+
+private:
+    bool fail(std::string_view error) { m_error = error; return false; }
+    bool readString(std::string_view &block, std::string &str);
+
+    HpackTable m_table;
+    const std::size_t m_maxTableSize;
+    std::string_view m_error;
+};
+
+class HpackEncoder
+{
+public:
+    // starts with the default of 4096 until the peer's settings arrive
+    explicit HpackEncoder(std::size_t maxTableSize = 4096) :
+        m_table{std::min<std::size_t>(maxTableSize, 4096)}, m_maxTableSize{maxTableSize}
+    {}
+
+    // the decoder's SETTINGS_HEADER_TABLE_SIZE, we use at most our own
+    // limit and announce the change in front of the next block
+    void setPeerMaxTableSize(std::size_t size);
+
+    // values which change with every response are not worth an entry
+    void encode(std::string_view name, std::string_view value, std::string &out, bool index = true);
+
+private:
+    HpackTable m_table;
+    const std::size_t m_maxTableSize;
+    bool m_sizeUpdatePending{};
+};
+
+namespace hpack {
+void encodeInteger(uint64_t value, uint8_t prefixBits, uint8_t flags, std::string &out);
+bool decodeInteger(std::string_view &in, uint8_t prefixBits, uint64_t &value);
+
+std::size_t huffmanEncodedSize(std::string_view str);
+void huffmanEncode(std::string_view str, std::string &out);
+bool huffmanDecode(std::string_view in, std::string &out);
+} // namespace hpack
@@ -0,0 +1,65 @@
+#include "http2channel.h"
+
+// local includes
+#include "http2connection.h"
+
+asio::ip::tcp::endpoint Http2Channel::remote_endpoint(std::error_code &ec) const
+{
+    if (const auto connection = m_stream->connection)
+    {
+        ec = {};
+        return connection->remote_endpoint();
+    }
+
+    ec = asio::error::not_connected;
+    return {};
+}
+
+bool Http2Channel::is_open() const
+{
+    return m_stream->connection;
+}
+
+void Http2Channel::close(std::error_code &ec)
+{
+    ec = {};
+    if (const auto connection = m_stream->connection)
+        connection->streamClosed(*m_stream);
+}
+
+void Http2Channel::shutdown(asio::socket_base::shutdown_type what, std::error_code &ec)
+{
+    close(ec);
+}
+
+bool Http2Channel::secure() const
+{
+    return m_stream->secure;
+}
+
+void Http2Channel::read(asio::mutable_buffer buffer, Handler &&handler)
+{
+    if (const auto connection = m_stream->connection)
+        connection->streamRead(*m_stream, buffer, std::move(handler));
+    else if (m_stream->reset)
+        handler(asio::error::connection_reset, 0);
+    else
+        handler(asio::error::eof, 0);
+}
+
+void Http2Channel::write(std::string_view data)
+{
+    if (const auto connection = m_stream->connection)
+        connection->streamWrite(*m_stream, data);
+}
+
+void Http2Channel::writeFinished(std::size_t size, Handler &&handler)
+{
+    if (const auto connection = m_stream->connection)
+        connection->streamWriteFinished(*m_stream, size, std::move(handler));
+    // a finished stream is detached with the write completing the response
+    else if (m_stream->reset)
+        handler(asio::error::connection_reset, 0);
+    else
+        handler({}, size);
+}
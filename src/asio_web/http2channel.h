@@ -0,0 +1,93 @@
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// forward declares
+struct Http2Stream;
+
+// One stream of an Http2Connection as seen by the ClientConnection serving
+// it, so response handlers run unchanged on HTTP/2. Reads return the
+// request as HTTP/1.1 (request line, headers, body), what the handler
+// writes is parsed as an HTTP/1.1 response and sent as HEADERS and DATA
+// frames. A write completes once the frames are queued, or later when the
+// flow control window of the stream does not allow more of it.
+//
+// HTTP/1.1 needs the length of a body before the body. Without a
+// content-length header the request body is therefore collected until the
+// stream ends and handed on with a Content-Length of what arrived. The
+// window is not replenished meanwhile, so such a body is capped at one
+// stream window (Http2Settings::initialWindowSize), a larger one resets
+// the stream with INTERNAL_ERROR.
+class Http2Channel
+{
+public:
+    using executor_type = asio::any_io_executor;
+    using Handler = std::move_only_function<void(std::error_code, std::size_t)>;
+
+    Http2Channel(std::shared_ptr<Http2Stream> stream, executor_type executor) :
+        m_stream{std::move(stream)}, m_executor{std::move(executor)}
+    {}
+
+    executor_type get_executor() { return m_executor; }
+
+    template<typename MutableBufferSequence, typename ReadToken>
+    auto async_read_some(const MutableBufferSequence &buffers, ReadToken &&token)
+    {
+        return asio::async_initiate<ReadToken, void(std::error_code, std::size_t)>([this](auto handler, const MutableBufferSequence &buffers){
+            read(*asio::buffer_sequence_begin(buffers), wrap(std::move(handler)));
+        }, token, buffers);
+    }
+
+    template<typename ConstBufferSequence, typename WriteToken>
+    auto async_write_some(const ConstBufferSequence &buffers, WriteToken &&token)
+    {
+        return asio::async_initiate<WriteToken, void(std::error_code, std::size_t)>([this](auto handler, const ConstBufferSequence &buffers){
+            std::size_t size{};
+            for (auto iter = asio::buffer_sequence_begin(buffers); iter != asio::buffer_sequence_end(buffers); ++iter)
+            {
+                const asio::const_buffer buffer{*iter};
+                write({static_cast<const char *>(buffer.data()), buffer.size()});
+                size += buffer.size();
+            }
+            writeFinished(size, wrap(std::move(handler)));
+        }, token, buffers);
+    }
+
+    // the socket operations of ClientStream
+    asio::ip::tcp::endpoint remote_endpoint(std::error_code &ec) const;
+    bool is_open() const;
+    void close(std::error_code &ec);
+    // ends a response delimited by the close, any other response is reset
+    void shutdown(asio::socket_base::shutdown_type what, std::error_code &ec);
+    template<typename SettableSocketOption>
+    void set_option(const SettableSocketOption &, std::error_code &ec) { ec = {}; }
+
+    bool secure() const;
+
+private:
+    // completions are never invoked from within the initiating function
+    template<typename CompletionHandler>
+    Handler wrap(CompletionHandler &&handler)
+    {
+        return [handler=std::move(handler), executor=m_executor](std::error_code ec, std::size_t length) mutable {
+            const auto handlerExecutor = asio::get_associated_executor(handler, executor);
+            asio::post(handlerExecutor, [handler=std::move(handler), ec, length]() mutable { handler(ec, length); });
+        };
+    }
+
+    void read(asio::mutable_buffer buffer, Handler &&handler);
+    void write(std::string_view data);
+    void writeFinished(std::size_t size, Handler &&handler);
+
+    std::shared_ptr<Http2Stream> m_stream;
+    executor_type m_executor;
+};
@@ -0,0 +1,1157 @@
+#include "http2connection.h"
+
+// system includes
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <utility>
+
+// esp-idf includes
+#include <esp_log.h>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <numberparsing.h>
+#include <strutils.h>
+
+// local includes
+#include "clientconnection.h"
+#include "webserver.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEB";
+
+constexpr uint8_t flagEndStream{0x1};
+constexpr uint8_t flagAck{0x1};
+constexpr uint8_t flagEndHeaders{0x4};
+constexpr uint8_t flagPadded{0x8};
+constexpr uint8_t flagPriority{0x20};
+
+enum class Setting : uint16_t { HeaderTableSize = 1, EnablePush, MaxConcurrentStreams, InitialWindowSize, MaxFrameSize, MaxHeaderListSize };
+
+constexpr std::size_t frameHeaderSize{9};
+// the default, we never announce more
+constexpr std::size_t maxFrameSize{16384};
+constexpr uint32_t defaultWindowSize{65535};
+constexpr int64_t maxWindowSize{0x7fffffff};
+
+// DATA frames are only queued while less than this waits for the socket,
+// the rest stays with the streams until the write finished
+constexpr std::size_t sendBufferLimit{64 * 1024};
+// a write of a handler completes once less than this of it waits for window
+constexpr std::size_t writeLowWater{16 * 1024};
+
+uint32_t readUint32(std::string_view data)
+{
+    return uint32_t(uint8_t(data[0])) << 24 | uint32_t(uint8_t(data[1])) << 16 |
+           uint32_t(uint8_t(data[2])) << 8 | uint32_t(uint8_t(data[3]));
+}
+
+void appendUint32(std::string &out, uint32_t value)
+{
+    out += char(value >> 24);
+    out += char(value >> 16);
+    out += char(value >> 8);
+    out += char(value);
+}
+
+// not allowed in HTTP/2 requests (RFC 9113 8.2.2)
+bool connectionSpecific(std::string_view name)
+{
+    for (const std::string_view header : {"connection", "keep-alive", "proxy-connection", "transfer-encoding", "upgrade"})
+        if (name == header)
+            return true;
+    return false;
+}
+
+// only meaningful for the HTTP/1.1 connection the handler thinks it writes to
+bool hopByHop(std::string_view name)
+{
+    for (const std::string_view header : {"Connection", "Keep-Alive", "Proxy-Connection", "Transfer-Encoding", "Upgrade", "TE", "Trailer"})
+        if (cpputils::stringEqualsIgnoreCase(name, header))
+            return true;
+    return false;
+}
+
+// different in every response, an entry in the dynamic table would only evict useful ones
+bool indexable(std::string_view name)
+{
+    return name != "content-length" && name != "date" && name != "set-cookie" && name != "etag";
+}
+
+// the request is handed on as HTTP/1.1 text, nothing may end a line early
+bool validName(std::string_view name)
+{
+    if (name.empty())
+        return false;
+    for (const char ch : name.substr(name.front() == ':' ? 1 : 0))
+        if (ch <= ' ' || ch == ':' || ch >= 0x7f || (ch >= 'A' && ch <= 'Z'))
+            return false;
+    return true;
+}
+
+bool validValue(std::string_view value)
+{
+    return value.find_first_of(std::string_view{"\0\r\n", 3}) == std::string_view::npos;
+}
+} // namespace
+
+Http2Connection::Http2Connection(Webserver &webserver, ClientStream &&stream, std::string &&buffer, AdmissionControl::Ticket &&admission) :
+    m_webserver{webserver},
+    m_stream{std::move(stream)},
+    m_remote_endpoint{[&](){ std::error_code ec; return m_stream.remote_endpoint(ec); }()},
+    m_admission{std::move(admission)},
+    m_settings{m_webserver.http2Settings()},
+    m_parsingBuffer{std::move(buffer)},
+    m_decoder{m_settings.headerTableSize},
+    m_encoder{m_settings.headerTableSize},
+    m_idleTimer{m_webserver.timerWheel(), [](void *context){ static_cast<Http2Connection *>(context)->idleTimeout(); }, this}
+{
+    ESP_LOGI(TAG, "new http2 client (%s:%hi)",
+             m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+}
+
+Http2Connection::~Http2Connection()
+{
+    ESP_LOGI(TAG, "http2 client destroyed (%s:%hi)",
+             m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+    abort();
+}
+
+void Http2Connection::start()
+{
+    constexpr std::pair<Setting, uint32_t Http2Settings::*> settings[] {
+        {Setting::HeaderTableSize, &Http2Settings::headerTableSize},
+        {Setting::MaxConcurrentStreams, &Http2Settings::maxConcurrentStreams},
+        {Setting::InitialWindowSize, &Http2Settings::initialWindowSize},
+        {Setting::MaxHeaderListSize, &Http2Settings::maxHeaderListSize},
+    };
+
+    writeFrameHeader(std::size(settings) * 6, FrameType::Settings, 0, 0);
+    for (const auto &[setting, member] : settings)
+    {
+        m_sendBuffer += char(std::to_underlying(setting) >> 8);
+        m_sendBuffer += char(std::to_underlying(setting));
+        appendUint32(m_sendBuffer, m_settings.*member);
+    }
+
+    // the connection window has no setting, it only grows with WINDOW_UPDATE
+    if (m_settings.connectionWindowSize > defaultWindowSize)
+    {
+        const uint32_t increment = m_settings.connectionWindowSize - defaultWindowSize;
+        writeFrameHeader(4, FrameType::WindowUpdate, 0, 0);
+        appendUint32(m_sendBuffer, increment);
+        m_receiveWindow += increment;
+    }
+
+    armIdleTimer();
+
+    if (!m_parsingBuffer.empty() && !parseFrames())
+        return;
+
+    doWrite();
+    doRead();
+}
+
+void Http2Connection::streamRead(Http2Stream &stream, asio::mutable_buffer buffer, Http2Channel::Handler &&handler)
+{
+    stream.readBuffer = buffer;
+    stream.readHandler = std::move(handler);
+
+    deliverInput(stream);
+
+    // window updates for what the handler consumed
+    doWrite();
+}
+
+void Http2Connection::streamWrite(Http2Stream &stream, std::string_view data)
+{
+    // anything after the response is dropped, as it would be by a client
+    if (stream.responseComplete)
+        return;
+
+    bool parsing{true};
+    while (parsing)
+    {
+        switch (stream.parser.parse(data))
+        {
+        case HttpResponseParser::Event::NeedMore:
+            parsing = false;
+            break;
+        case HttpResponseParser::Event::ResponseLine:
+            stream.responseHeaders.clear();
+            break;
+        case HttpResponseParser::Event::Header:
+            if (!hopByHop(stream.parser.headerKey()))
+            {
+                std::string name{stream.parser.headerKey()};
+                std::transform(std::begin(name), std::end(name), std::begin(name), [](unsigned char ch){ return std::tolower(ch); });
+                stream.responseHeaders.push_back(HpackHeader{std::move(name), std::string{stream.parser.headerValue()}});
+            }
+            break;
+        case HttpResponseParser::Event::HeadersComplete:
+            // interim responses are not forwarded
+            if (stream.parser.status() < 200)
+            {
+                stream.responseHeaders.clear();
+                stream.parser.reset(stream.headRequest);
+                break;
+            }
+            stream.headersComplete = true;
+            break;
+        case HttpResponseParser::Event::Body:
+            if (!stream.headersSent)
+                sendResponseHeaders(stream, false);
+            stream.pending += stream.parser.body();
+            break;
+        case HttpResponseParser::Event::Complete:
+            stream.responseComplete = true;
+            parsing = false;
+            break;
+        case HttpResponseParser::Event::Error:
+            ESP_LOGW(TAG, "invalid response on stream %u: %.*s (%s:%hi)", stream.id,
+                     stream.parser.error().size(), stream.parser.error().data(),
+                     m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+            resetStream(stream, ErrorCode::InternalError, true);
+            doWrite();
+            return;
+        }
+    }
+
+    if (stream.headersComplete && !stream.headersSent)
+        sendResponseHeaders(stream, stream.responseComplete);
+
+    flushStream(stream);
+    doWrite();
+}
+
+void Http2Connection::streamWriteFinished(Http2Stream &stream, std::size_t size, Http2Channel::Handler &&handler)
+{
+    if (stream.pendingSize() <= writeLowWater)
+    {
+        handler({}, size);
+        return;
+    }
+
+    // completed by flushStream() once the peer opened the window
+    stream.writeSize = size;
+    stream.writeHandler = std::move(handler);
+}
+
+void Http2Connection::streamClosed(Http2Stream &stream)
+{
+    // still waiting for window, sent nevertheless
+    if (stream.responseComplete)
+        return;
+
+    // a response delimited by the close
+    if (stream.headersComplete && stream.parser.finish())
+    {
+        stream.responseComplete = true;
+        if (!stream.headersSent)
+            sendResponseHeaders(stream, !stream.pendingSize());
+        flushStream(stream);
+        doWrite();
+        return;
+    }
+
+    resetStream(stream, ErrorCode::InternalError, true);
+    doWrite();
+}
+
+void Http2Connection::doRead()
+{
+    m_stream.async_read_some(asio::buffer(m_receiveBuffer, max_length),
+                             [this, self=shared_from_this()](std::error_code ec, std::size_t length)
+                             { readyRead(ec, length); });
+}
+
+void Http2Connection::readyRead(std::error_code ec, std::size_t length)
+{
+    if (ec)
+    {
+        if (!m_closed)
+            ESP_LOGI(TAG, "error: %i (%s:%hi)", ec.value(),
+                     m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        abort();
+        return;
+    }
+
+    // after our GOAWAY nothing is processed anymore
+    if (m_closed || m_goingAway)
+        return;
+
+    m_parsingBuffer.append(m_receiveBuffer, length);
+
+    if (!parseFrames())
+        return;
+
+    // a peer which does not read its responses (or floods us with pings)
+    // is not read from either until the socket caught up
+    if (m_sendBuffer.size() > 4 * sendBufferLimit)
+        m_readDeferred = true;
+    else
+        doRead();
+}
+
+bool Http2Connection::parseFrames()
+{
+    std::string_view input{m_parsingBuffer};
+
+    while (true)
+    {
+        if (!m_prefaceReceived)
+        {
+            const auto size = std::min(input.size(), preface.size());
+            if (input.substr(0, size) != preface.substr(0, size))
+            {
+                ESP_LOGW(TAG, "invalid connection preface (%s:%hi)",
+                         m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+                abort();
+                return false;
+            }
+            if (size < preface.size())
+                break;
+
+            input.remove_prefix(preface.size());
+            m_prefaceReceived = true;
+        }
+
+        if (input.size() < frameHeaderSize)
+            break;
+
+        const std::size_t length = readUint32(input) >> 8;
+        const auto type = FrameType(input[3]);
+        const uint8_t flags = input[4];
+        const uint32_t streamId = readUint32(input.substr(5)) & 0x7fffffff;
+
+        if (length > maxFrameSize)
+            return connectionError(ErrorCode::FrameSizeError, "frame too large");
+
+        if (input.size() < frameHeaderSize + length)
+            break;
+
+        const auto payload = input.substr(frameHeaderSize, length);
+        input.remove_prefix(frameHeaderSize + length);
+
+        if (!m_settingsReceived && (type != FrameType::Settings || flags & flagAck))
+            return connectionError(ErrorCode::ProtocolError, "first frame is not SETTINGS");
+
+        if (!handleFrame(type, flags, streamId, payload))
+            return false;
+    }
+
+    m_parsingBuffer.erase(0, m_parsingBuffer.size() - input.size());
+
+    // everything queued while parsing goes out with one write
+    doWrite();
+
+    return true;
+}
+
+bool Http2Connection::handleFrame(FrameType type, uint8_t flags, uint32_t streamId, std::string_view payload)
+{
+    if (m_continuationStream && (type != FrameType::Continuation || streamId != m_continuationStream))
+        return connectionError(ErrorCode::ProtocolError, "header block interrupted");
+
+    switch (type)
+    {
+    case FrameType::Data:
+        return handleData(flags, streamId, payload);
+    case FrameType::Headers:
+        return handleHeaders(flags, streamId, payload);
+    case FrameType::Priority:
+        // parsed for errors only, streams are served in order
+        if (!streamId)
+            return connectionError(ErrorCode::ProtocolError, "PRIORITY on stream 0");
+        if (payload.size() != 5)
+            sendRstStream(streamId, ErrorCode::FrameSizeError);
+        return true;
+    case FrameType::RstStream:
+        if (!streamId || streamId > m_lastStreamId)
+            return connectionError(ErrorCode::ProtocolError, "RST_STREAM on an idle stream");
+        if (payload.size() != 4)
+            return connectionError(ErrorCode::FrameSizeError, "invalid RST_STREAM");
+        if (const auto iter = m_streams.find(streamId); iter != std::end(m_streams))
+            resetStream(*iter->second, ErrorCode(readUint32(payload)), false);
+        return true;
+    case FrameType::Settings:
+        if (streamId)
+            return connectionError(ErrorCode::ProtocolError, "SETTINGS on a stream");
+        return handleSettings(flags, payload);
+    case FrameType::PushPromise:
+        return connectionError(ErrorCode::ProtocolError, "PUSH_PROMISE from a client");
+    case FrameType::Ping:
+        if (streamId)
+            return connectionError(ErrorCode::ProtocolError, "PING on a stream");
+        if (payload.size() != 8)
+            return connectionError(ErrorCode::FrameSizeError, "invalid PING");
+        if (!(flags & flagAck))
+        {
+            writeFrameHeader(8, FrameType::Ping, flagAck, 0);
+            m_sendBuffer += payload;
+        }
+        return true;
+    case FrameType::GoAway:
+        if (streamId)
+            return connectionError(ErrorCode::ProtocolError, "GOAWAY on a stream");
+        // the streams already open are still served
+        m_peerGoingAway = true;
+        if (m_streams.empty())
+        {
+            closeAfterWrite();
+            return false;
+        }
+        return true;
+    case FrameType::WindowUpdate:
+        return handleWindowUpdate(streamId, payload);
+    case FrameType::Continuation:
+        if (!m_continuationStream)
+            return connectionError(ErrorCode::ProtocolError, "unexpected CONTINUATION");
+        m_headerBlock += payload;
+        // compressed it is never larger than the decoded list
+        if (m_headerBlock.size() > m_settings.maxHeaderListSize)
+            return connectionError(ErrorCode::EnhanceYourCalm, "header block too large");
+        if (flags & flagEndHeaders)
+        {
+            m_continuationStream = 0;
+            const auto block = std::exchange(m_headerBlock, {});
+            return handleHeaderBlock(m_continuationFlags, streamId, block);
+        }
+        return true;
+    default:
+        // unknown frame types are ignored (RFC 9113 4.1)
+        return true;
+    }
+}
+
+bool Http2Connection::handleData(uint8_t flags, uint32_t streamId, std::string_view payload)
+{
+    if (!streamId)
+        return connectionError(ErrorCode::ProtocolError, "DATA on stream 0");
+
+    // flow control counts the padding as well
+    const auto frameSize = payload.size();
+    m_receiveWindow -= frameSize;
+    if (m_receiveWindow < 0)
+        return connectionError(ErrorCode::FlowControlError, "connection window exceeded");
+
+    if (flags & flagPadded)
+    {
+        if (payload.empty() || uint8_t(payload.front()) >= payload.size())
+            return connectionError(ErrorCode::ProtocolError, "invalid padding");
+        payload = payload.substr(1, payload.size() - 1 - uint8_t(payload.front()));
+    }
+
+    const auto iter = m_streams.find(streamId);
+    if (iter == std::end(m_streams))
+    {
+        if (streamId > m_lastStreamId)
+            return connectionError(ErrorCode::ProtocolError, "DATA on an idle stream");
+
+        // a stream we reset or finished, the client may not know yet
+        creditWindow(nullptr, frameSize);
+        return true;
+    }
+
+    // keep the stream alive, resetting it removes it from m_streams
+    const auto streamPtr = iter->second;
+    auto &stream = *streamPtr;
+
+    if (stream.remoteEnded)
+    {
+        creditWindow(nullptr, frameSize);
+        resetStream(stream, ErrorCode::StreamClosed, true);
+        return true;
+    }
+
+    stream.receiveWindow -= frameSize;
+    if (stream.receiveWindow < 0)
+    {
+        creditWindow(nullptr, frameSize);
+        resetStream(stream, ErrorCode::FlowControlError, true);
+        return true;
+    }
+
+    // the padding never reaches the handler
+    creditWindow(&stream, frameSize - payload.size());
+
+    if (stream.hasContentLength)
+    {
+        if (payload.size() > stream.contentLength)
+        {
+            resetStream(stream, ErrorCode::ProtocolError, true);
+            return true;
+        }
+        stream.contentLength -= payload.size();
+    }
+    else if (!stream.headWritten && stream.receiveWindow <= 0 && !(flags & flagEndStream))
+    {
+        // the body is collected until it is complete, but the window is
+        // all we will ever get without content-length
+        ESP_LOGW(TAG, "request body without content-length exceeds the stream window (%s:%hi)",
+                 m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        resetStream(stream, ErrorCode::InternalError, true);
+        return true;
+    }
+
+    stream.input += payload;
+
+    if (flags & flagEndStream)
+        requestEnded(stream);
+    else
+        deliverInput(stream);
+
+    return true;
+}
+
+bool Http2Connection::handleHeaders(uint8_t flags, uint32_t streamId, std::string_view payload)
+{
+    if (!streamId || !(streamId & 1))
+        return connectionError(ErrorCode::ProtocolError, "HEADERS on an invalid stream");
+
+    if (flags & flagPadded)
+    {
+        if (payload.empty() || uint8_t(payload.front()) >= payload.size())
+            return connectionError(ErrorCode::ProtocolError, "invalid padding");
+        payload = payload.substr(1, payload.size() - 1 - uint8_t(payload.front()));
+    }
+
+    if (flags & flagPriority)
+    {
+        if (payload.size() < 5)
+            return connectionError(ErrorCode::FrameSizeError, "invalid HEADERS");
+        payload.remove_prefix(5);
+    }
+
+    if (!(flags & flagEndHeaders))
+    {
+        m_continuationStream = streamId;
+        m_continuationFlags = flags;
+        m_headerBlock.assign(payload);
+        return true;
+    }
+
+    return handleHeaderBlock(flags, streamId, payload);
+}
+
+bool Http2Connection::handleHeaderBlock(uint8_t flags, uint32_t streamId, std::string_view block)
+{
+    // decoded even for streams we refuse, the dynamic table has to stay in sync
+    std::vector<HpackHeader> headers;
+    if (!m_decoder.decode(block, headers, m_settings.maxHeaderListSize))
+        return connectionError(ErrorCode::CompressionError, m_decoder.error());
+
+    const bool endStream = flags & flagEndStream;
+
+    if (const auto iter = m_streams.find(streamId); iter != std::end(m_streams))
+    {
+        // trailers, they are dropped
+        const auto stream = iter->second;
+        if (stream->remoteEnded)
+            resetStream(*stream, ErrorCode::StreamClosed, true);
+        else if (!endStream)
+            resetStream(*stream, ErrorCode::ProtocolError, true);
+        else
+            requestEnded(*stream);
+        return true;
+    }
+
+    if (streamId <= m_lastStreamId)
+        return connectionError(ErrorCode::StreamClosed, "HEADERS on a closed stream");
+
+    m_lastStreamId = streamId;
+
+    if (m_peerGoingAway || m_streams.size() >= m_settings.maxConcurrentStreams)
+    {
+        sendRstStream(streamId, ErrorCode::RefusedStream);
+        return true;
+    }
+
+    return openStream(streamId, endStream, std::move(headers));
+}
+
+bool Http2Connection::handleSettings(uint8_t flags, std::string_view payload)
+{
+    if (flags & flagAck)
+    {
+        if (!payload.empty())
+            return connectionError(ErrorCode::FrameSizeError, "invalid SETTINGS ack");
+
+        // the streams opened before used the default window
+        if (!m_settingsAcked)
+        {
+            m_settingsAcked = true;
+            for (const auto &[id, stream] : m_streams)
+                stream->receiveWindow += int64_t{m_settings.initialWindowSize} - defaultWindowSize;
+        }
+        return true;
+    }
+
+    if (payload.size() % 6)
+        return connectionError(ErrorCode::FrameSizeError, "invalid SETTINGS");
+
+    for (; !payload.empty(); payload.remove_prefix(6))
+    {
+        const auto setting = Setting(uint16_t(uint8_t(payload[0])) << 8 | uint8_t(payload[1]));
+        const uint32_t value = readUint32(payload.substr(2));
+
+        switch (setting)
+        {
+        case Setting::HeaderTableSize:
+            m_encoder.setPeerMaxTableSize(value);
+            break;
+        case Setting::EnablePush:
+            if (value > 1)
+                return connectionError(ErrorCode::ProtocolError, "invalid SETTINGS_ENABLE_PUSH");
+            break;
+        case Setting::InitialWindowSize:
+        {
+            if (value > maxWindowSize)
+                return connectionError(ErrorCode::FlowControlError, "invalid SETTINGS_INITIAL_WINDOW_SIZE");
+            const int64_t delta = int64_t{value} - m_peerInitialWindowSize;
+            for (const auto &[id, stream] : m_streams)
+            {
+                stream->sendWindow += delta;
+                if (stream->sendWindow > maxWindowSize)
+                    return connectionError(ErrorCode::FlowControlError, "stream window too large");
+            }
+            m_peerInitialWindowSize = value;
+            break;
+        }
+        case Setting::MaxFrameSize:
+            if (value < 16384 || value > 16777215)
+                return connectionError(ErrorCode::ProtocolError, "invalid SETTINGS_MAX_FRAME_SIZE");
+            m_peerMaxFrameSize = value;
+            break;
+        default:
+            // unknown settings are ignored, we do not push and do not send
+            // header lists large enough to care about the peers limit
+            break;
+        }
+    }
+
+    writeFrameHeader(0, FrameType::Settings, flagAck, 0);
+
+    if (!m_settingsReceived)
+    {
+        m_settingsReceived = true;
+        armIdleTimer();
+    }
+
+    // a larger initial window may unblock streams
+    flushStreams();
+
+    return true;
+}
+
+bool Http2Connection::handleWindowUpdate(uint32_t streamId, std::string_view payload)
+{
+    if (payload.size() != 4)
+        return connectionError(ErrorCode::FrameSizeError, "invalid WINDOW_UPDATE");
+
+    const uint32_t increment = readUint32(payload) & 0x7fffffff;
+
+    if (!streamId)
+    {
+        if (!increment)
+            return connectionError(ErrorCode::ProtocolError, "WINDOW_UPDATE without increment");
+        m_sendWindow += increment;
+        if (m_sendWindow > maxWindowSize)
+            return connectionError(ErrorCode::FlowControlError, "connection window too large");
+        flushStreams();
+        return true;
+    }
+
+    const auto iter = m_streams.find(streamId);
+    if (iter == std::end(m_streams))
+    {
+        if (streamId > m_lastStreamId)
+            return connectionError(ErrorCode::ProtocolError, "WINDOW_UPDATE on an idle stream");
+        return true;
+    }
+
+    const auto stream = iter->second;
+    if (!increment)
+    {
+        resetStream(*stream, ErrorCode::ProtocolError, true);
+        return true;
+    }
+
+    stream->sendWindow += increment;
+    if (stream->sendWindow > maxWindowSize)
+    {
+        resetStream(*stream, ErrorCode::FlowControlError, true);
+        return true;
+    }
+
+    flushStream(*stream);
+    return true;
+}
+
+bool Http2Connection::openStream(uint32_t streamId, bool endStream, std::vector<HpackHeader> &&headers)
+{
+    std::string_view method, scheme, authority, path;
+    std::string fields;
+    std::string cookie;
+    bool pseudoHeadersDone{};
+    bool hasHost{};
+    std::optional<std::size_t> contentLength;
+
+    const auto malformed = [&](std::string_view reason){
+        ESP_LOGW(TAG, "malformed request on stream %u: %.*s (%s:%hi)", streamId, reason.size(), reason.data(),
+                 m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        sendRstStream(streamId, ErrorCode::ProtocolError);
+        return true;
+    };
+
+    for (const auto &header : headers)
+    {
+        const std::string_view name{header.name};
+        const std::string_view value{header.value};
+
+        if (!validName(name) || !validValue(value))
+            return malformed("invalid header field");
+
+        if (name.front() == ':')
+        {
+            if (pseudoHeadersDone)
+                return malformed("pseudo header after a regular one");
+
+            std::string_view *pseudoHeader =
+                name == ":method" ? &method :
+                name == ":scheme" ? &scheme :
+                name == ":authority" ? &authority :
+                name == ":path" ? &path : nullptr;
+            if (!pseudoHeader || !pseudoHeader->empty())
+                return malformed("unknown or repeated pseudo header");
+            *pseudoHeader = value;
+            continue;
+        }
+
+        pseudoHeadersDone = true;
+
+        if (connectionSpecific(name) || (name == "te" && value != "trailers"))
+            return malformed("connection specific header");
+
+        // split into several fields for better compression (RFC 9113 8.2.3)
+        if (name == "cookie")
+        {
+            if (!cookie.empty())
+                cookie += "; ";
+            cookie += value;
+            continue;
+        }
+
+        if (name == "host")
+            hasHost = true;
+        else if (name == "content-length")
+        {
+            const auto parsed = cpputils::fromString<std::size_t>(value);
+            if (!parsed)
+                return malformed("invalid content-length");
+            contentLength = *parsed;
+        }
+
+        fields += name;
+        fields += ": ";
+        fields += value;
+        fields += "\r\n";
+    }
+
+    // CONNECT has neither, it is not supported
+    if (method.empty() || scheme.empty() || path.empty())
+        return malformed("missing pseudo header");
+    if (method.find(' ') != std::string_view::npos || path.find(' ') != std::string_view::npos)
+        return malformed("invalid request line");
+    if (endStream && contentLength.value_or(0))
+        return malformed("content-length without body");
+
+    const auto stream = std::make_shared<Http2Stream>();
+    stream->connection = this;
+    stream->id = streamId;
+    stream->secure = m_stream.secure();
+    stream->receiveWindow = m_settingsAcked ? m_settings.initialWindowSize : defaultWindowSize;
+    stream->sendWindow = m_peerInitialWindowSize;
+    stream->headRequest = method == "HEAD";
+    stream->parser.reset(stream->headRequest);
+
+    auto &input = stream->input;
+    input = fmt::format("{} {} HTTP/2\r\n", method, path);
+    if (!hasHost && !authority.empty())
+        input += fmt::format("Host: {}\r\n", authority);
+    input += fields;
+    if (!cookie.empty())
+        input += fmt::format("Cookie: {}\r\n", cookie);
+
+    if (endStream || contentLength)
+    {
+        input += "\r\n";
+        stream->headWritten = true;
+        stream->remoteEnded = endStream;
+        stream->hasContentLength = bool(contentLength);
+        stream->contentLength = contentLength.value_or(0);
+    }
+    // otherwise the head is finished by writeRequestHead() once the body is complete
+    stream->headSize = input.size();
+
+    m_streams.emplace(streamId, stream);
+    armIdleTimer();
+
+    std::make_shared<ClientConnection>(m_webserver, ClientStream{Http2Channel{stream, m_stream.get_executor()}})->start();
+
+    return true;
+}
+
+void Http2Connection::requestEnded(Http2Stream &stream)
+{
+    stream.remoteEnded = true;
+
+    if (stream.hasContentLength && stream.contentLength)
+    {
+        resetStream(stream, ErrorCode::ProtocolError, true);
+        return;
+    }
+
+    if (!stream.headWritten)
+        writeRequestHead(stream, stream.input.size() - stream.headSize);
+
+    deliverInput(stream);
+}
+
+void Http2Connection::writeRequestHead(Http2Stream &stream, std::size_t contentLength)
+{
+    const auto end = contentLength ? fmt::format("Content-Length: {}\r\n\r\n", contentLength) : std::string{"\r\n"};
+    stream.input.insert(stream.headSize, end);
+    stream.headSize += end.size();
+    stream.headWritten = true;
+}
+
+void Http2Connection::deliverInput(Http2Stream &stream)
+{
+    if (!stream.readHandler || !stream.headWritten)
+        return;
+
+    const auto available = stream.input.size() - stream.inputOffset;
+    if (!available)
+    {
+        // the ClientConnection waits for another request, there is none
+        if (stream.remoteEnded)
+            std::exchange(stream.readHandler, {})(asio::error::eof, 0);
+        return;
+    }
+
+    const auto size = std::min(available, stream.readBuffer.size());
+    std::copy_n(stream.input.data() + stream.inputOffset, size, static_cast<char *>(stream.readBuffer.data()));
+    stream.inputOffset += size;
+    if (stream.inputOffset == stream.input.size())
+    {
+        stream.input.clear();
+        stream.inputOffset = 0;
+    }
+
+    const auto head = std::min(size, stream.headSize);
+    stream.headSize -= head;
+    creditWindow(&stream, size - head);
+
+    std::exchange(stream.readHandler, {})({}, size);
+}
+
+void Http2Connection::creditWindow(Http2Stream *stream, std::size_t size)
+{
+    if (!size)
+        return;
+
+    // updates are batched, a window is replenished once half of it is used
+    m_consumed += size;
+    if (m_consumed >= std::max(m_settings.connectionWindowSize, defaultWindowSize) / 2)
+    {
+        writeFrameHeader(4, FrameType::WindowUpdate, 0, 0);
+        appendUint32(m_sendBuffer, m_consumed);
+        m_receiveWindow += m_consumed;
+        m_consumed = 0;
+    }
+
+    if (!stream || stream->remoteEnded)
+        return;
+
+    stream->consumed += size;
+    if (stream->consumed >= m_settings.initialWindowSize / 2)
+    {
+        writeFrameHeader(4, FrameType::WindowUpdate, 0, stream->id);
+        appendUint32(m_sendBuffer, stream->consumed);
+        stream->receiveWindow += stream->consumed;
+        stream->consumed = 0;
+    }
+}
+
+void Http2Connection::sendResponseHeaders(Http2Stream &stream, bool endStream)
+{
+    std::string block;
+    m_encoder.encode(":status", std::to_string(stream.parser.status()), block);
+    for (const auto &header : stream.responseHeaders)
+        m_encoder.encode(header.name, header.value, block, indexable(header.name));
+
+    stream.responseHeaders.clear();
+    stream.headersSent = true;
+    stream.endSent = endStream;
+
+    // HEADERS and CONTINUATION frames have to follow each other directly,
+    // they are always queued at once
+    std::string_view rest{block};
+    bool first{true};
+    do
+    {
+        const auto size = std::min<std::size_t>(rest.size(), m_peerMaxFrameSize);
+        const uint8_t flags = (size == rest.size() ? flagEndHeaders : 0) | (first && endStream ? flagEndStream : 0);
+        writeFrameHeader(size, first ? FrameType::Headers : FrameType::Continuation, flags, stream.id);
+        m_sendBuffer += rest.substr(0, size);
+        rest.remove_prefix(size);
+        first = false;
+    } while (!rest.empty());
+}
+
+void Http2Connection::flushStream(Http2Stream &stream)
+{
+    if (stream.reset || !stream.connection)
+        return;
+
+    while (stream.pendingSize() && stream.sendWindow > 0 && m_sendWindow > 0 && m_sendBuffer.size() < sendBufferLimit)
+    {
+        const auto size = std::min<std::size_t>({stream.pendingSize(), std::size_t(stream.sendWindow), std::size_t(m_sendWindow), m_peerMaxFrameSize});
+        const bool end = stream.responseComplete && size == stream.pendingSize();
+
+        writeFrameHeader(size, FrameType::Data, end ? flagEndStream : 0, stream.id);
+        m_sendBuffer.append(stream.pending, stream.pendingOffset, size);
+
+        stream.pendingOffset += size;
+        stream.sendWindow -= size;
+        m_sendWindow -= size;
+        if (end)
+            stream.endSent = true;
+    }
+
+    if (!stream.pendingSize())
+    {
+        stream.pending.clear();
+        stream.pendingOffset = 0;
+    }
+    else if (stream.pendingOffset > stream.pending.size() / 2)
+    {
+        stream.pending.erase(0, stream.pendingOffset);
+        stream.pendingOffset = 0;
+    }
+
+    if (stream.responseComplete && !stream.pendingSize() && !stream.endSent)
+    {
+        if (!stream.headersSent)
+            sendResponseHeaders(stream, true);
+        else
+        {
+            writeFrameHeader(0, FrameType::Data, flagEndStream, stream.id);
+            stream.endSent = true;
+        }
+    }
+
+    if (stream.writeHandler && stream.pendingSize() <= writeLowWater)
+        std::exchange(stream.writeHandler, {})({}, stream.writeSize);
+
+    if (stream.endSent)
+        finishStream(stream);
+}
+
+void Http2Connection::flushStreams()
+{
+    for (auto iter = std::begin(m_streams); iter != std::end(m_streams) && m_sendBuffer.size() < sendBufferLimit; )
+    {
+        // finishing a stream removes it from m_streams
+        const auto stream = (iter++)->second;
+        if (stream->pendingSize())
+            flushStream(*stream);
+    }
+}
+
+void Http2Connection::finishStream(Http2Stream &stream)
+{
+    // the response is complete, the rest of the request is not needed anymore
+    if (!stream.remoteEnded)
+        sendRstStream(stream.id, ErrorCode::NoError);
+
+    detachStream(stream, {});
+}
+
+void Http2Connection::resetStream(Http2Stream &stream, ErrorCode error, bool sendRstStream)
+{
+    if (sendRstStream)
+        this->sendRstStream(stream.id, error);
+
+    stream.reset = true;
+    detachStream(stream, asio::error::connection_reset);
+}
+
+void Http2Connection::detachStream(Http2Stream &stream, std::error_code ec)
+{
+    stream.connection = nullptr;
+
+    if (stream.readHandler)
+        std::exchange(stream.readHandler, {})(ec ? ec : asio::error::eof, 0);
+    if (stream.writeHandler)
+        std::exchange(stream.writeHandler, {})(ec, ec ? 0 : stream.writeSize);
+
+    m_streams.erase(stream.id);
+
+    if (m_streams.empty() && m_peerGoingAway)
+        closeAfterWrite();
+    else
+        armIdleTimer();
+}
+
+void Http2Connection::sendRstStream(uint32_t streamId, ErrorCode error)
+{
+    writeFrameHeader(4, FrameType::RstStream, 0, streamId);
+    appendUint32(m_sendBuffer, std::to_underlying(error));
+}
+
+bool Http2Connection::connectionError(ErrorCode error, std::string_view message)
+{
+    ESP_LOGW(TAG, "connection error %u: %.*s (%s:%hi)", std::to_underlying(error), message.size(), message.data(),
+             m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+    closeStreams();
+    goAway(error);
+    return false;
+}
+
+void Http2Connection::goAway(ErrorCode error)
+{
+    writeFrameHeader(8, FrameType::GoAway, 0, 0);
+    appendUint32(m_sendBuffer, m_lastStreamId);
+    appendUint32(m_sendBuffer, std::to_underlying(error));
+    closeAfterWrite();
+}
+
+void Http2Connection::closeAfterWrite()
+{
+    m_goingAway = true;
+    m_idleTimer.cancel();
+
+    doWrite();
+    if (!m_writeInProgress)
+        abort();
+}
+
+void Http2Connection::closeStreams()
+{
+    const auto streams = std::exchange(m_streams, {});
+    for (const auto &[id, stream] : streams)
+    {
+        stream->reset = true;
+        stream->connection = nullptr;
+        if (stream->readHandler)
+            std::exchange(stream->readHandler, {})(asio::error::connection_reset, 0);
+        if (stream->writeHandler)
+            std::exchange(stream->writeHandler, {})(asio::error::connection_reset, 0);
+    }
+}
+
+void Http2Connection::abort()
+{
+    if (m_closed)
+        return;
+
+    m_closed = true;
+    m_idleTimer.cancel();
+
+    closeStreams();
+
+    std::error_code ec;
+    m_stream.close(ec);
+}
+
+void Http2Connection::writeFrameHeader(std::size_t length, FrameType type, uint8_t flags, uint32_t streamId)
+{
+    appendUint32(m_sendBuffer, length << 8 | std::to_underlying(type));
+    m_sendBuffer += char(flags);
+    appendUint32(m_sendBuffer, streamId);
+}
+
+void Http2Connection::doWrite()
+{
+    if (m_writeInProgress || m_sendBuffer.empty() || m_closed)
+        return;
+
+    m_writing.swap(m_sendBuffer);
+    m_writeInProgress = true;
+
+    asio::async_write(m_stream, asio::buffer(m_writing.data(), m_writing.size()),
+                      [this, self=shared_from_this()](std::error_code ec, std::size_t length)
+                      { writeFinished(ec); });
+}
+
+void Http2Connection::writeFinished(std::error_code ec)
+{
+    m_writeInProgress = false;
+    m_writing.clear();
+
+    if (ec)
+    {
+        if (!m_closed)
+            ESP_LOGI(TAG, "error: %i (%s:%hi)", ec.value(),
+                     m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        abort();
+        return;
+    }
+
+    if (m_closed)
+        return;
+
+    if (m_goingAway)
+    {
+        if (m_sendBuffer.empty())
+            abort();
+        else
+            doWrite();
+        return;
+    }
+
+    flushStreams();
+    doWrite();
+
+    if (m_readDeferred && m_sendBuffer.size() <= 4 * sendBufferLimit)
+    {
+        m_readDeferred = false;
+        doRead();
+    }
+}
+
+void Http2Connection::armIdleTimer()
+{
+    if (m_closed || m_goingAway)
+        return;
+
+    // the preface and settings are due like a request header, afterwards
+    // a connection without streams is idle like a kept alive one
+    const auto timeout = !m_settingsReceived ? m_webserver.requestHeaderTimeout() :
+                         m_streams.empty() ? m_webserver.keepAliveTimeout() :
+                         std::chrono::milliseconds{};
+
+    if (timeout.count() > 0)
+        m_idleTimer.expiresAfter(timeout);
+    else
+        m_idleTimer.cancel();
+}
+
+void Http2Connection::idleTimeout()
+{
+    ESP_LOGI(TAG, "%s timeout (%s:%hi)", m_settingsReceived ? "keep-alive" : "preface",
+             m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+    if (!m_settingsReceived)
+    {
+        abort();
+        return;
+    }
+
+    goAway(ErrorCode::NoError);
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// local includes
+#include "admissioncontrol.h"
+#include "clientstream.h"
+#include "hpack.h"
+#include "http2channel.h"
+#include "httpresponseparser.h"
+#include "timerwheel.h"
+
+// forward declares
+class Webserver;
+class Http2Connection;
+
+struct Http2Settings
+{
+    // h2c without upgrade, a client starting with the connection preface.
+    // With tls h2 is selected with alpn, see SslServerContext::setAlpnProtocols()
+    bool priorKnowledge{true};
+
+    uint32_t maxConcurrentStreams{100};
+    // receive windows, per stream and for the whole connection
+    uint32_t initialWindowSize{65535};
+    uint32_t connectionWindowSize{1024 * 1024};
+    // of the hpack decoder, the encoder uses at most as much as well
+    uint32_t headerTableSize{4096};
+    uint32_t maxHeaderListSize{16 * 1024};
+};
+
+// state of one stream, shared between the connection and the channel of
+// the ClientConnection serving it
+struct Http2Stream
+{
+    Http2Connection *connection{}; // nullptr once the stream is closed
+    uint32_t id{};
+    bool secure{};
+
+    // request, the head as HTTP/1.1 text followed by the body
+    std::string input;
+    std::size_t inputOffset{};
+    std::size_t headSize{};          // head bytes not read yet, not flow controlled
+    std::size_t contentLength{};     // of DATA frames still expected, if the request had one
+    bool hasContentLength{};
+    bool headWritten{};              // without content-length the body is collected first
+    bool remoteEnded{};              // END_STREAM received
+    int64_t receiveWindow{};
+    uint32_t consumed{};             // bytes read by the handler, not credited to the window yet
+
+    asio::mutable_buffer readBuffer;
+    Http2Channel::Handler readHandler;
+
+    // response
+    HttpResponseParser parser;
+    bool headRequest{};
+    std::vector<HpackHeader> responseHeaders;
+    bool headersComplete{};
+    bool headersSent{};
+    bool responseComplete{};
+    bool endSent{};                  // END_STREAM sent
+    std::string pending;             // DATA waiting for window
+    std::size_t pendingOffset{};
+    int64_t sendWindow{};
+
+    std::size_t writeSize{};
+    Http2Channel::Handler writeHandler;
+
+    bool reset{};
+
+    std::size_t pendingSize() const { return pending.size() - pendingOffset; }
+};
+
+// A server side HTTP/2 connection (RFC 9113), next to ClientConnection.
+// Every stream is served by its own ClientConnection over an Http2Channel,
+// so Webserver::makeResponseHandler() and the existing response handlers
+// work for both protocols; the request protocol is "HTTP/2". Entered with
+// prior knowledge (h2c) or after alpn selected h2. Server push, priorities
+// and websockets over HTTP/2 (RFC 8441) are not supported.
+class Http2Connection : public std::enable_shared_from_this<Http2Connection>
+{
+public:
+    static constexpr std::string_view preface{"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"};
+
+    // buffer holds what was read already, the preface at least in part
+    Http2Connection(Webserver &webserver, ClientStream &&stream, std::string &&buffer = {}, AdmissionControl::Ticket &&admission = {});
+    ~Http2Connection();
+
+    Webserver &webserver() { return m_webserver; }
+    const asio::ip::tcp::endpoint &remote_endpoint() const { return m_remote_endpoint; }
+
+    void start();
+
+    // called by Http2Channel
+    void streamRead(Http2Stream &stream, asio::mutable_buffer buffer, Http2Channel::Handler &&handler);
+    void streamWrite(Http2Stream &stream, std::string_view data);
+    void streamWriteFinished(Http2Stream &stream, std::size_t size, Http2Channel::Handler &&handler);
+    void streamClosed(Http2Stream &stream);
+
+private:
+    enum class FrameType : uint8_t { Data, Headers, Priority, RstStream, Settings, PushPromise, Ping, GoAway, WindowUpdate, Continuation };
+    enum class ErrorCode : uint32_t { NoError, ProtocolError, InternalError, FlowControlError, SettingsTimeout, StreamClosed,
+                                      FrameSizeError, RefusedStream, Cancel, CompressionError, ConnectError, EnhanceYourCalm };
+
+    void doRead();
+    void readyRead(std::error_code ec, std::size_t length);
+    bool parseFrames();
+    bool handleFrame(FrameType type, uint8_t flags, uint32_t streamId, std::string_view payload);
+    bool handleData(uint8_t flags, uint32_t streamId, std::string_view payload);
+    bool handleHeaders(uint8_t flags, uint32_t streamId, std::string_view payload);
+    bool handleHeaderBlock(uint8_t flags, uint32_t streamId, std::string_view block);
+    bool handleSettings(uint8_t flags, std::string_view payload);
+    bool handleWindowUpdate(uint32_t streamId, std::string_view payload);
+    bool openStream(uint32_t streamId, bool endStream, std::vector<HpackHeader> &&headers);
+
+    // request side of a stream
+    void requestEnded(Http2Stream &stream);
+    void writeRequestHead(Http2Stream &stream, std::size_t contentLength);
+    void deliverInput(Http2Stream &stream);
+    void creditWindow(Http2Stream *stream, std::size_t size);
+
+    // response side of a stream
+    void sendResponseHeaders(Http2Stream &stream, bool endStream);
+    void flushStream(Http2Stream &stream);
+    void flushStreams();
+    void finishStream(Http2Stream &stream);
+
+    void resetStream(Http2Stream &stream, ErrorCode error, bool sendRstStream);
+    void detachStream(Http2Stream &stream, std::error_code ec);
+    void sendRstStream(uint32_t streamId, ErrorCode error);
+
+    bool connectionError(ErrorCode error, std::string_view message);
+    void goAway(ErrorCode error);
+    void closeAfterWrite();
+    void closeStreams();
+    void abort();
+
+    void writeFrameHeader(std::size_t length, FrameType type, uint8_t flags, uint32_t streamId);
+    void doWrite();
+    void writeFinished(std::error_code ec);
+
+    void armIdleTimer();
+    void idleTimeout();
+
+    Webserver &m_webserver;
+    ClientStream m_stream;
+    const asio::ip::tcp::endpoint m_remote_endpoint;
+    AdmissionControl::Ticket m_admission;
+    const Http2Settings m_settings;
+
+    static constexpr const std::size_t max_length = 16384;
+    char m_receiveBuffer[max_length];
+    std::string m_parsingBuffer;
+
+    bool m_prefaceReceived{};
+    bool m_settingsReceived{};
+    bool m_settingsAcked{};
+    bool m_goingAway{};     // GOAWAY sent, closed once it is written
+    bool m_peerGoingAway{}; // GOAWAY received, no new streams
+    bool m_closed{};
+    bool m_readDeferred{};
+
+    std::map<uint32_t, std::shared_ptr<Http2Stream>> m_streams;
+    uint32_t m_lastStreamId{};
+
+    // a header block split into CONTINUATION frames
+    uint32_t m_continuationStream{};
+    uint8_t m_continuationFlags{};
+    std::string m_headerBlock;
+
+    HpackDecoder m_decoder;
+    HpackEncoder m_encoder;
+
+    int64_t m_receiveWindow{65535};
+    uint32_t m_consumed{};
+
+    // peer settings
+    int64_t m_sendWindow{65535};
+    uint32_t m_peerInitialWindowSize{65535};
+    uint32_t m_peerMaxFrameSize{16384};
+
+    std::string m_sendBuffer;
+    std::string m_writing;
+    bool m_writeInProgress{};
+
+    TimerWheel::Timer m_idleTimer;
+};
@@ -0,0 +1,751 @@
+#include "httpclient.h"
+
+// system includes
+#include <algorithm>
+#include <iterator>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio/ssl.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+
+// local includes
+#include "happyeyeballs.h"
+#include "httpresponseparser.h"
+#include "sslwebsocketclient.h"
+#include "timerwheel.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEB";
+
+// RFC 9110 9.2.2, only these are pipelined and retried
+bool isIdempotent(std::string_view method)
+{
+    return method == "GET" || method == "HEAD" || method == "OPTIONS" ||
+           method == "TRACE" || method == "PUT" || method == "DELETE";
+}
+} // namespace
+
+// One connection of the pool, the parts which do not depend on the stream.
+// Kept alive by its pending operations, the client only holds it while it
+// is usable.
+class HttpClientConnection : public std::enable_shared_from_this<HttpClientConnection>
+{
+public:
+    HttpClientConnection(HttpClient &client, HttpClient::Host &host);
+    virtual ~HttpClientConnection() = default;
+
+    virtual void start() = 0;
+
+    void send(HttpClient::Pending &&pending);
+
+    // the client is destroyed, nothing is called back anymore
+    void detach();
+    // closes without failing anything, unanswered requests go back to the queue
+    void retire();
+
+    bool ready() const { return m_ready && !m_closed; }
+    bool idle() const { return ready() && m_reusable && m_inFlight.empty(); }
+    bool canPipeline() const;
+    std::size_t inFlight() const { return m_inFlight.size(); }
+
+protected:
+    virtual void doRead() = 0;
+    virtual void doWrite() = 0;
+    virtual void closeStream() = 0;
+
+    void connected();
+    void connectFailed(std::string &&message);
+    void onRead(const std::error_code &error, std::string_view input);
+    void onWritten(const std::error_code &error);
+
+    HttpClient *m_client;
+    HttpClient::Host *m_host;
+
+    std::string m_writeBuffer; // being written
+    char m_receiveBuffer[4096];
+
+private:
+    void startWrite();
+    bool completeResponse();
+    void lost(std::string &&message);
+    void timeout();
+    bool interim() const { return m_parser.status() >= 100 && m_parser.status() < 200 && m_parser.status() != 101; }
+
+    std::deque<HttpClient::Pending> m_inFlight;
+    HttpResponseParser m_parser;
+    bool m_responseStarted{}; // of the front request
+
+    std::string m_writeQueue; // requests sent while writing
+    bool m_writing{};
+
+    bool m_ready{};
+    bool m_closed{};
+    bool m_reusable{true}; // no Connection: close in either direction yet
+    bool m_served{};
+
+    // idle timeout without requests, response timeout with
+    TimerWheel::Timer m_timer;
+};
+
+template<typename Stream>
+class BasicHttpClientConnection final : public HttpClientConnection, private detail::WebsocketClientStream<Stream>
+{
+    using Base = detail::WebsocketClientStream<Stream>;
+    using Base::m_socket;
+
+public:
+    BasicHttpClientConnection(asio::io_context &io_context, HttpClient &client, HttpClient::Host &host,
+                              const typename Base::Options &options);
+
+    void start() final;
+
+private:
+    void onResolved(const std::error_code &error, asio::ip::tcp::resolver::iterator iterator);
+    void connect();
+    void onConnected(const std::error_code &error, asio::ip::tcp::socket &&socket);
+    void onHandshaked(const std::error_code &error);
+
+    void doRead() final;
+    void doWrite() final;
+    void closeStream() final;
+
+    asio::io_context &m_io_context;
+    asio::ip::tcp::resolver m_resolver;
+    HappyEyeballsConnector m_connector;
+    // the connector calls back with a raw pointer
+    std::shared_ptr<HttpClientConnection> m_connectingSelf;
+    bool m_handshaked{};
+};
+
+HttpClient::HttpClient(asio::io_context &io_context, std::shared_ptr<SslClientContext> sslContext) :
+    m_io_context{io_context},
+    m_sslContext{sslContext ? std::move(sslContext) : SslClientContext::shared()}
+{
+}
+
+HttpClient::~HttpClient()
+{
+    for (auto &[key, host] : m_hosts)
+        for (auto &connection : host->connections)
+            connection->detach();
+}
+
+void HttpClient::request(bool secure, std::string_view host, std::string_view port,
+                         HttpClientRequest &&request, std::unique_ptr<HttpClientResponseHandler> &&handler)
+{
+    m_stats.requests++;
+
+    auto &entry = m_hosts[fmt::format("{} {}:{}", secure ? "https" : "http", host, port)];
+    if (!entry)
+    {
+        entry = std::make_unique<Host>();
+        entry->secure = secure;
+        entry->host = host;
+        entry->port = port;
+    }
+
+    const bool idempotent = isIdempotent(request.method);
+    const bool head = request.method == "HEAD";
+    entry->queue.push_back(Pending {
+        .request = std::move(request),
+        .handler = std::move(handler),
+        .idempotent = idempotent,
+        .head = head
+    });
+
+    dispatch(*entry);
+}
+
+std::size_t HttpClient::connections() const
+{
+    std::size_t count{};
+    for (const auto &[key, host] : m_hosts)
+        count += host->connections.size();
+    return count;
+}
+
+void HttpClient::closeIdleConnections()
+{
+    for (auto &[key, host] : m_hosts)
+    {
+        // retire() removes it from the vector
+        auto connections = host->connections;
+        for (auto &connection : connections)
+            if (connection->idle())
+                connection->retire();
+    }
+}
+
+void HttpClient::dispatch(Host &host)
+{
+    while (!host.queue.empty())
+    {
+        HttpClientConnection *target{};
+
+        for (const auto &connection : host.connections)
+            if (connection->idle())
+            {
+                target = connection.get();
+                break;
+            }
+
+        if (!target && host.queue.front().idempotent && m_settings.maxPipelineDepth > 1)
+            for (const auto &connection : host.connections)
+                if (connection->canPipeline() && connection->inFlight() < m_settings.maxPipelineDepth &&
+                    (!target || connection->inFlight() < target->inFlight()))
+                    target = connection.get();
+
+        if (!target)
+            break;
+
+        auto pending = std::move(host.queue.front());
+        host.queue.pop_front();
+        target->send(std::move(pending));
+    }
+
+    // connections which are still being opened take the queue once ready
+    std::size_t connecting = std::count_if(std::begin(host.connections), std::end(host.connections),
+                                           [](const auto &connection){ return !connection->ready(); });
+    while (host.queue.size() > connecting && host.connections.size() < m_settings.maxConnectionsPerHost)
+    {
+        openConnection(host);
+        connecting++;
+    }
+}
+
+void HttpClient::openConnection(Host &host)
+{
+    ESP_LOGD(TAG, "new connection to %s:%s", host.host.c_str(), host.port.c_str());
+
+    std::shared_ptr<HttpClientConnection> connection;
+    if (host.secure)
+        connection = std::make_shared<BasicHttpClientConnection<asio::ssl::stream<asio::ip::tcp::socket>>>(
+            m_io_context, *this, host, SslWebsocketClient::StreamOptions{ .context = m_sslContext });
+    else
+        connection = std::make_shared<BasicHttpClientConnection<asio::ip::tcp::socket>>(
+            m_io_context, *this, host, WebsocketClient::StreamOptions{});
+
+    host.connections.push_back(connection);
+    m_stats.connects++;
+
+    connection->start();
+}
+
+void HttpClient::removeConnection(Host &host, const HttpClientConnection &connection)
+{
+    const auto iter = std::find_if(std::begin(host.connections), std::end(host.connections),
+                                   [&](const auto &other){ return other.get() == &connection; });
+    if (iter != std::end(host.connections))
+        host.connections.erase(iter);
+}
+
+void HttpClient::failQueue(Host &host, std::string_view message)
+{
+    auto queue = std::move(host.queue);
+    host.queue.clear();
+
+    for (auto &pending : queue)
+    {
+        m_stats.failures++;
+        pending.handler->requestFailed(message);
+    }
+}
+
+HttpClientConnection::HttpClientConnection(HttpClient &client, HttpClient::Host &host) :
+    m_client{&client},
+    m_host{&host},
+    m_timer{TimerWheel::get(client.m_io_context), [](void *context){ static_cast<HttpClientConnection *>(context)->timeout(); }, this}
+{
+}
+
+void HttpClientConnection::send(HttpClient::Pending &&pending)
+{
+    auto &client = *m_client;
+
+    if (m_served)
+        client.m_stats.reusedConnections++;
+
+    if (m_inFlight.empty())
+    {
+        m_parser.reset(pending.head);
+        m_responseStarted = false;
+        m_timer.expiresAfter(client.m_settings.responseTimeout);
+    }
+    else
+        client.m_stats.pipelined++;
+
+    const auto &request = pending.request;
+    const auto &host = *m_host;
+
+    m_writeQueue += request.method;
+    m_writeQueue += ' ';
+    m_writeQueue += request.target;
+    m_writeQueue += " HTTP/1.1\r\nHost: ";
+    m_writeQueue += host.host;
+    if (host.port != (host.secure ? "443" : "80"))
+    {
+        m_writeQueue += ':';
+        m_writeQueue += host.port;
+    }
+    m_writeQueue += "\r\n";
+
+    for (const auto &[key, value] : request.headers)
+    {
+        m_writeQueue += key;
+        m_writeQueue += ": ";
+        m_writeQueue += value;
+        m_writeQueue += "\r\n";
+    }
+
+    if (!request.body.empty() || request.method == "POST" || request.method == "PUT" || request.method == "PATCH")
+        m_writeQueue += fmt::format("Content-Length: {}\r\n", request.body.size());
+
+    if (!client.m_settings.keepAlive)
+    {
+        m_writeQueue += "Connection: close\r\n";
+        m_reusable = false;
+    }
+
+    m_writeQueue += "\r\n";
+    m_writeQueue += request.body;
+
+    m_inFlight.push_back(std::move(pending));
+
+    if (!m_writing)
+        startWrite();
+}
+
+void HttpClientConnection::detach()
+{
+    if (m_closed)
+        return;
+
+    m_closed = true;
+    m_timer.cancel();
+    closeStream();
+    m_inFlight.clear();
+    m_client = nullptr;
+    m_host = nullptr;
+}
+
+void HttpClientConnection::retire()
+{
+    if (m_closed)
+        return;
+
+    auto self = shared_from_this();
+    auto &client = *m_client;
+    auto &host = *m_host;
+
+    m_closed = true;
+    m_timer.cancel();
+    closeStream();
+
+    // pipelined requests the server did not get to, in their order
+    while (!m_inFlight.empty())
+    {
+        host.queue.push_front(std::move(m_inFlight.back()));
+        m_inFlight.pop_back();
+    }
+
+    client.removeConnection(host, *this);
+    client.dispatch(host);
+}
+
+bool HttpClientConnection::canPipeline() const
+{
+    return ready() && m_reusable && !m_responseStarted &&
+           std::all_of(std::begin(m_inFlight), std::end(m_inFlight), [](const auto &pending){ return pending.idempotent; });
+}
+
+void HttpClientConnection::connected()
+{
+    if (m_closed)
+        return;
+
+    m_ready = true;
+    doRead();
+    m_client->dispatch(*m_host);
+}
+
+void HttpClientConnection::connectFailed(std::string &&message)
+{
+    if (m_closed)
+        return;
+
+    ESP_LOGW(TAG, "%s", message.c_str());
+
+    auto self = shared_from_this();
+    auto &client = *m_client;
+    auto &host = *m_host;
+
+    m_closed = true;
+    closeStream();
+
+    // the addresses may be stale
+    host.endpoints.clear();
+
+    client.removeConnection(host, *this);
+
+    // nothing else is left to serve the queue
+    if (host.connections.empty())
+        client.failQueue(host, message);
+}
+
+void HttpClientConnection::onRead(const std::error_code &error, std::string_view input)
+{
+    if (m_closed)
+        return;
+
+    auto self = shared_from_this();
+
+    if (error)
+    {
+        // a body delimited by the end of the connection
+        if ((error == asio::error::eof || error == asio::ssl::error::stream_truncated) &&
+            !m_inFlight.empty() && m_parser.finish())
+        {
+            m_reusable = false;
+            completeResponse();
+            return;
+        }
+
+        if (m_inFlight.empty())
+        {
+            ESP_LOGD(TAG, "closed by the server while idle");
+            retire();
+            return;
+        }
+
+        lost(fmt::format("Receiving http response failed: {}", error.message()));
+        return;
+    }
+
+    // any progress restarts the response timeout
+    if (!m_inFlight.empty())
+        m_timer.expiresAfter(m_client->m_settings.responseTimeout);
+
+    while (true)
+    {
+        if (m_inFlight.empty())
+        {
+            if (!input.empty())
+            {
+                lost("received data without a request");
+                return;
+            }
+            break;
+        }
+
+        auto &current = m_inFlight.front();
+
+        switch (m_parser.parse(input))
+        {
+        case HttpResponseParser::Event::NeedMore:
+            doRead();
+            return;
+        case HttpResponseParser::Event::ResponseLine:
+            m_responseStarted = true;
+            if (!interim())
+                current.handler->responseLineReceived(m_parser.status(), m_parser.message());
+            break;
+        case HttpResponseParser::Event::Header:
+            if (!interim())
+                current.handler->responseHeaderReceived(m_parser.headerKey(), m_parser.headerValue());
+            break;
+        case HttpResponseParser::Event::HeadersComplete:
+            break;
+        case HttpResponseParser::Event::Body:
+            current.handler->responseBodyReceived(m_parser.body());
+            break;
+        case HttpResponseParser::Event::Complete:
+            if (!completeResponse())
+                return;
+            break;
+        case HttpResponseParser::Event::Error:
+            lost(std::string{m_parser.error()});
+            return;
+        }
+
+        if (m_closed)
+            return;
+    }
+
+    doRead();
+}
+
+void HttpClientConnection::onWritten(const std::error_code &error)
+{
+    if (m_closed)
+        return;
+
+    m_writing = false;
+    m_writeBuffer.clear();
+
+    if (error)
+    {
+        auto self = shared_from_this();
+        lost(fmt::format("Sending http request failed: {}", error.message()));
+        return;
+    }
+
+    if (!m_writeQueue.empty())
+        startWrite();
+}
+
+void HttpClientConnection::timeout()
+{
+    if (m_closed)
+        return;
+
+    if (!m_inFlight.empty())
+        lost("response timeout");
+    else
+    {
+        ESP_LOGD(TAG, "idle timeout");
+        retire();
+    }
+}
+
+void HttpClientConnection::startWrite()
+{
+    m_writing = true;
+    std::swap(m_writeBuffer, m_writeQueue);
+    doWrite();
+}
+
+bool HttpClientConnection::completeResponse()
+{
+    // 100 Continue and friends, the final response follows
+    if (interim())
+    {
+        m_parser.reset(m_inFlight.front().head);
+        return true;
+    }
+
+    if (!m_parser.keepAlive())
+        m_reusable = false;
+
+    auto pending = std::move(m_inFlight.front());
+    m_inFlight.pop_front();
+    m_responseStarted = false;
+    m_served = true;
+
+    m_client->m_stats.responses++;
+    pending.handler->responseFinished();
+    pending.handler.reset();
+
+    // the handler may have destroyed the client
+    if (m_closed)
+        return false;
+
+    if (!m_reusable)
+    {
+        retire();
+        return false;
+    }
+
+    if (!m_inFlight.empty())
+        m_parser.reset(m_inFlight.front().head);
+    else
+    {
+        m_timer.expiresAfter(m_client->m_settings.idleTimeout);
+        m_client->dispatch(*m_host);
+    }
+
+    return true;
+}
+
+void HttpClientConnection::lost(std::string &&message)
+{
+    ESP_LOGW(TAG, "%s", message.c_str());
+
+    auto self = shared_from_this();
+    auto &client = *m_client;
+    auto &host = *m_host;
+
+    m_closed = true;
+    m_timer.cancel();
+    closeStream();
+
+    std::deque<HttpClient::Pending> retried;
+    std::deque<HttpClient::Pending> failed;
+
+    // only the front one can have seen a byte of its response
+    for (auto &pending : m_inFlight)
+    {
+        if (!m_responseStarted && pending.idempotent && !pending.retries)
+        {
+            pending.retries++;
+            client.m_stats.retries++;
+            retried.push_back(std::move(pending));
+        }
+        else
+        {
+            client.m_stats.failures++;
+            failed.push_back(std::move(pending));
+        }
+        m_responseStarted = false;
+    }
+    m_inFlight.clear();
+
+    // back to the front of the queue, in their order
+    host.queue.insert(std::begin(host.queue), std::make_move_iterator(std::begin(retried)), std::make_move_iterator(std::end(retried)));
+
+    client.removeConnection(host, *this);
+    client.dispatch(host);
+
+    for (auto &pending : failed)
+        pending.handler->requestFailed(message);
+}
+
+template<typename Stream>
+BasicHttpClientConnection<Stream>::BasicHttpClientConnection(asio::io_context &io_context, HttpClient &client, HttpClient::Host &host,
+                                                             const typename Base::Options &options) :
+    HttpClientConnection{client, host},
+    Base{io_context, options},
+    m_io_context{io_context},
+    m_resolver{io_context},
+    m_connector{io_context, [](void *context, const std::error_code &error, asio::ip::tcp::socket &&socket){
+        auto &connection = *static_cast<BasicHttpClientConnection *>(context);
+        auto self = std::move(connection.m_connectingSelf);
+        connection.onConnected(error, std::move(socket));
+    }, this}
+{
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::start()
+{
+    const auto &host = *m_host;
+
+    if (!host.endpoints.empty() && espchrono::millis_clock::now() - host.resolvedAt < m_client->m_settings.resolveCacheTtl)
+    {
+        connect();
+        return;
+    }
+
+    m_resolver.async_resolve(host.host, host.port,
+                             [this, self=shared_from_this()](const std::error_code &error, asio::ip::tcp::resolver::iterator iterator) {
+                                 onResolved(error, iterator);
+                             });
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::onResolved(const std::error_code &error, asio::ip::tcp::resolver::iterator iterator)
+{
+    if (!m_client)
+        return;
+
+    auto &host = *m_host;
+
+    if (error)
+    {
+        connectFailed(fmt::format("Resolving {} failed: {}", host.host, error.message()));
+        return;
+    }
+
+    host.endpoints.clear();
+    for (; iterator != asio::ip::tcp::resolver::iterator{}; ++iterator)
+        host.endpoints.push_back(iterator->endpoint());
+    host.resolvedAt = espchrono::millis_clock::now();
+
+    connect();
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::connect()
+{
+    if (!m_client)
+        return;
+
+    m_connectingSelf = shared_from_this();
+    m_connector.connect(m_host->endpoints);
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::onConnected(const std::error_code &error, asio::ip::tcp::socket &&socket)
+{
+    if (!m_client)
+        return;
+
+    if (error)
+    {
+        connectFailed(fmt::format("Connecting to {}:{} failed: {}", m_host->host, m_host->port, error.message()));
+        return;
+    }
+
+    m_socket.lowest_layer() = std::move(socket);
+
+    std::error_code ec;
+    m_socket.lowest_layer().set_option(asio::ip::tcp::no_delay{true}, ec);
+
+    if constexpr (Base::secure)
+    {
+        Base::prepareHandshake(m_host->host, m_host->port);
+        m_socket.async_handshake(asio::ssl::stream_base::client,
+                                 [this, self=shared_from_this()](const std::error_code &error) {
+                                     onHandshaked(error);
+                                 });
+    }
+    else
+        connected();
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::onHandshaked(const std::error_code &error)
+{
+    if (!m_client)
+        return;
+
+    if (error)
+    {
+        connectFailed(fmt::format("TLS handshake with {} failed: {}", m_host->host, error.message()));
+        return;
+    }
+
+    m_handshaked = true;
+    connected();
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::doRead()
+{
+    m_socket.async_read_some(asio::buffer(m_receiveBuffer, std::size(m_receiveBuffer)),
+                             [this, self=shared_from_this()](const std::error_code &error, std::size_t length) {
+                                 onRead(error, std::string_view{m_receiveBuffer, length});
+                             });
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::doWrite()
+{
+    asio::async_write(m_socket, asio::buffer(m_writeBuffer.data(), m_writeBuffer.size()),
+                      [this, self=shared_from_this()](const std::error_code &error, std::size_t length) {
+                          onWritten(error);
+                      });
+}
+
+template<typename Stream>
+void BasicHttpClientConnection<Stream>::closeStream()
+{
+    if (m_connector.connecting())
+    {
+        m_connector.cancel();
+        // released after the cancelled attempts completed
+        asio::post(m_io_context, [self=std::move(m_connectingSelf)](){});
+    }
+
+    m_resolver.cancel();
+
+    // the next connection to that server resumes the tls session
+    if constexpr (Base::secure)
+        if (m_handshaked)
+            Base::storeSession(m_host->host, m_host->port);
+
+    std::error_code ec;
+    m_socket.lowest_layer().close(ec);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+// system includes
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <espchrono.h>
+
+// forward declarations
+class HttpClientConnection;
+class SslClientContext;
+
+struct HttpClientRequest
+{
+    std::string method{"GET"};
+    std::string target{"/"};
+    // Host, Content-Length and Connection are added by the client
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+// Receives the response of one request, like ResponseHandler on the server
+// side. Exactly one of responseFinished() and requestFailed() is called,
+// the handler is destroyed right after.
+class HttpClientResponseHandler
+{
+public:
+    virtual ~HttpClientResponseHandler() = default;
+
+    virtual void responseLineReceived(uint16_t status, std::string_view message) {}
+    virtual void responseHeaderReceived(std::string_view key, std::string_view value) {}
+    // body data as it arrives, never buffered, chunked encoding already removed
+    virtual void responseBodyReceived(std::string_view data) {}
+    virtual void responseFinished() = 0;
+    virtual void requestFailed(std::string_view message) = 0;
+};
+
+struct HttpClientSettings
+{
+    std::size_t maxConnectionsPerHost{4};
+    // more than one pipelines idempotent requests on a busy connection
+    std::size_t maxPipelineDepth{1};
+    std::chrono::milliseconds idleTimeout{std::chrono::seconds{30}};
+    // no response data for that long fails the requests in flight
+    std::chrono::milliseconds responseTimeout{std::chrono::seconds{30}};
+    std::chrono::seconds resolveCacheTtl{60};
+    // false sends Connection: close, every request gets a new connection
+    bool keepAlive{true};
+};
+
+// Async HTTP/1.1 client with a pool of keep-alive connections per
+// scheme://host:port. A request goes to an idle connection of its host,
+// or is pipelined onto a busy one, or opens a new connection up to
+// maxConnectionsPerHost, otherwise it waits in the queue of its host.
+// Idempotent requests which got no response byte before their connection
+// died (a server closing an idle connection) are retried once.
+// Requests are queued and completed without a lock, so everything has to
+// happen on the one thread running io_context.
+class HttpClient
+{
+public:
+    // TLS connections use SslClientContext::shared() if no context is given
+    explicit HttpClient(asio::io_context &io_context, std::shared_ptr<SslClientContext> sslContext = {});
+    // pending requests are dropped without calling their handlers
+    ~HttpClient();
+
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    const HttpClientSettings &settings() const { return m_settings; }
+    void setSettings(const HttpClientSettings &settings) { m_settings = settings; }
+
+    void request(bool secure, std::string_view host, std::string_view port,
+                 HttpClientRequest &&request, std::unique_ptr<HttpClientResponseHandler> &&handler);
+
+    struct Stats {
+        uint64_t requests{};
+        uint64_t responses{};
+        uint64_t failures{};
+        uint64_t connects{};          // connections opened
+        uint64_t reusedConnections{}; // requests sent over a connection which served one before
+        uint64_t pipelined{};         // requests sent while another was in flight
+        uint64_t retries{};
+    };
+
+    const Stats &stats() const { return m_stats; }
+
+    // open and connecting ones, of all hosts
+    std::size_t connections() const;
+    void closeIdleConnections();
+
+private:
+    friend class HttpClientConnection;
+    template<typename Stream> friend class BasicHttpClientConnection;
+
+    struct Pending
+    {
+        HttpClientRequest request;
+        std::unique_ptr<HttpClientResponseHandler> handler;
+        bool idempotent{};
+        bool head{};
+        uint8_t retries{};
+    };
+
+    struct Host
+    {
+        bool secure{};
+        std::string host;
+        std::string port;
+
+        std::vector<asio::ip::tcp::endpoint> endpoints;
+        espchrono::millis_clock::time_point resolvedAt;
+
+        std::deque<Pending> queue;
+        std::vector<std::shared_ptr<HttpClientConnection>> connections;
+    };
+
+    void dispatch(Host &host);
+    void openConnection(Host &host);
+    void removeConnection(Host &host, const HttpClientConnection &connection);
+    void failQueue(Host &host, std::string_view message);
+
+    asio::io_context &m_io_context;
+    std::shared_ptr<SslClientContext> m_sslContext;
+
+    HttpClientSettings m_settings;
+
+    // keyed by "http host:port" or "https host:port"
+    std::unordered_map<std::string, std::unique_ptr<Host>> m_hosts;
+
+    Stats m_stats;
+};
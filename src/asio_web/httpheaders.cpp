@@ -0,0 +1,29 @@
+#include "httpheaders.h"
+
+// 3rdparty lib includes
+#include <strutils.h>
+
+namespace {
+std::string_view trim(std::string_view str)
+{
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+        str.remove_prefix(1);
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+        str.remove_suffix(1);
+    return str;
+}
+} // namespace
+
+bool httpHeaderContainsToken(std::string_view value, std::string_view token)
+{
+    while (!value.empty())
+    {
+        const auto comma = value.find(',');
+        if (cpputils::stringEqualsIgnoreCase(trim(value.substr(0, comma)), token))
+            return true;
+        if (comma == std::string_view::npos)
+            break;
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// system includes
+#include <string_view>
+
+// true if a comma separated header value like "Connection: keep-alive,
+// Upgrade" lists token, compared case insensitive
+bool httpHeaderContainsToken(std::string_view value, std::string_view token);
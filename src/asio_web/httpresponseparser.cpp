@@ -0,0 +1,303 @@
+#include "httpresponseparser.h"
+
+// system includes
+#include <algorithm>
+#include <limits>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <numberparsing.h>
+#include <strutils.h>
+
+// local includes
+#include "httpheaders.h"
+
+namespace {
+std::string_view trim(std::string_view str)
+{
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+        str.remove_prefix(1);
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+        str.remove_suffix(1);
+    return str;
+}
+} // namespace
+
+void HttpResponseParser::reset(bool headRequest)
+{
+    m_state = State::ResponseLine;
+    m_headRequest = headRequest;
+    m_line.clear();
+    m_lineConsumed = false;
+    m_http11 = false;
+    m_status = 0;
+    m_message = {};
+    m_headerKey = {};
+    m_headerValue = {};
+    m_body = {};
+    m_error.clear();
+    m_chunked = false;
+    m_contentLength = std::nullopt;
+    m_connectionClose = false;
+    m_connectionKeepAlive = false;
+    m_remaining = 0;
+}
+
+HttpResponseParser::Event HttpResponseParser::parse(std::string_view &input)
+{
+    while (true)
+    {
+        switch (m_state)
+        {
+        case State::ResponseLine:
+        {
+            const auto line = readLine(input);
+            if (!line)
+                return m_state == State::Failed ? Event::Error : Event::NeedMore;
+            // empty lines before the response line are ignored (RFC 9112 2.2)
+            if (line->empty())
+                continue;
+            return parseResponseLine(*line);
+        }
+        case State::Headers:
+        {
+            const auto line = readLine(input);
+            if (!line)
+                return m_state == State::Failed ? Event::Error : Event::NeedMore;
+            if (line->empty())
+                return headersComplete();
+            return parseHeader(*line);
+        }
+        case State::Body:
+        case State::ChunkData:
+        {
+            if (input.empty())
+                return Event::NeedMore;
+
+            const auto length = std::min(m_remaining, input.size());
+            m_body = input.substr(0, length);
+            input.remove_prefix(length);
+            m_remaining -= length;
+            if (!m_remaining)
+                m_state = m_state == State::Body ? State::Complete : State::ChunkDataEnd;
+            return Event::Body;
+        }
+        case State::ChunkSize:
+        {
+            const auto line = readLine(input);
+            if (!line)
+                return m_state == State::Failed ? Event::Error : Event::NeedMore;
+            if (!parseChunkSize(*line))
+                return fail(fmt::format("invalid chunk size: \"{}\"", *line));
+            m_state = m_remaining ? State::ChunkData : State::Trailers;
+            continue;
+        }
+        case State::ChunkDataEnd:
+        {
+            const auto line = readLine(input);
+            if (!line)
+                return m_state == State::Failed ? Event::Error : Event::NeedMore;
+            if (!line->empty())
+                return fail("chunk not terminated by a line break");
+            m_state = State::ChunkSize;
+            continue;
+        }
+        case State::Trailers:
+        {
+            // trailer fields are not handed out
+            const auto line = readLine(input);
+            if (!line)
+                return m_state == State::Failed ? Event::Error : Event::NeedMore;
+            if (line->empty())
+                m_state = State::Complete;
+            continue;
+        }
+        case State::UntilClose:
+            if (input.empty())
+                return Event::NeedMore;
+            m_body = input;
+            input = {};
+            return Event::Body;
+        case State::Complete:
+            return Event::Complete;
+        case State::Failed:
+            return Event::Error;
+        }
+    }
+}
+
+bool HttpResponseParser::finish()
+{
+    if (m_state == State::UntilClose)
+        m_state = State::Complete;
+    return m_state == State::Complete;
+}
+
+bool HttpResponseParser::keepAlive() const
+{
+    if (m_connectionClose || m_status == 101)
+        return false;
+    if (!m_chunked && !m_contentLength && !m_headRequest && m_status >= 200 && m_status != 204 && m_status != 304)
+        return false; // the body ends with the connection
+    return m_http11 || m_connectionKeepAlive;
+}
+
+std::optional<std::string_view> HttpResponseParser::readLine(std::string_view &input)
+{
+    // the last line handed out is not needed anymore, the next one must not
+    // be appended to it
+    if (m_lineConsumed)
+    {
+        m_line.clear();
+        m_lineConsumed = false;
+    }
+
+    const auto newLine = input.find('\n');
+    if (newLine == std::string_view::npos)
+    {
+        if (m_line.size() + input.size() > maxLineLength)
+        {
+            fail("line too long");
+            return std::nullopt;
+        }
+        m_line.append(input);
+        input = {};
+        return std::nullopt;
+    }
+
+    std::string_view line;
+    if (m_line.empty())
+        line = input.substr(0, newLine);
+    else
+    {
+        m_line.append(input.substr(0, newLine));
+        line = m_line;
+    }
+    input.remove_prefix(newLine + 1);
+    m_lineConsumed = true;
+
+    if (line.size() > maxLineLength)
+    {
+        fail("line too long");
+        return std::nullopt;
+    }
+
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+
+    return line;
+}
+
+HttpResponseParser::Event HttpResponseParser::parseResponseLine(std::string_view line)
+{
+    const auto index = line.find(' ');
+    if (index == std::string_view::npos)
+        return fail(fmt::format("invalid response line: \"{}\"", line));
+
+    const std::string_view protocol{line.data(), index};
+    if (protocol == "HTTP/1.1")
+        m_http11 = true;
+    else if (protocol != "HTTP/1.0")
+        return fail(fmt::format("invalid response protocol: \"{}\"", protocol));
+
+    // the reason phrase may be missing altogether
+    const auto index2 = line.find(' ', index + 1);
+    const std::string_view status = line.substr(index + 1, index2 == std::string_view::npos ? std::string_view::npos : index2 - index - 1);
+    if (status.size() != 3 || !std::all_of(std::begin(status), std::end(status), [](char c){ return c >= '0' && c <= '9'; }))
+        return fail(fmt::format("invalid response status: \"{}\"", status));
+
+    m_status = (status[0] - '0') * 100 + (status[1] - '0') * 10 + (status[2] - '0');
+    m_message = index2 == std::string_view::npos ? std::string_view{} : line.substr(index2 + 1);
+
+    m_state = State::Headers;
+
+    return Event::ResponseLine;
+}
+
+HttpResponseParser::Event HttpResponseParser::parseHeader(std::string_view line)
+{
+    const auto index = line.find(':');
+    if (index == std::string_view::npos || index == 0)
+        return fail(fmt::format("invalid response header: \"{}\"", line));
+
+    m_headerKey = line.substr(0, index);
+    m_headerValue = trim(line.substr(index + 1));
+
+    if (cpputils::stringEqualsIgnoreCase(m_headerKey, "Content-Length"))
+    {
+        const auto parsed = cpputils::fromString<std::size_t>(m_headerValue);
+        if (!parsed)
+            return fail(fmt::format("invalid Content-Length: \"{}\": {}", m_headerValue, parsed.error()));
+        if (m_contentLength && *m_contentLength != *parsed)
+            return fail("conflicting Content-Length headers");
+        m_contentLength = *parsed;
+    }
+    else if (cpputils::stringEqualsIgnoreCase(m_headerKey, "Transfer-Encoding"))
+    {
+        if (httpHeaderContainsToken(m_headerValue, "chunked"))
+            m_chunked = true;
+    }
+    else if (cpputils::stringEqualsIgnoreCase(m_headerKey, "Connection"))
+    {
+        if (httpHeaderContainsToken(m_headerValue, "close"))
+            m_connectionClose = true;
+        if (httpHeaderContainsToken(m_headerValue, "keep-alive"))
+            m_connectionKeepAlive = true;
+    }
+
+    return Event::Header;
+}
+
+HttpResponseParser::Event HttpResponseParser::headersComplete()
+{
+    // RFC 9112 6.3: these never have a body, chunked wins over Content-Length
+    if (m_headRequest || m_status < 200 || m_status == 204 || m_status == 304)
+        m_state = State::Complete;
+    else if (m_chunked)
+        m_state = State::ChunkSize;
+    else if (m_contentLength)
+    {
+        m_remaining = *m_contentLength;
+        m_state = m_remaining ? State::Body : State::Complete;
+    }
+    else
+        m_state = State::UntilClose;
+
+    return Event::HeadersComplete;
+}
+
+bool HttpResponseParser::parseChunkSize(std::string_view line)
+{
+    // chunk extensions are ignored
+    line = trim(line.substr(0, line.find(';')));
+    if (line.empty())
+        return false;
+
+    std::size_t size{};
+    for (const char c : line)
+    {
+        unsigned digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            return false;
+
+        if (size > (std::numeric_limits<std::size_t>::max() >> 4))
+            return false;
+        size = (size << 4) | digit;
+    }
+
+    m_remaining = size;
+    return true;
+}
+
+HttpResponseParser::Event HttpResponseParser::fail(std::string &&error)
+{
+    m_error = std::move(error);
+    m_state = State::Failed;
+    return Event::Error;
+}
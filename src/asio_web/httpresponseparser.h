@@ -0,0 +1,78 @@
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Incremental HTTP/1.1 response parser, shared by the upgrade of the
+// websocket client and HttpClient. parse() consumes from the front of
+// input and returns one event at a time, the views handed out stay valid
+// until the next call. Body data is never copied, a Body event points into
+// input with chunked encoding already removed. Whatever follows a complete
+// response is left in input (pipelined responses, websocket frames).
+class HttpResponseParser
+{
+public:
+    enum class Event { NeedMore, ResponseLine, Header, HeadersComplete, Body, Complete, Error };
+
+    static constexpr std::size_t maxLineLength{8 * 1024};
+
+    // a response to HEAD has no body, whatever its headers say
+    void reset(bool headRequest = false);
+
+    Event parse(std::string_view &input);
+
+    // the peer closed the connection, completes a body which is delimited
+    // by the close, returns false if the response was cut off
+    bool finish();
+
+    uint16_t status() const { return m_status; }
+    std::string_view message() const { return m_message; }   // ResponseLine only
+    std::string_view headerKey() const { return m_headerKey; }     // Header only
+    std::string_view headerValue() const { return m_headerValue; } // Header only
+    std::string_view body() const { return m_body; }               // Body only
+    std::string_view error() const { return m_error; }
+
+    // known once the headers are complete
+    bool chunked() const { return m_chunked; }
+    const std::optional<std::size_t> &contentLength() const { return m_contentLength; }
+    // whether the connection may carry another request afterwards
+    bool keepAlive() const;
+
+    bool complete() const { return m_state == State::Complete; }
+
+private:
+    enum class State { ResponseLine, Headers, Body, ChunkSize, ChunkData, ChunkDataEnd, Trailers, UntilClose, Complete, Failed };
+
+    std::optional<std::string_view> readLine(std::string_view &input);
+    Event parseResponseLine(std::string_view line);
+    Event parseHeader(std::string_view line);
+    Event headersComplete();
+    bool parseChunkSize(std::string_view line);
+    Event fail(std::string &&error);
+
+    State m_state{State::ResponseLine};
+    bool m_headRequest{};
+
+    // a line split over several reads, complete lines are taken from input
+    std::string m_line;
+    bool m_lineConsumed{};
+
+    bool m_http11{};
+    uint16_t m_status{};
+    std::string_view m_message;
+    std::string_view m_headerKey;
+    std::string_view m_headerValue;
+    std::string_view m_body;
+    std::string m_error;
+
+    bool m_chunked{};
+    std::optional<std::size_t> m_contentLength;
+    bool m_connectionClose{};
+    bool m_connectionKeepAlive{};
+
+    std::size_t m_remaining{};
+};
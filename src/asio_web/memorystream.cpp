@@ -0,0 +1,173 @@
+#include "memorystream.h"
+
+// system includes
+#include <algorithm>
+
+std::pair<MemoryStream, MemoryStream> MemoryStream::pipe(executor_type executor, const MemoryStreamSettings &first,
+                                                         const MemoryStreamSettings &second)
+{
+    const auto state = std::make_shared<State>();
+
+    const MemoryStreamSettings *settings[] {&first, &second};
+    for (uint8_t end = 0; end < 2; end++)
+    {
+        auto &direction = state->directions[end];
+        direction.maxReadSize = settings[end]->maxReadSize;
+        direction.randomChunks = settings[end]->randomSeed;
+        direction.random.seed(settings[end]->randomSeed);
+    }
+
+    return {
+        MemoryStream{state, 0, executor, first.remoteEndpoint},
+        MemoryStream{state, 1, std::move(executor), second.remoteEndpoint}
+    };
+}
+
+MemoryStream::MemoryStream(std::shared_ptr<State> state, uint8_t end, executor_type executor, const asio::ip::tcp::endpoint &remoteEndpoint) :
+    m_state{std::move(state)}, m_end{end}, m_executor{std::move(executor)}, m_remoteEndpoint{remoteEndpoint}
+{
+}
+
+MemoryStream::~MemoryStream()
+{
+    // a pending read of the peer would wait forever otherwise
+    if (m_state)
+    {
+        std::error_code ec;
+        close(ec);
+    }
+}
+
+asio::ip::tcp::endpoint MemoryStream::remote_endpoint(std::error_code &ec) const
+{
+    if (!is_open())
+    {
+        ec = asio::error::bad_descriptor;
+        return {};
+    }
+
+    ec = {};
+    return m_remoteEndpoint;
+}
+
+bool MemoryStream::is_open() const
+{
+    return m_state->open[m_end];
+}
+
+void MemoryStream::close(std::error_code &ec)
+{
+    ec = {};
+
+    if (!is_open())
+        return;
+
+    m_state->open[m_end] = false;
+
+    auto &in = incoming();
+    in.buffer.clear();
+    in.offset = 0;
+    if (in.readHandler)
+        std::exchange(in.readHandler, {})(asio::error::operation_aborted, 0);
+
+    auto &out = outgoing();
+    out.ended = true;
+    deliver(out);
+}
+
+void MemoryStream::shutdown(asio::socket_base::shutdown_type what, std::error_code &ec)
+{
+    ec = {};
+
+    if (!is_open())
+    {
+        ec = asio::error::bad_descriptor;
+        return;
+    }
+
+    // nothing to do for the receiving side, the peer writes into memory
+    if (what == asio::socket_base::shutdown_receive)
+        return;
+
+    auto &out = outgoing();
+    out.ended = true;
+    deliver(out);
+}
+
+std::size_t MemoryStream::available() const
+{
+    const auto &in = m_state->directions[m_end];
+    return in.buffer.size() - in.offset;
+}
+
+void MemoryStream::read(asio::mutable_buffer buffer, Handler &&handler)
+{
+    if (!is_open())
+    {
+        handler(asio::error::bad_descriptor, 0);
+        return;
+    }
+
+    auto &in = incoming();
+    in.readBuffer = buffer;
+    in.readHandler = std::move(handler);
+    deliver(in);
+}
+
+void MemoryStream::write(std::string_view data, std::error_code &ec)
+{
+    if (!is_open())
+    {
+        ec = asio::error::bad_descriptor;
+        return;
+    }
+
+    auto &out = outgoing();
+    if (out.ended || !m_state->open[m_end ^ 1])
+    {
+        ec = asio::error::broken_pipe;
+        return;
+    }
+
+    out.buffer += data;
+    deliver(out);
+}
+
+void MemoryStream::deliver(Direction &direction)
+{
+    if (!direction.readHandler)
+        return;
+
+    const auto available = direction.buffer.size() - direction.offset;
+    if (!available)
+    {
+        if (direction.ended)
+            std::exchange(direction.readHandler, {})(asio::error::eof, 0);
+        // a read of nothing completes at once, as with a socket
+        else if (!direction.readBuffer.size())
+            std::exchange(direction.readHandler, {})({}, 0);
+        return;
+    }
+
+    auto size = std::min(available, direction.readBuffer.size());
+    if (direction.maxReadSize)
+        size = std::min(size, direction.maxReadSize);
+    if (direction.randomChunks && size > 1)
+        size = 1 + direction.random() % size;
+
+    std::copy_n(direction.buffer.data() + direction.offset, size, static_cast<char *>(direction.readBuffer.data()));
+    direction.offset += size;
+
+    if (direction.offset == direction.buffer.size())
+    {
+        direction.buffer.clear();
+        direction.offset = 0;
+    }
+    else if (direction.offset > direction.buffer.size() / 2)
+    {
+        direction.buffer.erase(0, direction.offset);
+        direction.offset = 0;
+    }
+
+    std::exchange(direction.readHandler, {})({}, size);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+// esp-idf includes
+#include <asio.hpp>
+
+struct MemoryStreamSettings
+{
+    // largest read completion of this end, 0 for everything buffered
+    std::size_t maxReadSize{};
+    // with a seed every read completes with 1 to maxReadSize bytes (or to
+    // everything buffered), the same sizes for the same seed
+    uint32_t randomSeed{};
+    // what remote_endpoint() returns
+    asio::ip::tcp::endpoint remoteEndpoint{asio::ip::address_v4::loopback(), 0};
+};
+
+// One end of an in-memory duplex pipe, to run the request path of a
+// Webserver (see Webserver::acceptStream()) or anything else written
+// against AsyncReadStream and AsyncWriteStream in one process, without
+// sockets and syscalls. Writes complete at once, the data waits for the
+// peer without limit. Reads can be cut into chunks to exercise parsers at
+// every split point. Not thread safe, both ends belong to one io_context.
+class MemoryStream
+{
+public:
+    using executor_type = asio::any_io_executor;
+    using Handler = std::move_only_function<void(std::error_code, std::size_t)>;
+
+    // two connected ends, what is written to one is read from the other
+    static std::pair<MemoryStream, MemoryStream> pipe(executor_type executor, const MemoryStreamSettings &first = {},
+                                                       const MemoryStreamSettings &second = {});
+
+    MemoryStream(MemoryStream &&) = default;
+    MemoryStream &operator=(MemoryStream &&) = default;
+    ~MemoryStream();
+
+    executor_type get_executor() { return m_executor; }
+
+    template<typename MutableBufferSequence, typename ReadToken>
+    auto async_read_some(const MutableBufferSequence &buffers, ReadToken &&token)
+    {
+        return asio::async_initiate<ReadToken, void(std::error_code, std::size_t)>([this](auto handler, const MutableBufferSequence &buffers){
+            read(*asio::buffer_sequence_begin(buffers), wrap(std::move(handler)));
+        }, token, buffers);
+    }
+
+    template<typename ConstBufferSequence, typename WriteToken>
+    auto async_write_some(const ConstBufferSequence &buffers, WriteToken &&token)
+    {
+        return asio::async_initiate<WriteToken, void(std::error_code, std::size_t)>([this](auto handler, const ConstBufferSequence &buffers){
+            std::size_t size{};
+            std::error_code ec;
+            for (auto iter = asio::buffer_sequence_begin(buffers); iter != asio::buffer_sequence_end(buffers) && !ec; ++iter)
+            {
+                const asio::const_buffer buffer{*iter};
+                write({static_cast<const char *>(buffer.data()), buffer.size()}, ec);
+                if (!ec)
+                    size += buffer.size();
+            }
+            wrap(std::move(handler))(ec, size);
+        }, token, buffers);
+    }
+
+    // the socket operations of ClientStream
+    asio::ip::tcp::endpoint remote_endpoint(std::error_code &ec) const;
+    bool is_open() const;
+    // the peer reads eof, a pending read of this end is aborted
+    void close(std::error_code &ec);
+    // shutdown_send lets the peer read eof once it read everything before
+    void shutdown(asio::socket_base::shutdown_type what, std::error_code &ec);
+    template<typename SettableSocketOption>
+    void set_option(const SettableSocketOption &, std::error_code &ec) { ec = {}; }
+
+    // written by the peer and not read yet
+    std::size_t available() const;
+
+private:
+    struct Direction
+    {
+        std::string buffer;
+        std::size_t offset{};
+        bool ended{}; // the writer shut down or closed
+
+        // chunking of the reader
+        std::size_t maxReadSize{};
+        bool randomChunks{};
+        std::minstd_rand random;
+
+        asio::mutable_buffer readBuffer;
+        Handler readHandler;
+    };
+
+    struct State
+    {
+        Direction directions[2]; // what end 0 and end 1 read
+        bool open[2]{true, true};
+    };
+
+    MemoryStream(std::shared_ptr<State> state, uint8_t end, executor_type executor, const asio::ip::tcp::endpoint &remoteEndpoint);
+
+    // completions are never invoked from within the initiating function
+    template<typename CompletionHandler>
+    Handler wrap(CompletionHandler &&handler)
+    {
+        return [handler=std::move(handler), executor=m_executor](std::error_code ec, std::size_t length) mutable {
+            const auto handlerExecutor = asio::get_associated_executor(handler, executor);
+            asio::post(handlerExecutor, [handler=std::move(handler), ec, length]() mutable { handler(ec, length); });
+        };
+    }
+
+    Direction &incoming() { return m_state->directions[m_end]; }
+    Direction &outgoing() { return m_state->directions[m_end ^ 1]; }
+
+    void read(asio::mutable_buffer buffer, Handler &&handler);
+    void write(std::string_view data, std::error_code &ec);
+    static void deliver(Direction &direction);
+
+    std::shared_ptr<State> m_state;
+    uint8_t m_end;
+    executor_type m_executor;
+    asio::ip::tcp::endpoint m_remoteEndpoint;
+};
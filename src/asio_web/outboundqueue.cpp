@@ -0,0 +1,308 @@
+#include "outboundqueue.h"
+
+// system includes
+#include <algorithm>
+#include <cassert>
+
+OutboundQueue::OutboundQueue(const OutboundQueueSettings &settings, OutboundMemoryBudget *budget) :
+    m_settings{settings},
+    m_budget{budget}
+{
+}
+
+OutboundQueue::~OutboundQueue()
+{
+    clear();
+}
+
+void OutboundQueue::setBudget(OutboundMemoryBudget *budget)
+{
+    if (m_budget)
+        m_budget->release(m_bytes);
+    m_budget = budget;
+    if (m_budget)
+        m_budget->acquire(m_bytes);
+}
+
+OutboundQueue::PushResult OutboundQueue::push(WebsocketFrame &&frame, std::string_view key, MessagePriority priority)
+{
+    std::vector<WebsocketFrame> fragments;
+    fragments.push_back(std::move(frame));
+    return push(std::move(fragments), true, key, priority);
+}
+
+OutboundQueue::PushResult OutboundQueue::push(std::vector<WebsocketFrame> &&fragments, bool fin,
+                                              std::string_view key, MessagePriority priority)
+{
+    if (fragments.empty())
+        return PushResult::Queued;
+
+    // a message may only be inserted where no other message is open
+    std::size_t pushed = m_frames.size();
+    if (priority == MessagePriority::High)
+        for (auto i = firstUntouched(); i < m_frames.size(); i = messageEnd(i))
+            if (m_frames[i]->priority == MessagePriority::Normal)
+            {
+                pushed = i;
+                break;
+            }
+
+    const std::size_t count = fragments.size();
+    std::size_t size{};
+    {
+        auto iter = std::next(std::begin(m_frames), pushed);
+        for (auto &fragment : fragments)
+        {
+            size += fragment.size();
+            iter = std::next(m_frames.insert(iter, std::make_unique<Frame>(Frame{ .frame = std::move(fragment), .key = std::string{key}, .last = false, .priority = priority })));
+        }
+        (*std::prev(iter))->last = fin;
+    }
+
+    m_bytes += size;
+    if (m_budget)
+        m_budget->acquire(size);
+
+    if (!aboveHighWater())
+        return PushResult::Queued;
+
+    switch (m_settings.policy)
+    {
+    case SlowConsumerPolicy::Disconnect:
+        erase(pushed, pushed + count);
+        return PushResult::Disconnect;
+
+    case SlowConsumerPolicy::Backpressure:
+        if (m_backpressured)
+            return PushResult::Queued;
+        m_backpressured = true;
+        return PushResult::Backpressure;
+
+    case SlowConsumerPolicy::CoalesceByKey:
+        if (!key.empty() && fin)
+        {
+            for (auto i = firstUntouched(); i < m_frames.size(); i = messageEnd(i))
+            {
+                if (i == pushed || m_frames[i]->key != key)
+                    continue;
+
+                const auto end = messageEnd(i);
+                if (!m_frames[end - 1]->last)
+                    break;
+
+                // the new message takes the place of the old one
+                erase(i, end);
+                const auto begin = std::begin(m_frames);
+                if (i < pushed)
+                {
+                    pushed -= end - i;
+                    std::rotate(std::next(begin, i), std::next(begin, pushed), std::next(begin, pushed + count));
+                }
+                else
+                    std::rotate(std::next(begin, pushed), std::next(begin, pushed + count), std::next(begin, i));
+
+                m_coalescedFrames += end - i;
+                return PushResult::Coalesced;
+            }
+        }
+        [[fallthrough]];
+
+    case SlowConsumerPolicy::DropOldest:
+    {
+        bool dropped{};
+        while (aboveHighWater() && dropOldest(pushed))
+            dropped = true;
+        return dropped ? PushResult::DroppedOldest : PushResult::Queued;
+    }
+    }
+
+    return PushResult::Queued;
+}
+
+void OutboundQueue::pushControl(WebsocketFrame &&frame)
+{
+    const auto size = frame.size();
+
+    m_control.push_back(Frame{ .frame = std::move(frame) });
+    m_bytes += size;
+    if (m_budget)
+        m_budget->acquire(size);
+}
+
+const OutboundQueue::Frame &OutboundQueue::beginWrite()
+{
+    beginWriteBatch(0);
+    return writingFrame(0);
+}
+
+std::size_t OutboundQueue::beginWriteBatch(std::size_t maxBytes)
+{
+    assert(!empty() && !writing());
+
+    std::size_t size{};
+    const auto fits = [&](const Frame &frame){
+        if (writing() && size + frame.frame.size() > maxBytes)
+            return false;
+        size += frame.frame.size();
+        return true;
+    };
+
+    while (m_writingControl < m_control.size() && fits(m_control[m_writingControl]))
+        m_writingControl++;
+
+    if (m_writingControl == m_control.size())
+        while (m_writingData < m_frames.size() && fits(*m_frames[m_writingData]))
+            m_writingData++;
+
+    return m_writingControl + m_writingData;
+}
+
+const OutboundQueue::Frame &OutboundQueue::writingFrame(std::size_t index) const
+{
+    assert(index < m_writingControl + m_writingData);
+
+    if (index < m_writingControl)
+        return m_control[index];
+    return *m_frames[index - m_writingControl];
+}
+
+bool OutboundQueue::finishWrite()
+{
+    assert(writing());
+
+    if (m_writingControl)
+    {
+        const auto end = std::next(std::begin(m_control), m_writingControl);
+
+        std::size_t size{};
+        for (auto iter = std::begin(m_control); iter != end; iter++)
+            size += iter->frame.size();
+
+        m_bytes -= size;
+        if (m_budget)
+            m_budget->release(size);
+        m_control.erase(std::begin(m_control), end);
+    }
+
+    if (m_writingData)
+    {
+        m_messageOpen = !m_frames[m_writingData - 1]->last;
+        erase(0, m_writingData);
+    }
+
+    m_writingControl = 0;
+    m_writingData = 0;
+
+    if (m_backpressured && belowLowWater())
+    {
+        m_backpressured = false;
+        return true;
+    }
+
+    return false;
+}
+
+void OutboundQueue::abortWrite()
+{
+    finishWrite();
+    m_messageOpen = false;
+}
+
+void OutboundQueue::dropUnlocked()
+{
+    const auto first = std::next(std::begin(m_control), m_writingControl);
+
+    std::size_t size{};
+    for (auto iter = first; iter != std::end(m_control); iter++)
+        size += iter->frame.size();
+
+    m_bytes -= size;
+    if (m_budget)
+        m_budget->release(size);
+    m_control.erase(first, std::end(m_control));
+
+    erase(m_writingData, m_frames.size());
+
+    m_messageOpen = false;
+    m_backpressured = false;
+}
+
+void OutboundQueue::clear()
+{
+    if (m_budget)
+        m_budget->release(m_bytes);
+    m_frames.clear();
+    m_control.clear();
+    m_bytes = 0;
+    m_writingControl = 0;
+    m_writingData = 0;
+    m_messageOpen = false;
+    m_backpressured = false;
+}
+
+bool OutboundQueue::aboveHighWater() const
+{
+    return m_bytes > m_settings.highWaterBytes ||
+           frames() > m_settings.highWaterFrames ||
+           (m_budget && m_budget->exceeded());
+}
+
+bool OutboundQueue::belowLowWater() const
+{
+    return m_bytes <= m_settings.lowWaterBytes &&
+           frames() <= m_settings.lowWaterFrames &&
+           !(m_budget && m_budget->exceeded());
+}
+
+std::size_t OutboundQueue::firstUntouched() const
+{
+    // skip the locked frames and the remaining fragments of the message on the wire
+    if (m_writingData ? !m_frames[m_writingData - 1]->last : m_messageOpen)
+        return messageEnd(m_writingData);
+    return m_writingData;
+}
+
+std::size_t OutboundQueue::messageEnd(std::size_t begin) const
+{
+    while (begin < m_frames.size())
+        if (m_frames[begin++]->last)
+            break;
+    return begin;
+}
+
+bool OutboundQueue::dropOldest(std::size_t &pushed)
+{
+    // never drop the message on the wire nor the one that was just pushed
+    for (auto i = firstUntouched(); i < m_frames.size(); i = messageEnd(i))
+    {
+        if (i == pushed)
+            continue;
+
+        const auto end = messageEnd(i);
+        if (!m_frames[end - 1]->last)
+            return false;
+
+        erase(i, end);
+        if (pushed > i)
+            pushed -= end - i;
+        m_droppedFrames += end - i;
+        return true;
+    }
+
+    return false;
+}
+
+void OutboundQueue::erase(std::size_t begin, std::size_t end)
+{
+    const auto first = std::next(std::begin(m_frames), begin);
+    const auto last = std::next(std::begin(m_frames), end);
+
+    std::size_t size{};
+    for (auto iter = first; iter != last; iter++)
+        size += (*iter)->frame.size();
+
+    m_bytes -= size;
+    if (m_budget)
+        m_budget->release(size);
+    m_frames.erase(first, last);
+}
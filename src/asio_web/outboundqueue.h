@@ -0,0 +1,173 @@
+#pragma once
+
+// system includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// local includes
+#include "websocketstream.h"
+
+enum class SlowConsumerPolicy : uint8_t
+{
+    DropOldest,    // discard the oldest queued frames
+    CoalesceByKey, // replace a queued frame with the same key, otherwise DropOldest
+    Disconnect,    // give up on the peer
+    Backpressure,  // keep queueing, the producer gets notified to pause
+};
+
+enum class MessagePriority : uint8_t
+{
+    Normal,
+    High, // overtakes queued normal messages, but never splits a fragmented message already on the wire
+};
+
+struct OutboundQueueSettings
+{
+    std::size_t highWaterBytes{64 * 1024};
+    std::size_t lowWaterBytes{16 * 1024};
+    std::size_t highWaterFrames{256};
+    std::size_t lowWaterFrames{64};
+    SlowConsumerPolicy policy{SlowConsumerPolicy::DropOldest};
+    std::size_t maxFragmentSize{16 * 1024}; // larger messages are sent as continuation frames, 0 disables
+    std::size_t maxBatchSize{16 * 1024}; // queued frames written together with one write (about one tls record), 0 writes them one by one
+};
+
+// Counts the bytes queued for sending over many connections, limit 0 means unlimited
+class OutboundMemoryBudget
+{
+public:
+    explicit OutboundMemoryBudget(std::size_t limit = 0) : m_limit{limit} {}
+
+    std::size_t used() const { return m_used.load(std::memory_order_relaxed); }
+    std::size_t limit() const { return m_limit.load(std::memory_order_relaxed); }
+    void setLimit(std::size_t limit) { m_limit.store(limit, std::memory_order_relaxed); }
+
+    bool exceeded() const { const auto l = limit(); return l && used() > l; }
+
+    void acquire(std::size_t bytes) { m_used.fetch_add(bytes, std::memory_order_relaxed); }
+    void release(std::size_t bytes) { m_used.fetch_sub(bytes, std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::size_t> m_used{};
+    std::atomic<std::size_t> m_limit;
+};
+
+// Per connection queue of encoded frames waiting to be written. Payloads
+// are referenced, not copied, so a broadcast payload is shared by all queues. Data
+// messages may consist of several fragments, they are dropped or coalesced
+// as a whole and only before their first fragment went out. Control frames
+// have their own lane and are written between any two fragments, so a large
+// message does not hold back pings or close frames.
+class OutboundQueue
+{
+public:
+    struct Frame
+    {
+        WebsocketFrame frame;
+        std::string key;
+        bool last{true}; // last fragment of its message
+        MessagePriority priority{MessagePriority::Normal};
+    };
+
+    enum class PushResult : uint8_t
+    {
+        Queued,
+        Coalesced,
+        DroppedOldest,
+        Backpressure, // queued, but crossed the high water mark
+        Disconnect,   // not queued, the connection should be closed
+    };
+
+    explicit OutboundQueue(const OutboundQueueSettings &settings = {}, OutboundMemoryBudget *budget = nullptr);
+    ~OutboundQueue();
+
+    OutboundQueue(const OutboundQueue &) = delete;
+    OutboundQueue &operator=(const OutboundQueue &) = delete;
+
+    const OutboundQueueSettings &settings() const { return m_settings; }
+    void setSettings(const OutboundQueueSettings &settings) { m_settings = settings; }
+
+    void setBudget(OutboundMemoryBudget *budget);
+
+    // queues a complete single frame data message
+    PushResult push(WebsocketFrame &&frame, std::string_view key = {},
+                    MessagePriority priority = MessagePriority::Normal);
+
+    // queues the fragments of a data message, fin is false if the caller
+    // continues the message with further pushes
+    PushResult push(std::vector<WebsocketFrame> &&fragments, bool fin, std::string_view key = {},
+                    MessagePriority priority = MessagePriority::Normal);
+
+    // control frames are not subject to the slow consumer policy
+    void pushControl(WebsocketFrame &&frame);
+
+    bool empty() const { return m_frames.empty() && m_control.empty(); }
+    std::size_t frames() const { return m_frames.size() + m_control.size(); }
+    std::size_t bytes() const { return m_bytes; }
+
+    bool writing() const { return m_writingControl || m_writingData; }
+    bool backpressured() const { return m_backpressured; }
+
+    std::size_t droppedFrames() const { return m_droppedFrames; }
+    std::size_t coalescedFrames() const { return m_coalescedFrames; }
+
+    // locks and returns the next frame to write, control frames go first,
+    // only valid if !empty() && !writing()
+    const Frame &beginWrite();
+
+    // locks as many frames as fit into maxBytes, but at least one, and
+    // returns their count. Data frames are only added once all control
+    // frames are in. Same preconditions as beginWrite().
+    std::size_t beginWriteBatch(std::size_t maxBytes);
+
+    // the index-th locked frame, in the order they have to be written
+    const Frame &writingFrame(std::size_t index) const;
+
+    // pops the written frames, returns true if the queue just fell below the
+    // low water marks while being backpressured
+    bool finishWrite();
+
+    // pops the locked frames of a write which failed or belongs to a closed
+    // connection, the next message starts from scratch
+    void abortWrite();
+
+    // drops everything but the locked frames, a write on the wire still
+    // references them
+    void dropUnlocked();
+
+    void clear();
+
+private:
+    bool aboveHighWater() const;
+    bool belowLowWater() const;
+    std::size_t firstUntouched() const;
+    std::size_t messageEnd(std::size_t begin) const;
+    bool dropOldest(std::size_t &pushed);
+    void erase(std::size_t begin, std::size_t end);
+
+    OutboundQueueSettings m_settings;
+    OutboundMemoryBudget *m_budget;
+
+    // A write on the wire references the headers of the locked frames, but
+    // high priority pushes, drops and coalescing insert and erase in the
+    // middle, which shifts deque elements. Data frames therefore live on the
+    // heap. Control frames are only appended and popped at the ends.
+    std::deque<std::unique_ptr<Frame>> m_frames;
+    std::deque<Frame> m_control;
+    std::size_t m_bytes{};
+
+    // locked frames at the front of m_control and m_frames
+    std::size_t m_writingControl{};
+    std::size_t m_writingData{};
+    bool m_messageOpen{}; // the last written data frame was not the last fragment
+    bool m_backpressured{};
+
+    std::size_t m_droppedFrames{};
+    std::size_t m_coalescedFrames{};
+};
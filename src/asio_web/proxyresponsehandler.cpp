@@ -0,0 +1,599 @@
+#include "proxyresponsehandler.h"
+
+// system includes
+#include <array>
+#include <utility>
+
+// esp-idf includes
+#include <esp_log.h>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <numberparsing.h>
+#include <strutils.h>
+
+// local includes
+#include "clientconnection.h"
+#include "proxyupstream.h"
+#include "webserver.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEB";
+
+constexpr std::string_view crlf{"\r\n"};
+
+// RFC 9110 7.6.1, these describe one connection and are never forwarded
+bool isHopByHop(std::string_view key)
+{
+    for (const std::string_view hopByHop : {"Connection", "Keep-Alive", "Proxy-Connection", "TE", "Trailer", "Transfer-Encoding", "Upgrade"})
+        if (cpputils::stringEqualsIgnoreCase(key, hopByHop))
+            return true;
+    return false;
+}
+} // namespace
+
+ProxyResponseHandler::ProxyResponseHandler(ClientConnection &clientConnection, ProxyUpstream &upstream, std::string_view method, std::string_view target) :
+    m_clientConnection{clientConnection},
+    m_upstream{upstream},
+    m_headRequest{method == "HEAD"},
+    m_requestHead{fmt::format("{} {} HTTP/1.1\r\n", method, target)},
+    m_connector{clientConnection.webserver().ioContext(), [](void *context, const std::error_code &error, asio::ip::tcp::socket &&socket){
+        auto &handler = *static_cast<ProxyResponseHandler *>(context);
+        auto self = std::move(handler.m_connectingSelf);
+        handler.onConnected(error, std::move(socket));
+    }, this},
+    m_timer{clientConnection.webserver().timerWheel(), [](void *context){
+        static_cast<ProxyResponseHandler *>(context)->upstreamFailed("upstream timeout", true);
+    }, this}
+{
+}
+
+ProxyResponseHandler::~ProxyResponseHandler() = default;
+
+void ProxyResponseHandler::requestHeaderReceived(std::string_view key, std::string_view value)
+{
+    if (isHopByHop(key))
+    {
+        if (cpputils::stringEqualsIgnoreCase(key, "Upgrade") && cpputils::stringEqualsIgnoreCase(value, "websocket"))
+            m_websocketUpgrade = true;
+        return;
+    }
+
+    if (cpputils::stringEqualsIgnoreCase(key, "Content-Length"))
+    {
+        // ClientConnection has validated it already
+        if (const auto parsed = cpputils::fromString<std::size_t>(value))
+            m_requestBodySize = *parsed;
+    }
+
+    m_requestHead += key;
+    m_requestHead += ": ";
+    m_requestHead += value;
+
+    if (cpputils::stringEqualsIgnoreCase(key, "X-Forwarded-For"))
+    {
+        m_requestHead += ", ";
+        m_requestHead += m_clientConnection.remote_endpoint().address().to_string();
+        m_forwardedFor = true;
+    }
+
+    m_requestHead += crlf;
+}
+
+void ProxyResponseHandler::requestBodyReceived(std::string_view body)
+{
+    startRequest();
+
+    // the upstream answered early or failed, the rest is drained
+    if (m_exchangeDone || m_responseDone)
+        return;
+
+    m_upstreamOut.append(body);
+    writeUpstream();
+
+    // no more of the body is read until this went out
+    m_clientConnection.pauseReading();
+}
+
+void ProxyResponseHandler::sendResponse()
+{
+    m_requestComplete = true;
+
+    if (m_exchangeDone)
+    {
+        postResponseFinished();
+        return;
+    }
+
+    startRequest();
+}
+
+void ProxyResponseHandler::startRequest()
+{
+    if (m_started)
+        return;
+
+    m_started = true;
+
+    if (!m_forwardedFor)
+        m_requestHead += fmt::format("X-Forwarded-For: {}\r\n", m_clientConnection.remote_endpoint().address().to_string());
+
+    if (m_websocketUpgrade)
+        m_requestHead += "Connection: Upgrade\r\nUpgrade: websocket\r\n";
+
+    m_requestHead += crlf;
+
+    m_upstreamOut = m_requestHead;
+    if (m_requestBodySize)
+        m_requestHead.clear();
+
+    m_parser.reset(m_headRequest);
+
+    connectUpstream(true);
+}
+
+void ProxyResponseHandler::connectUpstream(bool allowIdle)
+{
+    if (allowIdle)
+    {
+        if (auto socket = m_upstream.takeIdle())
+        {
+            m_upstreamSocket.emplace(std::move(*socket));
+            m_reused = true;
+            upstreamConnected();
+            return;
+        }
+    }
+
+    m_reused = false;
+    m_timer.expiresAfter(m_upstream.responseTimeout());
+
+    if (!m_upstream.endpoints().empty())
+    {
+        connect();
+        return;
+    }
+
+    if (!m_resolver)
+        m_resolver.emplace(m_clientConnection.stream().get_executor());
+
+    m_resolver->async_resolve(m_upstream.host(), m_upstream.port(),
+                              [this, self=m_clientConnection.shared_from_this(), generation=m_generation]
+                              (const std::error_code &error, asio::ip::tcp::resolver::iterator iterator)
+                              { onResolved(generation, error, iterator); });
+}
+
+void ProxyResponseHandler::onResolved(uint32_t generation, const std::error_code &error, asio::ip::tcp::resolver::iterator iterator)
+{
+    if (generation != m_generation)
+        return;
+
+    if (error)
+    {
+        ESP_LOGW(TAG, "resolving %s failed: %s", m_upstream.host().c_str(), error.message().c_str());
+        upstreamFailed("resolve failed");
+        return;
+    }
+
+    std::vector<asio::ip::tcp::endpoint> endpoints;
+    for (; iterator != asio::ip::tcp::resolver::iterator{}; ++iterator)
+        endpoints.push_back(iterator->endpoint());
+    m_upstream.setEndpoints(std::move(endpoints));
+
+    connect();
+}
+
+void ProxyResponseHandler::connect()
+{
+    m_upstream.m_stats.connects++;
+
+    m_connectingSelf = m_clientConnection.shared_from_this();
+    m_connector.connect(m_upstream.endpoints());
+}
+
+void ProxyResponseHandler::onConnected(const std::error_code &error, asio::ip::tcp::socket &&socket)
+{
+    if (error)
+    {
+        ESP_LOGW(TAG, "connecting to %s:%s failed: %s", m_upstream.host().c_str(), m_upstream.port().c_str(), error.message().c_str());
+        m_upstream.clearEndpoints();
+        upstreamFailed("connect failed");
+        return;
+    }
+
+    m_upstreamSocket.emplace(std::move(socket));
+
+    std::error_code ec;
+    m_upstreamSocket->set_option(asio::ip::tcp::no_delay{true}, ec);
+
+    upstreamConnected();
+}
+
+void ProxyResponseHandler::upstreamConnected()
+{
+    m_connected = true;
+    writeUpstream();
+    readUpstream();
+}
+
+void ProxyResponseHandler::writeUpstream()
+{
+    if (!m_connected || m_upstreamWritingActive || m_upstreamOut.empty())
+        return;
+
+    m_upstreamWritingActive = true;
+    std::swap(m_upstreamWriting, m_upstreamOut);
+
+    asio::async_write(*m_upstreamSocket, asio::buffer(m_upstreamWriting.data(), m_upstreamWriting.size()),
+                      [this, self=m_clientConnection.shared_from_this(), generation=m_generation]
+                      (const std::error_code &error, std::size_t length)
+                      { onUpstreamWritten(generation, error); });
+}
+
+void ProxyResponseHandler::onUpstreamWritten(uint32_t generation, const std::error_code &error)
+{
+    if (generation != m_generation)
+        return;
+
+    m_upstreamWritingActive = false;
+    m_upstreamWriting.clear();
+
+    if (error)
+    {
+        upstreamFailed(error.message());
+        return;
+    }
+
+    if (!m_upstreamOut.empty())
+        writeUpstream();
+    else
+        m_clientConnection.resumeReading();
+}
+
+void ProxyResponseHandler::readUpstream()
+{
+    m_timer.expiresAfter(m_upstream.responseTimeout());
+
+    m_upstreamSocket->async_read_some(asio::buffer(m_upstreamBuffer, bufferSize),
+                                      [this, self=m_clientConnection.shared_from_this(), generation=m_generation]
+                                      (const std::error_code &error, std::size_t length)
+                                      { onUpstreamRead(generation, error, length); });
+}
+
+void ProxyResponseHandler::onUpstreamRead(uint32_t generation, const std::error_code &error, std::size_t length)
+{
+    if (generation != m_generation)
+        return;
+
+    m_timer.cancel();
+
+    if (error)
+    {
+        // a body delimited by the end of the connection
+        if (error == asio::error::eof && m_parser.finish())
+        {
+            m_upstreamKeepAlive = false;
+            m_responseHead += m_chunked ? "0\r\n\r\n" : "";
+            m_responseDone = true;
+            writeClient();
+            return;
+        }
+
+        upstreamFailed(error == asio::error::eof ? "upstream closed the connection" : error.message());
+        return;
+    }
+
+    m_responseStarted = true;
+    m_upstreamInput = {m_upstreamBuffer, length};
+
+    parseUpstream();
+}
+
+void ProxyResponseHandler::parseUpstream()
+{
+    while (true)
+    {
+        switch (m_parser.parse(m_upstreamInput))
+        {
+        case HttpResponseParser::Event::NeedMore:
+            if (!m_responseHead.empty())
+                writeClient();
+            else
+                readUpstream();
+            return;
+        case HttpResponseParser::Event::ResponseLine:
+            // 100 Continue and friends are not forwarded, 101 is
+            m_interim = m_parser.status() < 200 && m_parser.status() != 101;
+            if (!m_interim)
+                m_responseHead += fmt::format("HTTP/1.1 {} {}\r\n", m_parser.status(), m_parser.message());
+            break;
+        case HttpResponseParser::Event::Header:
+            if (m_interim || isHopByHop(m_parser.headerKey()) || cpputils::stringEqualsIgnoreCase(m_parser.headerKey(), "Content-Length"))
+                break;
+            m_responseHead += m_parser.headerKey();
+            m_responseHead += ": ";
+            m_responseHead += m_parser.headerValue();
+            m_responseHead += crlf;
+            break;
+        case HttpResponseParser::Event::HeadersComplete:
+            if (m_interim)
+                break;
+
+            if (m_parser.status() == 101)
+            {
+                if (!m_websocketUpgrade)
+                {
+                    upstreamFailed("unexpected 101 response");
+                    return;
+                }
+
+                m_responseHead += "Connection: Upgrade\r\nUpgrade: websocket\r\n\r\n";
+                m_switching = true;
+                writeClient();
+                return;
+            }
+
+            // the body is framed anew, a length is kept, anything else is sent chunked
+            m_chunked = !m_parser.complete() && (m_parser.chunked() || !m_parser.contentLength());
+            if (m_chunked)
+                m_responseHead += "Transfer-Encoding: chunked\r\n";
+            else if (m_parser.contentLength())
+                m_responseHead += fmt::format("Content-Length: {}\r\n", *m_parser.contentLength());
+
+            m_responseHead += fmt::format("Connection: {}\r\n\r\n", m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close");
+            break;
+        case HttpResponseParser::Event::Body:
+            if (m_chunked)
+                m_responseHead += fmt::format("{:x}\r\n", m_parser.body().size());
+            m_responseBody = m_parser.body();
+            writeClient();
+            return;
+        case HttpResponseParser::Event::Complete:
+            if (m_interim)
+            {
+                m_parser.reset(m_headRequest);
+                break;
+            }
+
+            if (m_chunked)
+                m_responseHead += "0\r\n\r\n";
+
+            // anything after the response would be a protocol violation
+            m_upstreamKeepAlive = m_parser.keepAlive() && m_upstreamInput.empty();
+            m_responseDone = true;
+            writeClient();
+            return;
+        case HttpResponseParser::Event::Error:
+            ESP_LOGW(TAG, "invalid response from %s:%s: %.*s", m_upstream.host().c_str(), m_upstream.port().c_str(),
+                     m_parser.error().size(), m_parser.error().data());
+            upstreamFailed("invalid response");
+            return;
+        }
+    }
+}
+
+void ProxyResponseHandler::upstreamFailed(std::string_view reason, bool timeout)
+{
+    if (m_exchangeDone || m_responseDone)
+        return;
+
+    // a pooled connection the server closed just now, a bodyless request is sent again once
+    if (m_reused && !m_retried && !m_responseStarted && !timeout && !m_requestHead.empty())
+    {
+        ESP_LOGD(TAG, "retrying on a new connection to %s:%s", m_upstream.host().c_str(), m_upstream.port().c_str());
+        closeUpstream();
+        m_retried = true;
+        m_upstreamOut = m_requestHead;
+        m_parser.reset(m_headRequest);
+        connectUpstream(false);
+        return;
+    }
+
+    ESP_LOGW(TAG, "proxying to %s:%s failed: %.*s (%s:%hi)", m_upstream.host().c_str(), m_upstream.port().c_str(),
+             reason.size(), reason.data(),
+             m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
+
+    m_upstream.m_stats.failures++;
+    closeUpstream();
+
+    // the rest of the request body is drained
+    m_clientConnection.resumeReading();
+
+    if (m_clientHeadSent)
+    {
+        // the response is cut off, only closing tells the client
+        m_exchangeDone = true;
+        m_clientConnection.responseFinished(asio::error::connection_aborted);
+        return;
+    }
+
+    m_responseHead = fmt::format("HTTP/1.1 {}\r\n"
+                                 "Content-Length: 0\r\n"
+                                 "Connection: {}\r\n"
+                                 "\r\n",
+                                 timeout ? "504 Gateway Timeout" : "502 Bad Gateway",
+                                 m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close");
+    m_responseBody = {};
+    m_chunked = false;
+    m_upstreamKeepAlive = false;
+    m_responseDone = true;
+    writeClient();
+}
+
+void ProxyResponseHandler::closeUpstream()
+{
+    m_generation++;
+    m_timer.cancel();
+    m_connected = false;
+    m_upstreamWritingActive = false;
+    m_upstreamWriting.clear();
+    m_upstreamOut.clear();
+
+    if (m_resolver)
+        m_resolver->cancel();
+
+    if (m_connector.connecting())
+    {
+        m_connector.cancel();
+        // the last reference would destroy this handler right here
+        asio::post(m_clientConnection.stream().get_executor(), [self=std::move(m_connectingSelf)](){});
+    }
+
+    if (m_upstreamSocket)
+    {
+        std::error_code ec;
+        m_upstreamSocket->close(ec);
+        m_upstreamSocket = std::nullopt;
+    }
+}
+
+void ProxyResponseHandler::writeClient()
+{
+    if (m_responseHead.starts_with("HTTP/"))
+        m_clientHeadSent = true;
+
+    const std::array<asio::const_buffer, 3> buffers {
+        asio::buffer(m_responseHead.data(), m_responseHead.size()),
+        asio::buffer(m_responseBody.data(), m_responseBody.size()),
+        m_chunked && !m_responseBody.empty() ? asio::buffer(crlf.data(), crlf.size()) : asio::const_buffer{}
+    };
+
+    asio::async_write(m_clientConnection.stream(), buffers,
+                      [this, self=m_clientConnection.shared_from_this()](const std::error_code &error, std::size_t length)
+                      { onClientWritten(error); });
+}
+
+void ProxyResponseHandler::onClientWritten(const std::error_code &error)
+{
+    if (m_exchangeDone)
+        return;
+
+    if (error)
+    {
+        ESP_LOGW(TAG, "error: %i (%s:%hi)", error.value(),
+                 m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
+        closeUpstream();
+        m_exchangeDone = true;
+        m_clientConnection.responseFinished(error);
+        return;
+    }
+
+    m_responseHead.clear();
+    m_responseBody = {};
+
+    if (m_switching)
+        startSplice();
+    else if (m_responseDone)
+        finish();
+    else
+        parseUpstream();
+}
+
+void ProxyResponseHandler::finish()
+{
+    m_timer.cancel();
+
+    // the connection only goes back to the pool once the request is fully sent
+    if (m_upstreamKeepAlive && m_upstreamSocket && m_requestComplete && !m_upstreamWritingActive && m_upstreamOut.empty())
+    {
+        m_generation++;
+        m_upstream.release(std::move(*m_upstreamSocket));
+        m_upstreamSocket = std::nullopt;
+    }
+    else
+        closeUpstream();
+
+    m_exchangeDone = true;
+
+    // otherwise sendResponse() finishes once the request body is drained
+    if (m_requestComplete)
+        postResponseFinished();
+}
+
+void ProxyResponseHandler::postResponseFinished()
+{
+    // With a pipelined request waiting, responseFinished() replaces and
+    // destroys this handler right away. The upstream completions aborted by
+    // closeUpstream() are queued already and still reference it, so they
+    // have to run first.
+    asio::post(m_clientConnection.stream().get_executor(),
+               [&clientConnection=m_clientConnection, self=m_clientConnection.shared_from_this()]()
+               { clientConnection.responseFinished({}); });
+}
+
+void ProxyResponseHandler::startSplice()
+{
+    ESP_LOGI(TAG, "splicing websocket to %s:%s (%s:%hi)", m_upstream.host().c_str(), m_upstream.port().c_str(),
+             m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
+
+    m_timer.cancel();
+    m_exchangeDone = true;
+    m_spliceOpen = 2;
+
+    // frames which arrived together with the upgrade request or the 101
+    m_clientLeftover = m_clientConnection.takeBufferedData();
+
+    if (m_clientLeftover.empty())
+        spliceRead(true);
+    else
+        spliceWrite(true, asio::buffer(m_clientLeftover.data(), m_clientLeftover.size()));
+
+    if (m_upstreamInput.empty())
+        spliceRead(false);
+    else
+        spliceWrite(false, asio::buffer(m_upstreamInput.data(), m_upstreamInput.size()));
+}
+
+void ProxyResponseHandler::spliceWrite(bool fromClient, asio::const_buffer data)
+{
+    auto written = [this, self=m_clientConnection.shared_from_this(), fromClient](const std::error_code &error, std::size_t length)
+    {
+        if (error)
+            spliceClosed(fromClient, error);
+        else
+            spliceRead(fromClient);
+    };
+
+    if (fromClient)
+        asio::async_write(*m_upstreamSocket, data, std::move(written));
+    else
+        asio::async_write(m_clientConnection.stream(), data, std::move(written));
+}
+
+void ProxyResponseHandler::spliceRead(bool fromClient)
+{
+    char * const buffer = fromClient ? m_clientBuffer : m_upstreamBuffer;
+
+    auto received = [this, self=m_clientConnection.shared_from_this(), fromClient, buffer](const std::error_code &error, std::size_t length)
+    {
+        if (error)
+            spliceClosed(fromClient, error);
+        else
+            spliceWrite(fromClient, asio::buffer(buffer, length));
+    };
+
+    // the other direction is not read while this one is written
+    if (fromClient)
+        m_clientConnection.stream().async_read_some(asio::buffer(buffer, bufferSize), std::move(received));
+    else
+        m_upstreamSocket->async_read_some(asio::buffer(buffer, bufferSize), std::move(received));
+}
+
+void ProxyResponseHandler::spliceClosed(bool fromClient, const std::error_code &error)
+{
+    std::error_code ec;
+
+    if (error == asio::error::eof && --m_spliceOpen)
+    {
+        // half close, the other direction may still have data
+        if (fromClient)
+            m_upstreamSocket->shutdown(asio::ip::tcp::socket::shutdown_send, ec);
+        else
+            m_clientConnection.stream().shutdownSend(ec);
+        return;
+    }
+
+    m_spliceOpen = 0;
+    m_upstreamSocket->close(ec);
+    m_clientConnection.stream().close(ec);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// local includes
+#include "happyeyeballs.h"
+#include "httpresponseparser.h"
+#include "responsehandler.h"
+#include "timerwheel.h"
+
+// forward declarations
+class ClientConnection;
+class ProxyUpstream;
+
+// Forwards one request to a ProxyUpstream over one of its pooled keep-alive
+// connections and streams the response back. Neither body is buffered as a
+// whole: while a request body chunk is written upstream the client
+// connection is not read, while a response chunk is written to the client
+// the upstream is not read. Upstream bodies without Content-Length are sent
+// to the client chunked. A websocket upgrade answered with 101 turns into a
+// raw bidirectional copy between both sockets.
+class ProxyResponseHandler final : public ResponseHandler
+{
+public:
+    // target is sent upstream unchanged, makeResponseHandler may have rewritten it
+    ProxyResponseHandler(ClientConnection &clientConnection, ProxyUpstream &upstream, std::string_view method, std::string_view target);
+    ~ProxyResponseHandler() final;
+
+    void requestHeaderReceived(std::string_view key, std::string_view value) final;
+    void requestBodyReceived(std::string_view body) final;
+    void sendResponse() final;
+
+private:
+    void startRequest();
+    void connectUpstream(bool allowIdle);
+    void onResolved(uint32_t generation, const std::error_code &error, asio::ip::tcp::resolver::iterator iterator);
+    void connect();
+    void onConnected(const std::error_code &error, asio::ip::tcp::socket &&socket);
+    void upstreamConnected();
+
+    void writeUpstream();
+    void onUpstreamWritten(uint32_t generation, const std::error_code &error);
+    void readUpstream();
+    void onUpstreamRead(uint32_t generation, const std::error_code &error, std::size_t length);
+    void parseUpstream();
+    void upstreamFailed(std::string_view reason, bool timeout = false);
+    void closeUpstream();
+
+    void writeClient();
+    void onClientWritten(const std::error_code &error);
+    void finish();
+    void postResponseFinished();
+
+    void startSplice();
+    void spliceWrite(bool fromClient, asio::const_buffer data);
+    void spliceRead(bool fromClient);
+    void spliceClosed(bool fromClient, const std::error_code &error);
+
+    ClientConnection &m_clientConnection;
+    ProxyUpstream &m_upstream;
+
+    const bool m_headRequest;
+    std::string m_requestHead; // kept for a retry, bodyless requests only
+    std::size_t m_requestBodySize{};
+    bool m_forwardedFor{};
+    bool m_websocketUpgrade{};
+
+    bool m_started{};
+    bool m_requestComplete{}; // sendResponse() was called
+    bool m_exchangeDone{};    // response complete or failed
+
+    std::optional<asio::ip::tcp::resolver> m_resolver;
+    HappyEyeballsConnector m_connector;
+    // the connector calls back with a raw pointer
+    std::shared_ptr<ClientConnection> m_connectingSelf;
+    std::optional<asio::ip::tcp::socket> m_upstreamSocket;
+    // completions of a connection given up on are ignored
+    uint32_t m_generation{};
+    bool m_connected{};
+    bool m_reused{};
+    bool m_retried{};
+
+    std::string m_upstreamOut;     // queued for the upstream
+    std::string m_upstreamWriting; // being written
+    bool m_upstreamWritingActive{};
+
+    HttpResponseParser m_parser;
+    static constexpr const std::size_t bufferSize = 16384;
+    char m_upstreamBuffer[bufferSize];
+    std::string_view m_upstreamInput; // not yet parsed part of m_upstreamBuffer
+    bool m_responseStarted{};
+    bool m_interim{};
+    bool m_chunked{};
+    bool m_upstreamKeepAlive{};
+
+    std::string m_responseHead;     // status line, headers or chunk framing
+    std::string_view m_responseBody; // points into m_upstreamBuffer
+    bool m_clientHeadSent{};
+    bool m_responseDone{};
+    bool m_switching{};
+
+    TimerWheel::Timer m_timer;
+
+    char m_clientBuffer[bufferSize]; // websocket splice only
+    std::string m_clientLeftover;
+    int m_spliceOpen{};
+};
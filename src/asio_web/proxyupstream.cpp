@@ -0,0 +1,93 @@
+#include "proxyupstream.h"
+
+// esp-idf includes
+#include <esp_log.h>
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEB";
+
+// a connection the server closed is readable with eof, an open one would block
+bool stillOpen(asio::ip::tcp::socket &socket)
+{
+    std::error_code ec;
+    socket.non_blocking(true, ec);
+    if (ec)
+        return false;
+
+    char byte;
+    socket.receive(asio::buffer(&byte, 1), asio::socket_base::message_peek, ec);
+    const bool open = ec == asio::error::would_block;
+
+    socket.non_blocking(false, ec);
+    return open && !ec;
+}
+} // namespace
+
+ProxyUpstream::ProxyUpstream(std::string host, std::string port) :
+    m_host{std::move(host)},
+    m_port{std::move(port)}
+{
+}
+
+void ProxyUpstream::setMaxIdleConnections(std::size_t maxIdleConnections)
+{
+    m_maxIdleConnections = maxIdleConnections;
+    while (m_idle.size() > m_maxIdleConnections)
+        m_idle.pop_front();
+}
+
+std::optional<asio::ip::tcp::socket> ProxyUpstream::takeIdle()
+{
+    const auto now = espchrono::millis_clock::now();
+
+    while (!m_idle.empty())
+    {
+        auto idle = std::move(m_idle.back());
+        m_idle.pop_back();
+
+        // everything before it is older still
+        if (now - idle.since >= m_idleTimeout)
+        {
+            m_idle.clear();
+            break;
+        }
+
+        if (stillOpen(idle.socket))
+        {
+            m_stats.reuses++;
+            return std::move(idle.socket);
+        }
+
+        ESP_LOGD(TAG, "pooled connection to %s:%s was closed", m_host.c_str(), m_port.c_str());
+        m_stats.stale++;
+    }
+
+    return std::nullopt;
+}
+
+void ProxyUpstream::release(asio::ip::tcp::socket &&socket)
+{
+    if (!m_maxIdleConnections)
+        return;
+
+    if (m_idle.size() >= m_maxIdleConnections)
+        m_idle.pop_front();
+
+    m_idle.push_back(Idle{ .socket = std::move(socket), .since = espchrono::millis_clock::now() });
+}
+
+const std::vector<asio::ip::tcp::endpoint> &ProxyUpstream::endpoints() const
+{
+    static const std::vector<asio::ip::tcp::endpoint> empty;
+
+    if (m_endpoints.empty() || espchrono::millis_clock::now() - m_resolvedAt >= m_resolveCacheTtl)
+        return empty;
+
+    return m_endpoints;
+}
+
+void ProxyUpstream::setEndpoints(std::vector<asio::ip::tcp::endpoint> &&endpoints)
+{
+    m_endpoints = std::move(endpoints);
+    m_resolvedAt = espchrono::millis_clock::now();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// system includes
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <espchrono.h>
+
+// One server behind ProxyResponseHandler with its pool of idle keep-alive
+// connections, shared by all handlers forwarding to it. Idle connections
+// have no read pending, a connection the server closed meanwhile is
+// noticed with a non-blocking peek when it is taken out of the pool.
+// Not thread safe, like the webserver it belongs to.
+class ProxyUpstream
+{
+public:
+    ProxyUpstream(std::string host, std::string port);
+
+    const std::string &host() const { return m_host; }
+    const std::string &port() const { return m_port; }
+
+    std::size_t maxIdleConnections() const { return m_maxIdleConnections; }
+    void setMaxIdleConnections(std::size_t maxIdleConnections);
+
+    std::chrono::milliseconds idleTimeout() const { return m_idleTimeout; }
+    void setIdleTimeout(std::chrono::milliseconds idleTimeout) { m_idleTimeout = idleTimeout; }
+
+    // no response data for that long answers 504 (or closes the client
+    // connection if the response already started)
+    std::chrono::milliseconds responseTimeout() const { return m_responseTimeout; }
+    void setResponseTimeout(std::chrono::milliseconds responseTimeout) { m_responseTimeout = responseTimeout; }
+
+    // resolved endpoints are reused for that long, zero resolves on every connect
+    void setResolveCacheTtl(std::chrono::seconds ttl) { m_resolveCacheTtl = ttl; }
+
+    struct Stats {
+        uint64_t connects{};
+        uint64_t reuses{};     // requests sent over a pooled connection
+        uint64_t stale{};      // pooled connections closed by the server meanwhile
+        uint64_t failures{};   // answered with 502 or 504
+    };
+
+    const Stats &stats() const { return m_stats; }
+    std::size_t idleConnections() const { return m_idle.size(); }
+
+private:
+    friend class ProxyResponseHandler;
+
+    // the most recently used connection which is still open
+    std::optional<asio::ip::tcp::socket> takeIdle();
+    // the response was complete, the connection may carry the next request
+    void release(asio::ip::tcp::socket &&socket);
+
+    // empty if resolving is due
+    const std::vector<asio::ip::tcp::endpoint> &endpoints() const;
+    void setEndpoints(std::vector<asio::ip::tcp::endpoint> &&endpoints);
+    void clearEndpoints() { m_endpoints.clear(); }
+
+    const std::string m_host;
+    const std::string m_port;
+
+    std::size_t m_maxIdleConnections{16};
+    std::chrono::milliseconds m_idleTimeout{std::chrono::seconds{30}};
+    std::chrono::milliseconds m_responseTimeout{std::chrono::seconds{30}};
+
+    std::vector<asio::ip::tcp::endpoint> m_endpoints;
+    espchrono::millis_clock::time_point m_resolvedAt;
+    std::chrono::seconds m_resolveCacheTtl{60};
+
+    struct Idle
+    {
+        asio::ip::tcp::socket socket;
+        espchrono::millis_clock::time_point since;
+    };
+
+    // the oldest in front
+    std::deque<Idle> m_idle;
+
+    Stats m_stats;
+};
@@ -1,8 +1,12 @@
 #pragma once
 
 // system includes
+#include <cstdint>
 #include <string_view>
 
+// forward declares
+class WebsocketClientConnection;
+
 class ResponseHandler
 {
 public:
@@ -11,4 +15,16 @@ public:
     virtual void requestHeaderReceived(std::string_view key, std::string_view value) = 0;
     virtual void requestBodyReceived(std::string_view body) = 0;
     virtual void sendResponse() = 0;
+
+    // return true to let ClientConnection answer websocket upgrade requests
+    // itself, sendResponse() is then only called for other requests
+    virtual bool acceptsWebsocketUpgrade() const { return false; }
+
+    // only called after ClientConnection::upgradeWebsocket()
+    virtual void websocketConnected(WebsocketClientConnection &connection) {}
+    virtual void websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) {}
+    virtual void websocketDisconnected(WebsocketClientConnection &connection) {}
+
+    // only with SlowConsumerPolicy::Backpressure, stop producing while active
+    virtual void websocketBackpressure(WebsocketClientConnection &connection, bool active) {}
 };
@@ -0,0 +1,120 @@
+#include "sha1.h"
+
+// system includes
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr uint32_t rotl(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+} // namespace
+
+void Sha1::update(std::string_view data)
+{
+    auto *iter = reinterpret_cast<const uint8_t *>(data.data());
+    auto length = data.size();
+
+    m_length += length;
+
+    if (m_bufferSize)
+    {
+        const auto count = std::min(length, sizeof(m_buffer) - m_bufferSize);
+        std::memcpy(m_buffer + m_bufferSize, iter, count);
+        m_bufferSize += count;
+        iter += count;
+        length -= count;
+
+        if (m_bufferSize < sizeof(m_buffer))
+            return;
+
+        processBlock(m_buffer);
+        m_bufferSize = 0;
+    }
+
+    for (; length >= sizeof(m_buffer); iter += sizeof(m_buffer), length -= sizeof(m_buffer))
+        processBlock(iter);
+
+    std::memcpy(m_buffer, iter, length);
+    m_bufferSize = length;
+}
+
+Sha1::Digest Sha1::finish()
+{
+    const uint64_t bits = m_length * 8;
+
+    m_buffer[m_bufferSize++] = 0x80;
+    if (m_bufferSize > sizeof(m_buffer) - 8)
+    {
+        std::fill(m_buffer + m_bufferSize, m_buffer + sizeof(m_buffer), 0);
+        processBlock(m_buffer);
+        m_bufferSize = 0;
+    }
+    std::fill(m_buffer + m_bufferSize, m_buffer + sizeof(m_buffer) - 8, 0);
+    for (int i = 0; i < 8; i++)
+        m_buffer[sizeof(m_buffer) - 1 - i] = uint8_t(bits >> (8 * i));
+    processBlock(m_buffer);
+
+    Digest digest;
+    for (int i = 0; i < 20; i++)
+        digest[i] = uint8_t(m_state[i / 4] >> (24 - 8 * (i % 4)));
+    return digest;
+}
+
+Sha1::Digest Sha1::hash(std::string_view data)
+{
+    Sha1 sha1;
+    sha1.update(data);
+    return sha1.finish();
+}
+
+void Sha1::processBlock(const uint8_t *block)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++)
+        w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16 |
+               uint32_t(block[4 * i + 2]) << 8 | uint32_t(block[4 * i + 3]);
+    for (int i = 16; i < 80; i++)
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3], e = m_state[4];
+
+    for (int i = 0; i < 80; i++)
+    {
+        uint32_t f, k;
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        const uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+}
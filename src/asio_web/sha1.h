@@ -0,0 +1,29 @@
+#pragma once
+
+// system includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Small SHA-1 (FIPS 180-4) for the websocket handshake, so the library
+// does not need OpenSSL or mbedtls just to compute Sec-WebSocket-Accept.
+// Not meant for anything security relevant.
+class Sha1
+{
+public:
+    using Digest = std::array<uint8_t, 20>;
+
+    void update(std::string_view data);
+    Digest finish();
+
+    static Digest hash(std::string_view data);
+
+private:
+    void processBlock(const uint8_t *block);
+
+    uint32_t m_state[5] { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint8_t m_buffer[64];
+    std::size_t m_bufferSize{};
+    uint64_t m_length{};
+};
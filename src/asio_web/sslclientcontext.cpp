@@ -0,0 +1,177 @@
+#include "sslclientcontext.h"
+
+// esp-idf includes
+#include <esp_log.h>
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEB";
+
+std::string sessionKey(const std::string &host, const std::string &port)
+{
+    std::string key;
+    key.reserve(host.size() + 1 + port.size());
+    key += host;
+    key += ':';
+    key += port;
+    return key;
+}
+} // namespace
+
+SslClientContext::SslClientContext()
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    std::error_code ec;
+    m_context.set_default_verify_paths(ec);
+    if (ec)
+        ESP_LOGW(TAG, "no default CA store, only added CAs are trusted: %s", ec.message().c_str());
+
+    // verifying against an empty store fails every handshake, which is still better than trusting anyone
+    enableVerification(ec);
+    if (ec)
+        ESP_LOGW(TAG, "enabling peer verification failed: %s", ec.message().c_str());
+#else
+    m_context.set_verify_mode(asio::ssl::verify_none);
+#endif
+}
+
+SslClientContext::~SslClientContext()
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    for (const auto &pair : m_sessions)
+        SSL_SESSION_free(pair.second);
+#endif
+}
+
+const std::shared_ptr<SslClientContext> &SslClientContext::shared()
+{
+    static const std::shared_ptr<SslClientContext> context = std::make_shared<SslClientContext>();
+    return context;
+}
+
+void SslClientContext::addCertificateAuthority(std::string_view pem, std::error_code &ec)
+{
+    m_context.add_certificate_authority(asio::buffer(pem.data(), pem.size()), ec);
+    if (!ec)
+        enableVerification(ec);
+}
+
+void SslClientContext::loadVerifyFile(const std::string &path, std::error_code &ec)
+{
+    m_context.load_verify_file(path, ec);
+    if (!ec)
+        enableVerification(ec);
+}
+
+void SslClientContext::setDefaultVerifyPaths(std::error_code &ec)
+{
+    m_context.set_default_verify_paths(ec);
+    if (!ec)
+        enableVerification(ec);
+}
+
+void SslClientContext::disableVerification()
+{
+    ESP_LOGW(TAG, "peer verification disabled, any certificate is accepted");
+    m_context.set_verify_mode(asio::ssl::verify_none);
+    m_verifyPeer = false;
+}
+
+void SslClientContext::enableVerification(std::error_code &ec)
+{
+    m_context.set_verify_mode(asio::ssl::verify_peer, ec);
+    if (!ec)
+        m_verifyPeer = true;
+}
+
+void SslClientContext::setAlpnProtocols(std::initializer_list<std::string_view> protocols)
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    // wire format, every protocol prefixed with its length
+    std::string wire;
+    for (const auto protocol : protocols)
+    {
+        if (protocol.empty() || protocol.size() > 255)
+        {
+            ESP_LOGW(TAG, "invalid alpn protocol \"%.*s\"", protocol.size(), protocol.data());
+            continue;
+        }
+        wire += char(protocol.size());
+        wire += protocol;
+    }
+
+    // unlike everything else in openssl, 0 means success here
+    if (SSL_CTX_set_alpn_protos(m_context.native_handle(), reinterpret_cast<const unsigned char *>(wire.data()), wire.size()))
+        ESP_LOGW(TAG, "SSL_CTX_set_alpn_protos() failed");
+#else
+    ESP_LOGW(TAG, "alpn not supported");
+#endif
+}
+
+std::size_t SslClientContext::cachedSessions() const
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    std::lock_guard lock{m_sessionsMutex};
+    return m_sessions.size();
+#else
+    return 0;
+#endif
+}
+
+void SslClientContext::prepareHandshake(SSL *ssl, const std::string &host, const std::string &port)
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    std::error_code ec;
+    asio::ip::make_address(host, ec);
+    const bool isAddress = !ec;
+
+    // sni is only sent for names, never for addresses
+    if (!isAddress)
+        SSL_set_tlsext_host_name(ssl, host.c_str());
+
+    if (m_verifyPeer)
+    {
+        if (isAddress)
+            X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), host.c_str());
+        else
+            SSL_set1_host(ssl, host.c_str());
+    }
+
+    std::lock_guard lock{m_sessionsMutex};
+    if (const auto iter = m_sessions.find(sessionKey(host, port)); iter != std::end(m_sessions))
+        SSL_set_session(ssl, iter->second);
+#endif
+}
+
+void SslClientContext::storeSession(SSL *ssl, const std::string &host, const std::string &port)
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    SSL_SESSION *session = SSL_get1_session(ssl);
+    if (!session)
+        return;
+
+    if (!SSL_SESSION_is_resumable(session) || !m_maxCachedSessions)
+    {
+        SSL_SESSION_free(session);
+        return;
+    }
+
+    std::lock_guard lock{m_sessionsMutex};
+
+    auto key = sessionKey(host, port);
+    if (const auto iter = m_sessions.find(key); iter != std::end(m_sessions))
+    {
+        SSL_SESSION_free(iter->second);
+        iter->second = session;
+        return;
+    }
+
+    if (m_sessions.size() >= m_maxCachedSessions)
+    {
+        // no lru, any host is as good as another
+        SSL_SESSION_free(std::begin(m_sessions)->second);
+        m_sessions.erase(std::begin(m_sessions));
+    }
+
+    m_sessions.emplace(std::move(key), session);
+#endif
+}
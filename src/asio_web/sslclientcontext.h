@@ -0,0 +1,78 @@
+#pragma once
+
+// system includes
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// esp-idf includes
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+// the mbedtls port of esp-idf only has a subset of the openssl api, no
+// sessions, alpn nor hostname checking
+#ifndef CONFIG_ASIO_USE_ESP_MBEDTLS
+#define ASIO_WEB_OPENSSL_API
+#endif
+
+// One TLS client context shared by any number of SslWebsocketClients: the
+// CA store is parsed once, peers are verified including their hostname and
+// sessions are cached per host:port, so a second client to the same server
+// resumes as well. Configure it before the first client starts, streams
+// take the verify mode over when they are created.
+// With openssl the system CA store is trusted from the start, the mbedtls
+// port has none and only verifies once a CA was added.
+// The session cache is thread safe, the configuration is not.
+class SslClientContext
+{
+public:
+    SslClientContext();
+    ~SslClientContext();
+
+    SslClientContext(const SslClientContext &) = delete;
+    SslClientContext &operator=(const SslClientContext &) = delete;
+
+    // used by clients which are not given an own context
+    static const std::shared_ptr<SslClientContext> &shared();
+
+    asio::ssl::context &context() { return m_context; }
+
+    // trusted in addition, the first CA which loads enables peer and
+    // hostname verification again
+    void addCertificateAuthority(std::string_view pem, std::error_code &ec);
+    void loadVerifyFile(const std::string &path, std::error_code &ec);
+    void setDefaultVerifyPaths(std::error_code &ec);
+
+    // accepts any certificate, for test servers with a self signed one
+    void disableVerification();
+
+    bool verifyPeer() const { return m_verifyPeer; }
+
+    // offered in every handshake, for example {"http/1.1"}
+    void setAlpnProtocols(std::initializer_list<std::string_view> protocols);
+
+    // at most that many host:port sessions are kept
+    void setMaxCachedSessions(std::size_t maxCachedSessions) { m_maxCachedSessions = maxCachedSessions; }
+    std::size_t cachedSessions() const;
+
+    // sets sni, the expected hostname and offers a cached session
+    void prepareHandshake(SSL *ssl, const std::string &host, const std::string &port);
+    // keeps the session of a connection which is done, tls 1.3 tickets
+    // arrive after the handshake so this is not called right after it
+    void storeSession(SSL *ssl, const std::string &host, const std::string &port);
+
+private:
+    void enableVerification(std::error_code &ec);
+
+    asio::ssl::context m_context{asio::ssl::context::tls_client};
+    bool m_verifyPeer{};
+
+#ifdef ASIO_WEB_OPENSSL_API
+    mutable std::mutex m_sessionsMutex;
+    std::unordered_map<std::string, SSL_SESSION *> m_sessions;
+#endif
+    std::size_t m_maxCachedSessions{64};
+};
@@ -0,0 +1,126 @@
+#include "sslservercontext.h"
+
+// system includes
+#include <algorithm>
+
+// esp-idf includes
+#include <esp_log.h>
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEB";
+
+#ifdef ASIO_WEB_OPENSSL_API
+int selectAlpn(SSL *ssl, const unsigned char **out, unsigned char *outlen,
+               const unsigned char *in, unsigned int inlen, void *arg)
+{
+    const auto &wire = static_cast<const SslServerContext *>(arg)->alpnProtocols();
+    if (wire.empty())
+        return SSL_TLSEXT_ERR_NOACK;
+
+    // the first of ours the client offered as well
+    unsigned char *selected{};
+    if (SSL_select_next_proto(&selected, outlen, reinterpret_cast<const unsigned char *>(wire.data()), wire.size(), in, inlen) != OPENSSL_NPN_NEGOTIATED)
+        return SSL_TLSEXT_ERR_ALERT_FATAL;
+
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+#endif
+} // namespace
+
+SslServerContext::SslServerContext()
+{
+    m_context.set_options(asio::ssl::context::default_workarounds |
+                          asio::ssl::context::no_sslv2 |
+                          asio::ssl::context::no_sslv3 |
+                          asio::ssl::context::no_tlsv1 |
+                          asio::ssl::context::no_tlsv1_1);
+
+#ifdef ASIO_WEB_OPENSSL_API
+    SSL_CTX *ctx = m_context.native_handle();
+
+    // resumed sessions only match this context
+    constexpr std::string_view sessionIdContext{"asio_web"};
+    SSL_CTX_set_session_id_context(ctx, reinterpret_cast<const unsigned char *>(sessionIdContext.data()), sessionIdContext.size());
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+
+    // keep the buffers of idle connections small, most of them are websockets
+    SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS);
+
+    SSL_CTX_set_alpn_select_cb(ctx, &selectAlpn, this);
+#endif
+}
+
+void SslServerContext::useCertificateChain(std::string_view pem, std::error_code &ec)
+{
+    m_context.use_certificate_chain(asio::buffer(pem.data(), pem.size()), ec);
+}
+
+void SslServerContext::usePrivateKey(std::string_view pem, std::error_code &ec)
+{
+    m_context.use_private_key(asio::buffer(pem.data(), pem.size()), asio::ssl::context::pem, ec);
+}
+
+void SslServerContext::useCertificateChainFile(const std::string &path, std::error_code &ec)
+{
+    m_context.use_certificate_chain_file(path, ec);
+}
+
+void SslServerContext::usePrivateKeyFile(const std::string &path, std::error_code &ec)
+{
+    m_context.use_private_key_file(path, asio::ssl::context::pem, ec);
+}
+
+void SslServerContext::setAlpnProtocols(std::initializer_list<std::string_view> protocols)
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    m_alpnWire.clear();
+    for (const auto protocol : protocols)
+    {
+        if (protocol.empty() || protocol.size() > 255)
+        {
+            ESP_LOGW(TAG, "invalid alpn protocol \"%.*s\"", protocol.size(), protocol.data());
+            continue;
+        }
+        m_alpnWire += char(protocol.size());
+        m_alpnWire += protocol;
+    }
+#else
+    ESP_LOGW(TAG, "alpn not supported");
+#endif
+}
+
+void SslServerContext::setSessionTickets(std::size_t count)
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    SSL_CTX *ctx = m_context.native_handle();
+    if (count)
+        SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    else
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_num_tickets(ctx, count);
+#else
+    ESP_LOGW(TAG, "session tickets not supported");
+#endif
+}
+
+void SslServerContext::setSessionCacheSize(std::size_t size)
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    SSL_CTX *ctx = m_context.native_handle();
+    SSL_CTX_set_session_cache_mode(ctx, size ? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+    SSL_CTX_sess_set_cache_size(ctx, size);
+#else
+    ESP_LOGW(TAG, "session cache not supported");
+#endif
+}
+
+void SslServerContext::setMaxRecordSize(std::size_t size)
+{
+#ifdef ASIO_WEB_OPENSSL_API
+    if (!SSL_CTX_set_max_send_fragment(m_context.native_handle(), std::clamp<std::size_t>(size, 512, 16384)))
+        ESP_LOGW(TAG, "SSL_CTX_set_max_send_fragment() failed");
+#else
+    ESP_LOGW(TAG, "record size not supported");
+#endif
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// esp-idf includes
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+// local includes
+#include "sslclientcontext.h"
+
+// The tls configuration of a Webserver serving https and wss directly,
+// shared by all its connections: certificate chain and key, the alpn
+// protocols it selects from, session resumption and the record size.
+// Configure it before the webserver accepts the first client, streams take
+// the settings over when they are created.
+class SslServerContext
+{
+public:
+    SslServerContext();
+
+    SslServerContext(const SslServerContext &) = delete;
+    SslServerContext &operator=(const SslServerContext &) = delete;
+
+    asio::ssl::context &context() { return m_context; }
+
+    void useCertificateChain(std::string_view pem, std::error_code &ec);
+    void usePrivateKey(std::string_view pem, std::error_code &ec);
+    void useCertificateChainFile(const std::string &path, std::error_code &ec);
+    void usePrivateKeyFile(const std::string &path, std::error_code &ec);
+
+    // in order of preference, for example {"h2", "http/1.1"}. A client
+    // offering none of them is refused, one not using alpn is served anyway.
+    void setAlpnProtocols(std::initializer_list<std::string_view> protocols);
+    const std::string &alpnProtocols() const { return m_alpnWire; }
+
+    // tls 1.3 tickets sent after a full handshake, 0 disables resumption
+    // with tickets (stateless, nothing is kept on the server)
+    void setSessionTickets(std::size_t count);
+    // tls 1.2 session ids kept on the server, 0 disables the cache
+    void setSessionCacheSize(std::size_t size);
+
+    // largest plaintext per tls record, 512 to 16384. Smaller records let
+    // the client start decrypting a response before all of it arrived, at
+    // the cost of more overhead per byte.
+    void setMaxRecordSize(std::size_t size);
+
+private:
+    asio::ssl::context m_context{asio::ssl::context::tls_server};
+
+    // wire format, every protocol prefixed with its length
+    std::string m_alpnWire;
+};
@@ -1,82 +1,68 @@
 #pragma once
 
-// system include
-#include <queue>
-#include <optional>
+// system includes
+#include <memory>
 
 // esp-idf includes
 #include <asio.hpp>
 #include <asio/ssl.hpp>
 
-// 3rdparty lib includes
-#include <espchrono.h>
+// local includes
+#include "sslclientcontext.h"
+#include "websocketclient.h"
 
-class SslWebsocketClient
+namespace detail {
+template<typename Socket>
+struct WebsocketClientStream<asio::ssl::stream<Socket>>
 {
-public:
-    SslWebsocketClient(asio::io_context &io_context, std::string &&host, std::string &&port, std::string &&path);
-    SslWebsocketClient(asio::io_context &io_context, const std::string &host, const std::string &port, const std::string &path);
+    static constexpr bool secure = true;
 
-    void start();
-
-    struct Error {
-        espchrono::millis_clock::time_point timestamp = espchrono::millis_clock::now();
-        std::string message;
+    struct Options
+    {
+        // SslClientContext::shared() if empty
+        std::shared_ptr<SslClientContext> context;
     };
 
-    virtual void handleConnected() = 0;
-    virtual void handleDisconnected() = 0;
-    virtual void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) = 0;
-    virtual void handleErrorOccured(const Error &error) = 0;
-
-    const std::optional<Error> &error() const { return m_error; }
-    void clearError() { m_error = std::nullopt; }
-
-private:
-    void resolve();
-    void onResolved(const std::error_code &error, asio::ip::tcp::resolver::iterator iterator);
-    void connect(const asio::ip::tcp::resolver::iterator &endpoints);
-    void onConnected(const std::error_code &error);
-    void handshake();
-    void onHandshaked(const std::error_code & error);
-    void send_request();
-    void onSentRequest(const std::error_code &error, std::size_t length);
-    void receive_response();
-    void onReceivedResponse(const std::error_code &error, std::size_t length);
-    bool readyReadLine(std::string_view line);
-    bool parseResponseLine(std::string_view line);
-    bool parseResponseHeader(std::string_view line);
-    void doReadWebSocket();
-    void onReceiveWebsocket(const std::error_code &error, std::size_t length);
-
-public:
-    void sendMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload);
-
-private:
-    void onMessageSent(std::error_code error, std::size_t length);
-
-    std::string m_host;
-    std::string m_port;
-    std::string m_path;
-
-    asio::ip::tcp::resolver m_resolver;
-    asio::ssl::context m_sslCtx{asio::ssl::context::tls_client};
-    asio::ssl::stream<asio::ip::tcp::socket> m_socket;
-    //asio::ip::tcp::socket m_socket;
-    char m_receiveBuffer[1024];
-
-    enum class State { Request, ResponseLine, ResponseHeaders, ResponseBody, WebSocket };
-    State m_state { State::Request };
-
-    bool connectionUpgrade;
-    bool upgradeWebsocket;
-
-    std::string m_parsingBuffer;
-
-    std::size_t m_responseBodySize{};
+    WebsocketClientStream(asio::io_context &io_context, const Options &options) :
+        m_context{options.context ? options.context : SslClientContext::shared()},
+        m_socket{io_context, m_context->context()}
+    {
+    }
+
+    void shutdownStream(std::error_code &ec) { m_socket.shutdown(ec); }
+
+    // an ssl::stream cannot handshake twice, a fresh one is constructed in place
+    void resetStream()
+    {
+        const auto executor = m_socket.get_executor();
+        std::destroy_at(&m_socket);
+        std::construct_at(&m_socket, executor, m_context->context());
+    }
+
+    void prepareHandshake(const std::string &host, const std::string &port)
+    {
+        m_context->prepareHandshake(m_socket.native_handle(), host, port);
+    }
+
+    bool sessionReused()
+    {
+#ifdef ASIO_WEB_OPENSSL_API
+        return SSL_session_reused(m_socket.native_handle());
+#else
+        return false;
+#endif
+    }
+
+    void storeSession(const std::string &host, const std::string &port)
+    {
+        m_context->storeSession(m_socket.native_handle(), host, port);
+    }
+
+    std::shared_ptr<SslClientContext> m_context;
+    asio::ssl::stream<Socket> m_socket;
+};
+} // namespace detail
 
-    std::optional<std::string> m_sending;
-    std::queue<std::string> m_sendingQueue;
+using SslWebsocketClient = BasicWebsocketClient<asio::ssl::stream<asio::ip::tcp::socket>>;
 
-    std::optional<Error> m_error;
-};
+extern template class BasicWebsocketClient<asio::ssl::stream<asio::ip::tcp::socket>>;
@@ -0,0 +1,139 @@
+#include "timerwheel.h"
+
+// system includes
+#include <algorithm>
+
+asio::io_context::id TimerWheel::id;
+
+void TimerWheel::Node::unlink()
+{
+    prev->next = next;
+    next->prev = prev;
+    prev = nullptr;
+    next = nullptr;
+}
+
+void TimerWheel::Node::linkBefore(Node &other)
+{
+    prev = other.prev;
+    next = &other;
+    other.prev->next = this;
+    other.prev = this;
+}
+
+TimerWheel::TimerWheel(asio::io_context &io_context) :
+    asio::io_context::service{io_context},
+    m_timer{io_context},
+    m_epoch{std::chrono::steady_clock::now()}
+{
+    for (auto &slot : m_slots)
+        slot.prev = slot.next = &slot;
+}
+
+TimerWheel::~TimerWheel() = default;
+
+void TimerWheel::shutdown()
+{
+    std::error_code ec;
+    m_timer.cancel(ec);
+
+    for (auto &slot : m_slots)
+        while (slot.next != &slot)
+            slot.next->unlink();
+
+    m_armedTimers = 0;
+}
+
+void TimerWheel::arm(Timer &timer, std::chrono::milliseconds timeout)
+{
+    const uint64_t ticks = std::max<uint64_t>(1, (timeout + tickDuration - std::chrono::milliseconds{1}) / tickDuration);
+
+    if (timer.linked())
+        timer.unlink();
+    else
+        m_armedTimers++;
+
+    if (!m_ticking)
+        m_currentTick = elapsedTicks();
+
+    timer.m_expiryTick = m_currentTick + ticks;
+    timer.linkBefore(m_slots[timer.m_expiryTick % slotCount]);
+
+    if (!m_ticking)
+        scheduleTick();
+}
+
+void TimerWheel::cancel(Timer &timer)
+{
+    if (!timer.linked())
+        return;
+
+    timer.unlink();
+    m_armedTimers--;
+}
+
+uint64_t TimerWheel::elapsedTicks() const
+{
+    return (std::chrono::steady_clock::now() - m_epoch) / tickDuration;
+}
+
+void TimerWheel::scheduleTick()
+{
+    m_ticking = true;
+
+    m_timer.expires_at(m_epoch + (m_currentTick + 1) * tickDuration);
+    m_timer.async_wait([this](std::error_code ec){ onTick(ec); });
+}
+
+void TimerWheel::onTick(std::error_code ec)
+{
+    if (ec)
+    {
+        m_ticking = false;
+        return;
+    }
+
+    const auto target = elapsedTicks();
+
+    while (m_currentTick < target)
+    {
+        if (!m_armedTimers)
+        {
+            m_currentTick = target;
+            break;
+        }
+
+        m_currentTick++;
+
+        Node &slot = m_slots[m_currentTick % slotCount];
+        if (slot.next == &slot)
+            continue;
+
+        // detach the whole slot, callbacks may arm or cancel any timer meanwhile
+        Node pending;
+        pending.next = slot.next;
+        pending.prev = slot.prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        slot.prev = slot.next = &slot;
+
+        while (pending.next != &pending)
+        {
+            Timer &timer = static_cast<Timer &>(*pending.next);
+            timer.unlink();
+
+            if (timer.m_expiryTick <= m_currentTick)
+            {
+                m_armedTimers--;
+                timer.m_callback(timer.m_context);
+            }
+            else
+                timer.linkBefore(slot);
+        }
+    }
+
+    if (m_armedTimers)
+        scheduleTick();
+    else
+        m_ticking = false;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// system includes
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// Hashed timer wheel, one per io_context (asio service), used for the
+// connection deadlines instead of one steady_timer per connection. Arming,
+// re-arming and cancelling a Timer is O(1) and never allocates. A single
+// steady_timer only runs while at least one Timer is armed.
+// Not locked, bound to the thread running its io_context (see Webserver).
+class TimerWheel : public asio::io_context::service
+{
+public:
+    static asio::io_context::id id;
+
+    static constexpr std::chrono::milliseconds tickDuration{100};
+    static constexpr std::size_t slotCount{512};
+
+    class Timer;
+
+    explicit TimerWheel(asio::io_context &io_context);
+    ~TimerWheel() override;
+
+    static TimerWheel &get(asio::io_context &io_context) { return asio::use_service<TimerWheel>(io_context); }
+
+    std::size_t armedTimers() const { return m_armedTimers; }
+
+private:
+    struct Node
+    {
+        Node *prev{};
+        Node *next{};
+
+        bool linked() const { return next; }
+        void unlink();
+        void linkBefore(Node &other);
+    };
+
+    void shutdown() override;
+
+    void arm(Timer &timer, std::chrono::milliseconds timeout);
+    void cancel(Timer &timer);
+
+    uint64_t elapsedTicks() const;
+    void scheduleTick();
+    void onTick(std::error_code ec);
+
+    asio::steady_timer m_timer;
+    std::chrono::steady_clock::time_point m_epoch;
+    uint64_t m_currentTick{};
+    bool m_ticking{};
+
+    std::size_t m_armedTimers{};
+
+    Node m_slots[slotCount];
+};
+
+class TimerWheel::Timer : private TimerWheel::Node
+{
+public:
+    using Callback = void (*)(void *context);
+
+    Timer(TimerWheel &wheel, Callback callback, void *context) :
+        m_wheel{wheel}, m_callback{callback}, m_context{context}
+    {}
+    ~Timer() { cancel(); }
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+    // (re)arms the timer, the callback is invoked once the timeout elapsed
+    // (rounded up to the next tick)
+    void expiresAfter(std::chrono::milliseconds timeout) { m_wheel.arm(*this, timeout); }
+    void cancel() { m_wheel.cancel(*this); }
+
+    bool armed() const { return linked(); }
+
+private:
+    friend class TimerWheel;
+
+    TimerWheel &m_wheel;
+    const Callback m_callback;
+    void * const m_context;
+    uint64_t m_expiryTick{};
+};
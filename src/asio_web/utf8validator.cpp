@@ -0,0 +1,324 @@
+#include "utf8validator.h"
+
+// system includes
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ASIO_WEB_UTF8_SSSE3
+#endif
+
+namespace {
+bool isAscii8(const uint8_t *data)
+{
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return !(word & 0x8080808080808080ull);
+}
+
+#ifdef ASIO_WEB_UTF8_SSSE3
+// error bits of the lookup tables, see Keiser & Lemire
+constexpr uint8_t TOO_SHORT      = 1 << 0; // 11______ 0_______ or 11______ 11______
+constexpr uint8_t TOO_LONG       = 1 << 1; // 0_______ 10______
+constexpr uint8_t OVERLONG_3     = 1 << 2; // 11100000 100_____
+constexpr uint8_t TOO_LARGE      = 1 << 3; // 11110100 1001____ and above
+constexpr uint8_t SURROGATE      = 1 << 4; // 11101101 101_____
+constexpr uint8_t OVERLONG_2     = 1 << 5; // 1100000_ 10______
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6; // 11110101+ 1000____
+constexpr uint8_t OVERLONG_4     = 1 << 6; // 11110000 1000____
+constexpr uint8_t TWO_CONTS      = 1 << 7; // 10______ 10______
+constexpr uint8_t CARRY          = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+#define ASIO_WEB_TABLE(...) _mm_setr_epi8(__VA_ARGS__)
+#define C(x) char(x)
+
+struct Ssse3Checker
+{
+    __m128i error = _mm_setzero_si128();
+    __m128i prevInput = _mm_setzero_si128();
+    __m128i prevIncomplete = _mm_setzero_si128();
+
+    __attribute__((target("ssse3"), always_inline)) inline void check(__m128i input)
+    {
+        // indexed by the high nibble of the previous byte
+        const __m128i byte1High = ASIO_WEB_TABLE(
+            C(TOO_LONG), C(TOO_LONG), C(TOO_LONG), C(TOO_LONG),
+            C(TOO_LONG), C(TOO_LONG), C(TOO_LONG), C(TOO_LONG),
+            C(TWO_CONTS), C(TWO_CONTS), C(TWO_CONTS), C(TWO_CONTS),
+            C(TOO_SHORT | OVERLONG_2),
+            C(TOO_SHORT),
+            C(TOO_SHORT | OVERLONG_3 | SURROGATE),
+            C(TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4));
+
+        // indexed by the low nibble of the previous byte
+        const __m128i byte1Low = ASIO_WEB_TABLE(
+            C(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4),
+            C(CARRY | OVERLONG_2),
+            C(CARRY),
+            C(CARRY),
+            C(CARRY | TOO_LARGE),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000),
+            C(CARRY | TOO_LARGE | TOO_LARGE_1000));
+
+        // indexed by the high nibble of the current byte
+        const __m128i byte2High = ASIO_WEB_TABLE(
+            C(TOO_SHORT), C(TOO_SHORT), C(TOO_SHORT), C(TOO_SHORT),
+            C(TOO_SHORT), C(TOO_SHORT), C(TOO_SHORT), C(TOO_SHORT),
+            C(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+            C(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+            C(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+            C(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+            C(TOO_SHORT), C(TOO_SHORT), C(TOO_SHORT), C(TOO_SHORT));
+
+        // the last 3 bytes of a block must not start a sequence which does not fit in
+        const __m128i maxValue = ASIO_WEB_TABLE(
+            C(0xFF), C(0xFF), C(0xFF), C(0xFF), C(0xFF), C(0xFF), C(0xFF), C(0xFF),
+            C(0xFF), C(0xFF), C(0xFF), C(0xFF), C(0xFF), C(0xEF), C(0xDF), C(0xBF));
+
+        const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+
+        if (!_mm_movemask_epi8(input))
+        {
+            // ascii only, just the previous block must not end incomplete
+            error = _mm_or_si128(error, prevIncomplete);
+        }
+        else
+        {
+            const __m128i prev1 = _mm_alignr_epi8(input, prevInput, 15);
+            const __m128i prev2 = _mm_alignr_epi8(input, prevInput, 14);
+            const __m128i prev3 = _mm_alignr_epi8(input, prevInput, 13);
+
+            const __m128i specialCases = _mm_and_si128(
+                _mm_and_si128(
+                    _mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibbleMask)),
+                    _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, nibbleMask))),
+                _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibbleMask)));
+
+            // only 111_____ resp. 1111____ end up >= 0x80
+            const __m128i isThirdByte = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80)));
+            const __m128i isFourthByte = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80)));
+            const __m128i must23 = _mm_and_si128(_mm_or_si128(isThirdByte, isFourthByte), _mm_set1_epi8(char(0x80)));
+
+            error = _mm_or_si128(error, _mm_xor_si128(must23, specialCases));
+            prevIncomplete = _mm_subs_epu8(input, maxValue);
+        }
+
+        prevInput = input;
+    }
+};
+
+__attribute__((target("ssse3")))
+bool validateSsse3(const uint8_t *data, std::size_t length)
+{
+    Ssse3Checker checker;
+
+    std::size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+        checker.check(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+
+    if (i < length)
+    {
+        alignas(16) uint8_t tail[16]{};
+        std::memcpy(tail, data + i, length - i);
+        checker.check(_mm_load_si128(reinterpret_cast<const __m128i *>(tail)));
+    }
+
+    const __m128i error = _mm_or_si128(checker.error, checker.prevIncomplete);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+#undef C
+#undef ASIO_WEB_TABLE
+
+bool haveSsse3()
+{
+    static const bool result = __builtin_cpu_supports("ssse3");
+    return result;
+}
+#endif
+
+std::size_t sequenceLength(uint8_t lead)
+{
+    if (lead < 0xC0)
+        return 1;
+    if (lead < 0xE0)
+        return 2;
+    if (lead < 0xF0)
+        return 3;
+    if (lead < 0xF8)
+        return 4;
+    return 1; // invalid anyways
+}
+} // namespace
+
+bool Utf8Validator::validate(std::string_view data)
+{
+    return validateBulk(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+}
+
+bool Utf8Validator::validateScalar(std::string_view data)
+{
+    Utf8Validator validator;
+    return validator.feedScalar(reinterpret_cast<const uint8_t *>(data.data()), data.size()) && validator.complete();
+}
+
+bool Utf8Validator::haveSimd()
+{
+#ifdef ASIO_WEB_UTF8_SSSE3
+    return haveSsse3();
+#else
+    return false;
+#endif
+}
+
+bool Utf8Validator::validateBulk(const uint8_t *data, std::size_t length)
+{
+#ifdef ASIO_WEB_UTF8_SSSE3
+    if (length >= 16 && haveSsse3())
+        return validateSsse3(data, length);
+#endif
+
+    return validateScalar({reinterpret_cast<const char *>(data), length});
+}
+
+bool Utf8Validator::feed(std::string_view str)
+{
+    if (m_invalid)
+        return false;
+
+    const auto *data = reinterpret_cast<const uint8_t *>(str.data());
+    std::size_t length = str.size();
+
+    // finish a code point started by the previous chunk
+    while (m_needed && length)
+    {
+        if (!feedScalar(data, 1))
+            return false;
+        data++;
+        length--;
+    }
+
+    if (length < 64)
+        return feedScalar(data, length);
+
+    // the bulk has to end on a code point boundary, the rest is kept in the state
+    std::size_t bulk = length;
+    for (std::size_t k = 1; k <= 3; k++)
+    {
+        const uint8_t c = data[length - k];
+        if ((c & 0xC0) == 0x80)
+            continue;
+        if (sequenceLength(c) > k)
+            bulk = length - k;
+        break;
+    }
+
+    if (!validateBulk(data, bulk))
+    {
+        m_invalid = true;
+        return false;
+    }
+
+    return feedScalar(data + bulk, length - bulk);
+}
+
+bool Utf8Validator::feedFrame(bool fin, uint8_t opcode, std::string_view payload)
+{
+    switch (opcode)
+    {
+    case 0: // continuation
+        if (!m_inTextMessage)
+            return true;
+        break;
+    case 1: // text
+        reset();
+        m_inTextMessage = true;
+        break;
+    case 2: // binary
+        m_inTextMessage = false;
+        return true;
+    default: // control frames may be interleaved
+        return true;
+    }
+
+    if (!feed(payload))
+        return false;
+
+    if (!fin)
+        return true;
+
+    m_inTextMessage = false;
+    return complete();
+}
+
+bool Utf8Validator::feedScalar(const uint8_t *data, std::size_t length)
+{
+    const uint8_t * const end = data + length;
+
+    while (data != end)
+    {
+        if (!m_needed)
+        {
+            while (end - data >= 8 && isAscii8(data))
+                data += 8;
+            if (data == end)
+                break;
+
+            const uint8_t c = *data++;
+            if (c < 0x80)
+                continue;
+
+            m_lower = 0x80;
+            m_upper = 0xBF;
+
+            if (c >= 0xC2 && c <= 0xDF)
+                m_needed = 1;
+            else if (c >= 0xE0 && c <= 0xEF)
+            {
+                m_needed = 2;
+                if (c == 0xE0)
+                    m_lower = 0xA0; // overlong
+                else if (c == 0xED)
+                    m_upper = 0x9F; // surrogates
+            }
+            else if (c >= 0xF0 && c <= 0xF4)
+            {
+                m_needed = 3;
+                if (c == 0xF0)
+                    m_lower = 0x90; // overlong
+                else if (c == 0xF4)
+                    m_upper = 0x8F; // > U+10FFFF
+            }
+            else
+            {
+                m_invalid = true;
+                return false;
+            }
+        }
+        else
+        {
+            const uint8_t c = *data++;
+            if (c < m_lower || c > m_upper)
+            {
+                m_invalid = true;
+                return false;
+            }
+
+            m_lower = 0x80;
+            m_upper = 0xBF;
+            m_needed--;
+        }
+    }
+
+    return true;
+}
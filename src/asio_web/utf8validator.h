@@ -0,0 +1,46 @@
+#pragma once
+
+// system includes
+#include <cstdint>
+#include <string_view>
+
+// Incremental UTF-8 validator for websocket text messages. Code points may
+// be split over any number of feed() calls (fragmented frames). Bulk data is
+// checked with the lookup algorithm by Keiser and Lemire ("Validating UTF-8
+// In Less Than One Instruction Per Byte") using SSSE3 when the cpu has it,
+// everything else goes through a scalar state machine with an ascii fast
+// path.
+class Utf8Validator
+{
+public:
+    // returns false once invalid data has been seen
+    bool feed(std::string_view data);
+
+    // true if the data so far is valid and does not end inside a code point
+    bool complete() const { return !m_invalid && !m_needed; }
+
+    // follows a text message over its continuation frames, other frames are
+    // ignored, returns false if the message is invalid so far
+    bool feedFrame(bool fin, uint8_t opcode, std::string_view payload);
+
+    bool invalid() const { return m_invalid; }
+
+    void reset() { *this = {}; }
+
+    // validates a complete buffer
+    static bool validate(std::string_view data);
+
+    // the state machine alone, what cpus without SSSE3 run, for comparison
+    static bool validateScalar(std::string_view data);
+    static bool haveSimd();
+
+private:
+    static bool validateBulk(const uint8_t *data, std::size_t length);
+    bool feedScalar(const uint8_t *data, std::size_t length);
+
+    bool m_invalid{};
+    bool m_inTextMessage{};
+    uint8_t m_needed{};
+    uint8_t m_lower{0x80};
+    uint8_t m_upper{0xBF};
+};
@@ -1,21 +1,173 @@
 #include "webserver.h"
 
+// system includes
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+
 // esp-idf includes
 #include <esp_log.h>
 
 // local includes
 #include "clientconnection.h"
+#include "sslservercontext.h"
 
 namespace {
 constexpr const char * const TAG = "ASIO_WEB";
+
+template<int Level, int Name>
+using IntegerOption = asio::detail::socket_option::integer<Level, Name>;
+template<int Level, int Name>
+using BooleanOption = asio::detail::socket_option::boolean<Level, Name>;
+
+// a failing option is not worth failing the listener or the connection for
+template<typename Socket, typename Option>
+void setOption(Socket &socket, const Option &option, const char *name)
+{
+    std::error_code ec;
+    socket.set_option(option, ec);
+    if (ec)
+        ESP_LOGW(TAG, "setting %s failed: %s", name, ec.message().c_str());
+}
 } // namespace
 
-Webserver::Webserver(asio::io_context &io_context, unsigned short port) :
-    m_acceptor{io_context, asio::ip::tcp::endpoint{asio::ip::tcp::v4(), port}}
+Webserver::Webserver(asio::io_context &io_context, unsigned short port, std::shared_ptr<SslServerContext> sslContext,
+                     const WebserverOptions &options) :
+    m_io_context{io_context},
+    m_options{options},
+    m_admissionControl{m_options.admission},
+    m_acceptor{io_context},
+    m_sslContext{std::move(sslContext)},
+    m_timerWheel{TimerWheel::get(io_context)}
 {
-    ESP_LOGI(TAG, "create webserver on port %hi", port);
+    ESP_LOGI(TAG, "create %s webserver on port %hi", m_sslContext ? "https" : "http", port);
 
-    doAccept();
+    // throws like the acceptor constructor did, only the tuning may fail
+    const asio::ip::tcp::endpoint endpoint{asio::ip::tcp::v4(), port};
+    m_acceptor.open(endpoint.protocol());
+
+    if (m_options.reuseAddress)
+        setOption(m_acceptor, asio::socket_base::reuse_address{true}, "SO_REUSEADDR");
+#ifdef SO_REUSEPORT
+    if (m_options.reusePort)
+        setOption(m_acceptor, BooleanOption<SOL_SOCKET, SO_REUSEPORT>{true}, "SO_REUSEPORT");
+#endif
+#ifdef TCP_DEFER_ACCEPT
+    if (m_options.deferAccept > 0)
+        setOption(m_acceptor, IntegerOption<IPPROTO_TCP, TCP_DEFER_ACCEPT>{m_options.deferAccept}, "TCP_DEFER_ACCEPT");
+#endif
+#ifdef TCP_FASTOPEN
+    if (m_options.fastOpen > 0)
+        setOption(m_acceptor, IntegerOption<IPPROTO_TCP, TCP_FASTOPEN>{m_options.fastOpen}, "TCP_FASTOPEN");
+#endif
+    // inherited by the accepted sockets, the window scale is fixed with the handshake
+    if (m_options.receiveBufferSize > 0)
+        setOption(m_acceptor, asio::socket_base::receive_buffer_size{m_options.receiveBufferSize}, "SO_RCVBUF");
+
+    m_acceptor.bind(endpoint);
+    m_acceptor.listen(m_options.backlog > 0 ? m_options.backlog : asio::socket_base::max_listen_connections);
+
+    // the batch is taken with accept() until it would block
+    if (m_options.acceptBatch > 1)
+        m_acceptor.non_blocking(true);
+
+    for (int i = 0; i < std::max(1, m_options.acceptConcurrency); i++)
+        doAccept();
+}
+
+Webserver::Webserver(asio::io_context &io_context, const WebserverOptions &options) :
+    m_io_context{io_context},
+    m_options{options},
+    m_admissionControl{m_options.admission},
+    m_acceptor{io_context},
+    m_timerWheel{TimerWheel::get(io_context)}
+{
+    ESP_LOGI(TAG, "create in-memory webserver");
+}
+
+Webserver::~Webserver()
+{
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    for (const auto &listener : m_localListeners)
+    {
+        std::error_code ec;
+        listener->acceptor.close(ec);
+        if (!listener->path.empty())
+            std::filesystem::remove(listener->path, ec);
+    }
+#endif
+}
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+void Webserver::listenLocal(const LocalListenerSettings &settings, std::error_code &ec)
+{
+    const bool abstract = !settings.path.empty() && settings.path.front() == '@';
+
+    std::string path{settings.path};
+    if (abstract)
+        path.front() = '\0';
+    else if (settings.removeStale)
+    {
+        // only a socket, never a regular file which happens to be there
+        std::error_code statusError;
+        if (std::filesystem::is_socket(path, statusError))
+            std::filesystem::remove(path, ec);
+        if (ec)
+            return;
+    }
+
+    auto listener = std::make_unique<LocalListener>(LocalListener{
+        .acceptor = asio::local::stream_protocol::acceptor{m_acceptor.get_executor()}
+    });
+    auto &acceptor = listener->acceptor;
+
+    acceptor.open(asio::local::stream_protocol{}, ec);
+    if (!ec)
+        acceptor.bind(asio::local::stream_protocol::endpoint{path}, ec);
+    if (ec)
+        return;
+
+    if (!abstract)
+        listener->path = path;
+
+    if (!abstract && settings.permissions)
+        std::filesystem::permissions(path, *settings.permissions, ec);
+    if (!ec)
+        acceptor.listen(asio::socket_base::max_listen_connections, ec);
+    if (ec)
+    {
+        std::error_code removeError;
+        std::filesystem::remove(path, removeError);
+        return;
+    }
+
+    ESP_LOGI(TAG, "create http webserver on unix socket %s", settings.path.c_str());
+
+    doAcceptLocal(*listener);
+    m_localListeners.push_back(std::move(listener));
+}
+
+void Webserver::doAcceptLocal(LocalListener &listener)
+{
+    listener.acceptor.async_accept(
+        [this, &listener](std::error_code ec, asio::local::stream_protocol::socket socket)
+        {
+            if (ec == asio::error::operation_aborted)
+                return;
+
+            if (ec)
+                ESP_LOGI(TAG, "error: %i", ec.value());
+            else
+                startClient(ClientStream{std::move(socket)});
+
+            doAcceptLocal(listener);
+        });
+}
+#endif
+
+void Webserver::acceptStream(MemoryStream &&stream)
+{
+    startClient(ClientStream{std::move(stream)});
 }
 
 void Webserver::doAccept()
@@ -34,7 +186,125 @@ void Webserver::acceptClient(std::error_code ec, asio::ip::tcp::socket socket)
         return;
     }
 
-    std::make_shared<ClientConnection>(*this, std::move(socket))->start();
+    deferSetup(std::move(socket));
+
+    // during a connection storm the backlog holds many more, a wakeup per
+    // connection would make the accept loop the bottleneck
+    for (int i = 1; i < m_options.acceptBatch; i++)
+    {
+        auto next = m_acceptor.accept(ec);
+        if (ec)
+        {
+            if (ec != asio::error::would_block && ec != asio::error::try_again)
+                ESP_LOGI(TAG, "error: %i", ec.value());
+            break;
+        }
+
+        deferSetup(std::move(next));
+    }
 
     doAccept();
 }
+
+void Webserver::deferSetup(asio::ip::tcp::socket &&socket)
+{
+    // socket options, the remote endpoint and logging of a new connection
+    // run after the accept is armed again
+    asio::post(m_acceptor.get_executor(), [this, socket=std::move(socket)]() mutable {
+        setupClient(std::move(socket));
+    });
+}
+
+void Webserver::setupClient(asio::ip::tcp::socket &&socket)
+{
+    applySocketOptions(socket);
+
+    if (m_sslContext)
+    {
+        // a response is written as several records, nagle would hold back the last one
+        if (!m_options.noDelay)
+        {
+            std::error_code ec;
+            socket.set_option(asio::ip::tcp::no_delay{true}, ec);
+        }
+
+        startClient(ClientStream{std::move(socket), m_sslContext->context()});
+    }
+    else
+        startClient(ClientStream{std::move(socket)});
+}
+
+void Webserver::startClient(ClientStream &&stream)
+{
+    // nothing here is locked, see the class comment
+    if (m_thread == std::thread::id{})
+        m_thread = std::this_thread::get_id();
+    assert(m_thread == std::this_thread::get_id());
+
+    AdmissionControl::Ticket ticket;
+    if (m_admissionControl.limitsConnections() && !admit(stream, ticket))
+        return;
+
+    std::make_shared<ClientConnection>(*this, std::move(stream), std::move(ticket))->start();
+}
+
+bool Webserver::admit(ClientStream &stream, AdmissionControl::Ticket &ticket)
+{
+    std::error_code ec;
+    const auto endpoint = stream.remote_endpoint(ec);
+    if (ec)
+    {
+        // gone again before it was set up
+        stream.close(ec);
+        return false;
+    }
+
+    const auto result = m_admissionControl.admit(endpoint.address(), ticket);
+    if (result == AdmissionControl::Result::Admitted)
+        return true;
+
+    ESP_LOGI(TAG, "%s, refused (%s:%hi)",
+             result == AdmissionControl::Result::TooManyConnections ? "too many connections" : "too many connections from address",
+             endpoint.address().to_string().c_str(), endpoint.port());
+
+    // only if it fits into the send buffer right away, a refused client
+    // must not cost more than the accept. tls is closed without a response.
+    if (m_admissionControl.settings().rejection == AdmissionRejection::Respond)
+    {
+        const auto response = m_admissionControl.serviceUnavailableResponse();
+        stream.tryWrite(asio::buffer(response.data(), response.size()), ec);
+    }
+
+    stream.close(ec);
+    return false;
+}
+
+void Webserver::applySocketOptions(asio::ip::tcp::socket &socket)
+{
+    if (m_options.noDelay)
+        setOption(socket, asio::ip::tcp::no_delay{true}, "TCP_NODELAY");
+#ifdef TCP_QUICKACK
+    if (m_options.quickAck)
+        setOption(socket, IntegerOption<IPPROTO_TCP, TCP_QUICKACK>{1}, "TCP_QUICKACK");
+#endif
+
+    if (m_options.keepAlive)
+    {
+        setOption(socket, asio::socket_base::keep_alive{true}, "SO_KEEPALIVE");
+#ifdef TCP_KEEPIDLE
+        if (m_options.keepAliveIdle > 0)
+            setOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPIDLE>{m_options.keepAliveIdle}, "TCP_KEEPIDLE");
+#endif
+#ifdef TCP_KEEPINTVL
+        if (m_options.keepAliveInterval > 0)
+            setOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPINTVL>{m_options.keepAliveInterval}, "TCP_KEEPINTVL");
+#endif
+#ifdef TCP_KEEPCNT
+        if (m_options.keepAliveCount > 0)
+            setOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPCNT>{m_options.keepAliveCount}, "TCP_KEEPCNT");
+#endif
+    }
+
+    if (m_options.sendBufferSize > 0)
+        setOption(socket, asio::socket_base::send_buffer_size{m_options.sendBufferSize}, "SO_SNDBUF");
+}
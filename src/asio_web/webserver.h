@@ -1,27 +1,135 @@
 #pragma once
 
 // system includes
+#include <chrono>
+#include <filesystem>
 #include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <system_error>
+#include <vector>
 #include <atomic>
+#include <thread>
 
 // esp-idf includes
 #include <asio.hpp>
 
+// local includes
+#include "admissioncontrol.h"
+#include "clientstream.h"
+#include "http2connection.h"
+#include "memorystream.h"
+#include "outboundqueue.h"
+#include "timerwheel.h"
+#include "websocketheartbeat.h"
+
 // forward declares
 class ResponseHandler;
 class ClientConnection;
+class SslServerContext;
+
+// Tuning of the tcp listener and of every accepted socket. Zero keeps the
+// system default, options the platform does not know are skipped.
+struct WebserverOptions
+{
+    // listener
+    int backlog{};             // of listen(), 0 for SOMAXCONN
+    bool reuseAddress{true};
+    bool reusePort{};          // SO_REUSEPORT, several listeners share the port (linux)
+    int deferAccept{};         // TCP_DEFER_ACCEPT, seconds accept() waits for the first data (linux)
+    int fastOpen{};            // TCP_FASTOPEN, queue length of pending fast open requests
+    int acceptConcurrency{1};  // async_accept operations kept outstanding
+    int acceptBatch{16};       // connections taken from the backlog per wakeup, without waiting for the reactor again
+
+    // accepted sockets
+    bool noDelay{true};        // TCP_NODELAY, always on with tls
+    bool quickAck{};           // TCP_QUICKACK after accept (linux), the kernel may turn it off again
+    bool keepAlive{};          // SO_KEEPALIVE, finds peers which are gone without a FIN
+    int keepAliveIdle{};       // TCP_KEEPIDLE, seconds idle before the first probe
+    int keepAliveInterval{};   // TCP_KEEPINTVL, seconds between probes
+    int keepAliveCount{};      // TCP_KEEPCNT, unanswered probes until the connection is dropped
+    int receiveBufferSize{};   // SO_RCVBUF, set on the listener, the window scale is fixed with the handshake
+    int sendBufferSize{};      // SO_SNDBUF
+
+    // connection caps and the request rate limit, for unix sockets and pipes as well
+    AdmissionSettings admission;
+};
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+struct LocalListenerSettings
+{
+    // a leading '@' binds in the abstract namespace (linux), no file is created
+    std::string path;
+    // of the socket file, who may connect. Unset keeps what the umask gave
+    std::optional<std::filesystem::perms> permissions;
+    // a socket file left behind by an earlier run would make the bind fail
+    bool removeStale{true};
+};
+#endif
 
+// A webserver with all of its connections, its timer wheel and its
+// admission control belongs to one io_context, which has to be run by a
+// single thread (asserted in debug builds). More cores are used with one
+// webserver and io_context per thread, sharing the port with reusePort.
+// Only the client counters are atomic, to be read from other threads.
 class Webserver
 {
 public:
-    Webserver(asio::io_context& io_context, unsigned short port);
-    virtual ~Webserver() = default;
+    // with a ssl context every connection is https (and wss), the handshake
+    // happens in the connection, never in the accept loop
+    Webserver(asio::io_context& io_context, unsigned short port, std::shared_ptr<SslServerContext> sslContext = {},
+              const WebserverOptions &options = {});
+    // without a tcp listener, connections only arrive with listenLocal() or
+    // acceptStream(). Of the options only the admission settings apply.
+    explicit Webserver(asio::io_context& io_context, const WebserverOptions &options = {});
+    virtual ~Webserver();
 
     virtual bool connectionKeepAlive() const = 0;
 
     virtual std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) = 0;
 
+    virtual OutboundQueueSettings websocketOutboundQueueSettings() const { return {}; }
+
+    // connection deadlines, zero disables them
+    virtual std::chrono::milliseconds handshakeTimeout() const { return std::chrono::seconds{10}; }
+    virtual std::chrono::milliseconds requestHeaderTimeout() const { return std::chrono::seconds{10}; }
+    virtual std::chrono::milliseconds requestBodyTimeout() const { return std::chrono::seconds{30}; }
+    virtual std::chrono::milliseconds keepAliveTimeout() const { return std::chrono::seconds{60}; }
+    virtual std::chrono::milliseconds websocketIdleTimeout() const { return std::chrono::seconds{120}; }
+
+    virtual WebsocketHeartbeatSettings websocketHeartbeatSettings() const { return {}; }
+
+    // text messages with invalid utf-8 are closed with 1007
+    virtual bool websocketValidateUtf8() const { return true; }
+
+    virtual Http2Settings http2Settings() const { return {}; }
+
+    const std::shared_ptr<SslServerContext> &sslContext() const { return m_sslContext; }
+
+    const WebserverOptions &options() const { return m_options; }
+
+    AdmissionControl &admissionControl() { return m_admissionControl; }
+    const AdmissionControl &admissionControl() const { return m_admissionControl; }
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    // serves a unix domain socket as well, with the same connections as
+    // tcp but always plain http. Can be called several times.
+    void listenLocal(const LocalListenerSettings &settings, std::error_code &ec);
+#endif
+
+    // serves one end of a MemoryStream::pipe() like an accepted socket,
+    // always plain http regardless of sslContext()
+    void acceptStream(MemoryStream &&stream);
+
+    asio::io_context &ioContext() { return m_io_context; }
+
+    TimerWheel &timerWheel() { return m_timerWheel; }
+
+    // bytes queued for sending over all websocket connections
+    OutboundMemoryBudget &outboundMemoryBudget() { return m_outboundMemoryBudget; }
+    const OutboundMemoryBudget &outboundMemoryBudget() const { return m_outboundMemoryBudget; }
+
 protected:
     friend class ClientConnection;
     friend class WebsocketClientConnection;
@@ -31,6 +139,37 @@ protected:
 private:
     void doAccept();
     void acceptClient(std::error_code ec, asio::ip::tcp::socket socket);
+    void deferSetup(asio::ip::tcp::socket &&socket);
+    void setupClient(asio::ip::tcp::socket &&socket);
+    void applySocketOptions(asio::ip::tcp::socket &socket);
+    void startClient(ClientStream &&stream);
+    bool admit(ClientStream &stream, AdmissionControl::Ticket &ticket);
+
+    asio::io_context &m_io_context;
+
+    const WebserverOptions m_options;
+
+    AdmissionControl m_admissionControl;
 
     asio::ip::tcp::acceptor m_acceptor;
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    struct LocalListener
+    {
+        asio::local::stream_protocol::acceptor acceptor;
+        std::string path; // the socket file, removed again, empty in the abstract namespace
+    };
+
+    void doAcceptLocal(LocalListener &listener);
+
+    std::vector<std::unique_ptr<LocalListener>> m_localListeners;
+#endif
+
+    const std::shared_ptr<SslServerContext> m_sslContext;
+
+    TimerWheel &m_timerWheel;
+
+    OutboundMemoryBudget m_outboundMemoryBudget;
+
+    std::thread::id m_thread; // running the io_context, taken from the first connection
 };
@@ -1,5 +1,848 @@
 #include "websocketclient.h"
 
+// system includes
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+// esp-idf includes
+#include <esp_log.h>
+
+// 3rdparty lib includes
+#include <strutils.h>
+#include <numberparsing.h>
+#include <fmt/core.h>
+
+// local includes
+#include "httpheaders.h"
+#include "sslwebsocketclient.h"
+#include "websocketstream.h"
+
 namespace {
 constexpr const char * const TAG = "ASIO_WEB";
 } // namespace
+
+template<typename Stream>
+BasicWebsocketClient<Stream>::BasicWebsocketClient(asio::io_context &io_context, std::string &&host, std::string &&port, std::string &&path,
+                                                   const StreamOptions &streamOptions) :
+    Base{io_context, streamOptions},
+    m_host(std::move(host)),
+    m_port{std::move(port)},
+    m_path{std::move(path)},
+    m_resolver{io_context},
+    m_connector{io_context, [](void *context, const std::error_code &error, asio::ip::tcp::socket &&socket){
+        auto &client = *static_cast<BasicWebsocketClient *>(context);
+        if (!error)
+            client.m_socket.lowest_layer() = std::move(socket);
+        client.onConnected(error);
+    }, this},
+    m_flushTimer{io_context},
+    m_heartbeatTimer{TimerWheel::get(io_context), [](void *context){ static_cast<BasicWebsocketClient *>(context)->heartbeatTimeout(); }, this},
+    m_reconnectTimer{TimerWheel::get(io_context), [](void *context){ static_cast<BasicWebsocketClient *>(context)->reconnect(); }, this}
+{
+}
+
+template<typename Stream>
+BasicWebsocketClient<Stream>::BasicWebsocketClient(asio::io_context &io_context, const std::string &host, const std::string &port, const std::string &path,
+                                                   const StreamOptions &streamOptions) :
+    Base{io_context, streamOptions},
+    m_host{host},
+    m_port{port},
+    m_path{path},
+    m_resolver{io_context},
+    m_connector{io_context, [](void *context, const std::error_code &error, asio::ip::tcp::socket &&socket){
+        auto &client = *static_cast<BasicWebsocketClient *>(context);
+        if (!error)
+            client.m_socket.lowest_layer() = std::move(socket);
+        client.onConnected(error);
+    }, this},
+    m_flushTimer{io_context},
+    m_heartbeatTimer{TimerWheel::get(io_context), [](void *context){ static_cast<BasicWebsocketClient *>(context)->heartbeatTimeout(); }, this},
+    m_reconnectTimer{TimerWheel::get(io_context), [](void *context){ static_cast<BasicWebsocketClient *>(context)->reconnect(); }, this}
+{
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::start()
+{
+    ESP_LOGI(TAG, "called");
+
+    clearError();
+    resolve();
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::resolve()
+{
+    if (!m_endpoints.empty() && espchrono::millis_clock::now() - m_resolvedAt < m_resolveCacheTtl)
+    {
+        ESP_LOGI(TAG, "using %zd cached endpoints", m_endpoints.size());
+        connect();
+        return;
+    }
+
+    ESP_LOGI(TAG, "called");
+
+    m_stats.resolves++;
+    m_resolver.async_resolve(m_host, m_port,
+                             [this, generation=m_generation](const std::error_code &error, asio::ip::tcp::resolver::iterator iterator){
+                                 if (generation == m_generation)
+                                     onResolved(error, iterator);
+                             });
+//    m_resolver.async_resolve("ruezn.local", "1234",
+//                             [this](const std::error_code &error, asio::ip::tcp::resolver::iterator iterator){
+//                                 onResolved(error, iterator);
+//                             });
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::onResolved(const std::error_code &error, asio::ip::tcp::resolver::iterator iterator)
+{
+    if (error)
+    {
+        ESP_LOGW(TAG, "Resolving failed: %i %s", error.value(), error.message().c_str());
+        m_error = Error { .message = fmt::format("Resolving failed: {}", error.value(), error.message()) };
+        handleErrorOccured(*m_error);
+        scheduleReconnect();
+        return;
+    }
+
+    ESP_LOGI(TAG, "called");
+
+    m_endpoints.clear();
+    for (; iterator != asio::ip::tcp::resolver::iterator{}; iterator++)
+        m_endpoints.push_back(iterator->endpoint());
+    m_resolvedAt = espchrono::millis_clock::now();
+
+    connect();
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::connect()
+{
+    ESP_LOGI(TAG, "called");
+
+    m_connector.connect(m_endpoints);
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::onConnected(const std::error_code &error)
+{
+    if (error)
+    {
+        ESP_LOGW(TAG, "Connect failed: %i %s", error.value(), error.message().c_str());
+        m_error = Error { .message = fmt::format("Connect failed: {}", error.value(), error.message()) };
+        handleErrorOccured(*m_error);
+        // the host may have moved, resolve again
+        m_endpoints.clear();
+        scheduleReconnect();
+        return;
+    }
+
+    ESP_LOGI(TAG, "called");
+
+    if constexpr (secure)
+        handshake();
+    else
+        send_request();
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::handshake()
+{
+    ESP_LOGI(TAG, "called");
+
+    if constexpr (secure)
+    {
+        Base::prepareHandshake(m_host, m_port);
+        m_socket.async_handshake(asio::ssl::stream_base::client,
+                                 [this, generation=m_generation](const std::error_code &error) {
+                                     if (generation == m_generation)
+                                         onHandshaked(error);
+                                 });
+    }
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::onHandshaked(const std::error_code &error)
+{
+    if (error)
+    {
+        ESP_LOGW(TAG, "SSL-Handshake failed: %i %s", error.value(), error.message().c_str());
+        m_error = Error { .message = fmt::format("SSL-Handshake failed: {}", error.value(), error.message()) };
+        handleErrorOccured(*m_error);
+        scheduleReconnect();
+        return;
+    }
+
+    ESP_LOGI(TAG, "called");
+
+    if constexpr (secure)
+    {
+        if (Base::sessionReused())
+            m_stats.resumedHandshakes++;
+        else
+            m_stats.fullHandshakes++;
+    }
+
+    send_request();
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::send_request()
+{
+    m_upgradeKey.generate(m_maskGenerator);
+
+    m_request = fmt::format("GET {} HTTP/1.1\r\n"
+                            "Host: {}\r\n"
+                            "Connection: Upgrade\r\n"
+                            "Upgrade: websocket\r\n"
+                            "Sec-WebSocket-Key: {}\r\n"
+                            "Sec-WebSocket-Version: 13\r\n"
+                            "\r\n", m_path, m_host, m_upgradeKey.value());
+    ESP_LOGI(TAG, "called %.*s", m_request.size(), m_request.data());
+
+    m_state = State::Request;
+
+    connectionUpgrade = false;
+    upgradeWebsocket = false;
+    websocketAccepted = false;
+
+    m_utf8Validator.reset();
+    m_closing = false;
+
+    asio::async_write(m_socket,
+                      asio::buffer(m_request.data(), m_request.size()),
+                      [this, generation=m_generation](const std::error_code &error, std::size_t length) {
+                          if (generation == m_generation)
+                              onSentRequest(error, length);
+                      });
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::onSentRequest(const std::error_code &error, std::size_t length)
+{
+    if (error)
+    {
+        ESP_LOGW(TAG, "Sending http request failed: %i %s", error.value(), error.message().c_str());
+        m_error = Error { .message = fmt::format("Sending http request failed: {}", error.value(), error.message()) };
+        handleErrorOccured(*m_error);
+        m_request.clear();
+        std::error_code shutdown_error;
+        shutdownStream(shutdown_error);
+        scheduleReconnect();
+        return;
+    }
+
+    ESP_LOGI(TAG, "called %zd (%zd)", length, m_request.size());
+
+    m_request.clear();
+    m_state = State::Response;
+    m_responseParser.reset();
+
+    receive_response();
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::receive_response()
+{
+    ESP_LOGI(TAG, "called");
+
+    m_socket.async_read_some(asio::buffer(m_receiveBuffer, std::size(m_receiveBuffer)),
+                             [this, generation=m_generation](const std::error_code &error, std::size_t length) {
+                                 if (generation == m_generation)
+                                     onReceivedResponse(error, length);
+                             });
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::onReceivedResponse(const std::error_code &error, std::size_t length)
+{
+    if (error)
+    {
+        ESP_LOGI(TAG, "Receiving http response failed: %i %s", error.value(), error.message().c_str());
+        if (!m_error)
+        {
+            m_error = Error { .message = fmt::format("Receiving http response failed: {}", error.value(), error.message()) };
+            handleErrorOccured(*m_error);
+        }
+        std::error_code shutdown_error;
+        shutdownStream(shutdown_error);
+        scheduleReconnect();
+        return;
+    }
+
+    ESP_LOGI(TAG, "received %.*s", length, m_receiveBuffer);
+
+    std::string_view input{m_receiveBuffer, length};
+
+    while (true)
+    {
+        switch (m_responseParser.parse(input))
+        {
+        case HttpResponseParser::Event::NeedMore:
+            receive_response();
+            return;
+        case HttpResponseParser::Event::ResponseLine:
+            if (m_responseParser.status() != 101)
+            {
+                responseFailed(fmt::format("invalid response status: \"{}\"", m_responseParser.status()));
+                return;
+            }
+            break;
+        case HttpResponseParser::Event::Header:
+        {
+            const auto key = m_responseParser.headerKey();
+            const auto value = m_responseParser.headerValue();
+
+            ESP_LOGD(TAG, "header key=\"%.*s\" value=\"%.*s\"", key.size(), key.data(), value.size(), value.data());
+
+            if (cpputils::stringEqualsIgnoreCase(key, "Connection"))
+            {
+                if (httpHeaderContainsToken(value, "Upgrade"))
+                    connectionUpgrade = true;
+            }
+            else if (cpputils::stringEqualsIgnoreCase(key, "Upgrade"))
+            {
+                if (cpputils::stringEqualsIgnoreCase(value, "websocket"))
+                    upgradeWebsocket = true;
+            }
+            else if (cpputils::stringEqualsIgnoreCase(key, "Sec-WebSocket-Accept"))
+                websocketAccepted = m_upgradeKey.accepts(value);
+            break;
+        }
+        case HttpResponseParser::Event::HeadersComplete:
+        case HttpResponseParser::Event::Body:
+            break;
+        case HttpResponseParser::Event::Complete:
+            upgraded(input);
+            return;
+        case HttpResponseParser::Event::Error:
+            responseFailed(std::string{m_responseParser.error()});
+            return;
+        }
+    }
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::responseFailed(std::string &&message)
+{
+    ESP_LOGW(TAG, "%s", message.c_str());
+    if (!m_error)
+    {
+        m_error = Error { .message = std::move(message) };
+        handleErrorOccured(*m_error);
+    }
+    std::error_code shutdown_error;
+    shutdownStream(shutdown_error);
+    scheduleReconnect();
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::upgraded(std::string_view remaining)
+{
+    if (!connectionUpgrade)
+    {
+        responseFailed("header Connection: Upgrade missing");
+        return;
+    }
+    if (!upgradeWebsocket)
+    {
+        responseFailed("header Upgrade: websocket missing");
+        return;
+    }
+    if (!websocketAccepted)
+    {
+        responseFailed("header Sec-WebSocket-Accept missing or not matching the key");
+        return;
+    }
+
+    if (m_disconnectedAt)
+    {
+        m_stats.lastReconnectDuration = std::chrono::duration_cast<std::chrono::milliseconds>(espchrono::millis_clock::now() - *m_disconnectedAt);
+        m_stats.reconnects++;
+        m_disconnectedAt = std::nullopt;
+        ESP_LOGI(TAG, "reconnected after %lldms", (long long)m_stats.lastReconnectDuration.count());
+    }
+    m_reconnectAttempt = 0;
+
+    handleConnected();
+
+    m_state = State::WebSocket;
+
+    m_heartbeat.reset();
+    if (m_heartbeat.enabled())
+        m_heartbeatTimer.expiresAfter(m_heartbeat.settings().interval);
+
+    // messages sent while connecting, a write of the previous connection
+    // still running starts them from onMessageSent()
+    if (!m_sendingQueue.empty() && !m_sendingQueue.writing())
+        doWrite();
+
+    // frames which arrived together with the response
+    m_parsingBuffer.assign(remaining);
+    if (m_parsingBuffer.empty())
+        doReadWebSocket();
+    else
+        onReceiveWebsocket({}, 0);
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::doReadWebSocket()
+{
+    ESP_LOGI(TAG, "called");
+
+    m_socket.async_read_some(asio::buffer(m_receiveBuffer, std::size(m_receiveBuffer)),
+                             [this, generation=m_generation](const std::error_code &error, std::size_t length) {
+                                 if (generation == m_generation)
+                                     onReceiveWebsocket(error, length);
+                             });
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::onReceiveWebsocket(const std::error_code &error, std::size_t length)
+{
+    if (error)
+    {
+        // the socket went away after a close() by the user, which stays closed
+        if (m_closing && !m_error)
+        {
+            ESP_LOGI(TAG, "closed: %i %s", error.value(), error.message().c_str());
+            return;
+        }
+
+        ESP_LOGI(TAG, "Receiving websocket response failed: %i %s", error.value(), error.message().c_str());
+        if (!m_error)
+        {
+            m_error = Error { .message = fmt::format("Receiving websocket response failed: {}", error.value(), error.message()) };
+            handleErrorOccured(*m_error);
+            handleDisconnected();
+        }
+        m_heartbeatTimer.cancel();
+        std::error_code shutdown_error;
+        shutdownStream(shutdown_error);
+        scheduleReconnect();
+        return;
+    }
+
+//    ESP_LOGV(TAG, "received: %zd \"%.*s\"", length, length, m_receiveBuffer);
+
+    m_parsingBuffer.append({m_receiveBuffer, length});
+
+again:
+//    ESP_LOGV(TAG, "m_parsingBuffer: %s", cpputils::toHexString(m_parsingBuffer).c_str());
+
+    if (m_parsingBuffer.empty())
+    {
+        doReadWebSocket();
+        return;
+    }
+
+    static_assert(sizeof(WebsocketHeader) == 2);
+
+    if (m_parsingBuffer.size() < sizeof(WebsocketHeader))
+    {
+        ESP_LOGW(TAG, "buffer smaller than a websocket header");
+        doReadWebSocket();
+        return;
+    }
+
+//    ESP_LOGV(TAG, "%s%s%s%s %s%s%s%s    %s%s%s%s %s%s%s%s",
+//                  m_parsingBuffer.data()[0]&128?"1":".", m_parsingBuffer.data()[0]&64?"1":".", m_parsingBuffer.data()[0]&32?"1":".", m_parsingBuffer.data()[0]&16?"1":".",
+//                  m_parsingBuffer.data()[0]&8?"1":".", m_parsingBuffer.data()[0]&4?"1":".", m_parsingBuffer.data()[0]&2?"1":".", m_parsingBuffer.data()[0]&1?"1":".",
+//                  m_parsingBuffer.data()[1]&128?"1":".", m_parsingBuffer.data()[1]&64?"1":".", m_parsingBuffer.data()[1]&32?"1":".", m_parsingBuffer.data()[1]&16?"1":".",
+//                  m_parsingBuffer.data()[1]&8?"1":".", m_parsingBuffer.data()[1]&4?"1":".", m_parsingBuffer.data()[1]&2?"1":".", m_parsingBuffer.data()[1]&1?"1":".");
+
+    auto iter = std::begin(m_parsingBuffer);
+
+    const WebsocketHeader &hdr = *(const WebsocketHeader *)(&*iter);
+    std::advance(iter, sizeof(WebsocketHeader));
+
+    ESP_LOGI(TAG, "fin=%i reserved=%i opcode=%i mask=%i payloadLength=%i", hdr.fin, hdr.reserved, hdr.opcode, hdr.mask, hdr.payloadLength);
+
+    uint64_t payloadLength = hdr.payloadLength;
+
+    if (hdr.payloadLength == 126)
+    {
+        if (std::distance(iter, std::end(m_parsingBuffer)) < sizeof(uint16_t))
+        {
+            ESP_LOGW(TAG, "buffer smaller than uint32_t payloadLength");
+            doReadWebSocket();
+            return;
+        }
+
+        payloadLength = decodeFrameLength(&*iter, sizeof(uint16_t));
+        std::advance(iter, sizeof(uint16_t));
+
+        ESP_LOGI(TAG, "16bit payloadLength: %llu", (unsigned long long)payloadLength);
+    }
+    else if (hdr.payloadLength == 127)
+    {
+        if (std::distance(iter, std::end(m_parsingBuffer)) < sizeof(uint64_t))
+        {
+            ESP_LOGW(TAG, "buffer smaller than uint64_t payloadLength");
+            doReadWebSocket();
+            return;
+        }
+
+        payloadLength = decodeFrameLength(&*iter, sizeof(uint64_t));
+        std::advance(iter, sizeof(uint64_t));
+
+        ESP_LOGI(TAG, "64bit payloadLength: %llu", (unsigned long long)payloadLength);
+    }
+
+    if (hdr.mask)
+    {
+        if (std::distance(iter, std::end(m_parsingBuffer)) < sizeof(uint32_t))
+        {
+            ESP_LOGW(TAG, "buffer smaller than uint32_t mask");
+            doReadWebSocket();
+            return;
+        }
+
+        uint32_t mask;
+        std::memcpy(&mask, &*iter, sizeof(mask));
+        std::advance(iter, sizeof(uint32_t));
+
+        if (std::distance(iter, std::end(m_parsingBuffer)) < payloadLength)
+        {
+            ESP_LOGW(TAG, "masked buffer smaller payloadLength");
+            doReadWebSocket();
+            return;
+        }
+
+        applyWebsocketMask(&*iter, &*iter, payloadLength, mask);
+    }
+    else if (std::distance(iter, std::end(m_parsingBuffer)) < payloadLength)
+    {
+        ESP_LOGW(TAG, "buffer smaller payloadLength");
+        doReadWebSocket();
+        return;
+    }
+
+    ESP_LOGI(TAG, "remaining: std::distance=%zd payloadLength=%llu", std::distance(iter, std::end(m_parsingBuffer)), (unsigned long long)payloadLength);
+
+    std::string_view payload{&*iter, std::size_t(payloadLength)};
+
+    ESP_LOGI(TAG, "payload: %.*s", payload.size(), payload.data());
+
+    switch (hdr.opcode)
+    {
+    case 9: // ping
+        sendMessage(true, 0, 10, true, payload);
+        break;
+    case 10: // pong
+        if (m_heartbeat.pongReceived(payload))
+            ESP_LOGD(TAG, "rtt=%lldus srtt=%lldus jitter=%lldus", (long long)m_heartbeat.lastRtt().count(),
+                     (long long)m_heartbeat.smoothedRtt().count(), (long long)m_heartbeat.rttJitter().count());
+        break;
+    default:
+        if (m_validateUtf8 && !m_utf8Validator.feedFrame(hdr.fin, hdr.opcode, payload))
+        {
+            ESP_LOGW(TAG, "invalid utf-8 in text message");
+            if (!m_error)
+            {
+                m_error = Error { .message = "invalid utf-8 in text message" };
+                handleErrorOccured(*m_error);
+                handleDisconnected();
+            }
+            close(1007);
+            return;
+        }
+
+        handleMessage(hdr.fin, hdr.reserved, hdr.opcode, hdr.mask, payload);
+    }
+
+    std::advance(iter, payloadLength);
+    m_parsingBuffer.erase(std::begin(m_parsingBuffer), iter);
+
+    goto again;
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::heartbeatTimeout()
+{
+    WebsocketHeartbeat::Payload payload;
+    if (!m_heartbeat.tick(payload))
+    {
+        ESP_LOGW(TAG, "%hhu pongs missed", m_heartbeat.missedPongs());
+        if (!m_error)
+        {
+            m_error = Error { .message = fmt::format("{} pongs missed", m_heartbeat.missedPongs()) };
+            handleErrorOccured(*m_error);
+            handleDisconnected();
+        }
+        // no ssl shutdown, the peer is not answering anyways
+        std::error_code close_error;
+        m_socket.lowest_layer().close(close_error);
+        m_sendingQueue.dropUnlocked();
+        scheduleReconnect();
+        return;
+    }
+
+    sendMessage(true, 0, 9, true, {payload.data(), payload.size()});
+
+    m_heartbeatTimer.expiresAfter(m_heartbeat.settings().interval);
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::close(uint16_t code)
+{
+    if (m_closing)
+        return;
+
+    const char payload[] { char(code >> 8), char(code) };
+    sendMessage(true, 0, 8, true, {payload, sizeof(payload)});
+
+    m_closing = true;
+    m_heartbeatTimer.cancel();
+}
+
+template<typename Stream>
+bool BasicWebsocketClient<Stream>::sendMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload, std::string_view coalesceKey,
+                                     MessagePriority priority)
+{
+    //ESP_LOGI(TAG, "%.*s", payload.size(), payload.data());
+
+    if (m_closing)
+        return false;
+
+    if (opcode & 0x8)
+    {
+        // control frames are never fragmented and may be sent in between fragments
+        m_sendingQueue.pushControl(encodeWebsocketControlFrame(opcode, payload, mask ? &m_maskGenerator : nullptr));
+
+        scheduleWrite(true);
+
+        return true;
+    }
+
+    const auto maxFragmentSize = m_sendingQueue.settings().maxFragmentSize;
+
+    auto frames = mask ?
+        encodeMaskedWebsocketMessage(fin, reserved, opcode, m_maskGenerator, payload, maxFragmentSize) :
+        encodeWebsocketMessage(fin, reserved, opcode, std::make_shared<const std::string>(payload), maxFragmentSize);
+
+    switch (m_sendingQueue.push(std::move(frames), fin, coalesceKey, priority))
+    {
+    case OutboundQueue::PushResult::Disconnect:
+        ESP_LOGW(TAG, "slow consumer, disconnecting (frames=%zd bytes=%zd)", m_sendingQueue.frames(), m_sendingQueue.bytes());
+        if (!m_error)
+        {
+            m_error = Error { .message = fmt::format("Sending queue full (frames={} bytes={})", m_sendingQueue.frames(), m_sendingQueue.bytes()) };
+            handleErrorOccured(*m_error);
+            handleDisconnected();
+        }
+        m_heartbeatTimer.cancel();
+        {
+            std::error_code close_error;
+            m_socket.lowest_layer().close(close_error);
+        }
+        // the frames on the wire stay until their aborted write completes
+        m_sendingQueue.dropUnlocked();
+        scheduleReconnect();
+        return false;
+    case OutboundQueue::PushResult::Backpressure:
+        handleBackpressure(true);
+        break;
+    case OutboundQueue::PushResult::DroppedOldest:
+        ESP_LOGW(TAG, "sending queue full, dropped oldest (dropped=%zd)", m_sendingQueue.droppedFrames());
+        break;
+    default:;
+    }
+
+    if (!m_sendingQueue.writing())
+        scheduleWrite(priority == MessagePriority::High);
+    else
+        ESP_LOGI(TAG, "enqueueing %zd", m_sendingQueue.frames());
+
+    return true;
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::scheduleWrite(bool urgent)
+{
+    // before the upgrade the frames wait in the queue, upgraded() starts writing them
+    if (m_state != State::WebSocket || m_sendingQueue.writing())
+        return;
+
+    if (!urgent && m_coalescing.flushDelay.count() > 0 && m_sendingQueue.bytes() < m_coalescing.flushBytes)
+    {
+        if (m_flushPending)
+            return;
+
+        m_flushPending = true;
+        m_flushTimer.expires_after(m_coalescing.flushDelay);
+        m_flushTimer.async_wait([this, generation=m_generation](std::error_code error){
+            if (error || generation != m_generation || !m_flushPending)
+                return;
+            m_flushPending = false;
+            if (!m_sendingQueue.empty() && !m_sendingQueue.writing())
+                doWrite();
+        });
+        return;
+    }
+
+    if (m_flushPending)
+    {
+        m_flushPending = false;
+        m_flushTimer.cancel();
+    }
+
+    doWrite();
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::doWrite()
+{
+    // small frames are written together, fewer writes and tls records
+    const auto count = m_sendingQueue.beginWriteBatch(m_sendingQueue.settings().maxBatchSize);
+
+//    ESP_LOGI(TAG, "asio send %zd frames", count);
+
+    if constexpr (secure)
+    {
+        // ssl::stream writes one buffer per record, so the batch is joined
+        // in a buffer which keeps its capacity between writes
+        m_writeBuffer.clear();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            const auto &frame = m_sendingQueue.writingFrame(i).frame;
+            m_writeBuffer.append(frame.headerView());
+            m_writeBuffer.append(frame.payloadView());
+        }
+
+        asio::async_write(m_socket,
+                          asio::buffer(m_writeBuffer.data(), m_writeBuffer.size()),
+                          [this, generation=m_generation](std::error_code ec, std::size_t length)
+                          { onMessageSent(generation, ec, length); });
+    }
+    else
+    {
+        m_writeBuffers.clear();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            const auto &frame = m_sendingQueue.writingFrame(i).frame;
+            m_writeBuffers.push_back(asio::buffer(frame.headerView().data(), frame.headerView().size()));
+            if (frame.length)
+                m_writeBuffers.push_back(asio::buffer(frame.payloadView().data(), frame.payloadView().size()));
+        }
+
+        asio::async_write(m_socket, m_writeBuffers,
+                          [this, generation=m_generation](std::error_code ec, std::size_t length)
+                          { onMessageSent(generation, ec, length); });
+    }
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::onMessageSent(uint32_t generation, std::error_code error, std::size_t length)
+{
+    // a write of an abandoned connection, the new one may have queued up
+    // frames meanwhile which were held back by it
+    if (generation != m_generation)
+    {
+        m_sendingQueue.abortWrite();
+        if (m_state == State::WebSocket && !m_sendingQueue.empty())
+            doWrite();
+        return;
+    }
+
+    if (error)
+    {
+        ESP_LOGI(TAG, "Sending websocket message failed: %i %s", error.value(), error.message().c_str());
+        if (!m_error)
+        {
+            m_error = Error { .message = fmt::format("Sending websocket message failed: {}", error.value(), error.message()) };
+            handleErrorOccured(*m_error);
+            handleDisconnected();
+        }
+        m_heartbeatTimer.cancel();
+        std::error_code shutdown_error;
+        shutdownStream(shutdown_error);
+        scheduleReconnect();
+        m_sendingQueue.abortWrite();
+        return;
+    }
+
+//    ESP_LOGI(TAG, "length=%zd", length);
+
+    m_stats.writes++;
+    m_stats.writtenBytes += length;
+
+    if (m_sendingQueue.finishWrite())
+        handleBackpressure(false);
+
+    // whatever queued up meanwhile has waited long enough, like nagle does
+    if (!m_sendingQueue.empty() && !m_sendingQueue.writing())
+        doWrite();
+    else if (m_closing && m_sendingQueue.empty())
+    {
+        std::error_code close_error;
+        m_socket.lowest_layer().close(close_error);
+
+        // closed because of a protocol error, a close() by the user stays closed
+        if (m_error)
+            scheduleReconnect();
+    }
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::scheduleReconnect()
+{
+    if (!m_reconnectSettings.enabled || m_reconnectTimer.armed())
+        return;
+
+    // whatever is still outstanding on the old connection is ignored when
+    // it completes, no matter if before or after the reconnect
+    m_generation++;
+    m_state = State::Request;
+
+    std::error_code close_error;
+    m_socket.lowest_layer().close(close_error);
+    m_connector.cancel();
+    m_heartbeatTimer.cancel();
+
+    // the rest of a fragmented message cannot continue on a new connection,
+    // what is sent from now on waits in the queue for the upgrade
+    m_sendingQueue.dropUnlocked();
+
+    if (!m_disconnectedAt)
+        m_disconnectedAt = espchrono::millis_clock::now();
+
+    auto delay = m_reconnectSettings.initialDelay;
+    for (uint8_t i = 0; i < m_reconnectAttempt && delay < m_reconnectSettings.maxDelay; i++)
+        delay *= 2;
+    delay = std::min(delay, m_reconnectSettings.maxDelay);
+    if (m_reconnectAttempt < std::numeric_limits<decltype(m_reconnectAttempt)>::max())
+        m_reconnectAttempt++;
+
+    // jitter, so clients dropped at the same time do not come back at the same time
+    if (const auto half = delay.count() / 2; half > 0)
+        delay = std::chrono::milliseconds{delay.count() - half + m_maskGenerator() % (half + 1)};
+
+    ESP_LOGI(TAG, "reconnecting in %lldms (attempt %hhu)", (long long)delay.count(), m_reconnectAttempt);
+
+    m_reconnectTimer.expiresAfter(delay);
+}
+
+template<typename Stream>
+void BasicWebsocketClient<Stream>::reconnect()
+{
+    ESP_LOGI(TAG, "called");
+
+    m_stats.reconnectAttempts++;
+
+    if constexpr (secure)
+        Base::storeSession(m_host, m_port);
+    resetStream();
+    m_parsingBuffer.clear();
+    m_heartbeat.reset();
+    m_flushPending = false;
+    m_flushTimer.cancel();
+
+    start();
+}
+
+template class BasicWebsocketClient<asio::ip::tcp::socket>;
+template class BasicWebsocketClient<asio::ssl::stream<asio::ip::tcp::socket>>;
@@ -1,2 +1,232 @@
 #pragma once
 
+// system include
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <espchrono.h>
+
+// local includes
+#include "happyeyeballs.h"
+#include "httpresponseparser.h"
+#include "outboundqueue.h"
+#include "timerwheel.h"
+#include "websockethandshake.h"
+#include "websocketheartbeat.h"
+#include "utf8validator.h"
+#include "websocketstream.h"
+
+namespace detail {
+// owns the stream of a BasicWebsocketClient, specialized for TLS in sslwebsocketclient.h
+template<typename Stream>
+struct WebsocketClientStream
+{
+    static constexpr bool secure = false;
+
+    struct Options {};
+
+    WebsocketClientStream(asio::io_context &io_context, const Options &) : m_socket{io_context} {}
+
+    void shutdownStream(std::error_code &ec) { m_socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec); }
+
+    // a closed socket is reopened by the next connect
+    void resetStream() { std::error_code ec; m_socket.close(ec); }
+
+    Stream m_socket;
+};
+} // namespace detail
+
+struct WebsocketReconnectSettings
+{
+    bool enabled{};
+    std::chrono::milliseconds initialDelay{500};
+    std::chrono::milliseconds maxDelay{std::chrono::seconds{30}};
+};
+
+// Nagle for websocket messages: an idle client holds normal priority data
+// messages back for flushDelay, so a burst of small messages goes out as
+// one write (and one tls record). High priority messages and control
+// frames flush right away, as does reaching flushBytes.
+struct WebsocketCoalescingSettings
+{
+    std::chrono::microseconds flushDelay{}; // zero disables coalescing
+    std::size_t flushBytes{4 * 1024};
+};
+
+// Websocket client over any asio stream, the handshake, frame parser and
+// send queue are shared. Use WebsocketClient for plain tcp and
+// SslWebsocketClient (sslwebsocketclient.h) for TLS.
+template<typename Stream>
+class BasicWebsocketClient : private detail::WebsocketClientStream<Stream>
+{
+    using Base = detail::WebsocketClientStream<Stream>;
+    using Base::m_socket;
+    using Base::shutdownStream;
+    using Base::resetStream;
+
+public:
+    // for SslWebsocketClient the ssl context to use, see SslClientContext
+    using StreamOptions = typename Base::Options;
+
+    BasicWebsocketClient(asio::io_context &io_context, std::string &&host, std::string &&port, std::string &&path,
+                         const StreamOptions &streamOptions = {});
+    BasicWebsocketClient(asio::io_context &io_context, const std::string &host, const std::string &port, const std::string &path,
+                         const StreamOptions &streamOptions = {});
+    virtual ~BasicWebsocketClient() = default;
+
+    static constexpr bool secure = Base::secure;
+
+    void start();
+
+    struct Error {
+        espchrono::millis_clock::time_point timestamp = espchrono::millis_clock::now();
+        std::string message;
+    };
+
+    virtual void handleConnected() = 0;
+    virtual void handleDisconnected() = 0;
+    virtual void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) = 0;
+    virtual void handleErrorOccured(const Error &error) = 0;
+    // only with SlowConsumerPolicy::Backpressure, stop producing while active
+    virtual void handleBackpressure(bool active) {}
+
+    const std::optional<Error> &error() const { return m_error; }
+    void clearError() { m_error = std::nullopt; }
+
+    struct Stats {
+        uint32_t resolves{};          // dns lookups, connects from the cache are not counted
+        uint32_t reconnectAttempts{};
+        uint32_t reconnects{};        // successful ones
+        uint32_t fullHandshakes{};    // tls only
+        uint32_t resumedHandshakes{}; // tls only, abbreviated with a cached session
+        std::chrono::milliseconds lastReconnectDuration{}; // connection lost until handleConnected()
+        uint64_t writes{};            // completed writes of websocket frames
+        uint64_t writtenBytes{};
+    };
+
+    const Stats &stats() const { return m_stats; }
+
+    // After an error the connection is re-established with exponential
+    // backoff, every delay is picked randomly from its upper half.
+    void setReconnectSettings(const WebsocketReconnectSettings &settings) { m_reconnectSettings = settings; }
+
+    // resolved endpoints are reused for that long, zero resolves on every connect
+    void setResolveCacheTtl(std::chrono::seconds ttl) { m_resolveCacheTtl = ttl; }
+
+    void setCoalescingSettings(const WebsocketCoalescingSettings &settings) { m_coalescing = settings; }
+
+    // resolved addresses are raced (happy eyeballs), a new attempt starts after that delay
+    void setConnectAttemptDelay(std::chrono::milliseconds delay) { m_connector.setAttemptDelay(delay); }
+
+private:
+    void resolve();
+    void onResolved(const std::error_code &error, asio::ip::tcp::resolver::iterator iterator);
+    void connect();
+    void onConnected(const std::error_code &error);
+    void handshake();
+    void onHandshaked(const std::error_code & error);
+    void send_request();
+    void onSentRequest(const std::error_code &error, std::size_t length);
+    void receive_response();
+    void onReceivedResponse(const std::error_code &error, std::size_t length);
+    void responseFailed(std::string &&message);
+    void upgraded(std::string_view remaining);
+    void doReadWebSocket();
+    void onReceiveWebsocket(const std::error_code &error, std::size_t length);
+
+public:
+    // control frames (ping, pong, close) are written before any queued data frame,
+    // data messages larger than OutboundQueueSettings::maxFragmentSize are fragmented.
+    // Before the upgrade and during a reconnect the frames wait in the queue.
+    bool sendMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload, std::string_view coalesceKey = {},
+                     MessagePriority priority = MessagePriority::Normal);
+
+    const OutboundQueue &sendingQueue() const { return m_sendingQueue; }
+    void setOutboundQueueSettings(const OutboundQueueSettings &settings) { m_sendingQueue.setSettings(settings); }
+    void setOutboundMemoryBudget(OutboundMemoryBudget *budget) { m_sendingQueue.setBudget(budget); }
+    bool backpressured() const { return m_sendingQueue.backpressured(); }
+
+    const WebsocketHeartbeat &heartbeat() const { return m_heartbeat; }
+    void setHeartbeatSettings(const WebsocketHeartbeatSettings &settings) { m_heartbeat.setSettings(settings); }
+
+    // text messages with invalid utf-8 are closed with 1007
+    void setValidateUtf8(bool validateUtf8) { m_validateUtf8 = validateUtf8; }
+
+    // sends a close frame and closes the socket once everything is written
+    void close(uint16_t code);
+
+private:
+    void heartbeatTimeout();
+
+    void scheduleReconnect();
+    void reconnect();
+
+    void scheduleWrite(bool urgent);
+    void doWrite();
+    void onMessageSent(uint32_t generation, std::error_code error, std::size_t length);
+
+    std::string m_host;
+    std::string m_port;
+    std::string m_path;
+
+    asio::ip::tcp::resolver m_resolver;
+    std::vector<asio::ip::tcp::endpoint> m_endpoints;
+    espchrono::millis_clock::time_point m_resolvedAt;
+    std::chrono::seconds m_resolveCacheTtl{60};
+    HappyEyeballsConnector m_connector;
+    char m_receiveBuffer[1024];
+
+    enum class State { Request, Response, WebSocket };
+    State m_state { State::Request };
+
+    HttpResponseParser m_responseParser;
+    WebsocketUpgradeKey m_upgradeKey;
+    bool connectionUpgrade;
+    bool upgradeWebsocket;
+    bool websocketAccepted;
+
+    std::string m_parsingBuffer;
+
+    std::string m_request;
+    OutboundQueue m_sendingQueue;
+    std::string m_writeBuffer; // only for secure streams
+    std::vector<asio::const_buffer> m_writeBuffers; // only for plain streams
+
+    WebsocketCoalescingSettings m_coalescing;
+    // the timer wheel is too coarse for a few milliseconds
+    asio::steady_timer m_flushTimer;
+    bool m_flushPending{};
+
+    std::optional<Error> m_error;
+
+    WebsocketHeartbeat m_heartbeat;
+    TimerWheel::Timer m_heartbeatTimer;
+
+    WebsocketMaskGenerator m_maskGenerator;
+
+    bool m_validateUtf8{true};
+    Utf8Validator m_utf8Validator;
+
+    bool m_closing{};
+
+    // bumped when a connection is abandoned, completions of older ones are ignored
+    uint32_t m_generation{};
+
+    WebsocketReconnectSettings m_reconnectSettings;
+    TimerWheel::Timer m_reconnectTimer;
+    uint8_t m_reconnectAttempt{};
+    std::optional<espchrono::millis_clock::time_point> m_disconnectedAt;
+
+    Stats m_stats;
+};
+
+using WebsocketClient = BasicWebsocketClient<asio::ip::tcp::socket>;
+
+extern template class BasicWebsocketClient<asio::ip::tcp::socket>;
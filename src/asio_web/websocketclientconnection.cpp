@@ -1,13 +1,14 @@
 #include "websocketclientconnection.h"
 
 // system includes
+#include <array>
+#include <cstring>
 
 // esp-idf includes
 #include <esp_log.h>
 
 // 3rdparty lib includes
 #include <strutils.h>
-#include <fmt/core.h>
 
 // local includes
 #include "webserver.h"
@@ -18,13 +19,20 @@ namespace {
 constexpr const char * const TAG = "ASIO_WEB";
 } // namespace
 
-WebsocketClientConnection::WebsocketClientConnection(Webserver &webserver, asio::ip::tcp::socket socket,
-                                                     std::string &&parsingBuffer, std::unique_ptr<ResponseHandler> &&responseHandler) :
+WebsocketClientConnection::WebsocketClientConnection(Webserver &webserver, ClientStream &&stream,
+                                                     std::string &&parsingBuffer, std::unique_ptr<ResponseHandler> &&responseHandler,
+                                                     AdmissionControl::Ticket &&admission) :
     m_webserver{webserver},
-    m_socket{std::move(socket)},
-    m_remote_endpoint{m_socket.remote_endpoint()},
+    m_stream{std::move(stream)},
+    m_remote_endpoint{[&](){ std::error_code ec; return m_stream.remote_endpoint(ec); }()},
+    m_admission{std::move(admission)},
     m_parsingBuffer{std::move(parsingBuffer)},
-    m_responseHandler{std::move(responseHandler)}
+    m_responseHandler{std::move(responseHandler)},
+    m_sendingQueue{m_webserver.websocketOutboundQueueSettings(), &m_webserver.outboundMemoryBudget()},
+    m_idleTimer{m_webserver.timerWheel(), [](void *context){ static_cast<WebsocketClientConnection *>(context)->idleTimeoutExpired(); }, this},
+    m_heartbeat{m_webserver.websocketHeartbeatSettings()},
+    m_heartbeatTimer{m_webserver.timerWheel(), [](void *context){ static_cast<WebsocketClientConnection *>(context)->heartbeatTimeout(); }, this},
+    m_validateUtf8{m_webserver.websocketValidateUtf8()}
 {
     ESP_LOGI(TAG, "new client (%s:%hi)",
              m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
@@ -34,6 +42,9 @@ WebsocketClientConnection::WebsocketClientConnection(Webserver &webserver, asio:
 
 WebsocketClientConnection::~WebsocketClientConnection()
 {
+    if (m_responseHandler)
+        m_responseHandler->websocketDisconnected(*this);
+
     ESP_LOGI(TAG, "client destroyed (%s:%hi)",
              m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
 
@@ -42,12 +53,48 @@ WebsocketClientConnection::~WebsocketClientConnection()
 
 void WebsocketClientConnection::start()
 {
+    if (m_responseHandler)
+        m_responseHandler->websocketConnected(*this);
+
+    if (m_heartbeat.enabled())
+        m_heartbeatTimer.expiresAfter(m_heartbeat.settings().interval);
+
     doReadWebSocket();
 }
 
+void WebsocketClientConnection::idleTimeoutExpired()
+{
+    ESP_LOGI(TAG, "idle timeout (%s:%hi)",
+             m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+    std::error_code ec;
+    m_stream.close(ec);
+}
+
+void WebsocketClientConnection::heartbeatTimeout()
+{
+    WebsocketHeartbeat::Payload payload;
+    if (!m_heartbeat.tick(payload))
+    {
+        ESP_LOGI(TAG, "%hhu pongs missed (%s:%hi)", m_heartbeat.missedPongs(),
+                 m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+
+        std::error_code ec;
+        m_stream.close(ec);
+        return;
+    }
+
+    sendMessage(true, 0, 9, false, {payload.data(), payload.size()});
+
+    m_heartbeatTimer.expiresAfter(m_heartbeat.settings().interval);
+}
+
 void WebsocketClientConnection::doReadWebSocket()
 {
-    m_socket.async_read_some(asio::buffer(m_receiveBuffer, max_length),
+    if (const auto timeout = m_webserver.websocketIdleTimeout(); timeout.count() > 0)
+        m_idleTimer.expiresAfter(timeout);
+
+    m_stream.async_read_some(asio::buffer(m_receiveBuffer, max_length),
                              [this, self=shared_from_this()](std::error_code ec, std::size_t length)
                              { readyReadWebSocket(ec, length); });
 }
@@ -107,7 +154,7 @@ again:
             return;
         }
 
-        payloadLength = __builtin_bswap16(*(const uint16_t *)(&*iter));
+        payloadLength = decodeFrameLength(&*iter, sizeof(uint16_t));
         std::advance(iter, sizeof(uint16_t));
 
 //        ESP_LOGV(TAG, "16bit payloadLength: %u", payloadLength);
@@ -121,10 +168,10 @@ again:
             return;
         }
 
-        payloadLength = *(const uint64_t *)(&*iter);
+        payloadLength = decodeFrameLength(&*iter, sizeof(uint64_t));
         std::advance(iter, sizeof(uint64_t));
 
-        ESP_LOGI(TAG, "64bit payloadLength: %llu", payloadLength);
+        ESP_LOGI(TAG, "64bit payloadLength: %llu", (unsigned long long)payloadLength);
     }
 
     if (hdr.mask)
@@ -136,11 +183,8 @@ again:
             return;
         }
 
-        union {
-            uint32_t mask;
-            uint8_t maskArr[4];
-        };
-        mask = *(const uint32_t *)(&*iter);
+        uint32_t mask;
+        std::memcpy(&mask, &*iter, sizeof(mask));
         std::advance(iter, sizeof(uint32_t));
 
         if (std::distance(iter, std::end(m_parsingBuffer)) < payloadLength)
@@ -150,15 +194,7 @@ again:
             return;
         }
 
-        auto iter2 = std::begin(maskArr);
-        for (auto iter3 = iter;
-             iter3 != std::end(m_parsingBuffer) && iter3 != std::next(iter, payloadLength);
-             iter3++)
-        {
-            *iter3 ^= *(iter2++);
-            if (iter2 == std::end(maskArr))
-                iter2 = std::begin(maskArr);
-        }
+        applyWebsocketMask(&*iter, &*iter, payloadLength, mask);
     }
     else if (std::distance(iter, std::end(m_parsingBuffer)) < payloadLength)
     {
@@ -167,36 +203,145 @@ again:
         return;
     }
 
-    ESP_LOGI(TAG, "remaining: %zd %llu", std::distance(iter, std::end(m_parsingBuffer)), payloadLength);
+    ESP_LOGI(TAG, "remaining: %zd %llu", std::distance(iter, std::end(m_parsingBuffer)), (unsigned long long)payloadLength);
 
     ESP_LOGI(TAG, "payload: %.*s", int(payloadLength), &*iter);
 
+    {
+        const std::string_view payload{&*iter, std::size_t(payloadLength)};
+
+        switch (hdr.opcode)
+        {
+        case 9: // ping
+            sendMessage(true, 0, 10, false, payload);
+            break;
+        case 10: // pong
+            m_heartbeat.pongReceived(payload);
+            break;
+        default:
+            if (m_validateUtf8 && !m_utf8Validator.feedFrame(hdr.fin, hdr.opcode, payload))
+            {
+                ESP_LOGW(TAG, "invalid utf-8 in text message (%s:%hi)",
+                         m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+                close(1007);
+                return;
+            }
+
+            if (m_responseHandler)
+                m_responseHandler->websocketMessageReceived(*this, hdr.fin, hdr.reserved, hdr.opcode, hdr.mask, payload);
+        }
+    }
+
     std::advance(iter, payloadLength);
     m_parsingBuffer.erase(std::begin(m_parsingBuffer), iter);
 
-    sendMessage(true, 0, 1, false, fmt::format("received {}", payloadLength));
-
     goto again;
 }
 
-void WebsocketClientConnection::sendMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload)
+bool WebsocketClientConnection::sendMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload,
+                                            std::string_view coalesceKey, MessagePriority priority)
+{
+    if (!m_stream.is_open() || m_closing)
+        return false;
+
+    if (opcode & 0x8)
+    {
+        // control frames are never fragmented and may be sent in between fragments
+        sendControl(encodeWebsocketControlFrame(opcode, payload, mask ? &WebsocketMaskGenerator::threadLocal() : nullptr));
+        return true;
+    }
+
+    const auto maxFragmentSize = m_sendingQueue.settings().maxFragmentSize;
+
+    auto frames = mask ?
+        encodeMaskedWebsocketMessage(fin, reserved, opcode, WebsocketMaskGenerator::threadLocal(), payload, maxFragmentSize) :
+        encodeWebsocketMessage(fin, reserved, opcode, std::make_shared<const std::string>(payload), maxFragmentSize);
+
+    return queued(m_sendingQueue.push(std::move(frames), fin, coalesceKey, priority));
+}
+
+bool WebsocketClientConnection::sendMessage(bool fin, uint8_t reserved, uint8_t opcode, std::shared_ptr<const std::string> payload,
+                                            std::string_view coalesceKey, MessagePriority priority)
+{
+    if (!m_stream.is_open() || m_closing)
+        return false;
+
+    if (opcode & 0x8)
+    {
+        sendControl(encodeWebsocketControlFrame(opcode, *payload));
+        return true;
+    }
+
+    auto frames = encodeWebsocketMessage(fin, reserved, opcode, std::move(payload), m_sendingQueue.settings().maxFragmentSize);
+
+    return queued(m_sendingQueue.push(std::move(frames), fin, coalesceKey, priority));
+}
+
+void WebsocketClientConnection::close(uint16_t code)
+{
+    if (m_closing)
+        return;
+
+    const char payload[] { char(code >> 8), char(code) };
+    sendMessage(true, 0, 8, false, {payload, sizeof(payload)});
+
+    m_closing = true;
+    m_heartbeatTimer.cancel();
+}
+
+bool WebsocketClientConnection::sendFrames(std::vector<WebsocketFrame> frames, std::string_view coalesceKey, MessagePriority priority)
+{
+    if (!m_stream.is_open() || m_closing)
+        return false;
+
+    return queued(m_sendingQueue.push(std::move(frames), true, coalesceKey, priority));
+}
+
+void WebsocketClientConnection::sendControl(WebsocketFrame &&frame)
+{
+    m_sendingQueue.pushControl(std::move(frame));
+
+    if (!m_sendingQueue.writing())
+        doWrite();
+}
+
+bool WebsocketClientConnection::queued(OutboundQueue::PushResult result)
 {
-    m_sendBuffer.clear();
-    m_sendBuffer.resize(2);
+    switch (result)
     {
-        auto iter = std::begin(m_sendBuffer);
-        WebsocketHeader &hdr = *(WebsocketHeader *)(&*iter);
-        hdr.fin = fin;
-        hdr.reserved = reserved;
-        hdr.opcode = opcode;
-        hdr.mask = mask;
-        hdr.payloadLength = payload.size();
+    case OutboundQueue::PushResult::Disconnect:
+        ESP_LOGW(TAG, "slow consumer, disconnecting (frames=%zd bytes=%zd) (%s:%hi)",
+                 m_sendingQueue.frames(), m_sendingQueue.bytes(),
+                 m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        {
+            std::error_code ec;
+            m_stream.close(ec);
+        }
+        return false;
+    case OutboundQueue::PushResult::Backpressure:
+        if (m_responseHandler)
+            m_responseHandler->websocketBackpressure(*this, true);
+        break;
+    default:;
     }
-    m_sendBuffer.append(payload);
 
-    asio::async_write(m_socket,
-                      asio::buffer(m_sendBuffer.data(), m_sendBuffer.size()),
-                      [this](std::error_code ec, std::size_t length)
+    if (!m_sendingQueue.writing())
+        doWrite();
+
+    return true;
+}
+
+void WebsocketClientConnection::doWrite()
+{
+    const auto &frame = m_sendingQueue.beginWrite().frame;
+
+    const std::array<asio::const_buffer, 2> buffers {
+        asio::buffer(frame.headerView().data(), frame.headerView().size()),
+        asio::buffer(frame.payloadView().data(), frame.payloadView().size())
+    };
+
+    asio::async_write(m_stream, buffers,
+                      [this, self=shared_from_this()](std::error_code ec, std::size_t length)
                       { onMessageSent(ec, length); });
 }
 
@@ -206,8 +351,21 @@ void WebsocketClientConnection::onMessageSent(std::error_code ec, std::size_t le
     {
         ESP_LOGW(TAG, "error: %i (%s:%hi)", ec.value(),
                  m_remote_endpoint.address().to_string().c_str(), m_remote_endpoint.port());
+        m_sendingQueue.clear();
         return;
     }
 
-    ESP_LOGI(TAG, "length=%zd", length);
+//    ESP_LOGV(TAG, "length=%zd", length);
+
+    if (m_sendingQueue.finishWrite() && m_responseHandler)
+        m_responseHandler->websocketBackpressure(*this, false);
+
+    if (!m_sendingQueue.empty() && !m_sendingQueue.writing())
+        doWrite();
+    else if (m_closing && m_sendingQueue.empty())
+    {
+        std::error_code ec;
+        m_stream.shutdown(ec);
+        m_stream.close(ec);
+    }
 }
@@ -1,39 +1,80 @@
 #pragma once
 
 // system includes
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 // esp-idf includes
 #include <asio.hpp>
 
+// local includes
+#include "admissioncontrol.h"
+#include "clientstream.h"
+#include "outboundqueue.h"
+#include "timerwheel.h"
+#include "websocketheartbeat.h"
+#include "utf8validator.h"
+
 class Webserver;
 class ResponseHandler;
 
 class WebsocketClientConnection : public std::enable_shared_from_this<WebsocketClientConnection>
 {
 public:
-    WebsocketClientConnection(Webserver &webserver, asio::ip::tcp::socket socket, std::string &&parsingBuffer, std::unique_ptr<ResponseHandler> &&responseHandler);
+    WebsocketClientConnection(Webserver &webserver, ClientStream &&stream, std::string &&parsingBuffer, std::unique_ptr<ResponseHandler> &&responseHandler,
+                              AdmissionControl::Ticket &&admission = {});
     ~WebsocketClientConnection();
 
     Webserver &webserver() { return m_webserver; }
     const Webserver &webserver() const { return m_webserver; }
 
-    asio::ip::tcp::socket &socket() { return m_socket; }
-    const asio::ip::tcp::socket &socket() const { return m_socket; }
+    ClientStream &stream() { return m_stream; }
+    const ClientStream &stream() const { return m_stream; }
 
     const asio::ip::tcp::endpoint &remote_endpoint() const { return m_remote_endpoint; }
 
     void start();
 
+    // control frames (ping, pong, close) are written before any queued data frame,
+    // data messages larger than OutboundQueueSettings::maxFragmentSize are fragmented
+    bool sendMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload, std::string_view coalesceKey = {},
+                     MessagePriority priority = MessagePriority::Normal);
+
+    // unmasked data message, the payload is referenced instead of copied
+    bool sendMessage(bool fin, uint8_t reserved, uint8_t opcode, std::shared_ptr<const std::string> payload, std::string_view coalesceKey = {},
+                     MessagePriority priority = MessagePriority::Normal);
+
+    // queues the already encoded frames of a complete message, they may be shared with other connections (see WebsocketHub)
+    // returns false if the connection is closed or has been closed because of the slow consumer policy
+    bool sendFrames(std::vector<WebsocketFrame> frames, std::string_view coalesceKey = {},
+                    MessagePriority priority = MessagePriority::Normal);
+
+    const OutboundQueue &sendingQueue() const { return m_sendingQueue; }
+    bool backpressured() const { return m_sendingQueue.backpressured(); }
+
+    const WebsocketHeartbeat &heartbeat() const { return m_heartbeat; }
+
+    // sends a close frame and closes the socket once everything is written
+    void close(uint16_t code);
+
 private:
+    void idleTimeoutExpired();
+    void heartbeatTimeout();
+
     void doReadWebSocket();
     void readyReadWebSocket(std::error_code ec, std::size_t length);
 
-    void sendMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload);
+    bool queued(OutboundQueue::PushResult result);
+    void sendControl(WebsocketFrame &&frame);
+    void doWrite();
     void onMessageSent(std::error_code ec, std::size_t length);
 
     Webserver &m_webserver;
-    asio::ip::tcp::socket m_socket;
+    ClientStream m_stream;
     const asio::ip::tcp::endpoint m_remote_endpoint;
+    AdmissionControl::Ticket m_admission;
 
     static constexpr const std::size_t max_length = 1024;
     char m_receiveBuffer[max_length];
@@ -42,5 +83,15 @@ private:
 
     std::unique_ptr<ResponseHandler> m_responseHandler;
 
-    std::string m_sendBuffer;
+    OutboundQueue m_sendingQueue;
+
+    TimerWheel::Timer m_idleTimer;
+
+    WebsocketHeartbeat m_heartbeat;
+    TimerWheel::Timer m_heartbeatTimer;
+
+    const bool m_validateUtf8;
+    Utf8Validator m_utf8Validator;
+
+    bool m_closing{};
 };
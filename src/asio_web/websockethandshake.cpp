@@ -0,0 +1,103 @@
+#include "websockethandshake.h"
+
+// system includes
+#include <algorithm>
+#include <cstring>
+
+// 3rdparty lib includes
+#include <strutils.h>
+
+// local includes
+#include "httpheaders.h"
+#include "sha1.h"
+#include "websocketstream.h"
+
+namespace {
+constexpr std::string_view magicUuid{"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"};
+
+constexpr std::string_view responseBegin{"HTTP/1.1 101 Switching Protocols\r\n"
+                                         "Upgrade: websocket\r\n"
+                                         "Connection: Upgrade\r\n"
+                                         "Sec-WebSocket-Accept: "};
+constexpr std::string_view responseEnd{"\r\n\r\n"};
+
+static_assert(responseBegin.size() + 28 + responseEnd.size() == WebsocketUpgradeRequest::responseSize);
+
+template<std::size_t N>
+std::array<char, (N + 2) / 3 * 4> base64(const std::array<uint8_t, N> &data)
+{
+    constexpr std::string_view alphabet{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"};
+
+    std::array<char, (N + 2) / 3 * 4> result;
+    auto iter = std::begin(result);
+    for (std::size_t i = 0; i < N; i += 3)
+    {
+        const uint32_t group = uint32_t(data[i]) << 16 |
+                               (i + 1 < N ? uint32_t(data[i + 1]) << 8 : 0) |
+                               (i + 2 < N ? uint32_t(data[i + 2]) : 0);
+        *iter++ = alphabet[(group >> 18) & 0x3F];
+        *iter++ = alphabet[(group >> 12) & 0x3F];
+        *iter++ = i + 1 < N ? alphabet[(group >> 6) & 0x3F] : '=';
+        *iter++ = i + 2 < N ? alphabet[group & 0x3F] : '=';
+    }
+
+    return result;
+}
+} // namespace
+
+void WebsocketUpgradeRequest::headerReceived(std::string_view key, std::string_view value)
+{
+    if (cpputils::stringEqualsIgnoreCase(key, "Connection"))
+        m_connectionUpgrade = httpHeaderContainsToken(value, "Upgrade");
+    else if (cpputils::stringEqualsIgnoreCase(key, "Upgrade"))
+        m_upgradeWebsocket = cpputils::stringEqualsIgnoreCase(value, "websocket");
+    else if (cpputils::stringEqualsIgnoreCase(key, "Sec-WebSocket-Version"))
+        m_version13 = value == "13";
+    else if (cpputils::stringEqualsIgnoreCase(key, "Sec-WebSocket-Key"))
+    {
+        if (value.size() == m_key.size())
+        {
+            std::copy(std::begin(value), std::end(value), std::begin(m_key));
+            m_keySize = m_key.size();
+        }
+        else
+            m_keySize = 0;
+    }
+}
+
+std::size_t WebsocketUpgradeRequest::writeResponse(ResponseBuffer &buffer) const
+{
+    const auto accept = acceptKey({m_key.data(), m_keySize});
+
+    auto iter = std::begin(buffer);
+    iter = std::copy(std::begin(responseBegin), std::end(responseBegin), iter);
+    iter = std::copy(std::begin(accept), std::end(accept), iter);
+    iter = std::copy(std::begin(responseEnd), std::end(responseEnd), iter);
+
+    return std::distance(std::begin(buffer), iter);
+}
+
+std::array<char, 28> WebsocketUpgradeRequest::acceptKey(std::string_view key)
+{
+    Sha1 sha1;
+    sha1.update(key);
+    sha1.update(magicUuid);
+    return base64(sha1.finish());
+}
+
+void WebsocketUpgradeKey::generate(WebsocketMaskGenerator &random)
+{
+    std::array<uint8_t, 16> bytes;
+    for (std::size_t i = 0; i < bytes.size(); i += 4)
+    {
+        const uint32_t value = random();
+        std::memcpy(&bytes[i], &value, 4);
+    }
+    m_key = base64(bytes);
+}
+
+bool WebsocketUpgradeKey::accepts(std::string_view accept) const
+{
+    const auto expected = WebsocketUpgradeRequest::acceptKey(value());
+    return accept == std::string_view{expected.data(), expected.size()};
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// system includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// forward declares
+class WebsocketMaskGenerator;
+
+// Server side of the RFC 6455 opening handshake. The relevant headers are
+// picked up while ClientConnection parses them, nothing is allocated.
+class WebsocketUpgradeRequest
+{
+public:
+    // "HTTP/1.1 101 Switching Protocols" with all headers
+    static constexpr std::size_t responseSize = 129;
+    using ResponseBuffer = std::array<char, responseSize>;
+
+    void headerReceived(std::string_view key, std::string_view value);
+    void reset() { *this = {}; }
+
+    // Connection: Upgrade and Upgrade: websocket
+    bool requested() const { return m_connectionUpgrade && m_upgradeWebsocket; }
+
+    // version 13 and a key of 16 base64 encoded bytes
+    bool valid() const { return requested() && m_version13 && m_keySize == m_key.size(); }
+
+    // only valid() requests, returns the response length
+    std::size_t writeResponse(ResponseBuffer &buffer) const;
+
+    // base64(sha1(key + magic uuid))
+    static std::array<char, 28> acceptKey(std::string_view key);
+
+private:
+    bool m_connectionUpgrade{};
+    bool m_upgradeWebsocket{};
+    bool m_version13{};
+    uint8_t m_keySize{};
+    std::array<char, 24> m_key;
+};
+
+// Client side of the opening handshake: a random key for every request
+// and the check of the Sec-WebSocket-Accept the server answers with.
+class WebsocketUpgradeKey
+{
+public:
+    // 16 random bytes, base64 encoded
+    void generate(WebsocketMaskGenerator &random);
+
+    std::string_view value() const { return {m_key.data(), m_key.size()}; }
+
+    bool accepts(std::string_view accept) const;
+
+private:
+    std::array<char, 24> m_key{};
+};
@@ -0,0 +1,68 @@
+#include "websocketheartbeat.h"
+
+// system includes
+#include <algorithm>
+
+namespace {
+uint64_t nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(WebsocketHeartbeat::clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+bool WebsocketHeartbeat::tick(Payload &payload)
+{
+    if (m_awaitingPong && ++m_missedPongs >= m_settings.maxMissedPongs)
+        return false;
+
+    const auto now = nowMicros();
+    for (std::size_t i = 0; i < payload.size(); i++)
+        payload[i] = char(now >> (8 * (payload.size() - 1 - i)));
+
+    m_outstanding = payload;
+    m_awaitingPong = true;
+
+    return true;
+}
+
+bool WebsocketHeartbeat::pongReceived(std::string_view payload)
+{
+    if (!m_awaitingPong ||
+        payload.size() != m_outstanding.size() ||
+        !std::equal(std::begin(payload), std::end(payload), std::begin(m_outstanding)))
+        return false;
+
+    uint64_t sent{};
+    for (const char c : payload)
+        sent = (sent << 8) | uint8_t(c);
+
+    m_awaitingPong = false;
+    m_missedPongs = 0;
+
+    const std::chrono::microseconds rtt(nowMicros() - sent);
+    m_lastRtt = rtt;
+
+    if (!m_samples++)
+    {
+        m_smoothedRtt = rtt;
+        m_rttVariation = rtt / 2;
+    }
+    else
+    {
+        const auto delta = m_smoothedRtt > rtt ? m_smoothedRtt - rtt : rtt - m_smoothedRtt;
+        m_rttVariation = (3 * m_rttVariation + delta) / 4;
+        m_smoothedRtt = (7 * m_smoothedRtt + rtt) / 8;
+    }
+
+    return true;
+}
+
+void WebsocketHeartbeat::reset()
+{
+    m_awaitingPong = false;
+    m_missedPongs = 0;
+    m_samples = 0;
+    m_lastRtt = {};
+    m_smoothedRtt = {};
+    m_rttVariation = {};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// system includes
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+struct WebsocketHeartbeatSettings
+{
+    std::chrono::milliseconds interval{std::chrono::seconds{15}}; // zero disables pings
+    uint8_t maxMissedPongs{3};
+};
+
+// Bookkeeping for library generated pings. Every ping carries its send
+// timestamp, the matching pong yields a round trip time sample which is
+// smoothed like TCP does it (RFC 6298).
+class WebsocketHeartbeat
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using Payload = std::array<char, 8>;
+
+    explicit WebsocketHeartbeat(const WebsocketHeartbeatSettings &settings = {}) : m_settings{settings} {}
+
+    const WebsocketHeartbeatSettings &settings() const { return m_settings; }
+    void setSettings(const WebsocketHeartbeatSettings &settings) { m_settings = settings; }
+
+    bool enabled() const { return m_settings.interval.count() > 0; }
+
+    // called every interval, returns false once too many pongs are missing,
+    // otherwise payload is filled for the next ping
+    bool tick(Payload &payload);
+
+    // returns true if the pong answered our last ping
+    bool pongReceived(std::string_view payload);
+
+    void reset();
+
+    uint8_t missedPongs() const { return m_missedPongs; }
+    bool hasRtt() const { return m_samples; }
+    std::chrono::microseconds lastRtt() const { return m_lastRtt; }
+    std::chrono::microseconds smoothedRtt() const { return m_smoothedRtt; }
+    std::chrono::microseconds rttJitter() const { return m_rttVariation; }
+
+private:
+    WebsocketHeartbeatSettings m_settings;
+
+    Payload m_outstanding{};
+    bool m_awaitingPong{};
+    uint8_t m_missedPongs{};
+
+    uint32_t m_samples{};
+    std::chrono::microseconds m_lastRtt{};
+    std::chrono::microseconds m_smoothedRtt{};
+    std::chrono::microseconds m_rttVariation{};
+};
@@ -0,0 +1,143 @@
+#include "websockethub.h"
+
+// system includes
+#include <algorithm>
+
+// local includes
+#include "websocketclientconnection.h"
+#include "websocketstream.h"
+
+void WebsocketHub::subscribe(std::string_view topic, const std::shared_ptr<WebsocketClientConnection> &connection)
+{
+    const auto executor = connection->stream().get_executor();
+
+    std::lock_guard lock{m_mutex};
+
+    auto iter = m_topics.find(topic);
+    if (iter == std::end(m_topics))
+        iter = m_topics.emplace(std::string{topic}, Topic{}).first;
+
+    auto &shards = iter->second.shards;
+
+    auto shard = std::find_if(std::begin(shards), std::end(shards),
+                              [&](const Shard &shard){ return shard.executor == executor; });
+    if (shard == std::end(shards))
+    {
+        shards.push_back(Shard{ .executor = executor, .subscribers = std::make_shared<const Subscribers>() });
+        shard = std::prev(std::end(shards));
+    }
+
+    Subscribers subscribers;
+    subscribers.reserve(shard->subscribers->size() + 1);
+    for (const auto &subscriber : *shard->subscribers)
+    {
+        if (subscriber.weak.expired())
+            continue;
+        if (subscriber.connection == connection.get())
+            return;
+        subscribers.push_back(subscriber);
+    }
+    subscribers.push_back(Subscriber{ .connection = connection.get(), .weak = connection });
+
+    shard->subscribers = std::make_shared<const Subscribers>(std::move(subscribers));
+}
+
+void WebsocketHub::unsubscribe(std::string_view topic, const WebsocketClientConnection &connection)
+{
+    std::lock_guard lock{m_mutex};
+
+    const auto iter = m_topics.find(topic);
+    if (iter == std::end(m_topics))
+        return;
+
+    removeFromShards(iter->second, connection);
+
+    if (iter->second.shards.empty())
+        m_topics.erase(iter);
+}
+
+void WebsocketHub::unsubscribeAll(const WebsocketClientConnection &connection)
+{
+    std::lock_guard lock{m_mutex};
+
+    for (auto iter = std::begin(m_topics); iter != std::end(m_topics); )
+    {
+        removeFromShards(iter->second, connection);
+
+        if (iter->second.shards.empty())
+            iter = m_topics.erase(iter);
+        else
+            iter++;
+    }
+}
+
+std::size_t WebsocketHub::publish(std::string_view topic, uint8_t opcode, std::string_view payload)
+{
+    std::vector<Shard> shards;
+
+    {
+        std::lock_guard lock{m_mutex};
+
+        const auto iter = m_topics.find(topic);
+        if (iter == std::end(m_topics))
+            return 0;
+
+        shards = iter->second.shards;
+    }
+
+    // the payload is copied once and referenced by every subscriber's frames
+    const auto frames = encodeWebsocketMessage(true, 0, opcode, std::make_shared<const std::string>(payload), m_maxFragmentSize);
+
+    std::size_t count{};
+
+    for (auto &shard : shards)
+    {
+        count += shard.subscribers->size();
+
+        // the topic doubles as coalesce key for SlowConsumerPolicy::CoalesceByKey
+        asio::post(shard.executor, [frames, topic=std::string{topic}, subscribers=std::move(shard.subscribers)](){
+            for (const auto &subscriber : *subscribers)
+                if (const auto connection = subscriber.weak.lock())
+                    connection->sendFrames(frames, topic);
+        });
+    }
+
+    return count;
+}
+
+std::size_t WebsocketHub::subscriberCount(std::string_view topic) const
+{
+    std::lock_guard lock{m_mutex};
+
+    const auto iter = m_topics.find(topic);
+    if (iter == std::end(m_topics))
+        return 0;
+
+    std::size_t count{};
+    for (const auto &shard : iter->second.shards)
+        count += shard.subscribers->size();
+    return count;
+}
+
+void WebsocketHub::removeFromShards(Topic &topic, const WebsocketClientConnection &connection)
+{
+    for (auto iter = std::begin(topic.shards); iter != std::end(topic.shards); )
+    {
+        Subscribers subscribers;
+        subscribers.reserve(iter->subscribers->size());
+        for (const auto &subscriber : *iter->subscribers)
+            if (subscriber.connection != &connection && !subscriber.weak.expired())
+                subscribers.push_back(subscriber);
+
+        if (subscribers.empty())
+        {
+            iter = topic.shards.erase(iter);
+            continue;
+        }
+
+        if (subscribers.size() != iter->subscribers->size())
+            iter->subscribers = std::make_shared<const Subscribers>(std::move(subscribers));
+
+        iter++;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// system includes
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// local includes
+#include "outboundqueue.h"
+
+// forward declares
+class WebsocketClientConnection;
+
+// Topic based broadcasting to many websocket connections. Every published
+// message is encoded once (split into fragments when large) and the frames
+// are shared (refcounted) by all subscribers' write queues. Subscribers are
+// grouped by the executor of their socket, so a server running one
+// io_context per thread gets exactly one posted fan-out task per io_context
+// and publish.
+class WebsocketHub
+{
+public:
+    void subscribe(std::string_view topic, const std::shared_ptr<WebsocketClientConnection> &connection);
+    void unsubscribe(std::string_view topic, const WebsocketClientConnection &connection);
+    void unsubscribeAll(const WebsocketClientConnection &connection);
+
+    // returns the number of subscribers the frame has been posted to
+    std::size_t publish(std::string_view topic, uint8_t opcode, std::string_view payload);
+    std::size_t publishText(std::string_view topic, std::string_view payload) { return publish(topic, 1, payload); }
+    std::size_t publishBinary(std::string_view topic, std::string_view payload) { return publish(topic, 2, payload); }
+
+    std::size_t subscriberCount(std::string_view topic) const;
+
+    std::size_t maxFragmentSize() const { return m_maxFragmentSize; }
+    void setMaxFragmentSize(std::size_t maxFragmentSize) { m_maxFragmentSize = maxFragmentSize; }
+
+private:
+    using Executor = asio::ip::tcp::socket::executor_type;
+    // Connections belong to the threads of their io_contexts. They are only
+    // locked in the fan-out task on their own executor, never under
+    // m_mutex, or the last owner could end up destroying the connection on
+    // the wrong thread while holding the mutex. The raw pointer identifies
+    // a subscriber without locking it and is only compared, never used.
+    struct Subscriber
+    {
+        const WebsocketClientConnection *connection;
+        std::weak_ptr<WebsocketClientConnection> weak;
+    };
+
+    using Subscribers = std::vector<Subscriber>;
+
+    struct Shard
+    {
+        Executor executor;
+        // copy on write, publish() only has to grab a reference
+        std::shared_ptr<const Subscribers> subscribers;
+    };
+
+    struct Topic
+    {
+        std::vector<Shard> shards;
+    };
+
+    static void removeFromShards(Topic &topic, const WebsocketClientConnection &connection);
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Topic, std::less<>> m_topics;
+
+    std::atomic<std::size_t> m_maxFragmentSize{OutboundQueueSettings{}.maxFragmentSize};
+};
@@ -1,5 +1,147 @@
 #include "websocketstream.h"
 
+// system includes
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace {
+constexpr uint32_t rotl(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+} // namespace
+
+WebsocketMaskGenerator::WebsocketMaskGenerator()
+{
+    std::random_device device;
+    do
+        for (auto &state : m_state)
+            state = device();
+    while (!(m_state[0] | m_state[1] | m_state[2] | m_state[3]));
+}
+
+uint32_t WebsocketMaskGenerator::operator()()
+{
+    const uint32_t result = rotl(m_state[1] * 5, 7) * 9;
+    const uint32_t t = m_state[1] << 9;
+
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+
+    m_state[2] ^= t;
+    m_state[3] = rotl(m_state[3], 11);
+
+    return result;
+}
+
+WebsocketMaskGenerator &WebsocketMaskGenerator::threadLocal()
+{
+    thread_local WebsocketMaskGenerator generator;
+    return generator;
+}
+
+void applyWebsocketMask(char *dst, const char *src, std::size_t size, uint32_t key)
+{
+    // the key repeats every 4 bytes, so whole words can be xored
+    char keyBytes[8];
+    std::memcpy(keyBytes, &key, 4);
+    std::memcpy(keyBytes + 4, &key, 4);
+    uint64_t wordKey;
+    std::memcpy(&wordKey, keyBytes, sizeof(wordKey));
+
+    std::size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, src + i, sizeof(word));
+        word ^= wordKey;
+        std::memcpy(dst + i, &word, sizeof(word));
+    }
+
+    for (; i < size; i++)
+        dst[i] = src[i] ^ keyBytes[i % 4];
+}
+
 namespace {
-constexpr const char * const TAG = "ASIO_WEB";
+template<typename Callback>
+void splitFragments(std::size_t payloadSize, std::size_t maxFragmentSize, Callback &&callback)
+{
+    std::size_t offset{};
+    do
+    {
+        const auto length = maxFragmentSize ? std::min(payloadSize - offset, maxFragmentSize) : payloadSize - offset;
+        callback(offset, length, offset == 0, offset + length == payloadSize);
+        offset += length;
+    } while (offset < payloadSize);
+}
 } // namespace
+
+WebsocketFrame encodeWebsocketControlFrame(uint8_t opcode, std::string_view payload, WebsocketMaskGenerator *mask)
+{
+    WebsocketFrame frame;
+
+    if (mask)
+    {
+        const uint32_t key = (*mask)();
+        frame.headerSize = encodeFrameHeader(frame.header.data(), true, 0, opcode, payload.size(), &key);
+
+        auto masked = std::make_shared<std::string>(payload.size(), '\0');
+        applyWebsocketMask(masked->data(), payload.data(), payload.size(), key);
+        frame.payload = std::move(masked);
+    }
+    else
+    {
+        frame.headerSize = encodeFrameHeader(frame.header.data(), true, 0, opcode, payload.size());
+        frame.payload = std::make_shared<const std::string>(payload);
+    }
+
+    frame.length = payload.size();
+
+    return frame;
+}
+
+std::vector<WebsocketFrame> encodeWebsocketMessage(bool fin, uint8_t reserved, uint8_t opcode,
+                                                   std::shared_ptr<const std::string> payload, std::size_t maxFragmentSize)
+{
+    std::vector<WebsocketFrame> frames;
+
+    splitFragments(payload->size(), maxFragmentSize, [&](std::size_t offset, std::size_t length, bool first, bool last){
+        auto &frame = frames.emplace_back();
+        frame.headerSize = encodeFrameHeader(frame.header.data(), last && fin, first ? reserved : 0, first ? opcode : 0, length);
+        frame.payload = payload;
+        frame.offset = offset;
+        frame.length = length;
+    });
+
+    return frames;
+}
+
+std::vector<WebsocketFrame> encodeMaskedWebsocketMessage(bool fin, uint8_t reserved, uint8_t opcode, WebsocketMaskGenerator &mask,
+                                                         std::string_view payload, std::size_t maxFragmentSize)
+{
+    std::vector<WebsocketFrame> frames;
+
+    auto masked = std::make_shared<std::string>();
+
+    // masking is fused into the only copy of the payload, which is not zero filled first
+    masked->resize_and_overwrite(payload.size(), [&](char *data, std::size_t size){
+        splitFragments(size, maxFragmentSize, [&](std::size_t offset, std::size_t length, bool first, bool last){
+            const uint32_t key = mask();
+            applyWebsocketMask(data + offset, payload.data() + offset, length, key);
+
+            auto &frame = frames.emplace_back();
+            frame.headerSize = encodeFrameHeader(frame.header.data(), last && fin, first ? reserved : 0, first ? opcode : 0, length, &key);
+            frame.offset = offset;
+            frame.length = length;
+        });
+        return size;
+    });
+
+    for (auto &frame : frames)
+        frame.payload = masked;
+
+    return frames;
+}
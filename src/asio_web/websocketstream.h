@@ -1,6 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #pragma pack(push,1)
 struct WebsocketHeader {
@@ -11,3 +18,102 @@ struct WebsocketHeader {
     bool mask:1;
 };
 #pragma pack(pop)
+
+// xoshiro128** by Blackman and Vigna, generates the client masking keys.
+// Fast and good enough for masking, not for anything cryptographic.
+class WebsocketMaskGenerator
+{
+public:
+    // seeded from the os (std::random_device)
+    WebsocketMaskGenerator();
+
+    uint32_t operator()();
+
+    // for senders without an own generator
+    static WebsocketMaskGenerator &threadLocal();
+
+private:
+    uint32_t m_state[4];
+};
+
+// dst[i] = src[i] ^ key[i % 4], key is in wire (memory) order, dst may equal src
+void applyWebsocketMask(char *dst, const char *src, std::size_t size, uint32_t key);
+
+// 2 bytes, up to 8 bytes extended length and the mask key
+constexpr std::size_t maxWebsocketHeaderSize = 14;
+
+// Writes a frame header into buffer (at least maxWebsocketHeaderSize bytes),
+// the extended length in network byte order. Returns the header size.
+inline std::size_t encodeFrameHeader(char *buffer, bool fin, uint8_t reserved, uint8_t opcode, uint64_t payloadLength,
+                                     const uint32_t *maskKey = nullptr)
+{
+    WebsocketHeader &hdr = *(WebsocketHeader *)buffer;
+    hdr.fin = fin;
+    hdr.reserved = reserved;
+    hdr.opcode = opcode;
+    hdr.mask = maskKey != nullptr;
+
+    std::size_t size = sizeof(WebsocketHeader);
+
+    if (payloadLength < 126)
+        hdr.payloadLength = payloadLength;
+    else if (payloadLength <= 0xFFFF)
+    {
+        hdr.payloadLength = 126;
+        buffer[size++] = char(payloadLength >> 8);
+        buffer[size++] = char(payloadLength);
+    }
+    else
+    {
+        hdr.payloadLength = 127;
+        for (int shift = 56; shift >= 0; shift -= 8)
+            buffer[size++] = char(payloadLength >> shift);
+    }
+
+    if (maskKey)
+    {
+        std::memcpy(buffer + size, maskKey, sizeof(*maskKey));
+        size += sizeof(*maskKey);
+    }
+
+    return size;
+}
+
+// The extended length of a received frame header, size bytes in network
+// byte order at any alignment
+inline uint64_t decodeFrameLength(const char *data, std::size_t size)
+{
+    uint64_t length{};
+    for (std::size_t i = 0; i < size; i++)
+        length = (length << 8) | uint8_t(data[i]);
+    return length;
+}
+
+// One encoded frame: the header is stored inline, the payload is a slice of
+// a (possibly shared) buffer, so it can be written with gather I/O.
+struct WebsocketFrame
+{
+    std::array<char, maxWebsocketHeaderSize> header;
+    uint8_t headerSize{};
+    std::shared_ptr<const std::string> payload;
+    std::size_t offset{};
+    std::size_t length{};
+
+    std::string_view headerView() const { return {header.data(), headerSize}; }
+    std::string_view payloadView() const { return payload ? std::string_view{*payload}.substr(offset, length) : std::string_view{}; }
+    std::size_t size() const { return headerSize + length; }
+};
+
+// Encodes a data message as one frame or, if it is larger than
+// maxFragmentSize, as a first frame followed by continuation frames. The
+// frames reference the payload, nothing is copied.
+std::vector<WebsocketFrame> encodeWebsocketMessage(bool fin, uint8_t reserved, uint8_t opcode,
+                                                   std::shared_ptr<const std::string> payload, std::size_t maxFragmentSize);
+
+// ping, pong and close, the payload (at most 125 bytes) is copied
+WebsocketFrame encodeWebsocketControlFrame(uint8_t opcode, std::string_view payload, WebsocketMaskGenerator *mask = nullptr);
+
+// Same as encodeWebsocketMessage() for client frames, every frame gets its own mask key. The payload is
+// copied exactly once, masked on the fly.
+std::vector<WebsocketFrame> encodeMaskedWebsocketMessage(bool fin, uint8_t reserved, uint8_t opcode, WebsocketMaskGenerator &mask,
+                                                         std::string_view payload, std::size_t maxFragmentSize);
@@ -0,0 +1,181 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/httpresponseparser.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_ACCEPT_BENCHMARK";
+
+// the same short response to every request, the connection is closed after it
+constexpr std::string_view response{"HTTP/1.1 200 Ok\r\n"
+                                    "Connection: close\r\n"
+                                    "Content-Type: text/plain\r\n"
+                                    "Content-Length: 2\r\n"
+                                    "\r\n"
+                                    "ok"};
+
+struct Result
+{
+    std::vector<double> latencies; // us, from connect until the response arrived
+    std::size_t failed{};
+};
+
+// a new connection for every request like a device coming back after an
+// outage, blocking. The reset on close keeps the client ports out of
+// TIME_WAIT so long runs do not run out of them.
+Result runClient(const asio::ip::tcp::endpoint &endpoint, std::atomic<std::ptrdiff_t> &remaining)
+{
+    constexpr std::string_view request{"GET /benchmark HTTP/1.1\r\n"
+                                       "Host: localhost\r\n"
+                                       "\r\n"};
+
+    asio::io_context io_context;
+
+    Result result;
+
+    char buffer[4096];
+    HttpResponseParser parser;
+
+    while (remaining.fetch_sub(1) > 0)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        asio::ip::tcp::socket socket{io_context};
+        std::error_code ec;
+        socket.connect(endpoint, ec);
+        if (!ec)
+            asio::write(socket, asio::buffer(request), ec);
+
+        parser.reset();
+        bool complete{};
+        while (!ec && !complete)
+        {
+            const auto length = socket.read_some(asio::buffer(buffer), ec);
+            std::string_view input{buffer, length};
+            while (!ec && !complete)
+            {
+                const auto event = parser.parse(input);
+                if (event == HttpResponseParser::Event::NeedMore)
+                    break;
+                if (event == HttpResponseParser::Event::Error)
+                    ec = asio::error::invalid_argument;
+                complete = event == HttpResponseParser::Event::Complete;
+            }
+        }
+
+        if (ec)
+        {
+            ESP_LOGW(TAG, "request failed: %s", ec.message().c_str());
+            result.failed++;
+        }
+        else
+            result.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        socket.set_option(asio::socket_base::linger{true, 0}, ec);
+        socket.close(ec);
+    }
+
+    return result;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Simulates a reconnect storm, many clients opening a new connection per request at "
+                                                    "once, against a Webserver taking one connection per wakeup and against one with "
+                                                    "several outstanding accepts draining the backlog in batches. Reports accepts/sec. "
+                                                    "The servers share one thread, the clients have their own."));
+    parser.addHelpOption();
+
+    const QCommandLineOption connectionsOption{QStringLiteral("connections"), QStringLiteral("Connections per server."), QStringLiteral("count"), QStringLiteral("50000")};
+    const QCommandLineOption clientsOption{QStringLiteral("clients"), QStringLiteral("Client threads connecting at the same time."), QStringLiteral("count"), QStringLiteral("32")};
+    const QCommandLineOption concurrencyOption{QStringLiteral("concurrency"), QStringLiteral("Outstanding accepts of the second server."), QStringLiteral("count"), QStringLiteral("4")};
+    const QCommandLineOption batchOption{QStringLiteral("batch"), QStringLiteral("Connections per wakeup of the second server."), QStringLiteral("count"), QStringLiteral("16")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("First of the two ports used."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({connectionsOption, clientsOption, concurrencyOption, batchOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t connections = parser.value(connectionsOption).toULongLong();
+    const int clients = std::max(1, parser.value(clientsOption).toInt());
+    const auto port = parser.value(portOption).toUShort();
+
+    asio::io_context serverContext;
+    FixedWebserver single{std::string{response}, false, serverContext, port, nullptr, WebserverOptions{.acceptConcurrency = 1, .acceptBatch = 1}};
+    FixedWebserver batched{std::string{response}, false, serverContext, static_cast<unsigned short>(port + 1), nullptr, WebserverOptions {
+        .acceptConcurrency = parser.value(concurrencyOption).toInt(),
+        .acceptBatch = parser.value(batchOption).toInt()
+    }};
+    std::thread serverThread{[&](){ serverContext.run(); }};
+
+    for (const auto &[name, serverPort] : { std::pair{"single:", port}, std::pair{"batched:", static_cast<unsigned short>(port + 1)} })
+    {
+        const asio::ip::tcp::endpoint endpoint{asio::ip::make_address("127.0.0.1"), serverPort};
+        std::atomic<std::ptrdiff_t> remaining{std::ptrdiff_t(connections)};
+        std::vector<Result> results(clients);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        threads.reserve(clients);
+        for (auto &result : results)
+            threads.emplace_back([&](){ result = runClient(endpoint, remaining); });
+        for (auto &thread : threads)
+            thread.join();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Result total;
+        for (auto &result : results)
+        {
+            total.latencies.insert(std::end(total.latencies), std::begin(result.latencies), std::end(result.latencies));
+            total.failed += result.failed;
+        }
+
+        fmt::print("{:<8} {} connections in {:.2f}s, {:.0f} accepts/s, latency p50 {:.1f}us p99 {:.1f}us, {} failed\n",
+                   name, total.latencies.size(), seconds, total.latencies.size() / seconds,
+                   percentile(total.latencies, .5), percentile(total.latencies, .99), total.failed);
+    }
+
+    serverContext.stop();
+    serverThread.join();
+}
@@ -72,10 +72,79 @@ equals(CLONE_FMT, 1) {
 
 SUBDIRS += \
     asio_web.pro \
+    accept_benchmark \
+    batch_benchmark \
+    bulk_latency_benchmark \
+    coalescing_benchmark \
+    happyeyeballs_test \
+    http2_benchmark \
+    http_client_example \
+    hub_benchmark \
+    idle_timeout_test \
+    mask_benchmark \
+    memory_benchmark \
+    nodelay_benchmark \
+    outbound_queue_test \
+    pipelining_test \
+    proxy_benchmark \
+    response_parser_test \
+    ssl_context_benchmark \
+    tls_benchmark \
+    tls_websocket_benchmark \
+    uds_benchmark \
+    utf8_benchmark \
     webserver_example \
-    websocket_client_example
+    websocket_client_example \
+    websocket_loadgen \
+    websocket_reconnect_test
 
+sub-accept_benchmark.depends += sub-asio_web-pro
+accept_benchmark.depends += sub-asio_web-pro
+sub-batch_benchmark.depends += sub-asio_web-pro
+batch_benchmark.depends += sub-asio_web-pro
+sub-bulk_latency_benchmark.depends += sub-asio_web-pro
+bulk_latency_benchmark.depends += sub-asio_web-pro
+sub-coalescing_benchmark.depends += sub-asio_web-pro
+coalescing_benchmark.depends += sub-asio_web-pro
+sub-happyeyeballs_test.depends += sub-asio_web-pro
+happyeyeballs_test.depends += sub-asio_web-pro
+sub-http2_benchmark.depends += sub-asio_web-pro
+http2_benchmark.depends += sub-asio_web-pro
+sub-http_client_example.depends += sub-asio_web-pro
+http_client_example.depends += sub-asio_web-pro
+sub-hub_benchmark.depends += sub-asio_web-pro
+hub_benchmark.depends += sub-asio_web-pro
+sub-idle_timeout_test.depends += sub-asio_web-pro
+idle_timeout_test.depends += sub-asio_web-pro
+sub-mask_benchmark.depends += sub-asio_web-pro
+mask_benchmark.depends += sub-asio_web-pro
+sub-memory_benchmark.depends += sub-asio_web-pro
+memory_benchmark.depends += sub-asio_web-pro
+sub-nodelay_benchmark.depends += sub-asio_web-pro
+nodelay_benchmark.depends += sub-asio_web-pro
+sub-outbound_queue_test.depends += sub-asio_web-pro
+outbound_queue_test.depends += sub-asio_web-pro
+sub-pipelining_test.depends += sub-asio_web-pro
+pipelining_test.depends += sub-asio_web-pro
+sub-proxy_benchmark.depends += sub-asio_web-pro
+proxy_benchmark.depends += sub-asio_web-pro
+sub-response_parser_test.depends += sub-asio_web-pro
+response_parser_test.depends += sub-asio_web-pro
+sub-ssl_context_benchmark.depends += sub-asio_web-pro
+ssl_context_benchmark.depends += sub-asio_web-pro
+sub-tls_benchmark.depends += sub-asio_web-pro
+tls_benchmark.depends += sub-asio_web-pro
+sub-tls_websocket_benchmark.depends += sub-asio_web-pro
+tls_websocket_benchmark.depends += sub-asio_web-pro
+sub-uds_benchmark.depends += sub-asio_web-pro
+uds_benchmark.depends += sub-asio_web-pro
+sub-utf8_benchmark.depends += sub-asio_web-pro
+utf8_benchmark.depends += sub-asio_web-pro
 sub-webserver_example.depends += sub-asio_web-pro
 webserver_example.depends += sub-asio_web-pro
 sub-websocket_client_example.depends += sub-asio_web-pro
 websocket_client_example.depends += sub-asio_web-pro
+sub-websocket_loadgen.depends += sub-asio_web-pro
+websocket_loadgen.depends += sub-asio_web-pro
+sub-websocket_reconnect_test.depends += sub-asio_web-pro
+websocket_reconnect_test.depends += sub-asio_web-pro
@@ -0,0 +1,281 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/sslclientcontext.h>
+#include <asio_web/sslservercontext.h>
+#include <asio_web/sslwebsocketclient.h>
+#include <asio_web/webserver.h>
+#include <asio_web/websocketclient.h>
+#include <asio_web/websocketclientconnection.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_BATCH_BENCHMARK";
+
+using clock = std::chrono::steady_clock;
+
+// counts and drops every websocket message
+class SinkResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    SinkResponseHandler(ClientConnection &clientConnection, std::atomic<uint64_t> &received) :
+        BenchmarkResponseHandler{clientConnection}, m_received{received}
+    {}
+
+    bool acceptsWebsocketUpgrade() const final { return true; }
+
+    void websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        if (fin)
+            m_received.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> &m_received;
+};
+
+// a self signed P-256 certificate for localhost, good enough for a benchmark
+bool makeCertificate(SslServerContext &context)
+{
+    EVP_PKEY *key{};
+    {
+        EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (!keyContext)
+            return false;
+        if (EVP_PKEY_keygen_init(keyContext) <= 0 ||
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) <= 0 ||
+            EVP_PKEY_keygen(keyContext, &key) <= 0)
+            key = nullptr;
+        EVP_PKEY_CTX_free(keyContext);
+    }
+    if (!key)
+        return false;
+
+    X509 *certificate = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 60 * 60 * 24);
+    X509_set_pubkey(certificate, key);
+    X509_NAME *name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    const bool signed_ = X509_sign(certificate, key, EVP_sha256()) > 0;
+
+    const auto toPem = [](auto write){
+        BIO *bio = BIO_new(BIO_s_mem());
+        write(bio);
+        char *data{};
+        const auto size = BIO_get_mem_data(bio, &data);
+        std::string pem(data, size);
+        BIO_free(bio);
+        return pem;
+    };
+    const auto certificatePem = toPem([&](BIO *bio){ PEM_write_bio_X509(bio, certificate); });
+    const auto keyPem = toPem([&](BIO *bio){ PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr); });
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+
+    if (!signed_)
+        return false;
+
+    std::error_code ec;
+    context.useCertificateChain(certificatePem, ec);
+    if (!ec)
+        context.usePrivateKey(keyPem, ec);
+    if (ec)
+    {
+        ESP_LOGE(TAG, "loading the certificate failed: %s", ec.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+// sends small messages as fast as the queue takes them
+template<typename Client>
+class StreamClient final : public Client
+{
+public:
+    StreamClient(asio::io_context &io_context, const std::string &port, const std::string &payload, std::size_t maxBatchSize,
+                 const typename Client::StreamOptions &streamOptions = {}) :
+        Client{io_context, "127.0.0.1", port, "/", streamOptions},
+        m_io_context{io_context}, m_payload{payload}
+    {
+        OutboundQueueSettings settings;
+        settings.policy = SlowConsumerPolicy::Backpressure;
+        settings.maxBatchSize = maxBatchSize;
+        this->setOutboundQueueSettings(settings);
+    }
+
+    std::optional<clock::time_point> connectedAt;
+
+    void handleConnected() final
+    {
+        connectedAt = clock::now();
+        pump();
+    }
+
+    void handleDisconnected() final {}
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final {}
+    void handleErrorOccured(const typename Client::Error &error) final { ESP_LOGW(TAG, "%s", error.message.c_str()); }
+
+    // called from the write completion, continue once it returned
+    void handleBackpressure(bool active) final
+    {
+        if (!active)
+            asio::post(m_io_context, [this](){ pump(); });
+    }
+
+private:
+    void pump()
+    {
+        while (!this->backpressured())
+            if (!this->sendMessage(true, 0, 2, true, m_payload))
+                return;
+    }
+
+    asio::io_context &m_io_context;
+    const std::string &m_payload;
+};
+
+struct Mode
+{
+    const char *name;
+    bool tls;
+    std::size_t maxBatchSize;
+};
+
+struct Result
+{
+    double messagesPerSecond;
+    double writesPerSecond;
+    double bytesPerWrite;
+};
+
+// runs one client until duration is over, the rates count from the handshake on
+template<typename Client>
+std::optional<Result> measure(const std::atomic<uint64_t> &received, const std::string &port, const std::string &payload, std::size_t maxBatchSize,
+                              std::chrono::seconds duration, const typename Client::StreamOptions &streamOptions = {})
+{
+    asio::io_context clientContext;
+    StreamClient<Client> client{clientContext, port, payload, maxBatchSize, streamOptions};
+    client.start();
+    clientContext.run_for(duration);
+
+    if (!client.connectedAt)
+        return std::nullopt;
+
+    const auto &stats = client.stats();
+    const double seconds = std::chrono::duration<double>(clock::now() - *client.connectedAt).count();
+    return Result{ .messagesPerSecond = received.load(std::memory_order_relaxed) / seconds,
+                   .writesPerSecond = stats.writes / seconds,
+                   .bytesPerWrite = stats.writes ? double(stats.writtenBytes) / stats.writes : 0. };
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Streams small websocket messages from one client to a Webserver, over plain tcp "
+                                                    "and TLS, with every queued frame written on its own and with the queue drained in "
+                                                    "batches of maxBatchSize. Reports the received messages/s, the writes/s and the "
+                                                    "bytes per write. The server runs on its own thread."));
+    parser.addHelpOption();
+
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Message size."), QStringLiteral("bytes"), QStringLiteral("100")};
+    const QCommandLineOption batchOption{QStringLiteral("batch"), QStringLiteral("maxBatchSize of the batched runs."), QStringLiteral("bytes"), QStringLiteral("16384")};
+    const QCommandLineOption durationOption{QStringLiteral("duration"), QStringLiteral("Seconds per run."), QStringLiteral("seconds"), QStringLiteral("5")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Plain server port, the TLS one listens on the next."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({sizeOption, batchOption, durationOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::string payload(parser.value(sizeOption).toULongLong(), 'x');
+    const std::size_t batch = parser.value(batchOption).toULongLong();
+    const std::chrono::seconds duration{parser.value(durationOption).toLongLong()};
+    const auto port = parser.value(portOption).toUShort();
+    const unsigned short plainPort = port, tlsPort = port + 1;
+
+    const auto sslContext = std::make_shared<SslServerContext>();
+    if (!makeCertificate(*sslContext))
+    {
+        ESP_LOGE(TAG, "creating a certificate failed");
+        return 1;
+    }
+
+    // the self signed certificate is not verified
+    const auto clientContext = std::make_shared<SslClientContext>();
+    clientContext->disableVerification();
+
+    const Mode modes[] {
+        { "plain one by one", false, 0 },
+        { "plain batched",    false, batch },
+        { "TLS one by one",   true,  0 },
+        { "TLS batched",      true,  batch },
+    };
+
+    fmt::print("{} byte messages\n", payload.size());
+
+    for (const auto &mode : modes)
+    {
+        std::atomic<uint64_t> received{};
+        asio::io_context serverContext;
+        BenchmarkWebserver server{[&received](ClientConnection &clientConnection){ return std::make_unique<SinkResponseHandler>(clientConnection, received); },
+                                  serverContext, mode.tls ? tlsPort : plainPort, mode.tls ? sslContext : nullptr};
+        std::thread serverThread{[&](){ serverContext.run(); }};
+
+        const auto result = mode.tls ?
+            measure<SslWebsocketClient>(received, std::to_string(tlsPort), payload, mode.maxBatchSize, duration,
+                                        SslWebsocketClient::StreamOptions{ .context = clientContext }) :
+            measure<WebsocketClient>(received, std::to_string(plainPort), payload, mode.maxBatchSize, duration);
+
+        serverContext.stop();
+        serverThread.join();
+
+        if (!result)
+        {
+            fmt::print("{:<16} client did not connect\n", mode.name);
+            continue;
+        }
+
+        fmt::print("{:<16} {:>9.0f} msg/s, {:>9.0f} writes/s, {:>7.0f} bytes per write\n",
+                   mode.name, result->messagesPerSecond, result->writesPerSecond, result->bytesPerWrite);
+    }
+}
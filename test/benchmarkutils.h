@@ -0,0 +1,134 @@
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+
+// The servers and the statistics every benchmark needs, so each of them
+// only contains what it measures.
+
+// the value below which the fraction p of the samples lies, sorts them
+inline double percentile(std::vector<double> &values, double p)
+{
+    if (values.empty())
+        return 0.;
+    std::sort(std::begin(values), std::end(values));
+    return values[std::min(values.size() - 1, std::size_t(p * values.size()))];
+}
+
+// a keep-alive 200 with a body of bodySize bytes
+inline std::string fixedResponse(std::size_t bodySize)
+{
+    return fmt::format("HTTP/1.1 200 Ok\r\n"
+                       "Connection: keep-alive\r\n"
+                       "Content-Type: application/octet-stream\r\n"
+                       "Content-Length: {}\r\n"
+                       "\r\n"
+                       "{}",
+                       bodySize, std::string(bodySize, 'x'));
+}
+
+// ignores the request headers and body and answers with 404, subclasses
+// override sendResponse() or accept the websocket upgrade
+class BenchmarkResponseHandler : public ResponseHandler
+{
+public:
+    explicit BenchmarkResponseHandler(ClientConnection &clientConnection) :
+        m_clientConnection{clientConnection}
+    {}
+
+    void requestHeaderReceived(std::string_view key, std::string_view value) override {}
+    void requestBodyReceived(std::string_view body) override {}
+
+    void sendResponse() override
+    {
+        writeResponse("HTTP/1.1 404 Not Found\r\n"
+                      "Content-Length: 0\r\n"
+                      "\r\n");
+    }
+
+protected:
+    // response has to stay valid until the write finished the request
+    void writeResponse(std::string_view response)
+    {
+        asio::async_write(m_clientConnection.stream(), asio::buffer(response.data(), response.size()),
+                          [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
+                          { m_clientConnection.responseFinished(ec); });
+    }
+
+    ClientConnection &m_clientConnection;
+};
+
+// answers every request with the same response
+class FixedResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    FixedResponseHandler(ClientConnection &clientConnection, const std::string &response) :
+        BenchmarkResponseHandler{clientConnection}, m_response{response}
+    {}
+
+    void sendResponse() final { writeResponse(m_response); }
+
+private:
+    const std::string &m_response;
+};
+
+// keeps connections alive and serves every request with a handler from
+// makeHandler, the remaining arguments are those of Webserver
+class BenchmarkWebserver final : public Webserver
+{
+public:
+    using MakeHandler = std::function<std::unique_ptr<ResponseHandler>(ClientConnection &clientConnection)>;
+
+    template<typename ...WebserverArgs>
+    BenchmarkWebserver(MakeHandler makeHandler, WebserverArgs &&...args) :
+        Webserver{std::forward<WebserverArgs>(args)...}, m_makeHandler{std::move(makeHandler)}
+    {}
+
+    bool connectionKeepAlive() const final { return true; }
+
+    std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final
+    {
+        return m_makeHandler(clientConnection);
+    }
+
+private:
+    const MakeHandler m_makeHandler;
+};
+
+// answers every request with response, the remaining arguments are those
+// of Webserver
+class FixedWebserver final : public Webserver
+{
+public:
+    template<typename ...WebserverArgs>
+    FixedWebserver(std::string response, bool keepAlive, WebserverArgs &&...args) :
+        Webserver{std::forward<WebserverArgs>(args)...}, m_response{std::move(response)}, m_keepAlive{keepAlive}
+    {}
+
+    bool connectionKeepAlive() const final { return m_keepAlive; }
+
+    std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final
+    {
+        return std::make_unique<FixedResponseHandler>(clientConnection, m_response);
+    }
+
+private:
+    const std::string m_response;
+    const bool m_keepAlive;
+};
@@ -0,0 +1,4 @@
+SOURCES += \
+    main.cpp
+
+include(../testapp.pri)
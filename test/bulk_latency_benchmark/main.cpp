@@ -0,0 +1,208 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+#include <asio_web/websocketclient.h>
+#include <asio_web/websocketclientconnection.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_BULK_LATENCY_BENCHMARK";
+
+using clock = std::chrono::steady_clock;
+
+// echoes text messages, binary ones are the bulk transfer and dropped
+class EchoResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    explicit EchoResponseHandler(ClientConnection &clientConnection) :
+        BenchmarkResponseHandler{clientConnection}
+    {}
+
+    bool acceptsWebsocketUpgrade() const final { return true; }
+
+    void websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        if (opcode == 1)
+            connection.sendMessage(true, 0, 1, false, payload);
+    }
+};
+
+struct Mode
+{
+    const char *name;
+    bool bulk;
+    std::size_t maxFragmentSize;
+    MessagePriority priority;
+};
+
+// keeps up to two bulk messages queued and sends a small probe message every
+// interval, the echoes come back in order
+class BulkClient final : public WebsocketClient
+{
+public:
+    BulkClient(asio::io_context &io_context, const std::string &port, const Mode &mode, const std::string &bulk, std::chrono::microseconds interval) :
+        WebsocketClient{io_context, "127.0.0.1", port, "/"},
+        m_mode{mode}, m_bulk{bulk}, m_interval{interval}, m_probeTimer{io_context}, m_pumpTimer{io_context}
+    {
+        OutboundQueueSettings settings;
+        settings.policy = SlowConsumerPolicy::Backpressure;
+        settings.maxFragmentSize = mode.maxFragmentSize;
+        setOutboundQueueSettings(settings);
+    }
+
+    std::vector<double> latencies; // us, probe round trips
+    std::size_t bulkBytes{};
+
+    void handleConnected() final
+    {
+        probe();
+        if (m_mode.bulk)
+            pump();
+    }
+
+    void handleDisconnected() final
+    {
+        m_probeTimer.cancel();
+        m_pumpTimer.cancel();
+    }
+
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        if (opcode != 1 || m_sentAt.empty())
+            return;
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(clock::now() - m_sentAt.front()).count());
+        m_sentAt.pop_front();
+    }
+
+    void handleErrorOccured(const Error &error) final { ESP_LOGW(TAG, "%s", error.message.c_str()); }
+
+private:
+    void probe()
+    {
+        static constexpr std::string_view payload{"{\"type\":\"ping\"}"};
+        if (sendMessage(true, 0, 1, true, payload, {}, m_mode.priority))
+            m_sentAt.push_back(clock::now());
+
+        m_probeTimer.expires_after(m_interval);
+        m_probeTimer.async_wait([this](std::error_code ec){
+            if (!ec)
+                probe();
+        });
+    }
+
+    void pump()
+    {
+        while (sendingQueue().bytes() < m_bulk.size())
+        {
+            if (!sendMessage(true, 0, 2, true, m_bulk))
+                return;
+            bulkBytes += m_bulk.size();
+        }
+
+        m_pumpTimer.expires_after(std::chrono::milliseconds{1});
+        m_pumpTimer.async_wait([this](std::error_code ec){
+            if (!ec)
+                pump();
+        });
+    }
+
+    const Mode &m_mode;
+    const std::string &m_bulk;
+    const std::chrono::microseconds m_interval;
+    asio::steady_timer m_probeTimer;
+    asio::steady_timer m_pumpTimer;
+    std::deque<clock::time_point> m_sentAt;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures the round trip of small websocket messages while the same client streams "
+                                                    "large messages: without a bulk transfer, with the large messages as one frame, "
+                                                    "fragmented, and fragmented with the small messages at high priority. Server and "
+                                                    "client run on their own threads."));
+    parser.addHelpOption();
+
+    const QCommandLineOption bulkOption{QStringLiteral("bulk"), QStringLiteral("Size of the large messages."), QStringLiteral("bytes"), QStringLiteral("2097152")};
+    const QCommandLineOption fragmentOption{QStringLiteral("fragment"), QStringLiteral("maxFragmentSize of the fragmented runs."), QStringLiteral("bytes"), QStringLiteral("16384")};
+    const QCommandLineOption intervalOption{QStringLiteral("interval"), QStringLiteral("Time between small messages."), QStringLiteral("us"), QStringLiteral("1000")};
+    const QCommandLineOption durationOption{QStringLiteral("duration"), QStringLiteral("Seconds per run."), QStringLiteral("seconds"), QStringLiteral("5")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({bulkOption, fragmentOption, intervalOption, durationOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::string bulk(parser.value(bulkOption).toULongLong(), 'x');
+    const std::size_t fragment = parser.value(fragmentOption).toULongLong();
+    const std::chrono::microseconds interval{std::max(1ll, parser.value(intervalOption).toLongLong())};
+    const std::chrono::seconds duration{parser.value(durationOption).toLongLong()};
+    const auto port = parser.value(portOption).toUShort();
+
+    asio::io_context serverContext;
+    BenchmarkWebserver server{[](ClientConnection &clientConnection){ return std::make_unique<EchoResponseHandler>(clientConnection); },
+                              serverContext, port};
+    std::thread serverThread{[&](){ serverContext.run(); }};
+
+    const Mode modes[] {
+        { "idle",            false, fragment, MessagePriority::Normal },
+        { "one frame",       true,  0,        MessagePriority::Normal },
+        { "fragmented",      true,  fragment, MessagePriority::Normal },
+        { "fragmented+high", true,  fragment, MessagePriority::High },
+    };
+
+    for (const auto &mode : modes)
+    {
+        asio::io_context clientContext;
+        BulkClient client{clientContext, std::to_string(port), mode, bulk, interval};
+        client.start();
+        clientContext.run_for(duration);
+
+        const double seconds = std::chrono::duration<double>(duration).count();
+        fmt::print("{:<16} {} round trips, p50 {:.1f}us p99 {:.1f}us max {:.1f}us, bulk {:.1f} MB/s\n",
+                   mode.name, client.latencies.size(), percentile(client.latencies, .5), percentile(client.latencies, .99),
+                   percentile(client.latencies, 1.), client.bulkBytes / seconds / 1e6);
+    }
+
+    serverContext.stop();
+    serverThread.join();
+}
@@ -0,0 +1,196 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+#include <asio_web/websocketclient.h>
+#include <asio_web/websocketclientconnection.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_COALESCING_BENCHMARK";
+
+using clock = std::chrono::steady_clock;
+
+// a loopback segment per write, 20 bytes ip and 32 bytes tcp header with timestamps
+constexpr std::size_t segmentOverhead = 52;
+
+// echoes every text message right away
+class EchoResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    explicit EchoResponseHandler(ClientConnection &clientConnection) :
+        BenchmarkResponseHandler{clientConnection}
+    {}
+
+    bool acceptsWebsocketUpgrade() const final { return true; }
+
+    void websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        if (opcode == 1)
+            connection.sendMessage(true, 0, 1, false, payload);
+    }
+};
+
+struct Mode
+{
+    std::chrono::microseconds flushDelay;
+    MessagePriority priority;
+};
+
+// sends a small json update every interval, the echoes come back in order
+class UpdateClient final : public WebsocketClient
+{
+public:
+    UpdateClient(asio::io_context &io_context, const std::string &port, const Mode &mode, std::size_t flushBytes, std::chrono::microseconds interval) :
+        WebsocketClient{io_context, "127.0.0.1", port, "/"},
+        m_mode{mode}, m_interval{interval}, m_timer{io_context}
+    {
+        setCoalescingSettings({ .flushDelay = mode.flushDelay, .flushBytes = flushBytes });
+    }
+
+    std::vector<double> latencies; // us, update round trips
+    std::size_t sent{};
+
+    void handleConnected() final
+    {
+        m_next = clock::now();
+        update();
+    }
+
+    void handleDisconnected() final { m_timer.cancel(); }
+
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        if (opcode != 1 || m_sentAt.empty())
+            return;
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(clock::now() - m_sentAt.front()).count());
+        m_sentAt.pop_front();
+    }
+
+    void handleErrorOccured(const Error &error) final { ESP_LOGW(TAG, "%s", error.message.c_str()); }
+
+private:
+    void update()
+    {
+        const auto payload = fmt::format("{{\"id\":\"sensor\",\"seq\":{},\"value\":{}}}", sent, 20 + sent % 10);
+        if (sendMessage(true, 0, 1, true, payload, {}, m_mode.priority))
+        {
+            m_sentAt.push_back(clock::now());
+            sent++;
+        }
+
+        // a fixed rate, the timer does not drift with the send time
+        m_next += m_interval;
+        m_timer.expires_at(m_next);
+        m_timer.async_wait([this](std::error_code ec){
+            if (!ec)
+                update();
+        });
+    }
+
+    const Mode &m_mode;
+    const std::chrono::microseconds m_interval;
+    asio::steady_timer m_timer;
+    clock::time_point m_next;
+    std::deque<clock::time_point> m_sentAt;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Sends small json updates at a fixed rate to an echoing Webserver with different "
+                                                    "coalescing flush delays, and once with the largest delay at high priority. "
+                                                    "Reports writes (segments on the wire over loopback) and bytes per update "
+                                                    "against the round trip latency. The server runs on its own thread."));
+    parser.addHelpOption();
+
+    const QCommandLineOption delaysOption{QStringLiteral("delays"), QStringLiteral("Flush delays to run, comma separated, 0 disables coalescing."), QStringLiteral("us"), QStringLiteral("0,500,1000,2000,5000")};
+    const QCommandLineOption flushBytesOption{QStringLiteral("flush-bytes"), QStringLiteral("Queued bytes which flush before the delay."), QStringLiteral("bytes"), QStringLiteral("4096")};
+    const QCommandLineOption intervalOption{QStringLiteral("interval"), QStringLiteral("Time between updates."), QStringLiteral("us"), QStringLiteral("100")};
+    const QCommandLineOption durationOption{QStringLiteral("duration"), QStringLiteral("Seconds per run."), QStringLiteral("seconds"), QStringLiteral("5")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({delaysOption, flushBytesOption, intervalOption, durationOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t flushBytes = parser.value(flushBytesOption).toULongLong();
+    const std::chrono::microseconds interval{std::max(1ll, parser.value(intervalOption).toLongLong())};
+    const std::chrono::seconds duration{parser.value(durationOption).toLongLong()};
+    const auto port = parser.value(portOption).toUShort();
+
+    std::vector<Mode> modes;
+    for (const auto &delay : parser.value(delaysOption).split(','))
+        modes.push_back({ std::chrono::microseconds{delay.toLongLong()}, MessagePriority::Normal });
+    if (!modes.empty())
+    {
+        // latency critical updates skip the window
+        const auto longest = std::max_element(std::begin(modes), std::end(modes), [](const Mode &a, const Mode &b){ return a.flushDelay < b.flushDelay; });
+        modes.push_back({ longest->flushDelay, MessagePriority::High });
+    }
+
+    asio::io_context serverContext;
+    BenchmarkWebserver server{[](ClientConnection &clientConnection){ return std::make_unique<EchoResponseHandler>(clientConnection); },
+                              serverContext, port};
+    std::thread serverThread{[&](){ serverContext.run(); }};
+
+    for (const auto &mode : modes)
+    {
+        asio::io_context clientContext;
+        UpdateClient client{clientContext, std::to_string(port), mode, flushBytes, interval};
+        client.start();
+        clientContext.run_for(duration);
+
+        const auto &stats = client.stats();
+        const double updates = std::max<std::size_t>(1, client.sent);
+        const double seconds = std::chrono::duration<double>(duration).count();
+
+        fmt::print("delay {:>5}us {:<6} {:>7.0f} updates/s, {:>7.0f} writes/s, {:.3f} writes and {:>5.1f} bytes ({:>5.1f} on the wire) per update, "
+                   "round trip p50 {:.1f}us p99 {:.1f}us\n",
+                   mode.flushDelay.count(), mode.priority == MessagePriority::High ? "high" : "normal",
+                   client.sent / seconds, stats.writes / seconds, stats.writes / updates, stats.writtenBytes / updates,
+                   (stats.writtenBytes + stats.writes * segmentOverhead) / updates,
+                   percentile(client.latencies, .5), percentile(client.latencies, .99));
+    }
+
+    serverContext.stop();
+    serverThread.join();
+}
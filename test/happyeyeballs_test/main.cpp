@@ -0,0 +1,157 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/happyeyeballs.h>
+
+namespace {
+struct Result
+{
+    std::error_code error;
+    asio::ip::tcp::endpoint remote;
+    std::chrono::steady_clock::time_point connectedAt;
+};
+
+// A listener on ::1 with a backlog of 0 that is already full. Linux drops
+// further SYNs instead of refusing them, so a connect to it hangs like one
+// to an address family without a route, without needing any network.
+struct Blackhole
+{
+    explicit Blackhole(asio::io_context &io_context) :
+        acceptor{io_context}, filler{io_context}
+    {}
+
+    bool open(std::error_code &ec)
+    {
+        acceptor.open(asio::ip::tcp::v6(), ec);
+        if (ec)
+            return false;
+        acceptor.bind({asio::ip::address_v6::loopback(), 0}, ec);
+        if (ec)
+            return false;
+        acceptor.listen(0, ec);
+        if (ec)
+            return false;
+
+        // never accepted, occupies the only slot of the queue
+        filler.connect(acceptor.local_endpoint(), ec);
+        return !ec;
+    }
+
+    asio::ip::tcp::acceptor acceptor;
+    asio::ip::tcp::socket filler;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Connects with HappyEyeballsConnector to a blackholed IPv6 address and 127.0.0.1 and "
+                                                    "checks the connection is up one attempt delay later, not after a tcp timeout. "
+                                                    "Exits with 1 otherwise."));
+    parser.addHelpOption();
+
+    const QCommandLineOption blackholeOption{QStringLiteral("blackhole"), QStringLiteral("IPv6 address dropping SYNs, a full local listener on ::1 if not set."), QStringLiteral("address")};
+    const QCommandLineOption delayOption{QStringLiteral("delay"), QStringLiteral("Attempt delay."), QStringLiteral("ms"), QStringLiteral("250")};
+    const QCommandLineOption toleranceOption{QStringLiteral("tolerance"), QStringLiteral("Allowed deviation from the attempt delay."), QStringLiteral("ms"), QStringLiteral("100")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the debug logs of the library.")};
+
+    parser.addOptions({blackholeOption, delayOption, toleranceOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::chrono::milliseconds delay{parser.value(delayOption).toLongLong()};
+    const std::chrono::milliseconds tolerance{parser.value(toleranceOption).toLongLong()};
+
+    asio::io_context io_context;
+
+    asio::ip::tcp::acceptor acceptor{io_context, {asio::ip::address_v4::loopback(), 0}};
+    asio::ip::tcp::socket accepted{io_context};
+    acceptor.async_accept(accepted, [](std::error_code){});
+
+    std::vector<asio::ip::tcp::endpoint> endpoints;
+
+    Blackhole blackhole{io_context};
+    if (parser.isSet(blackholeOption))
+    {
+        std::error_code ec;
+        const auto address = asio::ip::make_address_v6(parser.value(blackholeOption).toStdString(), ec);
+        if (ec)
+        {
+            fmt::print("invalid blackhole address: {}\n", ec.message());
+            return 1;
+        }
+        endpoints.emplace_back(address, 9);
+    }
+    else
+    {
+        std::error_code ec;
+        if (!blackhole.open(ec))
+        {
+            fmt::print("no local blackhole on ::1 ({}), pass --blackhole\n", ec.message());
+            return 1;
+        }
+        endpoints.push_back(blackhole.acceptor.local_endpoint());
+    }
+    endpoints.push_back(acceptor.local_endpoint());
+
+    std::optional<Result> result;
+    HappyEyeballsConnector connector{io_context, [](void *context, const std::error_code &error, asio::ip::tcp::socket &&socket){
+        auto &result = *static_cast<std::optional<Result> *>(context);
+        std::error_code ec;
+        result = Result{ .error = error, .remote = error ? asio::ip::tcp::endpoint{} : socket.remote_endpoint(ec),
+                         .connectedAt = std::chrono::steady_clock::now() };
+    }, &result};
+    connector.setAttemptDelay(delay);
+
+    const auto start = std::chrono::steady_clock::now();
+    connector.connect(endpoints);
+
+    // a tcp timeout would take many seconds, give up well before
+    io_context.run_for(delay + tolerance + std::chrono::seconds{2});
+
+    if (!result)
+    {
+        fmt::print("not connected after {}ms\n", std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+        return 1;
+    }
+
+    if (result->error)
+    {
+        fmt::print("connect failed: {}\n", result->error.message());
+        return 1;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(result->connectedAt - start);
+    fmt::print("connected to {} after {}ms (attempt delay {}ms)\n", result->remote.address().to_string(), elapsed.count(), delay.count());
+
+    if (result->remote != acceptor.local_endpoint())
+    {
+        fmt::print("connected to the blackhole\n");
+        return 1;
+    }
+
+    // before the attempt delay only if the blackhole refused right away
+    if (elapsed < delay - tolerance || elapsed > delay + tolerance)
+    {
+        fmt::print("expected {}ms +- {}ms\n", delay.count(), tolerance.count());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,384 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/hpack.h>
+#include <asio_web/httpclient.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_HTTP2_BENCHMARK";
+
+// answers every request with the same body after a delay, the time a
+// real handler would spend looking something up
+class DelayedResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    DelayedResponseHandler(ClientConnection &clientConnection, const std::string &response, std::chrono::microseconds delay) :
+        BenchmarkResponseHandler{clientConnection}, m_response{response}, m_delay{delay}, m_timer{clientConnection.stream().get_executor()}
+    {}
+
+    void sendResponse() final
+    {
+        if (m_delay.count() <= 0)
+        {
+            writeResponse(m_response);
+            return;
+        }
+
+        m_timer.expires_after(m_delay);
+        m_timer.async_wait([this, self=m_clientConnection.shared_from_this()](std::error_code ec){
+            if (ec)
+                return;
+            writeResponse(m_response);
+        });
+    }
+
+private:
+    const std::string &m_response;
+    const std::chrono::microseconds m_delay;
+    asio::steady_timer m_timer;
+};
+
+// one page load: all resources requested at once, finished when the last
+// response is complete
+struct Page
+{
+    std::size_t resources;
+    std::size_t finished{};
+    std::size_t failed{};
+    uint64_t bodyBytes{};
+};
+
+class CountingHandler final : public HttpClientResponseHandler
+{
+public:
+    explicit CountingHandler(Page &page) : m_page{page} {}
+
+    void responseBodyReceived(std::string_view data) final { m_page.bodyBytes += data.size(); }
+    void responseFinished() final { m_page.finished++; }
+
+    void requestFailed(std::string_view message) final
+    {
+        ESP_LOGW(TAG, "request failed: %.*s", message.size(), message.data());
+        m_page.failed++;
+        m_page.finished++;
+    }
+
+private:
+    Page &m_page;
+};
+
+// a browser over HTTP/1.1, a few connections and the requests queued on them
+void loadHttp1(Page &page, const std::string &port, std::size_t connections)
+{
+    asio::io_context io_context;
+    HttpClient client{io_context};
+    client.setSettings(HttpClientSettings {
+        .maxConnectionsPerHost = connections,
+    });
+
+    for (std::size_t i = 0; i < page.resources; i++)
+        client.request(false, "127.0.0.1", port, HttpClientRequest{.target = fmt::format("/resource/{}", i)},
+                       std::make_unique<CountingHandler>(page));
+
+    while (page.finished < page.resources && io_context.run_one());
+}
+
+// just enough of an h2c client (prior knowledge) for the benchmark: one
+// stream per resource, windows opened wide so no WINDOW_UPDATE is needed
+class Http2PageLoad
+{
+public:
+    Http2PageLoad(asio::io_context &io_context, Page &page, unsigned short port) :
+        m_socket{io_context}, m_page{page}, m_port{port}
+    {}
+
+    void start()
+    {
+        m_socket.async_connect({asio::ip::make_address("127.0.0.1"), m_port}, [this](std::error_code ec){
+            if (ec)
+            {
+                fail(fmt::format("connect failed: {}", ec.message()));
+                return;
+            }
+
+            m_socket.set_option(asio::ip::tcp::no_delay{true}, ec);
+
+            m_sendBuffer = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+            writeFrameHeader(12, 0x4, 0, 0); // SETTINGS
+            appendSetting(0x2, 0);           // ENABLE_PUSH
+            appendSetting(0x4, 0x7fffffff);  // INITIAL_WINDOW_SIZE
+            writeFrameHeader(4, 0x8, 0, 0);  // WINDOW_UPDATE
+            appendUint32(0x7fffffff - 65535);
+
+            const auto authority = fmt::format("127.0.0.1:{}", m_port);
+            for (std::size_t i = 0; i < m_page.resources; i++)
+            {
+                std::string block;
+                m_encoder.encode(":method", "GET", block);
+                m_encoder.encode(":scheme", "http", block);
+                m_encoder.encode(":authority", authority, block);
+                m_encoder.encode(":path", fmt::format("/resource/{}", i), block, false);
+
+                writeFrameHeader(block.size(), 0x1, 0x1 | 0x4, 2 * i + 1); // HEADERS, END_STREAM | END_HEADERS
+                m_sendBuffer += block;
+            }
+
+            doWrite();
+            doRead();
+        });
+    }
+
+private:
+    void doRead()
+    {
+        m_socket.async_read_some(asio::buffer(m_receiveBuffer), [this](std::error_code ec, std::size_t length){
+            if (ec)
+            {
+                fail(fmt::format("read failed: {}", ec.message()));
+                return;
+            }
+
+            m_parsingBuffer.append(m_receiveBuffer, length);
+            if (!parseFrames())
+                return;
+
+            if (m_page.finished == m_page.resources)
+            {
+                std::error_code ec;
+                m_socket.close(ec);
+                return;
+            }
+
+            doWrite();
+            doRead();
+        });
+    }
+
+    bool parseFrames()
+    {
+        std::string_view input{m_parsingBuffer};
+
+        while (input.size() >= 9)
+        {
+            const std::size_t length = uint8_t(input[0]) << 16 | uint8_t(input[1]) << 8 | uint8_t(input[2]);
+            const uint8_t type = input[3];
+            const uint8_t flags = input[4];
+            if (input.size() < 9 + length)
+                break;
+            const auto payload = input.substr(9, length);
+            input.remove_prefix(9 + length);
+
+            switch (type)
+            {
+            case 0x0: // DATA
+                m_page.bodyBytes += payload.size();
+                if (flags & 0x1)
+                    m_page.finished++;
+                break;
+            case 0x1: // HEADERS
+            {
+                if (!(flags & 0x4))
+                    return fail("CONTINUATION not supported");
+                std::vector<HpackHeader> headers;
+                if (!m_decoder.decode(payload, headers, 64 * 1024))
+                    return fail(fmt::format("invalid header block: {}", m_decoder.error()));
+                if (flags & 0x1)
+                    m_page.finished++;
+                break;
+            }
+            case 0x3: // RST_STREAM
+                m_page.failed++;
+                m_page.finished++;
+                break;
+            case 0x4: // SETTINGS
+                if (!(flags & 0x1))
+                    writeFrameHeader(0, 0x4, 0x1, 0);
+                break;
+            case 0x7: // GOAWAY
+                return fail("GOAWAY received");
+            default:
+                break;
+            }
+        }
+
+        m_parsingBuffer.erase(0, m_parsingBuffer.size() - input.size());
+        return true;
+    }
+
+    void doWrite()
+    {
+        if (m_writeInProgress || m_sendBuffer.empty())
+            return;
+
+        m_writing.swap(m_sendBuffer);
+        m_writeInProgress = true;
+
+        asio::async_write(m_socket, asio::buffer(m_writing), [this](std::error_code ec, std::size_t){
+            m_writeInProgress = false;
+            m_writing.clear();
+            if (!ec)
+                doWrite();
+        });
+    }
+
+    bool fail(std::string_view message)
+    {
+        ESP_LOGW(TAG, "page load failed: %.*s", message.size(), message.data());
+        m_page.failed += m_page.resources - m_page.finished;
+        m_page.finished = m_page.resources;
+
+        std::error_code ec;
+        m_socket.close(ec);
+        return false;
+    }
+
+    void writeFrameHeader(std::size_t length, uint8_t type, uint8_t flags, uint32_t streamId)
+    {
+        appendUint32(length << 8 | type);
+        m_sendBuffer += char(flags);
+        appendUint32(streamId);
+    }
+
+    void appendSetting(uint16_t setting, uint32_t value)
+    {
+        m_sendBuffer += char(setting >> 8);
+        m_sendBuffer += char(setting);
+        appendUint32(value);
+    }
+
+    void appendUint32(uint32_t value)
+    {
+        m_sendBuffer += char(value >> 24);
+        m_sendBuffer += char(value >> 16);
+        m_sendBuffer += char(value >> 8);
+        m_sendBuffer += char(value);
+    }
+
+    asio::ip::tcp::socket m_socket;
+    Page &m_page;
+    const unsigned short m_port;
+
+    HpackEncoder m_encoder;
+    HpackDecoder m_decoder;
+
+    char m_receiveBuffer[16384];
+    std::string m_parsingBuffer;
+    std::string m_sendBuffer;
+    std::string m_writing;
+    bool m_writeInProgress{};
+};
+
+void loadHttp2(Page &page, unsigned short port)
+{
+    asio::io_context io_context;
+    Http2PageLoad load{io_context, page, port};
+    load.start();
+
+    while (page.finished < page.resources && io_context.run_one());
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Loads a page of many resources from a Webserver, over HTTP/1.1 with a browser's six "
+                                                    "connections and over one h2c connection, and compares the page load latency. Every "
+                                                    "page starts with new connections. Server and client run on their own threads."));
+    parser.addHelpOption();
+
+    const QCommandLineOption pagesOption{QStringLiteral("pages"), QStringLiteral("Page loads per protocol."), QStringLiteral("count"), QStringLiteral("500")};
+    const QCommandLineOption resourcesOption{QStringLiteral("resources"), QStringLiteral("Requests per page, at most the server's concurrent streams."), QStringLiteral("count"), QStringLiteral("60")};
+    const QCommandLineOption connectionsOption{QStringLiteral("connections"), QStringLiteral("HTTP/1.1 connections per page."), QStringLiteral("count"), QStringLiteral("6")};
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Response body size."), QStringLiteral("bytes"), QStringLiteral("4096")};
+    const QCommandLineOption delayOption{QStringLiteral("delay"), QStringLiteral("Time the server takes per response."), QStringLiteral("us"), QStringLiteral("1000")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Port of the server."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({pagesOption, resourcesOption, connectionsOption, sizeOption, delayOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t pages = parser.value(pagesOption).toULongLong();
+    const std::size_t resources = std::clamp(parser.value(resourcesOption).toULongLong(), 1ull, 100ull);
+    const std::size_t connections = std::max(1ull, parser.value(connectionsOption).toULongLong());
+    const std::size_t size = parser.value(sizeOption).toULongLong();
+    const std::chrono::microseconds delay{parser.value(delayOption).toLongLong()};
+    const auto port = parser.value(portOption).toUShort();
+
+    const std::string response = fixedResponse(size);
+    asio::io_context serverContext;
+    BenchmarkWebserver server{[&response, delay](ClientConnection &clientConnection){ return std::make_unique<DelayedResponseHandler>(clientConnection, response, delay); },
+                              serverContext, port};
+    std::thread serverThread{[&](){ serverContext.run(); }};
+
+    for (const bool http2 : {false, true})
+    {
+        std::vector<double> latencies;
+        latencies.reserve(pages);
+        std::size_t failed{};
+        uint64_t bodyBytes{};
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < pages; i++)
+        {
+            Page page{.resources = resources};
+
+            const auto pageStart = std::chrono::steady_clock::now();
+            if (http2)
+                loadHttp2(page, port);
+            else
+                loadHttp1(page, std::to_string(port), connections);
+            latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pageStart).count());
+
+            failed += page.failed;
+            bodyBytes += page.bodyBytes;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double average = latencies.empty() ? 0. : seconds * 1000. / latencies.size();
+
+        fmt::print("{:<9} {} pages of {} in {:.2f}s, page load avg {:.2f}ms p50 {:.2f}ms p99 {:.2f}ms, {:.1f} MB/s, {} failed\n",
+                   http2 ? "http/2:" : "http/1.1:", pages, resources, seconds, average,
+                   percentile(latencies, .5), percentile(latencies, .99), bodyBytes / seconds / 1e6, failed);
+    }
+
+    serverContext.stop();
+    serverThread.join();
+}
@@ -0,0 +1,179 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <chrono>
+#include <memory>
+#include <string>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/httpclient.h>
+#include <asio_web/sslclientcontext.h>
+
+namespace {
+constexpr const char * const TAG = "ASIO_HTTP_CLIENT";
+
+struct Run
+{
+    asio::io_context &io_context;
+    HttpClient &client;
+    bool tls;
+    std::string host;
+    std::string port;
+    std::string path;
+    std::size_t total;
+
+    std::size_t started{};
+    std::size_t finished{};
+    std::size_t failed{};
+    uint64_t bodyBytes{};
+
+    void next();
+};
+
+class CountingHandler final : public HttpClientResponseHandler
+{
+public:
+    explicit CountingHandler(Run &run) : m_run{run} {}
+
+    void responseLineReceived(uint16_t status, std::string_view message) final
+    {
+        if (status != 200)
+            ESP_LOGW(TAG, "status %hu %.*s", status, message.size(), message.data());
+    }
+
+    void responseBodyReceived(std::string_view data) final { m_run.bodyBytes += data.size(); }
+
+    void responseFinished() final
+    {
+        m_run.finished++;
+        m_run.next();
+    }
+
+    void requestFailed(std::string_view message) final
+    {
+        ESP_LOGW(TAG, "request failed: %.*s", message.size(), message.data());
+        m_run.failed++;
+        m_run.finished++;
+        m_run.next();
+    }
+
+private:
+    Run &m_run;
+};
+
+// every finished request starts the next one, concurrency stays constant
+void Run::next()
+{
+    if (started < total)
+    {
+        started++;
+        client.request(tls, host, port, HttpClientRequest{ .target = path }, std::make_unique<CountingHandler>(*this));
+    }
+    else if (finished == total)
+        io_context.stop();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Sends GET requests with HttpClient, once over pooled keep-alive connections "
+                                                    "and once with a new connection per request, and compares the request rates."));
+    parser.addHelpOption();
+
+    const QCommandLineOption hostOption{QStringLiteral("host"), QStringLiteral("Server host."), QStringLiteral("host"), QStringLiteral("localhost")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption pathOption{QStringLiteral("path"), QStringLiteral("Request target."), QStringLiteral("path"), QStringLiteral("/")};
+    const QCommandLineOption requestsOption{QStringLiteral("requests"), QStringLiteral("Requests per run."), QStringLiteral("count"), QStringLiteral("10000")};
+    const QCommandLineOption concurrencyOption{QStringLiteral("concurrency"), QStringLiteral("Requests in flight, also the connections per host."), QStringLiteral("count"), QStringLiteral("4")};
+    const QCommandLineOption pipelineOption{QStringLiteral("pipeline"), QStringLiteral("Pipeline depth of the pooled run."), QStringLiteral("depth"), QStringLiteral("1")};
+    const QCommandLineOption tlsOption{QStringLiteral("tls"), QStringLiteral("Connect with TLS.")};
+    const QCommandLineOption caOption{QStringLiteral("ca"), QStringLiteral("CA file, trusted besides the system CA store."), QStringLiteral("file")};
+    const QCommandLineOption insecureOption{QStringLiteral("insecure"), QStringLiteral("Accept any server certificate.")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({hostOption, portOption, pathOption, requestsOption, concurrencyOption, pipelineOption, tlsOption, caOption, insecureOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const bool tls = parser.isSet(tlsOption);
+    const std::size_t requests = parser.value(requestsOption).toULongLong();
+    const std::size_t concurrency = std::max(1ull, parser.value(concurrencyOption).toULongLong());
+    const std::size_t pipeline = std::max(1ull, parser.value(pipelineOption).toULongLong());
+
+    std::shared_ptr<SslClientContext> sslContext;
+    if (tls)
+    {
+        sslContext = std::make_shared<SslClientContext>();
+        sslContext->setAlpnProtocols({"http/1.1"});
+        if (parser.isSet(caOption))
+        {
+            std::error_code ec;
+            sslContext->loadVerifyFile(parser.value(caOption).toStdString(), ec);
+            if (ec)
+            {
+                ESP_LOGE(TAG, "loading %s failed: %s", qPrintable(parser.value(caOption)), ec.message().c_str());
+                return 1;
+            }
+        }
+        if (parser.isSet(insecureOption))
+            sslContext->disableVerification();
+    }
+
+    for (const bool keepAlive : {true, false})
+    {
+        asio::io_context io_context;
+        HttpClient client{io_context, sslContext};
+        client.setSettings(HttpClientSettings {
+            .maxConnectionsPerHost = concurrency,
+            .maxPipelineDepth = keepAlive ? pipeline : 1,
+            .keepAlive = keepAlive
+        });
+
+        Run run {
+            .io_context = io_context,
+            .client = client,
+            .tls = tls,
+            .host = parser.value(hostOption).toStdString(),
+            .port = parser.value(portOption).toStdString(),
+            .path = parser.value(pathOption).toStdString(),
+            .total = requests
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+
+        // with pipelining more requests than connections are in flight
+        for (std::size_t i = 0; i < concurrency * (keepAlive ? pipeline : 1); i++)
+            run.next();
+        io_context.run();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto &stats = client.stats();
+
+        fmt::print("{:<13} {} requests in {:.2f}s, {:.0f} req/s, {} failed, {} connects, {} reused, {} pipelined, {} retries, {} body bytes\n",
+                   keepAlive ? "pooled:" : "per request:", run.finished, seconds, run.finished / seconds, run.failed,
+                   stats.connects, stats.reusedConnections, stats.pipelined, stats.retries, run.bodyBytes);
+    }
+}
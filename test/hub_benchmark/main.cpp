@@ -0,0 +1,257 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+#include <asio_web/websocketclient.h>
+#include <asio_web/websocketclientconnection.h>
+#include <asio_web/websockethub.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_HUB_BENCHMARK";
+
+constexpr std::string_view topic{"bench"};
+
+using clock = std::chrono::steady_clock;
+
+// subscribes every websocket connection to the topic, nothing else is served
+class SubscribeResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    SubscribeResponseHandler(ClientConnection &clientConnection, WebsocketHub &hub) :
+        BenchmarkResponseHandler{clientConnection}, m_hub{hub}
+    {}
+
+    bool acceptsWebsocketUpgrade() const final { return true; }
+
+    void websocketConnected(WebsocketClientConnection &connection) final { m_hub.subscribe(topic, connection.shared_from_this()); }
+    void websocketDisconnected(WebsocketClientConnection &connection) final { m_hub.unsubscribeAll(connection); }
+
+private:
+    WebsocketHub &m_hub;
+};
+
+class HubWebserver final : public Webserver
+{
+public:
+    HubWebserver(asio::io_context &io_context, unsigned short port) :
+        Webserver{io_context, port}
+    {}
+
+    WebsocketHub &hub() { return m_hub; }
+
+    bool connectionKeepAlive() const final { return true; }
+
+    std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final
+    {
+        return std::make_unique<SubscribeResponseHandler>(clientConnection, m_hub);
+    }
+
+    // every message has to arrive, the publisher keeps the queues short itself
+    OutboundQueueSettings websocketOutboundQueueSettings() const final
+    {
+        OutboundQueueSettings settings;
+        settings.policy = SlowConsumerPolicy::Backpressure;
+        return settings;
+    }
+
+private:
+    WebsocketHub m_hub;
+};
+
+struct Worker;
+
+// takes the publish time from the first 8 bytes of every message
+class Subscriber final : public WebsocketClient
+{
+public:
+    Subscriber(Worker &worker, const std::string &port);
+
+    void handleConnected() final {}
+    void handleDisconnected() final {}
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final;
+    void handleErrorOccured(const Error &error) final { ESP_LOGW(TAG, "%s", error.message.c_str()); }
+
+private:
+    Worker &m_worker;
+};
+
+// one io_context per thread, the subscribers are spread over them
+struct Worker
+{
+    explicit Worker(std::atomic<uint64_t> &delivered) : delivered{delivered} {}
+
+    asio::io_context io_context;
+    std::atomic<uint64_t> &delivered;
+    std::vector<double> latencies; // us, from publish() until handleMessage()
+    std::vector<std::unique_ptr<Subscriber>> subscribers;
+    std::thread thread;
+};
+
+Subscriber::Subscriber(Worker &worker, const std::string &port) :
+    WebsocketClient{worker.io_context, "127.0.0.1", port, "/"},
+    m_worker{worker}
+{}
+
+void Subscriber::handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload)
+{
+    if (opcode != 2 || payload.size() < sizeof(clock::rep))
+        return;
+
+    clock::rep publishedAt;
+    std::memcpy(&publishedAt, payload.data(), sizeof(publishedAt));
+    m_worker.latencies.push_back(std::chrono::duration<double, std::micro>(clock::now() - clock::time_point{clock::duration{publishedAt}}).count());
+    m_worker.delivered.fetch_add(1, std::memory_order_relaxed);
+}
+
+// publishes on the server thread while at most window messages per
+// subscriber are on the way, so the queues stay short
+struct Publisher
+{
+    WebsocketHub &hub;
+    asio::io_context &io_context;
+    const std::atomic<uint64_t> &delivered;
+    std::size_t subscribers;
+    std::size_t messages;
+    std::size_t window;
+    std::string payload;
+    std::size_t published{};
+
+    void run()
+    {
+        while (published < messages && (published - delivered.load(std::memory_order_relaxed) / subscribers) < window)
+        {
+            const auto now = clock::now().time_since_epoch().count();
+            std::memcpy(payload.data(), &now, sizeof(now));
+            hub.publishBinary(topic, payload);
+            published++;
+        }
+
+        if (published < messages)
+            asio::post(io_context, [this](){ run(); });
+    }
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Publishes messages through a WebsocketHub to a growing number of websocket "
+                                                    "subscribers and reports messages/s, deliveries/s and the delivery latency. The "
+                                                    "server runs on its own thread, the subscribers on the client threads."));
+    parser.addHelpOption();
+
+    const QCommandLineOption subscribersOption{QStringLiteral("subscribers"), QStringLiteral("Subscriber counts to run, comma separated."), QStringLiteral("counts"), QStringLiteral("1,10,100,1000")};
+    const QCommandLineOption messagesOption{QStringLiteral("messages"), QStringLiteral("Messages published per run."), QStringLiteral("count"), QStringLiteral("10000")};
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Message size."), QStringLiteral("bytes"), QStringLiteral("64")};
+    const QCommandLineOption windowOption{QStringLiteral("window"), QStringLiteral("Messages per subscriber on the way at most."), QStringLiteral("count"), QStringLiteral("64")};
+    const QCommandLineOption threadsOption{QStringLiteral("threads"), QStringLiteral("Client threads."), QStringLiteral("count"),
+                                           QString::number(std::max(2u, std::thread::hardware_concurrency()) - 1)};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({subscribersOption, messagesOption, sizeOption, windowOption, threadsOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t messages = parser.value(messagesOption).toULongLong();
+    const std::size_t size = std::max(sizeof(clock::rep), std::size_t(parser.value(sizeOption).toULongLong()));
+    const std::size_t window = std::max(1ull, parser.value(windowOption).toULongLong());
+    const std::size_t threads = std::max(1ull, parser.value(threadsOption).toULongLong());
+    const auto port = parser.value(portOption).toUShort();
+
+    asio::io_context serverContext;
+    auto work = asio::make_work_guard(serverContext);
+    HubWebserver server{serverContext, port};
+    std::thread serverThread{[&](){ serverContext.run(); }};
+
+    for (const auto &count : parser.value(subscribersOption).split(','))
+    {
+        const std::size_t subscribers = std::max(1ull, count.toULongLong());
+
+        std::atomic<uint64_t> delivered{};
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (std::size_t i = 0; i < threads; i++)
+            workers.push_back(std::make_unique<Worker>(delivered));
+        for (std::size_t i = 0; i < subscribers; i++)
+        {
+            auto &worker = *workers[i % threads];
+            worker.subscribers.push_back(std::make_unique<Subscriber>(worker, std::to_string(port)));
+            worker.subscribers.back()->start();
+        }
+        for (auto &worker : workers)
+        {
+            worker->latencies.reserve(messages * (subscribers / threads + 1));
+            worker->thread = std::thread{[worker=worker.get()](){ auto work = asio::make_work_guard(worker->io_context); worker->io_context.run(); }};
+        }
+
+        // the connections of the previous run may still be unsubscribing
+        const auto connectStart = clock::now();
+        while (server.hub().subscriberCount(topic) != subscribers && clock::now() - connectStart < std::chrono::seconds{30})
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        Publisher publisher{ .hub = server.hub(), .io_context = serverContext, .delivered = delivered, .subscribers = subscribers,
+                             .messages = messages, .window = window, .payload = std::string(size, 'x') };
+
+        const auto start = clock::now();
+        asio::post(serverContext, [&](){ publisher.run(); });
+
+        while (delivered.load(std::memory_order_relaxed) < messages * subscribers && clock::now() - start < std::chrono::seconds{60})
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+        const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+        for (auto &worker : workers)
+            worker->io_context.stop();
+        for (auto &worker : workers)
+            worker->thread.join();
+
+        std::vector<double> latencies;
+        for (auto &worker : workers)
+            latencies.insert(std::end(latencies), std::begin(worker->latencies), std::end(worker->latencies));
+
+        fmt::print("{:>5} subscribers: {:.0f} messages/s, {:.0f} deliveries/s, latency p50 {:.1f}us p99 {:.1f}us, {} of {} delivered\n",
+                   subscribers, messages / seconds, latencies.size() / seconds, percentile(latencies, .5), percentile(latencies, .99),
+                   latencies.size(), messages * subscribers);
+    }
+
+    work.reset();
+    serverContext.stop();
+    serverThread.join();
+}
@@ -0,0 +1,254 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/memorystream.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/timerwheel.h>
+#include <asio_web/webserver.h>
+
+namespace {
+using clock = std::chrono::steady_clock;
+
+// one loopback source address per that many connections, the ephemeral
+// port range of a single address is too small for 100k of them
+constexpr std::size_t connectionsPerAddress = 20000;
+
+// no request ever arrives, every connection ends with the header deadline
+class IdleWebserver final : public Webserver
+{
+public:
+    IdleWebserver(asio::io_context &io_context, unsigned short port, std::chrono::milliseconds timeout) :
+        Webserver{io_context, port}, m_timeout{timeout}
+    {}
+
+    // without a listener, for acceptStream()
+    IdleWebserver(asio::io_context &io_context, std::chrono::milliseconds timeout) :
+        Webserver{io_context}, m_timeout{timeout}
+    {}
+
+    bool connectionKeepAlive() const final { return true; }
+
+    std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final
+    {
+        return nullptr;
+    }
+
+    std::chrono::milliseconds requestHeaderTimeout() const final { return m_timeout; }
+
+private:
+    const std::chrono::milliseconds m_timeout;
+};
+
+// both ends of every connection live in this process, returns how many fit
+std::size_t raiseFileLimit(std::size_t connections)
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return connections;
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur == RLIM_INFINITY)
+        return connections;
+    return std::min<std::size_t>(connections, limit.rlim_cur > 64 ? (limit.rlim_cur - 64) / 2 : 0);
+}
+
+double cpuSeconds(std::clock_t begin, std::clock_t end)
+{
+    return double(end - begin) / CLOCKS_PER_SEC;
+}
+
+double seconds(clock::time_point begin, clock::time_point end)
+{
+    return std::chrono::duration<double>(end - begin).count();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Opens many tcp connections to a Webserver which never send a request and waits for "
+                                                    "the request header deadline to close them. Exits with 1 unless all of them are "
+                                                    "closed in time and the wait costs next to no cpu. With --pipes the connections are "
+                                                    "in-memory pipes instead, without file descriptors and ports."));
+    parser.addHelpOption();
+
+    const QCommandLineOption connectionsOption{QStringLiteral("connections"), QStringLiteral("Idle connections, capped by the open file limit."), QStringLiteral("count"), QStringLiteral("100000")};
+    const QCommandLineOption timeoutOption{QStringLiteral("timeout"), QStringLiteral("Request header timeout."), QStringLiteral("ms"), QStringLiteral("5000")};
+    const QCommandLineOption toleranceOption{QStringLiteral("tolerance"), QStringLiteral("Allowed lateness of the last close."), QStringLiteral("ms"), QStringLiteral("500")};
+    const QCommandLineOption maxIdleCpuOption{QStringLiteral("max-idle-cpu"), QStringLiteral("Allowed cpu share while waiting for the deadline."), QStringLiteral("fraction"), QStringLiteral("0.05")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption pipesOption{QStringLiteral("pipes"), QStringLiteral("Connect over MemoryStream pipes instead of loopback tcp.")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({connectionsOption, timeoutOption, toleranceOption, maxIdleCpuOption, portOption, pipesOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t requested = parser.value(connectionsOption).toULongLong();
+    const std::chrono::milliseconds timeout{parser.value(timeoutOption).toLongLong()};
+    const std::chrono::milliseconds tolerance{parser.value(toleranceOption).toLongLong()};
+    const double maxIdleCpu = parser.value(maxIdleCpuOption).toDouble();
+    const auto port = parser.value(portOption).toUShort();
+    const bool pipes = parser.isSet(pipesOption);
+
+    const std::size_t connections = pipes ? requested : raiseFileLimit(requested);
+    if (connections < requested)
+        fmt::print("the open file limit allows only {} connections\n", connections);
+    if (!connections)
+        return 1;
+
+    asio::io_context io_context;
+    const auto server = pipes ? std::make_unique<IdleWebserver>(io_context, timeout) :
+                                std::make_unique<IdleWebserver>(io_context, port, timeout);
+
+    std::vector<asio::ip::tcp::socket> clients;
+    std::vector<MemoryStream> pipeClients;
+    if (pipes)
+        pipeClients.reserve(connections);
+    else
+        clients.reserve(connections);
+
+    // nothing is ever read, the eof of the closed connection completes the read
+    char buffer[1];
+    std::size_t connected{};
+    std::size_t closed{};
+    std::size_t failed{};
+    std::optional<clock::time_point> firstClose;
+    std::clock_t firstCloseCpu{};
+
+    const auto readUntilClosed = [&](auto &client){
+        client.async_read_some(asio::buffer(buffer), [&](std::error_code ec, std::size_t length){
+            if (ec != asio::error::eof)
+                failed++;
+            if (!firstClose)
+            {
+                firstClose = clock::now();
+                firstCloseCpu = std::clock();
+            }
+            if (++closed == connections)
+                io_context.stop();
+        });
+    };
+
+    const auto setupStart = clock::now();
+    const auto setupStartCpu = std::clock();
+
+    if (pipes)
+    {
+        for (std::size_t i = 0; i < connections; i++)
+        {
+            auto [client, serverEnd] = MemoryStream::pipe(io_context.get_executor());
+            server->acceptStream(std::move(serverEnd));
+
+            readUntilClosed(pipeClients.emplace_back(std::move(client)));
+            connected++;
+        }
+    }
+    else
+    {
+        for (std::size_t i = 0; i < connections; i++)
+        {
+            const asio::ip::address_v4 source{0x7F000001u + 1u + uint32_t(i / connectionsPerAddress)};
+
+            auto &client = clients.emplace_back(io_context);
+            std::error_code ec;
+            client.open(asio::ip::tcp::v4(), ec);
+            if (!ec)
+                client.bind({source, 0}, ec);
+            if (ec)
+            {
+                fmt::print("opening connection {} failed: {}\n", i, ec.message());
+                return 1;
+            }
+
+            client.async_connect({asio::ip::address_v4::loopback(), port}, [&, &client=client](std::error_code ec){
+                connected++;
+                if (ec)
+                {
+                    failed++;
+                    closed++;
+                    return;
+                }
+
+                readUntilClosed(client);
+            });
+        }
+    }
+
+    // the server accepts while the connects complete, every accept arms a deadline
+    while (connected < connections && clock::now() - setupStart < timeout / 2)
+        io_context.run_one_for(std::chrono::milliseconds{100});
+
+    const auto start = clock::now();
+    const auto startCpu = std::clock();
+
+    fmt::print("{} connections set up in {:.2f}s ({:.2f}s cpu), {} timers armed\n", connections, seconds(setupStart, start),
+               cpuSeconds(setupStartCpu, startCpu), TimerWheel::get(io_context).armedTimers());
+
+    if (connected < connections || start - setupStart >= timeout / 2)
+    {
+        fmt::print("setting up took too long to see the idle phase, raise --timeout\n");
+        return 1;
+    }
+
+    io_context.run_for(timeout + tolerance + std::chrono::seconds{5});
+
+    const auto end = clock::now();
+    const auto endCpu = std::clock();
+
+    if (!firstClose)
+    {
+        fmt::print("none of the connections closed\n");
+        return 1;
+    }
+
+    const double idle = seconds(start, *firstClose);
+    const double idleCpu = cpuSeconds(startCpu, firstCloseCpu);
+    fmt::print("waited {:.2f}s for the first close with {:.3f}s cpu ({:.2f}%)\n", idle, idleCpu, idle > 0. ? idleCpu / idle * 100. : 0.);
+    fmt::print("{} closed within {:.3f}s with {:.3f}s cpu, {} failed\n", closed, seconds(*firstClose, end), cpuSeconds(firstCloseCpu, endCpu), failed);
+
+    bool ok{true};
+
+    if (closed != connections || failed)
+    {
+        fmt::print("expected {} connections to be closed with eof\n", connections);
+        ok = false;
+    }
+
+    // the deadlines were armed with the accepts, the wheel may fire up to one tick early
+    if (*firstClose - setupStart < timeout - TimerWheel::tickDuration || end - start > timeout + tolerance)
+    {
+        fmt::print("expected the closes between {}ms after the first connect and {}ms after the last\n",
+                   (timeout - TimerWheel::tickDuration).count(), (timeout + tolerance).count());
+        ok = false;
+    }
+
+    if (idle > 0. && idleCpu / idle > maxIdleCpu)
+    {
+        fmt::print("waiting took more than {:.1f}% cpu\n", maxIdleCpu * 100.);
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
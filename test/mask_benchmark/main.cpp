@@ -0,0 +1,116 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/websocketstream.h>
+
+namespace {
+// encodes message until total bytes went through, returns GB/s
+double measure(const std::string &message, std::size_t total, const std::function<std::size_t(std::string_view)> &encode, std::size_t &frames)
+{
+    const std::size_t iterations = std::max<std::size_t>(1, total / message.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; i++)
+        frames += encode(message);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return iterations * message.size() / seconds / 1e9;
+}
+
+// unmasks the frames with the keys from their headers and compares with the message
+bool roundTrips(const std::vector<WebsocketFrame> &frames, std::string_view message)
+{
+    std::string unmasked;
+    for (const auto &frame : frames)
+    {
+        const auto header = frame.headerView();
+        if (header.size() < sizeof(WebsocketHeader) + sizeof(uint32_t) || !reinterpret_cast<const WebsocketHeader *>(header.data())->mask)
+            return false;
+
+        uint32_t key;
+        std::memcpy(&key, header.data() + header.size() - sizeof(key), sizeof(key));
+
+        const auto payload = frame.payloadView();
+        const auto offset = unmasked.size();
+        unmasked.resize(offset + payload.size());
+        applyWebsocketMask(unmasked.data() + offset, payload.data(), payload.size(), key);
+    }
+    return unmasked == message;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures the throughput of encoding client messages: unmasked (one copy of the "
+                                                    "payload), masked with the key applied while copying, and masked in a second pass "
+                                                    "over the copy. Exits with 1 if a masked message does not unmask to the original."));
+    parser.addHelpOption();
+
+    const QCommandLineOption sizesOption{QStringLiteral("sizes"), QStringLiteral("Message sizes to run, comma separated."), QStringLiteral("bytes"), QStringLiteral("100,1024,16384,1048576")};
+    const QCommandLineOption fragmentOption{QStringLiteral("fragment"), QStringLiteral("maxFragmentSize, 0 sends every message as one frame."), QStringLiteral("bytes"), QStringLiteral("16384")};
+    const QCommandLineOption totalOption{QStringLiteral("total"), QStringLiteral("Megabytes encoded per measurement."), QStringLiteral("MB"), QStringLiteral("2000")};
+
+    parser.addOptions({sizesOption, fragmentOption, totalOption});
+    parser.process(app);
+
+    const std::size_t fragment = parser.value(fragmentOption).toULongLong();
+    const std::size_t total = parser.value(totalOption).toULongLong() * 1000 * 1000;
+
+    WebsocketMaskGenerator mask;
+
+    const auto copy = [fragment](std::string_view message){
+        return encodeWebsocketMessage(true, 0, 2, std::make_shared<const std::string>(message), fragment).size();
+    };
+    const auto fused = [fragment, &mask](std::string_view message){
+        return encodeMaskedWebsocketMessage(true, 0, 2, mask, message, fragment).size();
+    };
+    // how masking was done before it was fused into the copy
+    const auto twoPass = [fragment, &mask](std::string_view message){
+        auto payload = std::make_shared<std::string>(message);
+        auto frames = encodeWebsocketMessage(true, 0, 2, payload, fragment);
+        for (auto &frame : frames)
+            applyWebsocketMask(payload->data() + frame.offset, payload->data() + frame.offset, frame.length, mask());
+        return frames.size();
+    };
+
+    fmt::print("{} byte fragments\n", fragment);
+
+    bool ok{true};
+
+    for (const auto &size : parser.value(sizesOption).split(','))
+    {
+        std::string message(std::max(1ull, size.toULongLong()), '\0');
+        for (std::size_t i = 0; i < message.size(); i++)
+            message[i] = char(i * 7 + 1);
+
+        std::size_t frames{};
+        const double unmasked = measure(message, total, copy, frames);
+        const double masked = measure(message, total, fused, frames);
+        const double separate = measure(message, total, twoPass, frames);
+
+        const bool valid = roundTrips(encodeMaskedWebsocketMessage(true, 0, 2, mask, message, fragment), message);
+
+        fmt::print("{:>8} bytes: unmasked {:6.2f} GB/s  masked {:6.2f} GB/s ({:.0f}%)  two pass {:6.2f} GB/s{}\n",
+                   message.size(), unmasked, masked, masked / unmasked * 100., separate, valid ? "" : "  WRONG: does not unmask");
+        ok &= valid;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <string>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/httpresponseparser.h>
+#include <asio_web/memorystream.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_MEMORY_BENCHMARK";
+
+struct Run
+{
+    asio::io_context &io_context;
+    Webserver &server;
+    MemoryStreamSettings settings;
+    std::string request;
+    std::size_t bodySize;
+    std::size_t total;
+    std::size_t perConnection;
+
+    std::size_t started{};
+    std::size_t finished{};
+    std::size_t failed{};
+    std::size_t connections{};
+};
+
+// sends the requests of one keep-alive connection one after another and
+// checks every response
+class MemoryClient : public std::enable_shared_from_this<MemoryClient>
+{
+public:
+    MemoryClient(Run &run, MemoryStream &&stream) :
+        m_run{run}, m_stream{std::move(stream)}
+    {}
+
+    static void startConnection(Run &run)
+    {
+        if (run.started == run.total)
+        {
+            if (run.finished == run.total)
+                run.io_context.stop();
+            return;
+        }
+
+        run.connections++;
+
+        // the same chunking for requests and responses
+        auto [client, server] = MemoryStream::pipe(run.io_context.get_executor(), run.settings, run.settings);
+        run.server.acceptStream(std::move(server));
+        std::make_shared<MemoryClient>(run, std::move(client))->next();
+    }
+
+private:
+    void next()
+    {
+        if (m_requests == m_run.perConnection || m_run.started == m_run.total)
+        {
+            std::error_code ec;
+            m_stream.close(ec);
+            startConnection(m_run);
+            return;
+        }
+
+        m_requests++;
+        m_run.started++;
+        m_parser.reset();
+        m_received = 0;
+
+        asio::async_write(m_stream, asio::buffer(m_run.request),
+                          [this, self=shared_from_this()](std::error_code ec, std::size_t){
+            if (ec)
+                return fail(fmt::format("write failed: {}", ec.message()));
+            doRead();
+        });
+    }
+
+    void doRead()
+    {
+        m_stream.async_read_some(asio::buffer(m_receiveBuffer), [this, self=shared_from_this()](std::error_code ec, std::size_t length){
+            if (ec)
+                return fail(fmt::format("read failed: {}", ec.message()));
+
+            std::string_view input{m_receiveBuffer, length};
+            while (true)
+            {
+                switch (m_parser.parse(input))
+                {
+                case HttpResponseParser::Event::NeedMore:
+                    doRead();
+                    return;
+                case HttpResponseParser::Event::Body:
+                    m_received += m_parser.body().size();
+                    break;
+                case HttpResponseParser::Event::Complete:
+                    if (m_parser.status() != 200 || m_received != m_run.bodySize || !input.empty())
+                        return fail(fmt::format("unexpected response, status {} body {}", m_parser.status(), m_received));
+                    m_run.finished++;
+                    next();
+                    return;
+                case HttpResponseParser::Event::Error:
+                    return fail(std::string{m_parser.error()});
+                default:
+                    break;
+                }
+            }
+        });
+    }
+
+    void fail(std::string_view message)
+    {
+        ESP_LOGW(TAG, "request failed: %.*s", message.size(), message.data());
+        m_run.failed++;
+        m_run.finished++;
+
+        // the connection is out of sync, the next request gets a new one
+        std::error_code ec;
+        m_stream.close(ec);
+        startConnection(m_run);
+    }
+
+    Run &m_run;
+    MemoryStream m_stream;
+    HttpResponseParser m_parser;
+    std::size_t m_requests{};
+    std::size_t m_received{};
+    char m_receiveBuffer[16384];
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs requests through a Webserver over in-memory pipes, from request parsing over "
+                                                    "makeResponseHandler() to the response, without sockets. Reports the cpu time per "
+                                                    "request. With a seed the reads are cut at random points, the same ones for the same "
+                                                    "seed, and every response is checked."));
+    parser.addHelpOption();
+
+    const QCommandLineOption requestsOption{QStringLiteral("requests"), QStringLiteral("Requests in total."), QStringLiteral("count"), QStringLiteral("200000")};
+    const QCommandLineOption perConnectionOption{QStringLiteral("per-connection"), QStringLiteral("Requests per kept alive connection."), QStringLiteral("count"), QStringLiteral("100")};
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Response body size."), QStringLiteral("bytes"), QStringLiteral("1024")};
+    const QCommandLineOption requestBodyOption{QStringLiteral("request-body"), QStringLiteral("Request body size, a POST if not 0."), QStringLiteral("bytes"), QStringLiteral("0")};
+    const QCommandLineOption chunkOption{QStringLiteral("chunk"), QStringLiteral("Largest read, 0 for everything buffered."), QStringLiteral("bytes"), QStringLiteral("0")};
+    const QCommandLineOption seedOption{QStringLiteral("seed"), QStringLiteral("Cut reads at random points, 0 for fixed chunks."), QStringLiteral("seed"), QStringLiteral("0")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({requestsOption, perConnectionOption, sizeOption, requestBodyOption, chunkOption, seedOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t size = parser.value(sizeOption).toULongLong();
+    const std::size_t requestBody = parser.value(requestBodyOption).toULongLong();
+
+    asio::io_context io_context;
+    FixedWebserver server{fixedResponse(size), true, io_context};
+
+    Run run {
+        .io_context = io_context,
+        .server = server,
+        .settings = MemoryStreamSettings {
+            .maxReadSize = parser.value(chunkOption).toULongLong(),
+            .randomSeed = parser.value(seedOption).toUInt(),
+        },
+        .request = requestBody ?
+            fmt::format("POST /benchmark HTTP/1.1\r\n"
+                        "Host: localhost\r\n"
+                        "Content-Type: application/octet-stream\r\n"
+                        "Content-Length: {}\r\n"
+                        "\r\n"
+                        "{}", requestBody, std::string(requestBody, 'y')) :
+            std::string{"GET /benchmark HTTP/1.1\r\n"
+                        "Host: localhost\r\n"
+                        "User-Agent: asio_web memory_benchmark\r\n"
+                        "Accept: */*\r\n"
+                        "\r\n"},
+        .bodySize = size,
+        .total = parser.value(requestsOption).toULongLong(),
+        .perConnection = std::max(1ull, parser.value(perConnectionOption).toULongLong()),
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto cpuStart = std::clock();
+
+    MemoryClient::startConnection(run);
+    io_context.run();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    fmt::print("{} requests over {} connections in {:.2f}s, {:.0f} req/s, {:.2f}us cpu per request, {} failed\n",
+               run.finished, run.connections, seconds, run.finished / seconds,
+               run.finished ? cpuSeconds * 1e6 / run.finished : 0., run.failed);
+
+    return run.failed ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/httpresponseparser.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_NODELAY_BENCHMARK";
+
+// writes the head and the body of a small response separately, like any
+// handler streaming its response does. With nagle the body waits until
+// the client acked the head, which a delayed ack holds back.
+class SplitResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    SplitResponseHandler(ClientConnection &clientConnection, const std::string &head, const std::string &body) :
+        BenchmarkResponseHandler{clientConnection}, m_head{head}, m_body{body}
+    {}
+
+    void sendResponse() final
+    {
+        asio::async_write(m_clientConnection.stream(), asio::buffer(m_head.data(), m_head.size()),
+                          [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length){
+            if (ec)
+            {
+                m_clientConnection.responseFinished(ec);
+                return;
+            }
+
+            asio::async_write(m_clientConnection.stream(), asio::buffer(m_body.data(), m_body.size()),
+                              [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
+                              { m_clientConnection.responseFinished(ec); });
+        });
+    }
+
+private:
+    const std::string &m_head;
+    const std::string &m_body;
+};
+
+struct Result
+{
+    std::vector<double> latencies; // us
+    std::size_t failed{};
+};
+
+// one request at a time over a kept alive connection, blocking
+Result runClient(const asio::ip::tcp::endpoint &endpoint, std::size_t requests)
+{
+    constexpr std::string_view request{"GET /benchmark HTTP/1.1\r\n"
+                                       "Host: localhost\r\n"
+                                       "\r\n"};
+
+    asio::io_context io_context;
+    asio::ip::tcp::socket socket{io_context};
+
+    Result result;
+    result.latencies.reserve(requests);
+
+    char buffer[16384];
+    HttpResponseParser parser;
+
+    for (std::size_t i = 0; i < requests; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::error_code ec;
+        if (!socket.is_open())
+            socket.connect(endpoint, ec);
+        if (!ec)
+            asio::write(socket, asio::buffer(request), ec);
+
+        parser.reset();
+        bool complete{};
+        while (!ec && !complete)
+        {
+            const auto length = socket.read_some(asio::buffer(buffer), ec);
+            std::string_view input{buffer, length};
+            while (!ec && !complete)
+            {
+                const auto event = parser.parse(input);
+                if (event == HttpResponseParser::Event::NeedMore)
+                    break;
+                if (event == HttpResponseParser::Event::Error)
+                    ec = asio::error::invalid_argument;
+                complete = event == HttpResponseParser::Event::Complete;
+            }
+        }
+
+        if (ec)
+        {
+            ESP_LOGW(TAG, "request failed: %s", ec.message().c_str());
+            result.failed++;
+            socket.close(ec);
+        }
+        else
+            result.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    return result;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures the latency of small responses written in two parts, from a Webserver with "
+                                                    "nagle left on and from one with TCP_NODELAY, one request at a time over a kept alive "
+                                                    "connection. Servers and client run on their own threads."));
+    parser.addHelpOption();
+
+    const QCommandLineOption requestsOption{QStringLiteral("requests"), QStringLiteral("Requests per server."), QStringLiteral("count"), QStringLiteral("2000")};
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Response body size."), QStringLiteral("bytes"), QStringLiteral("128")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("First of the two ports used."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({requestsOption, sizeOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t requests = parser.value(requestsOption).toULongLong();
+    const std::size_t size = parser.value(sizeOption).toULongLong();
+    const auto port = parser.value(portOption).toUShort();
+
+    const std::string head = fmt::format("HTTP/1.1 200 Ok\r\n"
+                                         "Connection: keep-alive\r\n"
+                                         "Content-Type: application/json\r\n"
+                                         "Content-Length: {}\r\n"
+                                         "\r\n",
+                                         size);
+    const std::string body(size, 'x');
+    const auto makeHandler = [&](ClientConnection &clientConnection){ return std::make_unique<SplitResponseHandler>(clientConnection, head, body); };
+
+    asio::io_context serverContext;
+    BenchmarkWebserver nagle{makeHandler, serverContext, port, nullptr, WebserverOptions{.noDelay = false}};
+    BenchmarkWebserver noDelay{makeHandler, serverContext, static_cast<unsigned short>(port + 1), nullptr, WebserverOptions{.noDelay = true}};
+    std::thread serverThread{[&](){ serverContext.run(); }};
+
+    for (const auto &[name, serverPort] : { std::pair{"nagle:", port}, std::pair{"nodelay:", static_cast<unsigned short>(port + 1)} })
+    {
+        auto result = runClient({asio::ip::make_address("127.0.0.1"), serverPort}, requests);
+
+        double sum{};
+        for (const auto latency : result.latencies)
+            sum += latency;
+        const double average = result.latencies.empty() ? 0. : sum / result.latencies.size();
+
+        fmt::print("{:<9} {} requests, latency avg {:.1f}us p50 {:.1f}us p99 {:.1f}us, {} failed\n",
+                   name, result.latencies.size(), average, percentile(result.latencies, .5),
+                   percentile(result.latencies, .99), result.failed);
+    }
+
+    serverContext.stop();
+    serverThread.join();
+}
@@ -0,0 +1,344 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+// system includes
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <fmt/ranges.h>
+#include <asio_web/outboundqueue.h>
+
+namespace {
+constexpr std::size_t queuedMessages{8};
+
+WebsocketFrame textFrame(std::string_view payload)
+{
+    return std::move(encodeWebsocketMessage(true, 0, 1, std::make_shared<const std::string>(payload), 0).front());
+}
+
+std::string message(std::size_t index)
+{
+    return fmt::format("message {}", index);
+}
+
+// the payloads of all queued messages in the order they are written
+std::vector<std::string> drain(OutboundQueue &queue)
+{
+    std::vector<std::string> payloads;
+    while (!queue.empty())
+    {
+        payloads.emplace_back(queue.beginWrite().frame.payloadView());
+        queue.finishWrite();
+    }
+    return payloads;
+}
+
+struct Case
+{
+    const char *name;
+    SlowConsumerPolicy policy;
+    std::size_t highWaterFrames;
+    std::function<OutboundQueue::PushResult(OutboundQueue &)> push;
+    OutboundQueue::PushResult expected;
+    // the payloads left in the queue, given how many were locked
+    std::function<std::vector<std::string>(std::size_t locked)> remaining;
+};
+
+const Case cases[] {
+    {
+        "high priority push", SlowConsumerPolicy::DropOldest, 256,
+        [](OutboundQueue &queue){ return queue.push(textFrame("urgent"), {}, MessagePriority::High); },
+        OutboundQueue::PushResult::Queued,
+        [](std::size_t locked){
+            std::vector<std::string> payloads;
+            for (std::size_t i = 0; i < queuedMessages; i++)
+            {
+                if (i == locked)
+                    payloads.push_back("urgent");
+                payloads.push_back(message(i));
+            }
+            return payloads;
+        }
+    },
+    {
+        "drop oldest", SlowConsumerPolicy::DropOldest, queuedMessages,
+        [](OutboundQueue &queue){ return queue.push(textFrame("overflow")); },
+        OutboundQueue::PushResult::DroppedOldest,
+        // the oldest message not on the wire goes
+        [](std::size_t locked){
+            std::vector<std::string> payloads;
+            for (std::size_t i = 0; i < queuedMessages; i++)
+                if (i != locked)
+                    payloads.push_back(message(i));
+            payloads.push_back("overflow");
+            return payloads;
+        }
+    },
+    {
+        "coalesce", SlowConsumerPolicy::CoalesceByKey, queuedMessages,
+        [](OutboundQueue &queue){ return queue.push(textFrame("replaced"), "key3"); },
+        OutboundQueue::PushResult::Coalesced,
+        // in the place of the message it replaced
+        [](std::size_t locked){
+            std::vector<std::string> payloads;
+            for (std::size_t i = 0; i < queuedMessages; i++)
+                payloads.push_back(i == 3 ? "replaced" : message(i));
+            return payloads;
+        }
+    },
+    {
+        "disconnect", SlowConsumerPolicy::Disconnect, queuedMessages,
+        [](OutboundQueue &queue){ return queue.push(textFrame("overflow")); },
+        OutboundQueue::PushResult::Disconnect,
+        // not queued, nothing else is touched
+        [](std::size_t locked){
+            std::vector<std::string> payloads;
+            for (std::size_t i = 0; i < queuedMessages; i++)
+                payloads.push_back(message(i));
+            return payloads;
+        }
+    },
+    {
+        "backpressure", SlowConsumerPolicy::Backpressure, queuedMessages,
+        [](OutboundQueue &queue){ return queue.push(textFrame("overflow")); },
+        OutboundQueue::PushResult::Backpressure,
+        [](std::size_t locked){
+            std::vector<std::string> payloads;
+            for (std::size_t i = 0; i < queuedMessages; i++)
+                payloads.push_back(message(i));
+            payloads.push_back("overflow");
+            return payloads;
+        }
+    },
+};
+
+// what an async_write of the locked frames points at
+struct Locked
+{
+    const char *header;
+    std::string headerBytes;
+    std::string payload;
+};
+
+// locks the first frames of a queue like a write on the wire does, runs the
+// push of the case and checks that the locked frames did not move or change
+// and that the policy removed the right message
+bool run(const Case &testCase, std::size_t locked, std::string &error)
+{
+    OutboundQueue queue{OutboundQueueSettings{ .highWaterFrames = testCase.highWaterFrames, .policy = testCase.policy }};
+
+    for (std::size_t i = 0; i < queuedMessages; i++)
+        queue.push(textFrame(message(i)), fmt::format("key{}", i));
+
+    const auto frameSize = queue.bytes() / queuedMessages;
+    if (queue.beginWriteBatch(locked * frameSize) != locked)
+    {
+        error = "could not lock the frames";
+        return false;
+    }
+
+    std::vector<Locked> before;
+    for (std::size_t i = 0; i < locked; i++)
+    {
+        const auto &frame = queue.writingFrame(i).frame;
+        before.push_back(Locked{ .header = frame.header.data(), .headerBytes = std::string{frame.headerView()},
+                                 .payload = std::string{frame.payloadView()} });
+    }
+
+    if (const auto result = testCase.push(queue); result != testCase.expected)
+    {
+        error = fmt::format("push result {}", int(result));
+        return false;
+    }
+
+    for (std::size_t i = 0; i < locked; i++)
+    {
+        const auto &frame = queue.writingFrame(i).frame;
+        if (frame.header.data() != before[i].header)
+            error = fmt::format("header of locked frame {} moved", i);
+        else if (std::string_view{before[i].header, before[i].headerBytes.size()} != before[i].headerBytes)
+            error = fmt::format("header of locked frame {} changed", i);
+        else if (frame.payloadView() != before[i].payload)
+            error = fmt::format("payload of locked frame {} is \"{}\"", i, frame.payloadView());
+        else
+            continue;
+        return false;
+    }
+
+    queue.finishWrite();
+
+    std::vector<std::string> payloads(before.size());
+    std::transform(std::begin(before), std::end(before), std::begin(payloads), [](const Locked &locked){ return locked.payload; });
+    for (auto &payload : drain(queue))
+        payloads.push_back(std::move(payload));
+
+    if (const auto expected = testCase.remaining(locked); payloads != expected)
+    {
+        error = fmt::format("wrote \"{}\" instead of \"{}\"", fmt::join(payloads, "\", \""), fmt::join(expected, "\", \""));
+        return false;
+    }
+
+    return true;
+}
+
+// crossing the high water mark reports Backpressure once, finishWrite()
+// reports the end once the queue is down to the low water mark
+bool runBackpressure(std::string &error)
+{
+    OutboundQueue queue{OutboundQueueSettings{ .highWaterFrames = queuedMessages, .lowWaterFrames = queuedMessages / 2,
+                                               .policy = SlowConsumerPolicy::Backpressure }};
+
+    for (std::size_t i = 0; i < queuedMessages; i++)
+        if (const auto result = queue.push(textFrame(message(i))); result != OutboundQueue::PushResult::Queued)
+        {
+            error = fmt::format("push {} below the high water mark: {}", i, int(result));
+            return false;
+        }
+
+    if (const auto result = queue.push(textFrame("overflow")); result != OutboundQueue::PushResult::Backpressure)
+    {
+        error = fmt::format("push above the high water mark: {}", int(result));
+        return false;
+    }
+
+    if (const auto result = queue.push(textFrame("more")); result != OutboundQueue::PushResult::Queued || !queue.backpressured())
+    {
+        error = fmt::format("push while backpressured: {}", int(result));
+        return false;
+    }
+
+    while (!queue.empty())
+    {
+        queue.beginWrite();
+        const bool released = queue.finishWrite();
+        if (released != (queue.frames() == queuedMessages / 2))
+        {
+            error = fmt::format("finishWrite() returned {} with {} frames left", released, queue.frames());
+            return false;
+        }
+        if (queue.backpressured() != (queue.frames() > queuedMessages / 2))
+        {
+            error = fmt::format("backpressured() is {} with {} frames left", queue.backpressured(), queue.frames());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// the budget counts the bytes of all queues sharing it, a queue hands back
+// what it wrote, dropped or still held when it goes away
+bool runBudget(std::string &error)
+{
+    OutboundMemoryBudget budget;
+    OutboundQueue first{{}, &budget};
+
+    const auto check = [&](std::string_view step, std::size_t expected){
+        if (budget.used() == expected)
+            return true;
+        error = fmt::format("{}: {} bytes used instead of {}", step, budget.used(), expected);
+        return false;
+    };
+
+    {
+        OutboundQueue second{{}, &budget};
+
+        for (std::size_t i = 0; i < queuedMessages; i++)
+        {
+            first.push(textFrame(message(i)));
+            second.push(textFrame(message(i)));
+        }
+        second.pushControl(textFrame("control"));
+        if (!check("pushed", first.bytes() + second.bytes()))
+            return false;
+
+        first.beginWrite();
+        first.finishWrite();
+        if (!check("written", first.bytes() + second.bytes()))
+            return false;
+
+        // over the limit of all queues drops from the one pushing, though it is below its own marks
+        budget.setLimit(budget.used());
+        const auto secondBytes = second.bytes();
+        if (const auto result = first.push(textFrame("overflow")); result != OutboundQueue::PushResult::DroppedOldest)
+        {
+            error = fmt::format("push over the budget: {}", int(result));
+            return false;
+        }
+        if (budget.exceeded() || second.bytes() != secondBytes || !check("dropped", first.bytes() + second.bytes()))
+        {
+            if (error.empty())
+                error = fmt::format("over the budget: {} of {} bytes used", budget.used(), budget.limit());
+            return false;
+        }
+        budget.setLimit(0);
+
+        second.beginWrite();
+        second.dropUnlocked();
+        second.finishWrite();
+        if (!check("dropped unlocked", first.bytes()))
+            return false;
+
+        second.push(textFrame("again"));
+    }
+
+    if (!check("queue destroyed", first.bytes()))
+        return false;
+
+    first.setBudget(nullptr);
+    return check("budget detached", 0);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Locks the front frames of an OutboundQueue like a running write, then pushes a high "
+                                                    "priority message and overflows it with every slow consumer policy. Checks that the "
+                                                    "locked frames neither moved nor changed and which messages are written afterwards, "
+                                                    "that backpressure ends at the low water mark and the accounting of a shared memory "
+                                                    "budget. Exits with 1 on the first mismatch of a run."));
+    parser.addHelpOption();
+    parser.process(app);
+
+    std::size_t runs{};
+    std::size_t failed{};
+
+    for (const auto &testCase : cases)
+    {
+        for (std::size_t locked = 1; locked < queuedMessages / 2; locked++)
+        {
+            runs++;
+            std::string error;
+            if (run(testCase, locked, error))
+                continue;
+
+            failed++;
+            fmt::print("{}: {} locked: {}\n", testCase.name, locked, error);
+        }
+    }
+
+    for (const auto &[name, check] : { std::pair{"backpressure release", &runBackpressure}, std::pair{"memory budget", &runBudget} })
+    {
+        runs++;
+        std::string error;
+        if (check(error))
+            continue;
+
+        failed++;
+        fmt::print("{}: {}\n", name, error);
+    }
+
+    fmt::print("{} runs, {} failed\n", runs, failed);
+
+    return failed ? 1 : 0;
+}
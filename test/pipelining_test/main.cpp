@@ -0,0 +1,278 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/httpresponseparser.h>
+#include <asio_web/memorystream.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+
+namespace {
+// answers with the path and the request body, so the responses show which
+// request they belong to
+class EchoResponseHandler final : public ResponseHandler
+{
+public:
+    EchoResponseHandler(ClientConnection &clientConnection, std::string_view path) :
+        m_clientConnection{clientConnection}, m_body{path}
+    {
+        m_body += ':';
+    }
+
+    void requestHeaderReceived(std::string_view key, std::string_view value) final {}
+    void requestBodyReceived(std::string_view body) final { m_body += body; }
+
+    void sendResponse() final
+    {
+        m_response = fmt::format("HTTP/1.1 200 Ok\r\n"
+                                 "Connection: keep-alive\r\n"
+                                 "Content-Type: text/plain\r\n"
+                                 "Content-Length: {}\r\n"
+                                 "\r\n"
+                                 "{}",
+                                 m_body.size(), m_body);
+
+        asio::async_write(m_clientConnection.stream(), asio::buffer(m_response.data(), m_response.size()),
+                          [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
+                          { m_clientConnection.responseFinished(ec); });
+    }
+
+private:
+    ClientConnection &m_clientConnection;
+    std::string m_body;
+    std::string m_response;
+};
+
+class EchoWebserver final : public Webserver
+{
+public:
+    using Webserver::Webserver;
+
+    bool connectionKeepAlive() const final { return true; }
+
+    std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final
+    {
+        return std::make_unique<EchoResponseHandler>(clientConnection, path);
+    }
+};
+
+struct Case
+{
+    const char *name;
+    std::vector<std::string_view> requests;
+    std::vector<std::string_view> bodies;
+};
+
+const Case cases[] {
+    {
+        "two requests",
+        {
+            "GET /first HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "\r\n",
+            "GET /second HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "\r\n",
+        },
+        { "/first:", "/second:" }
+    },
+    {
+        "request after a body",
+        {
+            "POST /upload HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "hello",
+            "GET /after HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "\r\n",
+        },
+        { "/upload:hello", "/after:" }
+    },
+    {
+        "three requests with bodies",
+        {
+            "POST /a HTTP/1.1\r\n"
+            "Content-Length: 1\r\n"
+            "\r\n"
+            "1",
+            "POST /b HTTP/1.1\r\n"
+            "Content-Length: 2\r\n"
+            "\r\n"
+            "22",
+            "GET /c HTTP/1.1\r\n"
+            "\r\n",
+        },
+        { "/a:1", "/b:22", "/c:" }
+    },
+};
+
+// writes all requests of a case at once and collects the responses
+class PipeliningClient : public std::enable_shared_from_this<PipeliningClient>
+{
+public:
+    PipeliningClient(asio::io_context &io_context, MemoryStream &&stream, const Case &testCase) :
+        m_io_context{io_context}, m_stream{std::move(stream)}, m_case{testCase}
+    {
+        for (const auto request : testCase.requests)
+            m_requests += request;
+    }
+
+    void start()
+    {
+        asio::async_write(m_stream, asio::buffer(m_requests),
+                          [this, self=shared_from_this()](std::error_code ec, std::size_t){
+            if (ec)
+                return finish(fmt::format("write failed: {}", ec.message()));
+            doRead();
+        });
+    }
+
+    const std::vector<std::string> &bodies() const { return m_bodies; }
+    const std::string &error() const { return m_error; }
+    bool finished() const { return m_finished; }
+
+private:
+    void doRead()
+    {
+        m_stream.async_read_some(asio::buffer(m_receiveBuffer), [this, self=shared_from_this()](std::error_code ec, std::size_t length){
+            if (ec)
+                return finish(fmt::format("read failed: {}", ec.message()));
+
+            std::string_view input{m_receiveBuffer, length};
+            while (true)
+            {
+                switch (m_parser.parse(input))
+                {
+                case HttpResponseParser::Event::NeedMore:
+                    doRead();
+                    return;
+                case HttpResponseParser::Event::Body:
+                    m_body += m_parser.body();
+                    break;
+                case HttpResponseParser::Event::Complete:
+                    m_bodies.push_back(std::exchange(m_body, {}));
+                    m_parser.reset();
+                    if (m_bodies.size() == m_case.requests.size())
+                        return finish({});
+                    break;
+                case HttpResponseParser::Event::Error:
+                    return finish(std::string{m_parser.error()});
+                default:
+                    break;
+                }
+            }
+        });
+    }
+
+    void finish(std::string &&error)
+    {
+        m_error = std::move(error);
+        m_finished = true;
+
+        std::error_code ec;
+        m_stream.close(ec);
+        m_io_context.stop();
+    }
+
+    asio::io_context &m_io_context;
+    MemoryStream m_stream;
+    const Case &m_case;
+    std::string m_requests;
+    HttpResponseParser m_parser;
+    std::string m_body;
+    std::vector<std::string> m_bodies;
+    std::string m_error;
+    bool m_finished{};
+    char m_receiveBuffer[4096];
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Writes several requests at once to a kept alive connection of a Webserver over an "
+                                                    "in-memory pipe and expects one response per request, in order. The server reads "
+                                                    "everything at once, byte by byte and cut at random points. Exits with 1 if a "
+                                                    "response is missing or wrong."));
+    parser.addHelpOption();
+
+    const QCommandLineOption seedsOption{QStringLiteral("seeds"), QStringLiteral("Random read sizes to try per case."), QStringLiteral("count"), QStringLiteral("100")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({seedsOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    std::vector<MemoryStreamSettings> reads {
+        MemoryStreamSettings{},
+        MemoryStreamSettings{ .maxReadSize = 1 },
+    };
+    for (uint32_t seed = 1; seed <= parser.value(seedsOption).toUInt(); seed++)
+        reads.push_back(MemoryStreamSettings{ .maxReadSize = 32, .randomSeed = seed });
+
+    asio::io_context io_context;
+    EchoWebserver server{io_context};
+
+    std::size_t runs{};
+    std::size_t failed{};
+
+    for (const auto &testCase : cases)
+    {
+        for (const auto &settings : reads)
+        {
+            runs++;
+
+            auto [client, serverEnd] = MemoryStream::pipe(io_context.get_executor(), {}, settings);
+            server.acceptStream(std::move(serverEnd));
+            const auto pipelining = std::make_shared<PipeliningClient>(io_context, std::move(client), testCase);
+            pipelining->start();
+
+            // a request left in the buffer of the server is never answered
+            io_context.restart();
+            io_context.run_for(std::chrono::seconds{1});
+
+            std::string error = pipelining->error();
+            if (!pipelining->finished())
+                error = fmt::format("{} of {} responses", pipelining->bodies().size(), testCase.requests.size());
+            else if (error.empty())
+            {
+                for (std::size_t i = 0; i < testCase.bodies.size(); i++)
+                    if (pipelining->bodies()[i] != testCase.bodies[i])
+                    {
+                        error = fmt::format("response {} is \"{}\"", i + 1, pipelining->bodies()[i]);
+                        break;
+                    }
+            }
+
+            if (error.empty())
+                continue;
+
+            failed++;
+            fmt::print("{}: read size {} seed {}: {}\n", testCase.name, settings.maxReadSize, settings.randomSeed, error);
+        }
+    }
+
+    fmt::print("{} runs, {} failed\n", runs, failed);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,227 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/httpclient.h>
+#include <asio_web/proxyresponsehandler.h>
+#include <asio_web/proxyupstream.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_PROXY_BENCHMARK";
+
+// forwards everything to one upstream
+class ProxyWebserver final : public Webserver
+{
+public:
+    ProxyWebserver(asio::io_context &io_context, unsigned short port, std::string host, std::string upstreamPort) :
+        Webserver{io_context, port},
+        m_upstream{std::move(host), std::move(upstreamPort)}
+    {}
+
+    bool connectionKeepAlive() const final { return true; }
+
+    std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final
+    {
+        return std::make_unique<ProxyResponseHandler>(clientConnection, m_upstream, method, path);
+    }
+
+    const ProxyUpstream &upstream() const { return m_upstream; }
+
+private:
+    ProxyUpstream m_upstream;
+};
+
+struct Run
+{
+    asio::io_context &io_context;
+    HttpClient &client;
+    std::string port;
+    std::size_t total;
+
+    std::size_t started{};
+    std::size_t finished{};
+    std::size_t failed{};
+    uint64_t bodyBytes{};
+    std::vector<double> latencies; // us
+
+    void next();
+};
+
+class TimingHandler final : public HttpClientResponseHandler
+{
+public:
+    explicit TimingHandler(Run &run) : m_run{run} {}
+
+    void responseLineReceived(uint16_t status, std::string_view message) final
+    {
+        if (status != 200)
+            ESP_LOGW(TAG, "status %hu %.*s", status, message.size(), message.data());
+    }
+
+    void responseBodyReceived(std::string_view data) final { m_run.bodyBytes += data.size(); }
+
+    void responseFinished() final
+    {
+        m_run.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_start).count());
+        m_run.finished++;
+        m_run.next();
+    }
+
+    void requestFailed(std::string_view message) final
+    {
+        ESP_LOGW(TAG, "request failed: %.*s", message.size(), message.data());
+        m_run.failed++;
+        m_run.finished++;
+        m_run.next();
+    }
+
+private:
+    Run &m_run;
+    const std::chrono::steady_clock::time_point m_start{std::chrono::steady_clock::now()};
+};
+
+void Run::next()
+{
+    if (started < total)
+    {
+        started++;
+        client.request(false, "127.0.0.1", port, HttpClientRequest{}, std::make_unique<TimingHandler>(*this));
+    }
+    else if (finished == total)
+        io_context.stop();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures the latency and throughput ProxyResponseHandler adds, by sending the same "
+                                                    "requests once directly to an origin server and once through a proxy in front of it. "
+                                                    "Origin, proxy and client run on their own threads."));
+    parser.addHelpOption();
+
+    const QCommandLineOption requestsOption{QStringLiteral("requests"), QStringLiteral("Requests per run."), QStringLiteral("count"), QStringLiteral("20000")};
+    const QCommandLineOption concurrencyOption{QStringLiteral("concurrency"), QStringLiteral("Requests in flight."), QStringLiteral("count"), QStringLiteral("4")};
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Response body size of the origin."), QStringLiteral("bytes"), QStringLiteral("1024")};
+    const QCommandLineOption originPortOption{QStringLiteral("origin-port"), QStringLiteral("Port of the origin server."), QStringLiteral("port"), QStringLiteral("8082")};
+    const QCommandLineOption proxyPortOption{QStringLiteral("proxy-port"), QStringLiteral("Port of the proxy."), QStringLiteral("port"), QStringLiteral("8081")};
+    const QCommandLineOption upstreamOption{QStringLiteral("upstream"), QStringLiteral("Only run the proxy, in front of this server, until killed."), QStringLiteral("host:port")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({requestsOption, concurrencyOption, sizeOption, originPortOption, proxyPortOption, upstreamOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t requests = parser.value(requestsOption).toULongLong();
+    const std::size_t concurrency = std::max(1ull, parser.value(concurrencyOption).toULongLong());
+    const auto originPort = parser.value(originPortOption).toUShort();
+    const auto proxyPort = parser.value(proxyPortOption).toUShort();
+
+    if (parser.isSet(upstreamOption))
+    {
+        const auto upstream = parser.value(upstreamOption).toStdString();
+        const auto index = upstream.rfind(':');
+        if (index == std::string::npos)
+        {
+            ESP_LOGE(TAG, "invalid upstream %s", upstream.c_str());
+            return 1;
+        }
+
+        asio::io_context io_context;
+        ProxyWebserver proxy{io_context, proxyPort, upstream.substr(0, index), upstream.substr(index + 1)};
+        ESP_LOGI(TAG, "proxying port %hu to %s", proxyPort, upstream.c_str());
+        io_context.run();
+        return 0;
+    }
+
+    asio::io_context originContext;
+    FixedWebserver origin{fixedResponse(parser.value(sizeOption).toULongLong()), true, originContext, originPort};
+    std::thread originThread{[&](){ originContext.run(); }};
+
+    asio::io_context proxyContext;
+    ProxyWebserver proxy{proxyContext, proxyPort, "127.0.0.1", std::to_string(originPort)};
+    std::thread proxyThread{[&](){ proxyContext.run(); }};
+
+    // a warm-up run first so both measure pooled connections
+    for (const auto &[name, port, total] : { std::tuple{"warm-up:", originPort, concurrency * 10},
+                                             std::tuple{"direct:", originPort, requests},
+                                             std::tuple{"proxied:", proxyPort, requests} })
+    {
+        asio::io_context io_context;
+        HttpClient client{io_context};
+        client.setSettings(HttpClientSettings {
+            .maxConnectionsPerHost = concurrency
+        });
+
+        Run run {
+            .io_context = io_context,
+            .client = client,
+            .port = std::to_string(port),
+            .total = total
+        };
+        run.latencies.reserve(total);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < concurrency; i++)
+            run.next();
+        io_context.run();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (run.latencies.empty())
+        {
+            fmt::print("{:<9} all {} requests failed\n", name, run.failed);
+            continue;
+        }
+
+        fmt::print("{:<9} {} requests in {:.2f}s, {:.0f} req/s, {:.1f} MB/s, latency p50 {:.0f}us p99 {:.0f}us max {:.0f}us, {} failed\n",
+                   name, run.finished, seconds, run.finished / seconds, run.bodyBytes / seconds / 1e6,
+                   percentile(run.latencies, .5), percentile(run.latencies, .99), percentile(run.latencies, 1.), run.failed);
+    }
+
+    proxyContext.stop();
+    proxyThread.join();
+    originContext.stop();
+    originThread.join();
+
+    const auto &stats = proxy.upstream().stats();
+    fmt::print("upstream: {} connects, {} reuses, {} stale, {} failures\n", stats.connects, stats.reuses, stats.stale, stats.failures);
+}
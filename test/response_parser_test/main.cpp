@@ -0,0 +1,183 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+// system includes
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/httpresponseparser.h>
+
+namespace {
+struct Case
+{
+    const char *name;
+    std::string_view response;
+    uint16_t status;
+    std::string_view body;
+    bool headRequest{};
+};
+
+// what follows the response has to stay in the input
+constexpr std::string_view trailing{"HTTP/1.1 2"};
+
+const Case cases[] {
+    {
+        "chunked",
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "3\r\nabc\r\n"
+        "5\r\nhello\r\n"
+        "0\r\n"
+        "\r\n",
+        200, "abchello"
+    },
+    {
+        "chunked with extensions and trailers",
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Transfer-Encoding: gzip, chunked\r\n"
+        "\r\n"
+        "a;name=value\r\n0123456789\r\n"
+        "1\r\nx\r\n"
+        "0\r\n"
+        "Expires: never\r\n"
+        "Checksum: 1234\r\n"
+        "\r\n",
+        200, "0123456789x"
+    },
+    {
+        "content length",
+        "HTTP/1.1 404 Not Found\r\n"
+        "Content-Length: 9\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "not found",
+        404, "not found"
+    },
+    {
+        "no body",
+        "\r\n"
+        "HTTP/1.0 204 No Content\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n",
+        204, ""
+    },
+    {
+        "head",
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 100\r\n"
+        "\r\n",
+        200, "", true
+    },
+};
+
+// feeds the input in the given pieces like separate reads, false with a
+// message on the first difference
+bool run(const Case &testCase, const std::vector<std::string_view> &pieces, std::string &error)
+{
+    HttpResponseParser parser;
+    parser.reset(testCase.headRequest);
+
+    std::string body;
+    std::string rest;
+    bool complete{};
+
+    for (std::size_t i = 0; i < pieces.size(); i++)
+    {
+        // a read buffer is reused, the parser must not keep views into it
+        std::string buffer{pieces[i]};
+        std::string_view input{buffer};
+
+        while (!complete)
+        {
+            const auto event = parser.parse(input);
+            if (event == HttpResponseParser::Event::NeedMore)
+                break;
+            if (event == HttpResponseParser::Event::Error)
+            {
+                error = std::string{parser.error()};
+                return false;
+            }
+            if (event == HttpResponseParser::Event::Body)
+                body += parser.body();
+            complete = event == HttpResponseParser::Event::Complete;
+        }
+
+        if (complete)
+            rest += input;
+        else if (!input.empty())
+        {
+            error = "input left without a complete response";
+            return false;
+        }
+
+        buffer.assign(buffer.size(), '#');
+    }
+
+    if (!complete)
+        error = "not complete";
+    else if (parser.status() != testCase.status)
+        error = fmt::format("status {}", parser.status());
+    else if (body != testCase.body)
+        error = fmt::format("body \"{}\"", body);
+    else if (rest != trailing)
+        error = fmt::format("rest \"{}\"", rest);
+    else
+        return true;
+
+    return false;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Feeds responses to HttpResponseParser split at every point into two and into three "
+                                                    "reads, followed by the start of the next response. Exits with 1 on the first split "
+                                                    "which parses differently."));
+    parser.addHelpOption();
+    parser.process(app);
+
+    std::size_t runs{};
+    std::size_t failed{};
+
+    for (const auto &testCase : cases)
+    {
+        const std::string input = std::string{testCase.response} + std::string{trailing};
+        const std::string_view view{input};
+
+        const auto check = [&](const std::vector<std::string_view> &pieces){
+            runs++;
+            std::string error;
+            if (run(testCase, pieces, error))
+                return;
+
+            failed++;
+            std::string splits;
+            std::size_t offset{};
+            for (std::size_t i = 0; i + 1 < pieces.size(); i++)
+                splits += fmt::format("{}{}", splits.empty() ? "" : ", ", offset += pieces[i].size());
+            fmt::print("{}: split at {}: {}\n", testCase.name, splits, error);
+        };
+
+        check({view});
+
+        for (std::size_t first = 0; first <= view.size(); first++)
+        {
+            check({view.substr(0, first), view.substr(first)});
+
+            for (std::size_t second = first; second <= view.size(); second++)
+                check({view.substr(0, first), view.substr(first, second - first), view.substr(second)});
+        }
+    }
+
+    fmt::print("{} splits parsed, {} failed\n", runs, failed);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,306 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <malloc.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <openssl/x509v3.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/sslclientcontext.h>
+#include <asio_web/sslservercontext.h>
+#include <asio_web/sslwebsocketclient.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_SSL_CONTEXT_BENCHMARK";
+
+// accepts the upgrade, the connections then stay idle
+class IdleResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    explicit IdleResponseHandler(ClientConnection &clientConnection) :
+        BenchmarkResponseHandler{clientConnection}
+    {}
+
+    bool acceptsWebsocketUpgrade() const final { return true; }
+};
+
+// a self signed P-256 certificate for 127.0.0.1, which the clients trust
+// and verify, returns its pem or an empty string
+std::string makeCertificate(SslServerContext &context)
+{
+    EVP_PKEY *key{};
+    {
+        EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (!keyContext)
+            return {};
+        if (EVP_PKEY_keygen_init(keyContext) <= 0 ||
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) <= 0 ||
+            EVP_PKEY_keygen(keyContext, &key) <= 0)
+            key = nullptr;
+        EVP_PKEY_CTX_free(keyContext);
+    }
+    if (!key)
+        return {};
+
+    X509 *certificate = X509_new();
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 60 * 60 * 24);
+    X509_set_pubkey(certificate, key);
+    X509_NAME *name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("127.0.0.1"), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    // the clients connect by address, hostname checking matches it against the ip SAN
+    if (X509_EXTENSION *altName = X509V3_EXT_conf_nid(nullptr, nullptr, NID_subject_alt_name, const_cast<char *>("IP:127.0.0.1")))
+    {
+        X509_add_ext(certificate, altName, -1);
+        X509_EXTENSION_free(altName);
+    }
+    const bool signed_ = X509_sign(certificate, key, EVP_sha256()) > 0;
+
+    const auto toPem = [](auto write){
+        BIO *bio = BIO_new(BIO_s_mem());
+        write(bio);
+        char *data{};
+        const auto size = BIO_get_mem_data(bio, &data);
+        std::string pem(data, size);
+        BIO_free(bio);
+        return pem;
+    };
+    const auto certificatePem = toPem([&](BIO *bio){ PEM_write_bio_X509(bio, certificate); });
+    const auto keyPem = toPem([&](BIO *bio){ PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr); });
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+
+    if (!signed_)
+        return {};
+
+    std::error_code ec;
+    context.useCertificateChain(certificatePem, ec);
+    if (!ec)
+        context.usePrivateKey(keyPem, ec);
+    if (ec)
+    {
+        ESP_LOGE(TAG, "loading the certificate failed: %s", ec.message().c_str());
+        return {};
+    }
+    return certificatePem;
+}
+
+// trusts the server certificate and, like a real client would, a ca bundle
+std::shared_ptr<SslClientContext> makeClientContext(const std::string &certificatePem, const std::string &bundle)
+{
+    auto context = std::make_shared<SslClientContext>();
+
+    std::error_code ec;
+    context->addCertificateAuthority(certificatePem, ec);
+    if (ec)
+        ESP_LOGE(TAG, "adding the server certificate failed: %s", ec.message().c_str());
+
+    if (!bundle.empty())
+    {
+        context->loadVerifyFile(bundle, ec);
+        if (ec)
+            ESP_LOGW(TAG, "loading %s failed: %s", bundle.c_str(), ec.message().c_str());
+    }
+
+    return context;
+}
+
+class HandshakeClient final : public SslWebsocketClient
+{
+public:
+    HandshakeClient(asio::io_context &io_context, const std::string &port, std::shared_ptr<SslClientContext> context,
+                    std::size_t &connected, std::size_t clients) :
+        SslWebsocketClient{io_context, "127.0.0.1", port, "/", StreamOptions{ .context = std::move(context) }},
+        m_io_context{io_context}, m_connected{connected}, m_clients{clients}
+    {}
+
+    void handleConnected() final
+    {
+        if (++m_connected == m_clients)
+            m_io_context.stop();
+    }
+
+    void handleDisconnected() final {}
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final {}
+    void handleErrorOccured(const Error &error) final { ESP_LOGW(TAG, "%s", error.message.c_str()); }
+
+private:
+    asio::io_context &m_io_context;
+    std::size_t &m_connected;
+    const std::size_t m_clients;
+};
+
+std::size_t residentBytes()
+{
+    std::size_t size{}, resident{};
+    std::ifstream{"/proc/self/statm"} >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+double cpuMilliseconds(std::clock_t begin, std::clock_t end)
+{
+    return double(end - begin) * 1000. / CLOCKS_PER_SEC;
+}
+
+struct Mode
+{
+    const char *name;
+    bool shared;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Connects many verifying SslWebsocketClients to a TLS Webserver, first with an "
+                                                    "SslClientContext per client, then with one shared by all of them, and reports "
+                                                    "the resident memory and cpu time per client. The server runs in a forked "
+                                                    "process, so only the clients are measured."));
+    parser.addHelpOption();
+
+    const QCommandLineOption clientsOption{QStringLiteral("clients"), QStringLiteral("Clients per run."), QStringLiteral("count"), QStringLiteral("200")};
+    const QCommandLineOption bundleOption{QStringLiteral("bundle"), QStringLiteral("CA bundle every context loads, empty for none."), QStringLiteral("path"),
+                                          QStringLiteral("/etc/ssl/certs/ca-certificates.crt")};
+    const QCommandLineOption timeoutOption{QStringLiteral("timeout"), QStringLiteral("Seconds to wait for the clients to connect."), QStringLiteral("seconds"), QStringLiteral("30")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8443")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({clientsOption, bundleOption, timeoutOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t clients = std::max(1ull, parser.value(clientsOption).toULongLong());
+    const std::string bundle = parser.value(bundleOption).toStdString();
+    const std::chrono::seconds timeout{parser.value(timeoutOption).toLongLong()};
+    const auto port = parser.value(portOption).toUShort();
+
+    const auto sslContext = std::make_shared<SslServerContext>();
+    const auto certificatePem = makeCertificate(*sslContext);
+    if (certificatePem.empty())
+    {
+        ESP_LOGE(TAG, "creating a certificate failed");
+        return 1;
+    }
+
+    // listening before the fork, so the clients cannot come too early
+    asio::io_context serverContext;
+    BenchmarkWebserver server{[](ClientConnection &clientConnection){ return std::make_unique<IdleResponseHandler>(clientConnection); },
+                              serverContext, port, sslContext};
+
+    serverContext.notify_fork(asio::execution_context::fork_prepare);
+    const pid_t serverPid = fork();
+    if (serverPid < 0)
+    {
+        ESP_LOGE(TAG, "fork failed");
+        return 1;
+    }
+    if (serverPid == 0)
+    {
+        serverContext.notify_fork(asio::execution_context::fork_child);
+        serverContext.run();
+        _exit(0);
+    }
+    serverContext.notify_fork(asio::execution_context::fork_parent);
+
+    const Mode modes[] {
+        { "context per client", false },
+        { "shared context",     true },
+    };
+
+    bool ok{true};
+
+    for (const auto &mode : modes)
+    {
+        // the previous run freed its memory, give it back so it is not reused unseen
+        malloc_trim(0);
+
+        const auto rssBefore = residentBytes();
+        const auto cpuBefore = std::clock();
+
+        asio::io_context clientContext;
+        std::size_t connected{};
+        std::vector<std::unique_ptr<HandshakeClient>> handshakeClients;
+        {
+            std::shared_ptr<SslClientContext> shared;
+            if (mode.shared)
+                shared = makeClientContext(certificatePem, bundle);
+
+            for (std::size_t i = 0; i < clients; i++)
+                handshakeClients.push_back(std::make_unique<HandshakeClient>(clientContext, std::to_string(port),
+                                                                             mode.shared ? shared : makeClientContext(certificatePem, bundle),
+                                                                             connected, clients));
+        }
+
+        const auto cpuSetUp = std::clock();
+
+        for (auto &client : handshakeClients)
+            client->start();
+        clientContext.run_for(timeout);
+
+        const auto cpuConnected = std::clock();
+        const auto rssConnected = residentBytes();
+
+        uint32_t fullHandshakes{}, resumedHandshakes{};
+        for (const auto &client : handshakeClients)
+        {
+            fullHandshakes += client->stats().fullHandshakes;
+            resumedHandshakes += client->stats().resumedHandshakes;
+        }
+
+        fmt::print("{:<18} {} of {} connected, {:.1f} KiB per client, setup {:.3f}ms and handshake {:.3f}ms cpu per client, "
+                   "{} full and {} resumed handshakes\n",
+                   mode.name, connected, clients, (double(rssConnected) - double(rssBefore)) / clients / 1024.,
+                   cpuMilliseconds(cpuBefore, cpuSetUp) / clients, cpuMilliseconds(cpuSetUp, cpuConnected) / clients,
+                   fullHandshakes, resumedHandshakes);
+
+        if (connected != clients)
+            ok = false;
+    }
+
+    kill(serverPid, SIGKILL);
+    waitpid(serverPid, nullptr, 0);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+TEMPLATE = app
+
+QT += core
+
+CONFIG += c++latest
+
+unix: TARGET=$${TARGET}.bin
+DESTDIR=$${OUT_PWD}/..
+INCLUDEPATH += $$PWD
+
+include($$PWD/paths.pri)
+
+include($$PWD/dependencies.pri)
+
+unix: {
+    LIBS += -Wl,-rpath=\\\$$ORIGIN
+}
+LIBS += -L$${OUT_PWD}/..
+LIBS += -lasio_web
+
+LIBS += -lssl -lcrypto
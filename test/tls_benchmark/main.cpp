@@ -0,0 +1,344 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/httpclient.h>
+#include <asio_web/sslclientcontext.h>
+#include <asio_web/sslservercontext.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_TLS_BENCHMARK";
+
+// what we had before: a separate tls terminator copying every byte to a
+// plain webserver over loopback
+class TerminatedConnection : public std::enable_shared_from_this<TerminatedConnection>
+{
+public:
+    TerminatedConnection(asio::ip::tcp::socket &&socket, asio::ssl::context &context, const asio::ip::tcp::endpoint &backend) :
+        m_client{std::move(socket), context}, m_backend{m_client.get_executor()}, m_backendEndpoint{backend}
+    {}
+
+    void start()
+    {
+        m_client.async_handshake(asio::ssl::stream_base::server, [this, self=shared_from_this()](std::error_code ec){
+            if (ec)
+                return;
+            m_backend.async_connect(m_backendEndpoint, [this, self=shared_from_this()](std::error_code ec){
+                if (ec)
+                    return;
+                m_backend.set_option(asio::ip::tcp::no_delay{true}, ec);
+                readClient();
+                readBackend();
+            });
+        });
+    }
+
+private:
+    void readClient()
+    {
+        m_client.async_read_some(asio::buffer(m_clientBuffer), [this, self=shared_from_this()](std::error_code ec, std::size_t length){
+            if (ec)
+                return close();
+            asio::async_write(m_backend, asio::buffer(m_clientBuffer, length), [this, self=shared_from_this()](std::error_code ec, std::size_t){
+                if (ec)
+                    return close();
+                readClient();
+            });
+        });
+    }
+
+    void readBackend()
+    {
+        m_backend.async_read_some(asio::buffer(m_backendBuffer), [this, self=shared_from_this()](std::error_code ec, std::size_t length){
+            if (ec)
+                return close();
+            asio::async_write(m_client, asio::buffer(m_backendBuffer, length), [this, self=shared_from_this()](std::error_code ec, std::size_t){
+                if (ec)
+                    return close();
+                readBackend();
+            });
+        });
+    }
+
+    void close()
+    {
+        std::error_code ec;
+        m_client.lowest_layer().close(ec);
+        m_backend.close(ec);
+    }
+
+    asio::ssl::stream<asio::ip::tcp::socket> m_client;
+    asio::ip::tcp::socket m_backend;
+    const asio::ip::tcp::endpoint m_backendEndpoint;
+    char m_clientBuffer[16384];
+    char m_backendBuffer[16384];
+};
+
+class Terminator
+{
+public:
+    Terminator(asio::io_context &io_context, unsigned short port, std::shared_ptr<SslServerContext> sslContext, unsigned short backendPort) :
+        m_acceptor{io_context, asio::ip::tcp::endpoint{asio::ip::tcp::v4(), port}},
+        m_sslContext{std::move(sslContext)},
+        m_backend{asio::ip::make_address("127.0.0.1"), backendPort}
+    {
+        doAccept();
+    }
+
+private:
+    void doAccept()
+    {
+        m_acceptor.async_accept([this](std::error_code ec, asio::ip::tcp::socket socket){
+            if (!ec)
+                socket.set_option(asio::ip::tcp::no_delay{true}, ec);
+            if (!ec)
+                std::make_shared<TerminatedConnection>(std::move(socket), m_sslContext->context(), m_backend)->start();
+            doAccept();
+        });
+    }
+
+    asio::ip::tcp::acceptor m_acceptor;
+    const std::shared_ptr<SslServerContext> m_sslContext;
+    const asio::ip::tcp::endpoint m_backend;
+};
+
+// a self signed P-256 certificate for localhost, good enough for a benchmark
+bool makeCertificate(SslServerContext &context)
+{
+    EVP_PKEY *key{};
+    {
+        EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (!keyContext)
+            return false;
+        if (EVP_PKEY_keygen_init(keyContext) <= 0 ||
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) <= 0 ||
+            EVP_PKEY_keygen(keyContext, &key) <= 0)
+            key = nullptr;
+        EVP_PKEY_CTX_free(keyContext);
+    }
+    if (!key)
+        return false;
+
+    X509 *certificate = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 60 * 60 * 24);
+    X509_set_pubkey(certificate, key);
+    X509_NAME *name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    const bool signed_ = X509_sign(certificate, key, EVP_sha256()) > 0;
+
+    const auto toPem = [](auto write){
+        BIO *bio = BIO_new(BIO_s_mem());
+        write(bio);
+        char *data{};
+        const auto size = BIO_get_mem_data(bio, &data);
+        std::string pem(data, size);
+        BIO_free(bio);
+        return pem;
+    };
+    const auto certificatePem = toPem([&](BIO *bio){ PEM_write_bio_X509(bio, certificate); });
+    const auto keyPem = toPem([&](BIO *bio){ PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr); });
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+
+    if (!signed_)
+        return false;
+
+    std::error_code ec;
+    context.useCertificateChain(certificatePem, ec);
+    if (!ec)
+        context.usePrivateKey(keyPem, ec);
+    if (ec)
+    {
+        ESP_LOGE(TAG, "loading the certificate failed: %s", ec.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+struct Run
+{
+    asio::io_context &io_context;
+    HttpClient &client;
+    std::string port;
+    std::size_t total;
+
+    std::size_t started{};
+    std::size_t finished{};
+    std::size_t failed{};
+    uint64_t bodyBytes{};
+
+    void next();
+};
+
+class CountingHandler final : public HttpClientResponseHandler
+{
+public:
+    explicit CountingHandler(Run &run) : m_run{run} {}
+
+    void responseBodyReceived(std::string_view data) final { m_run.bodyBytes += data.size(); }
+
+    void responseFinished() final
+    {
+        m_run.finished++;
+        m_run.next();
+    }
+
+    void requestFailed(std::string_view message) final
+    {
+        ESP_LOGW(TAG, "request failed: %.*s", message.size(), message.data());
+        m_run.failed++;
+        m_run.finished++;
+        m_run.next();
+    }
+
+private:
+    Run &m_run;
+};
+
+void Run::next()
+{
+    if (started < total)
+    {
+        started++;
+        client.request(true, "127.0.0.1", port, HttpClientRequest{}, std::make_unique<CountingHandler>(*this));
+    }
+    else if (finished == total)
+        io_context.stop();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Compares a Webserver serving https itself with a tls terminator in front of a plain "
+                                                    "one: throughput over kept alive connections, then the rate of full and of resumed "
+                                                    "handshakes with a new connection per request. Servers and client run on their own threads."));
+    parser.addHelpOption();
+
+    const QCommandLineOption requestsOption{QStringLiteral("requests"), QStringLiteral("Requests of the throughput run."), QStringLiteral("count"), QStringLiteral("20000")};
+    const QCommandLineOption handshakesOption{QStringLiteral("handshakes"), QStringLiteral("Connections of the handshake runs."), QStringLiteral("count"), QStringLiteral("2000")};
+    const QCommandLineOption concurrencyOption{QStringLiteral("concurrency"), QStringLiteral("Requests in flight."), QStringLiteral("count"), QStringLiteral("4")};
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Response body size."), QStringLiteral("bytes"), QStringLiteral("16384")};
+    const QCommandLineOption recordSizeOption{QStringLiteral("record-size"), QStringLiteral("Largest tls record of both servers."), QStringLiteral("bytes"), QStringLiteral("16384")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("First of the three ports used."), QStringLiteral("port"), QStringLiteral("8443")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({requestsOption, handshakesOption, concurrencyOption, sizeOption, recordSizeOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t requests = parser.value(requestsOption).toULongLong();
+    const std::size_t handshakes = parser.value(handshakesOption).toULongLong();
+    const std::size_t concurrency = std::max(1ull, parser.value(concurrencyOption).toULongLong());
+    const std::size_t size = parser.value(sizeOption).toULongLong();
+    const auto port = parser.value(portOption).toUShort();
+    const unsigned short directPort = port, terminatorPort = port + 1, plainPort = port + 2;
+
+    const auto sslContext = std::make_shared<SslServerContext>();
+    if (!makeCertificate(*sslContext))
+    {
+        ESP_LOGE(TAG, "creating a certificate failed");
+        return 1;
+    }
+    sslContext->setAlpnProtocols({"http/1.1"});
+    sslContext->setMaxRecordSize(parser.value(recordSizeOption).toULongLong());
+
+    asio::io_context directContext;
+    FixedWebserver direct{fixedResponse(size), true, directContext, directPort, sslContext};
+    std::thread directThread{[&](){ directContext.run(); }};
+
+    asio::io_context plainContext;
+    FixedWebserver plain{fixedResponse(size), true, plainContext, plainPort};
+    std::thread plainThread{[&](){ plainContext.run(); }};
+
+    asio::io_context terminatorContext;
+    Terminator terminator{terminatorContext, terminatorPort, sslContext, plainPort};
+    std::thread terminatorThread{[&](){ terminatorContext.run(); }};
+
+    enum class Mode { Throughput, FullHandshakes, ResumedHandshakes };
+
+    for (const auto &[mode, name, total] : { std::tuple{Mode::Throughput, "keep-alive", requests},
+                                             std::tuple{Mode::FullHandshakes, "full handshakes", handshakes},
+                                             std::tuple{Mode::ResumedHandshakes, "resumed", handshakes} })
+    {
+        for (const auto &[setup, serverPort] : { std::tuple{"direct:", directPort}, std::tuple{"terminator:", terminatorPort} })
+        {
+            // the self signed certificate is not verified
+            const auto clientContext = std::make_shared<SslClientContext>();
+            clientContext->disableVerification();
+            clientContext->setAlpnProtocols({"http/1.1"});
+            if (mode == Mode::FullHandshakes)
+                clientContext->setMaxCachedSessions(0);
+
+            asio::io_context io_context;
+            HttpClient client{io_context, clientContext};
+            client.setSettings(HttpClientSettings {
+                .maxConnectionsPerHost = concurrency,
+                .keepAlive = mode == Mode::Throughput
+            });
+
+            Run run {
+                .io_context = io_context,
+                .client = client,
+                .port = std::to_string(serverPort),
+                .total = total
+            };
+
+            const auto start = std::chrono::steady_clock::now();
+
+            for (std::size_t i = 0; i < concurrency; i++)
+                run.next();
+            io_context.run();
+
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            fmt::print("{:<16} {:<11} {} requests in {:.2f}s, {:.0f} req/s, {:.1f} MB/s, {} connections, {} failed\n",
+                       name, setup, run.finished, seconds, run.finished / seconds, run.bodyBytes / seconds / 1e6,
+                       client.stats().connects, run.failed);
+        }
+    }
+
+    directContext.stop();
+    directThread.join();
+    terminatorContext.stop();
+    terminatorThread.join();
+    plainContext.stop();
+    plainThread.join();
+}
@@ -0,0 +1,280 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/sslclientcontext.h>
+#include <asio_web/sslservercontext.h>
+#include <asio_web/sslwebsocketclient.h>
+#include <asio_web/webserver.h>
+#include <asio_web/websocketclient.h>
+#include <asio_web/websocketclientconnection.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_TLS_WEBSOCKET_BENCHMARK";
+
+using clock = std::chrono::steady_clock;
+
+struct Received
+{
+    std::atomic<uint64_t> messages{};
+    std::atomic<uint64_t> bytes{};
+};
+
+// counts and drops every websocket message
+class SinkResponseHandler final : public BenchmarkResponseHandler
+{
+public:
+    SinkResponseHandler(ClientConnection &clientConnection, Received &received) :
+        BenchmarkResponseHandler{clientConnection}, m_received{received}
+    {}
+
+    bool acceptsWebsocketUpgrade() const final { return true; }
+
+    void websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        m_received.bytes.fetch_add(payload.size(), std::memory_order_relaxed);
+        if (fin)
+            m_received.messages.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    Received &m_received;
+};
+
+// a self signed P-256 certificate for localhost, good enough for a benchmark
+bool makeCertificate(SslServerContext &context)
+{
+    EVP_PKEY *key{};
+    {
+        EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (!keyContext)
+            return false;
+        if (EVP_PKEY_keygen_init(keyContext) <= 0 ||
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) <= 0 ||
+            EVP_PKEY_keygen(keyContext, &key) <= 0)
+            key = nullptr;
+        EVP_PKEY_CTX_free(keyContext);
+    }
+    if (!key)
+        return false;
+
+    X509 *certificate = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 60 * 60 * 24);
+    X509_set_pubkey(certificate, key);
+    X509_NAME *name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    const bool signed_ = X509_sign(certificate, key, EVP_sha256()) > 0;
+
+    const auto toPem = [](auto write){
+        BIO *bio = BIO_new(BIO_s_mem());
+        write(bio);
+        char *data{};
+        const auto size = BIO_get_mem_data(bio, &data);
+        std::string pem(data, size);
+        BIO_free(bio);
+        return pem;
+    };
+    const auto certificatePem = toPem([&](BIO *bio){ PEM_write_bio_X509(bio, certificate); });
+    const auto keyPem = toPem([&](BIO *bio){ PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr); });
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+
+    if (!signed_)
+        return false;
+
+    std::error_code ec;
+    context.useCertificateChain(certificatePem, ec);
+    if (!ec)
+        context.usePrivateKey(keyPem, ec);
+    if (ec)
+    {
+        ESP_LOGE(TAG, "loading the certificate failed: %s", ec.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+// sends the same binary message as fast as the queue takes it
+template<typename Client>
+class StreamClient final : public Client
+{
+public:
+    StreamClient(asio::io_context &io_context, const std::string &port, const std::string &payload,
+                 const typename Client::StreamOptions &streamOptions = {}) :
+        Client{io_context, "127.0.0.1", port, "/", streamOptions},
+        m_io_context{io_context}, m_payload{payload}
+    {
+        OutboundQueueSettings settings;
+        settings.policy = SlowConsumerPolicy::Backpressure;
+        this->setOutboundQueueSettings(settings);
+    }
+
+    std::optional<clock::time_point> connectedAt;
+
+    void handleConnected() final
+    {
+        connectedAt = clock::now();
+        pump();
+    }
+
+    void handleDisconnected() final {}
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final {}
+    void handleErrorOccured(const typename Client::Error &error) final { ESP_LOGW(TAG, "%s", error.message.c_str()); }
+
+    // called from the write completion, continue once it returned
+    void handleBackpressure(bool active) final
+    {
+        if (!active)
+            asio::post(m_io_context, [this](){ pump(); });
+    }
+
+private:
+    void pump()
+    {
+        while (!this->backpressured())
+            if (!this->sendMessage(true, 0, 2, true, m_payload))
+                return;
+    }
+
+    asio::io_context &m_io_context;
+    const std::string &m_payload;
+};
+
+struct Result
+{
+    double messagesPerSecond;
+    double megabytesPerSecond;
+};
+
+// runs one client until duration is over, the rate counts from the handshake on
+template<typename Client>
+std::optional<Result> measure(const Received &received, const std::string &port, const std::string &payload, std::chrono::seconds duration,
+                              const typename Client::StreamOptions &streamOptions = {})
+{
+    asio::io_context clientContext;
+    StreamClient<Client> client{clientContext, port, payload, streamOptions};
+    client.start();
+    clientContext.run_for(duration);
+
+    if (!client.connectedAt)
+        return std::nullopt;
+
+    const auto messages = received.messages.load(std::memory_order_relaxed);
+    const auto bytes = received.bytes.load(std::memory_order_relaxed);
+    const double seconds = std::chrono::duration<double>(clock::now() - *client.connectedAt).count();
+    return Result{ .messagesPerSecond = messages / seconds, .megabytesPerSecond = bytes / seconds / 1e6 };
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Streams binary websocket messages from one client to a Webserver, once with "
+                                                    "WebsocketClient over plain tcp and once with SslWebsocketClient over TLS, and "
+                                                    "reports the received messages/s and MB/s of both. The server runs on its own "
+                                                    "thread."));
+    parser.addHelpOption();
+
+    const QCommandLineOption sizesOption{QStringLiteral("sizes"), QStringLiteral("Message sizes to run, comma separated."), QStringLiteral("bytes"), QStringLiteral("100,1024,16384,65536")};
+    const QCommandLineOption durationOption{QStringLiteral("duration"), QStringLiteral("Seconds per run."), QStringLiteral("seconds"), QStringLiteral("5")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Plain server port, the TLS one listens on the next."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({sizesOption, durationOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::chrono::seconds duration{parser.value(durationOption).toLongLong()};
+    const auto port = parser.value(portOption).toUShort();
+    const unsigned short plainPort = port, tlsPort = port + 1;
+
+    const auto sslContext = std::make_shared<SslServerContext>();
+    if (!makeCertificate(*sslContext))
+    {
+        ESP_LOGE(TAG, "creating a certificate failed");
+        return 1;
+    }
+
+    // the self signed certificate is not verified
+    const auto clientContext = std::make_shared<SslClientContext>();
+    clientContext->disableVerification();
+
+    for (const auto &size : parser.value(sizesOption).split(','))
+    {
+        const std::string payload(size.toULongLong(), 'x');
+
+        std::optional<Result> plain, tls;
+
+        {
+            Received received;
+            asio::io_context serverContext;
+            BenchmarkWebserver server{[&received](ClientConnection &clientConnection){ return std::make_unique<SinkResponseHandler>(clientConnection, received); },
+                                      serverContext, plainPort};
+            std::thread serverThread{[&](){ serverContext.run(); }};
+            plain = measure<WebsocketClient>(received, std::to_string(plainPort), payload, duration);
+            serverContext.stop();
+            serverThread.join();
+        }
+
+        {
+            Received received;
+            asio::io_context serverContext;
+            BenchmarkWebserver server{[&received](ClientConnection &clientConnection){ return std::make_unique<SinkResponseHandler>(clientConnection, received); },
+                                      serverContext, tlsPort, sslContext};
+            std::thread serverThread{[&](){ serverContext.run(); }};
+            tls = measure<SslWebsocketClient>(received, std::to_string(tlsPort), payload, duration,
+                                              SslWebsocketClient::StreamOptions{ .context = clientContext });
+            serverContext.stop();
+            serverThread.join();
+        }
+
+        if (!plain || !tls)
+        {
+            fmt::print("{:>6} bytes: {} client did not connect\n", payload.size(), !plain ? "plain" : "TLS");
+            continue;
+        }
+
+        fmt::print("{:>6} bytes: plain {:>9.0f} msg/s {:>8.1f} MB/s, TLS {:>9.0f} msg/s {:>8.1f} MB/s ({:.0f}% of plain)\n",
+                   payload.size(), plain->messagesPerSecond, plain->megabytesPerSecond, tls->messagesPerSecond, tls->megabytesPerSecond,
+                   plain->megabytesPerSecond > 0. ? tls->megabytesPerSecond / plain->megabytesPerSecond * 100. : 0.);
+    }
+}
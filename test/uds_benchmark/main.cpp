@@ -0,0 +1,184 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/httpresponseparser.h>
+#include <asio_web/webserver.h>
+
+// local includes
+#include "benchmarkutils.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_UDS_BENCHMARK";
+
+struct Result
+{
+    std::vector<double> latencies; // us
+    std::size_t failed{};
+};
+
+// one request at a time like a local client process would send them,
+// blocking, so only the transport and the server are measured
+template<typename Protocol>
+Result runClient(const typename Protocol::endpoint &endpoint, std::size_t requests, bool reconnect)
+{
+    constexpr std::string_view request{"GET /benchmark HTTP/1.1\r\n"
+                                       "Host: localhost\r\n"
+                                       "\r\n"};
+
+    asio::io_context io_context;
+    typename Protocol::socket socket{io_context};
+
+    Result result;
+    result.latencies.reserve(requests);
+
+    char buffer[16384];
+    HttpResponseParser parser;
+
+    for (std::size_t i = 0; i < requests; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::error_code ec;
+        if (!socket.is_open())
+        {
+            socket.connect(endpoint, ec);
+            if constexpr (std::is_same_v<Protocol, asio::ip::tcp>)
+                if (!ec)
+                    socket.set_option(asio::ip::tcp::no_delay{true}, ec);
+        }
+        if (!ec)
+            asio::write(socket, asio::buffer(request), ec);
+
+        parser.reset();
+        bool complete{};
+        while (!ec && !complete)
+        {
+            const auto length = socket.read_some(asio::buffer(buffer), ec);
+            std::string_view input{buffer, length};
+            while (!ec && !complete)
+            {
+                const auto event = parser.parse(input);
+                if (event == HttpResponseParser::Event::NeedMore)
+                    break;
+                if (event == HttpResponseParser::Event::Error)
+                    ec = asio::error::invalid_argument;
+                complete = event == HttpResponseParser::Event::Complete;
+            }
+        }
+
+        if (ec)
+        {
+            ESP_LOGW(TAG, "request failed: %s", ec.message().c_str());
+            result.failed++;
+        }
+        else
+            result.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        if (ec || reconnect)
+            socket.close(ec);
+    }
+
+    return result;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Compares the request latency of a Webserver over a unix domain socket with loopback "
+                                                    "tcp, one request at a time over a kept alive connection and with a new connection "
+                                                    "per request. Server and client run on their own threads."));
+    parser.addHelpOption();
+
+    const QCommandLineOption requestsOption{QStringLiteral("requests"), QStringLiteral("Requests of the kept alive runs."), QStringLiteral("count"), QStringLiteral("50000")};
+    const QCommandLineOption connectionsOption{QStringLiteral("connections"), QStringLiteral("Requests of the runs with a new connection each, tcp leaves them in TIME_WAIT."), QStringLiteral("count"), QStringLiteral("10000")};
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Response body size."), QStringLiteral("bytes"), QStringLiteral("256")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Port of the tcp listener."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption pathOption{QStringLiteral("path"), QStringLiteral("Path of the unix socket, a leading @ for the abstract namespace."), QStringLiteral("path"), QStringLiteral("/tmp/asio_web_uds_benchmark.sock")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({requestsOption, connectionsOption, sizeOption, portOption, pathOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::size_t requests = parser.value(requestsOption).toULongLong();
+    const std::size_t connections = parser.value(connectionsOption).toULongLong();
+    const std::size_t size = parser.value(sizeOption).toULongLong();
+    const auto port = parser.value(portOption).toUShort();
+    const auto path = parser.value(pathOption).toStdString();
+
+    asio::io_context serverContext;
+    FixedWebserver server{fixedResponse(size), true, serverContext, port};
+
+    std::error_code ec;
+    server.listenLocal(LocalListenerSettings {
+        .path = path,
+        .permissions = std::filesystem::perms::owner_read | std::filesystem::perms::owner_write
+    }, ec);
+    if (ec)
+    {
+        ESP_LOGE(TAG, "listening on %s failed: %s", path.c_str(), ec.message().c_str());
+        return 1;
+    }
+
+    std::thread serverThread{[&](){ serverContext.run(); }};
+
+    std::string endpointPath{path};
+    if (!endpointPath.empty() && endpointPath.front() == '@')
+        endpointPath.front() = '\0';
+    const asio::local::stream_protocol::endpoint localEndpoint{endpointPath};
+    const asio::ip::tcp::endpoint tcpEndpoint{asio::ip::make_address("127.0.0.1"), port};
+
+    for (const bool reconnect : {false, true})
+    {
+        for (const bool local : {false, true})
+        {
+            const auto total = reconnect ? connections : requests;
+            auto result = local ? runClient<asio::local::stream_protocol>(localEndpoint, total, reconnect) :
+                                  runClient<asio::ip::tcp>(tcpEndpoint, total, reconnect);
+
+            double sum{};
+            for (const auto latency : result.latencies)
+                sum += latency;
+            const double average = result.latencies.empty() ? 0. : sum / result.latencies.size();
+
+            fmt::print("{:<11} {:<5} {} requests, latency avg {:.1f}us p50 {:.1f}us p99 {:.1f}us, {} failed\n",
+                       reconnect ? "connect:" : "keep-alive:", local ? "uds" : "tcp", result.latencies.size(),
+                       average, percentile(result.latencies, .5), percentile(result.latencies, .99), result.failed);
+        }
+    }
+
+    serverContext.stop();
+    serverThread.join();
+}
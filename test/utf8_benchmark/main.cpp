@@ -0,0 +1,118 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/utf8validator.h>
+
+namespace {
+struct Input
+{
+    const char *name;
+    std::string_view pattern; // repeated to the buffer size, cut on a code point boundary
+};
+
+const Input inputs[] {
+    { "ascii", "{\"id\":1234,\"name\":\"sensor\",\"value\":21.5,\"unit\":\"C\"}," },
+    { "latin", "Grüße aus Köln, déjà vu, señor. " },
+    { "cjk",   "日本語のテキストと中文文本。" },
+    { "emoji", "😀🚀🌍🎉" },
+    { "mixed", "{\"text\":\"naïve café 東京 🚀\",\"n\":42}," },
+};
+
+std::string makeBuffer(std::string_view pattern, std::size_t size)
+{
+    std::string buffer;
+    buffer.reserve(size + pattern.size());
+    while (buffer.size() < size)
+        buffer += pattern;
+
+    // never end inside a code point
+    std::size_t end = size;
+    while (end > 0 && (uint8_t(buffer[end]) & 0xC0) == 0x80)
+        end--;
+    buffer.resize(end);
+    return buffer;
+}
+
+// runs validate over buffer until total bytes went through, returns GB/s
+double measure(const std::string &buffer, std::size_t total, const std::function<bool(std::string_view)> &validate, bool &valid)
+{
+    const std::size_t iterations = std::max<std::size_t>(1, total / buffer.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; i++)
+        valid &= validate(buffer);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return iterations * buffer.size() / seconds / 1e9;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures the throughput of Utf8Validator on ascii, two, three and four byte text: "
+                                                    "the SSSE3 bulk path, the scalar state machine, and feedFrame() over a fragmented "
+                                                    "message like the websocket read path. Exits with 1 if a result is wrong."));
+    parser.addHelpOption();
+
+    const QCommandLineOption sizeOption{QStringLiteral("size"), QStringLiteral("Message size."), QStringLiteral("bytes"), QStringLiteral("65536")};
+    const QCommandLineOption fragmentOption{QStringLiteral("fragment"), QStringLiteral("Fragment size for feedFrame()."), QStringLiteral("bytes"), QStringLiteral("4096")};
+    const QCommandLineOption totalOption{QStringLiteral("total"), QStringLiteral("Megabytes validated per measurement."), QStringLiteral("MB"), QStringLiteral("2000")};
+
+    parser.addOptions({sizeOption, fragmentOption, totalOption});
+    parser.process(app);
+
+    const std::size_t size = std::max(16ull, parser.value(sizeOption).toULongLong());
+    const std::size_t fragment = std::max(1ull, parser.value(fragmentOption).toULongLong());
+    const std::size_t total = parser.value(totalOption).toULongLong() * 1000 * 1000;
+
+    fmt::print("{} byte messages, {} byte fragments, SSSE3 {}\n", size, fragment, Utf8Validator::haveSimd() ? "available" : "not available");
+
+    const auto fragmented = [fragment](std::string_view data){
+        Utf8Validator validator;
+        bool valid{true};
+        for (std::size_t offset = 0; offset < data.size(); offset += fragment)
+            valid = validator.feedFrame(offset + fragment >= data.size(), offset ? 0 : 1, data.substr(offset, fragment));
+        return valid;
+    };
+
+    bool ok{true};
+
+    for (const auto &input : inputs)
+    {
+        const auto buffer = makeBuffer(input.pattern, size);
+
+        bool valid{true};
+        const double bulk = measure(buffer, total, &Utf8Validator::validate, valid);
+        const double scalar = measure(buffer, total, &Utf8Validator::validateScalar, valid);
+        const double frames = measure(buffer, total, fragmented, valid);
+
+        fmt::print("{:<6} simd {:6.2f} GB/s  scalar {:6.2f} GB/s ({:.1f}x)  feedFrame {:6.2f} GB/s{}\n",
+                   input.name, bulk, scalar, bulk / scalar, frames, valid ? "" : "  WRONG: rejected");
+        ok &= valid;
+
+        // a broken sequence in the middle must be found by every path
+        auto broken = buffer;
+        broken[broken.size() / 2] = char(0xC0);
+        if (Utf8Validator::validate(broken) || Utf8Validator::validateScalar(broken) || fragmented(broken))
+        {
+            fmt::print("{:<6} WRONG: accepted invalid data\n", input.name);
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
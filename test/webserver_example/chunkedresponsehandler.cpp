@@ -46,7 +46,7 @@ void ChunkedResponseHandler::sendResponse()
                              "\r\n",
                              m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close");
 
-    asio::async_write(m_clientConnection.socket(),
+    asio::async_write(m_clientConnection.stream(),
                       asio::buffer(m_response.data(), m_response.size()),
                       [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
                       { written(ec, length); });
@@ -75,7 +75,7 @@ void ChunkedResponseHandler::written(std::error_code ec, std::size_t length)
                                  "{}\r\n",
                                  m_response.size(), m_response);
 
-        asio::async_write(m_clientConnection.socket(),
+        asio::async_write(m_clientConnection.stream(),
                           asio::buffer(m_response.data(), m_response.size()),
                           [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
                           { written(ec, length); });
@@ -90,7 +90,7 @@ void ChunkedResponseHandler::written(std::error_code ec, std::size_t length)
         m_response = fmt::format("0\r\n"
                                  "\r\n");
 
-        asio::async_write(m_clientConnection.socket(),
+        asio::async_write(m_clientConnection.stream(),
                           asio::buffer(m_response.data(), m_response.size()),
                           [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
                           { written(ec, length); });
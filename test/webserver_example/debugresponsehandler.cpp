@@ -123,7 +123,7 @@ void DebugResponseHandler::sendResponse()
                              m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close",
                              m_response.size(), m_response);
 
-    asio::async_write(m_clientConnection.socket(),
+    asio::async_write(m_clientConnection.stream(),
                       asio::buffer(m_response.data(), m_response.size()),
                       [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
                       { written(ec, length); });
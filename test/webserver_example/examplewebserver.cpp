@@ -32,6 +32,8 @@ std::unique_ptr<ResponseHandler> ExampleWebserver::makeResponseHandler(ClientCon
         return std::make_unique<ChunkedResponseHandler>(clientConnection);
     else if (processedPath == "/ws")
         return std::make_unique<WebsocketResponseHandler>(clientConnection);
+    else if (processedPath == "/ws/broadcast")
+        return std::make_unique<WebsocketResponseHandler>(clientConnection, &m_websocketHub);
     else
         return std::make_unique<ErrorResponseHandler>(clientConnection, path);
 }
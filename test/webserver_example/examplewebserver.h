@@ -2,6 +2,7 @@
 
 // 3rdparty lib includes
 #include <asio_web/webserver.h>
+#include <asio_web/websockethub.h>
 
 class ExampleWebserver final : public Webserver
 {
@@ -11,4 +12,7 @@ public:
     bool connectionKeepAlive() const final { return true; }
 
     std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final;
+
+private:
+    WebsocketHub m_websocketHub;
 };
@@ -62,7 +62,7 @@ void RootResponseHandler::sendResponse()
                              m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close",
                              m_response.size(), m_response);
 
-    asio::async_write(m_clientConnection.socket(),
+    asio::async_write(m_clientConnection.stream(),
                       asio::buffer(m_response.data(), m_response.size()),
                       [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
                       { written(ec, length); });
@@ -1,9 +1,3 @@
-TEMPLATE = app
-
-QT += core
-
-CONFIG += c++latest
-
 HEADERS += \
     chunkedresponsehandler.h \
     debugresponsehandler.h \
@@ -21,18 +15,4 @@ SOURCES += \
     rootresponsehandler.cpp \
     websocketresponsehandler.cpp
 
-unix: TARGET=webserver_example.bin
-DESTDIR=$${OUT_PWD}/..
-INCLUDEPATH += $$PWD/..
-
-include(../paths.pri)
-
-include(../dependencies.pri)
-
-unix: {
-    LIBS += -Wl,-rpath=\\\$$ORIGIN
-}
-LIBS += -L$${OUT_PWD}/..
-LIBS += -lasio_web
-
-LIBS += -lssl -lcrypto
+include(../testapp.pri)
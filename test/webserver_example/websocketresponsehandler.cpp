@@ -1,8 +1,5 @@
 #include "websocketresponsehandler.h"
 
-// system includes
-#include <openssl/sha.h>
-
 // esp-idf includes
 #include <asio.hpp>
 #include <esp_log.h>
@@ -11,11 +8,14 @@
 #include <fmt/core.h>
 #include <asio_web/clientconnection.h>
 #include <asio_web/webserver.h>
-#include <strutils.h>
+#include <asio_web/websocketclientconnection.h>
+#include <asio_web/websockethub.h>
 
 namespace {
 constexpr const char * const TAG = "ASIO_WEBSERVER";
 
+constexpr std::string_view broadcastTopic{"broadcast"};
+
 constexpr std::string_view html{R"END(
 <!DOCTYPE html>
 <html>
@@ -129,8 +129,9 @@ constexpr std::string_view html{R"END(
 )END"};
 } // namespace
 
-WebsocketResponseHandler::WebsocketResponseHandler(ClientConnection &clientConnection) :
-    m_clientConnection{clientConnection}
+WebsocketResponseHandler::WebsocketResponseHandler(ClientConnection &clientConnection, WebsocketHub *websocketHub) :
+    m_clientConnection{clientConnection},
+    m_websocketHub{websocketHub}
 {
 //    ESP_LOGV(TAG, "constructed for (%s:%hi)",
 //             m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
@@ -145,28 +146,6 @@ WebsocketResponseHandler::~WebsocketResponseHandler()
 void WebsocketResponseHandler::requestHeaderReceived(std::string_view key, std::string_view value)
 {
 //    ESP_LOGV(TAG, "key=\"%.*s\" value=\"%.*s\"", key.size(), key.data(), value.size(), value.data());
-
-    if (cpputils::stringEqualsIgnoreCase(key, "Connection"))
-    {
-        m_connectionUpgrade = cpputils::stringEqualsIgnoreCase(value, "Upgrade") ||
-            value.contains("Upgrade");
-    }
-    else if (cpputils::stringEqualsIgnoreCase(key, "Upgrade"))
-    {
-        m_upgradeWebsocket = cpputils::stringEqualsIgnoreCase(value, "websocket");
-    }
-    else if (cpputils::stringEqualsIgnoreCase(key, "Sec-WebSocket-Version"))
-    {
-        m_secWebsocketVersion = value;
-    }
-    else if (cpputils::stringEqualsIgnoreCase(key, "Sec-WebSocket-Key"))
-    {
-        m_secWebsocketKey = value;
-    }
-    else if (cpputils::stringEqualsIgnoreCase(key, "Sec-WebSocket-Extensions"))
-    {
-        m_secWebsocketExtensions = value;
-    }
 }
 
 void WebsocketResponseHandler::requestBodyReceived(std::string_view body)
@@ -178,64 +157,19 @@ void WebsocketResponseHandler::sendResponse()
     ESP_LOGI(TAG, "sending response for (%s:%hi)",
              m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
 
-    if (!m_connectionUpgrade || !m_upgradeWebsocket)
-    {
-        m_response = fmt::format("HTTP/1.1 200 Ok\r\n"
-                                 "Connection: {}\r\n"
-                                 "Content-Type: text/html\r\n"
-                                 "Content-Length: {}\r\n"
-                                 "\r\n",
-                                 m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close",
-                                 html.size());
-
-        asio::async_write(m_clientConnection.socket(),
-                          asio::buffer(m_response.data(), m_response.size()),
-                          [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
-                          { writtenHtmlHeader(ec, length); });
-
-        return;
-    }
-
-    const auto showError = [&](std::string_view msg){
-        m_response = fmt::format("HTTP/1.1 400 Bad Request\r\n"
-                                 "Connection: {}\r\n"
-                                 "Content-Type: text/html\r\n"
-                                 "Content-Length: {}\r\n"
-                                 "\r\n"
-                                 "{}",
-                                 m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close",
-                                 msg.size(), msg);
-
-        asio::async_write(m_clientConnection.socket(),
-                          asio::buffer(m_response.data(), m_response.size()),
-                          [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
-                          { writtenHtml(ec, length); });
-    };
-
-    if (m_secWebsocketKey.empty())
-    {
-        showError("Header Sec-WebSocket-Key empty or missing!");
-        return;
-    }
-
-    constexpr std::string_view magic_uuid{"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"};
-    m_secWebsocketKey.append(magic_uuid);
-
-    unsigned char sha1[SHA_DIGEST_LENGTH]; // == 20
-    SHA1((const unsigned char *)m_secWebsocketKey.data(), m_secWebsocketKey.size(), sha1);
-
-    const auto base64Sha1 = cpputils::toBase64String({sha1, SHA_DIGEST_LENGTH});
-
-    m_response = fmt::format("HTTP/1.1 101 Switching Protocols\r\n"
-                             "Upgrade: websocket\r\n"
-                             "Connection: Upgrade\r\n"
-                             "Sec-WebSocket-Accept: {}\r\n"
-                             "\r\n", base64Sha1);
+    // websocket upgrades are handled by ClientConnection (acceptsWebsocketUpgrade())
+    m_response = fmt::format("HTTP/1.1 200 Ok\r\n"
+                             "Connection: {}\r\n"
+                             "Content-Type: text/html\r\n"
+                             "Content-Length: {}\r\n"
+                             "\r\n",
+                             m_clientConnection.webserver().connectionKeepAlive() ? "keep-alive" : "close",
+                             html.size());
 
-    asio::async_write(m_clientConnection.socket(),
+    asio::async_write(m_clientConnection.stream(),
                       asio::buffer(m_response.data(), m_response.size()),
                       [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
-                      { writtenWebsocket(ec, length); });
+                      { writtenHtmlHeader(ec, length); });
 }
 
 void WebsocketResponseHandler::writtenHtmlHeader(std::error_code ec, std::size_t length)
@@ -251,7 +185,7 @@ void WebsocketResponseHandler::writtenHtmlHeader(std::error_code ec, std::size_t
     ESP_LOGI(TAG, "expected=%zd actual=%zd for (%s:%hi)", m_response.size(), length,
              m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
 
-    asio::async_write(m_clientConnection.socket(),
+    asio::async_write(m_clientConnection.stream(),
                       asio::buffer(html.data(), html.size()),
                       [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
                       { writtenHtml(ec, length); });
@@ -273,18 +207,48 @@ void WebsocketResponseHandler::writtenHtml(std::error_code ec, std::size_t lengt
     m_clientConnection.responseFinished(ec);
 }
 
-void WebsocketResponseHandler::writtenWebsocket(std::error_code ec, std::size_t length)
+void WebsocketResponseHandler::websocketConnected(WebsocketClientConnection &connection)
 {
-    if (ec)
+    if (m_websocketHub)
+        m_websocketHub->subscribe(broadcastTopic, connection.shared_from_this());
+}
+
+void WebsocketResponseHandler::websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload)
+{
+    if (!m_websocketHub)
     {
-        ESP_LOGW(TAG, "error: %i (%s:%hi)", ec.value(),
-                 m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
-        m_clientConnection.responseFinished(ec);
+        connection.sendMessage(true, 0, 1, false, fmt::format("received {}", payload.size()));
         return;
     }
 
-    ESP_LOGI(TAG, "expected=%zd actual=%zd for (%s:%hi)", m_response.size(), length,
-             m_clientConnection.remote_endpoint().address().to_string().c_str(), m_clientConnection.remote_endpoint().port());
+    // only whole messages are broadcast, fragments are collected until fin
+    switch (opcode)
+    {
+    case 1: // text
+    case 2: // binary
+        if (fin)
+        {
+            m_websocketHub->publish(broadcastTopic, opcode, payload);
+            return;
+        }
+        m_fragmentsOpcode = opcode;
+        m_fragments.assign(payload);
+        return;
+    case 0: // continuation
+        if (!m_fragmentsOpcode)
+            return;
+        m_fragments.append(payload);
+        if (!fin)
+            return;
+        m_websocketHub->publish(broadcastTopic, m_fragmentsOpcode, m_fragments);
+        m_fragmentsOpcode = 0;
+        m_fragments.clear();
+        return;
+    }
+}
 
-    m_clientConnection.upgradeWebsocket();
+void WebsocketResponseHandler::websocketDisconnected(WebsocketClientConnection &connection)
+{
+    if (m_websocketHub)
+        m_websocketHub->unsubscribeAll(connection);
 }
@@ -1,8 +1,7 @@
 #pragma once
 
-#pragma once
-
 // system includes
+#include <cstdint>
 #include <string_view>
 #include <string>
 #include <system_error>
@@ -12,29 +11,34 @@
 
 // forward declarations
 class ClientConnection;
+class WebsocketHub;
 
 class WebsocketResponseHandler final : public ResponseHandler
 {
 public:
-    WebsocketResponseHandler(ClientConnection &clientConnection);
+    WebsocketResponseHandler(ClientConnection &clientConnection, WebsocketHub *websocketHub = nullptr);
     ~WebsocketResponseHandler() override;
 
     void requestHeaderReceived(std::string_view key, std::string_view value) final;
     void requestBodyReceived(std::string_view body) final;
     void sendResponse() final;
 
+    bool acceptsWebsocketUpgrade() const final { return true; }
+
+    void websocketConnected(WebsocketClientConnection &connection) final;
+    void websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final;
+    void websocketDisconnected(WebsocketClientConnection &connection) final;
+
 private:
     void writtenHtmlHeader(std::error_code ec, std::size_t length);
     void writtenHtml(std::error_code ec, std::size_t length);
-    void writtenWebsocket(std::error_code ec, std::size_t length);
 
     ClientConnection &m_clientConnection;
+    WebsocketHub * const m_websocketHub;
 
     std::string m_response;
 
-    bool m_connectionUpgrade{};
-    bool m_upgradeWebsocket{};
-    std::string m_secWebsocketVersion;
-    std::string m_secWebsocketKey;
-    std::string m_secWebsocketExtensions;
+    // the fragmented message being received, opcode 0 if none
+    uint8_t m_fragmentsOpcode{};
+    std::string m_fragments;
 };
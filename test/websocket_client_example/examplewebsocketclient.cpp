@@ -0,0 +1,34 @@
+#include "examplewebsocketclient.h"
+
+// esp-idf includes
+#include <esp_log.h>
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEBSOCKET_CLIENT";
+
+constexpr std::string_view hello{"{\"type\":\"hello\"}"};
+} // namespace
+
+void ExampleWebsocketClient::handleConnected()
+{
+    ESP_LOGI(TAG, "connected");
+
+    sendMessage(true, 0, 1, true, hello);
+}
+
+void ExampleWebsocketClient::handleDisconnected()
+{
+    ESP_LOGI(TAG, "disconnected");
+}
+
+void ExampleWebsocketClient::handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload)
+{
+    ESP_LOGI(TAG, "fin=%i opcode=%hhu payload: %.*s", fin, opcode, payload.size(), payload.data());
+
+    sendMessage(true, 0, 1, true, hello);
+}
+
+void ExampleWebsocketClient::handleErrorOccured(const Error &error)
+{
+    ESP_LOGW(TAG, "%s", error.message.c_str());
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// 3rdparty lib includes
+#include <asio_web/websocketclient.h>
+
+class ExampleWebsocketClient final : public WebsocketClient
+{
+public:
+    using WebsocketClient::WebsocketClient;
+
+    void handleConnected() final;
+    void handleDisconnected() final;
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final;
+    void handleErrorOccured(const Error &error) final;
+};
@@ -3,14 +3,16 @@
 // esp-idf includes
 #include <esp_log.h>
 #include <asio.hpp>
-#include <asio/ssl.hpp>
-#include <asio/buffer.hpp>
 
 // 3rdparty lib includes
 #include <cppmacros.h>
 
 // local includes
-#include "websocketclient.h"
+#include "examplewebsocketclient.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEBSOCKET_CLIENT";
+} // namespace
 
 int main(int argc, char *argv[])
 {
@@ -30,7 +32,8 @@ int main(int argc, char *argv[])
 
     asio::io_context io_context;
 
-    WebsocketClient c{io_context};
+    ExampleWebsocketClient c{io_context, "localhost", "1234", "/charger/99999999"};
+    c.setReconnectSettings({ .enabled = true });
     c.start();
 
     ESP_LOGI(TAG, "running mainloop");
@@ -0,0 +1,159 @@
+#pragma once
+
+// system includes
+#include <chrono>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+// esp-idf includes
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <asio_web/websocketclient.h>
+
+// local includes
+#include "loadgenstats.h"
+
+struct LoadgenSettings
+{
+    std::string host;
+    std::string port;
+    std::string path;
+
+    double rate{1.}; // messages per second and connection, 0 only connects
+
+    // message mix, a payload is picked with the probability of its weight
+    std::vector<std::string> payloads;
+    std::vector<double> weights;
+};
+
+class LoadgenConnection
+{
+public:
+    virtual ~LoadgenConnection() = default;
+
+    virtual void launch() = 0;
+};
+
+// One simulated device: sends a message from the mix at a fixed rate and
+// takes every reply of the server as the echo of its oldest unanswered
+// message (the /ws endpoint of webserver_example answers every message).
+template<typename Stream>
+class LoadgenClient final : public BasicWebsocketClient<Stream>, public LoadgenConnection
+{
+    using Base = BasicWebsocketClient<Stream>;
+
+public:
+    using clock = std::chrono::steady_clock;
+
+    LoadgenClient(asio::io_context &io_context, const LoadgenSettings &settings, LoadgenStats &stats,
+                  const typename Base::StreamOptions &streamOptions = {}) :
+        Base{io_context, settings.host, settings.port, settings.path, streamOptions},
+        m_settings{settings},
+        m_stats{stats},
+        m_sendTimer{io_context},
+        m_random{std::random_device{}()},
+        m_mix{std::begin(settings.weights), std::end(settings.weights)}
+    {
+        this->setReconnectSettings({ .enabled = true });
+
+        // replies are matched in order, nothing may be dropped
+        OutboundQueueSettings queueSettings;
+        queueSettings.policy = SlowConsumerPolicy::Backpressure;
+        this->setOutboundQueueSettings(queueSettings);
+    }
+
+    void launch() final { Base::start(); }
+
+    void handleConnected() final
+    {
+        m_stats.connects.fetch_add(1, std::memory_order_relaxed);
+        m_connected = true;
+        m_sentAt.clear();
+
+        if (m_settings.rate <= 0.)
+            return;
+
+        m_interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>{1. / m_settings.rate});
+
+        // random phase, so the connections do not send in lockstep
+        std::uniform_int_distribution<clock::rep> phase{0, m_interval.count()};
+        m_nextSend = clock::now() + clock::duration{phase(m_random)};
+        scheduleSend();
+    }
+
+    void handleDisconnected() final
+    {
+        m_stats.disconnects.fetch_add(1, std::memory_order_relaxed);
+        m_connected = false;
+        m_sendTimer.cancel();
+        m_sentAt.clear();
+    }
+
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        if (opcode != 1 && opcode != 2)
+            return;
+
+        m_stats.receivedMessages.fetch_add(1, std::memory_order_relaxed);
+
+        if (m_sentAt.empty())
+            return;
+
+        m_stats.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - m_sentAt.front()));
+        m_sentAt.pop_front();
+    }
+
+    void handleErrorOccured(const typename Base::Error &error) final
+    {
+        m_stats.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    void scheduleSend()
+    {
+        m_sendTimer.expires_at(m_nextSend);
+        m_sendTimer.async_wait([this](std::error_code ec){
+            if (ec || !m_connected)
+                return;
+            send();
+        });
+    }
+
+    void send()
+    {
+        // a fixed rate, a late tick does not move the following ones
+        m_nextSend += m_interval;
+
+        // the server is behind, skip instead of queueing up
+        if (!this->backpressured())
+        {
+            const auto &payload = m_settings.payloads[m_mix(m_random)];
+            if (this->sendMessage(true, 0, 1, true, payload))
+            {
+                m_sentAt.push_back(clock::now());
+                m_stats.sentMessages.fetch_add(1, std::memory_order_relaxed);
+                m_stats.sentBytes.fetch_add(payload.size(), std::memory_order_relaxed);
+            }
+        }
+
+        // sendMessage() may have ended the connection
+        if (m_connected)
+            scheduleSend();
+    }
+
+    const LoadgenSettings &m_settings;
+    LoadgenStats &m_stats;
+
+    bool m_connected{};
+    asio::steady_timer m_sendTimer;
+    clock::duration m_interval{};
+    clock::time_point m_nextSend;
+
+    std::minstd_rand m_random;
+    std::discrete_distribution<std::size_t> m_mix;
+
+    std::deque<clock::time_point> m_sentAt;
+};
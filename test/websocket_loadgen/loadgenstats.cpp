@@ -0,0 +1,56 @@
+#include "loadgenstats.h"
+
+// system includes
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+namespace {
+std::size_t bucketFor(uint64_t value)
+{
+    if (value < 16)
+        return value;
+
+    // keep the 5 most significant bits, value >> shift is in [16, 31]
+    const unsigned shift = std::bit_width(value) - 5;
+    return std::min<std::size_t>(shift * 16 + (value >> shift), LatencyHistogram::bucketCount - 1);
+}
+
+uint64_t bucketLowerBound(std::size_t bucket)
+{
+    if (bucket < 16)
+        return bucket;
+
+    return uint64_t(bucket % 16 + 16) << (bucket / 16 - 1);
+}
+} // namespace
+
+void LatencyHistogram::record(std::chrono::microseconds latency)
+{
+    m_buckets[bucketFor(std::max<int64_t>(latency.count(), 0))].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::mergeInto(Counts &counts) const
+{
+    for (std::size_t i = 0; i < bucketCount; i++)
+        counts[i] += m_buckets[i].load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(const Counts &counts, double q)
+{
+    const uint64_t total = std::accumulate(std::begin(counts), std::end(counts), uint64_t{});
+    if (!total)
+        return {};
+
+    const uint64_t rank = std::min<uint64_t>(total - 1, q * total);
+
+    uint64_t seen{};
+    for (std::size_t i = 0; i < bucketCount; i++)
+    {
+        seen += counts[i];
+        if (seen > rank)
+            return std::chrono::microseconds(bucketLowerBound(i));
+    }
+
+    return std::chrono::microseconds(bucketLowerBound(bucketCount - 1));
+}
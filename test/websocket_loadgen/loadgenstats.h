@@ -0,0 +1,41 @@
+#pragma once
+
+// system includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Round trip times in microseconds, log-linear buckets with 16 steps per
+// power of two (at most ~6% error). Written by one worker thread, read by
+// the reporting thread.
+class LatencyHistogram
+{
+public:
+    static constexpr std::size_t bucketCount{640};
+    using Counts = std::array<uint64_t, bucketCount>;
+
+    void record(std::chrono::microseconds latency);
+
+    // adds this histogram to counts
+    void mergeInto(Counts &counts) const;
+
+    // q in [0, 1], lower bound of the bucket holding the q-quantile
+    static std::chrono::microseconds percentile(const Counts &counts, double q);
+
+private:
+    std::array<std::atomic<uint64_t>, bucketCount> m_buckets{};
+};
+
+// per worker thread, all counters are totals since the start
+struct LoadgenStats
+{
+    std::atomic<uint64_t> connects{};
+    std::atomic<uint64_t> disconnects{};
+    std::atomic<uint64_t> errors{};
+    std::atomic<uint64_t> sentMessages{};
+    std::atomic<uint64_t> sentBytes{};
+    std::atomic<uint64_t> receivedMessages{};
+    LatencyHistogram latency;
+};
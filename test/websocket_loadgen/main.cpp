@@ -0,0 +1,274 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <numberparsing.h>
+#include <strutils.h>
+#include <asio_web/sslwebsocketclient.h>
+
+// local includes
+#include "loadgenclient.h"
+#include "loadgenstats.h"
+
+namespace {
+constexpr const char * const TAG = "ASIO_WEBSOCKET_LOADGEN";
+
+// one io_context per thread, the timer wheel is not thread safe
+struct Worker
+{
+    asio::io_context io_context;
+    asio::executor_work_guard<asio::io_context::executor_type> workGuard{asio::make_work_guard(io_context)};
+    LoadgenStats stats;
+    std::vector<std::unique_ptr<LoadgenConnection>> connections;
+    asio::steady_timer rampTimer{io_context};
+    std::size_t launched{};
+    std::thread thread;
+
+    // launches perTick connections every 10ms
+    void rampUp(std::size_t perTick)
+    {
+        const auto end = std::min(launched + perTick, connections.size());
+        for (; launched < end; launched++)
+            connections[launched]->launch();
+
+        if (launched == connections.size())
+            return;
+
+        rampTimer.expires_after(std::chrono::milliseconds{10});
+        rampTimer.async_wait([this, perTick](std::error_code ec){
+            if (!ec)
+                rampUp(perTick);
+        });
+    }
+};
+
+struct Totals
+{
+    uint64_t connects{};
+    uint64_t disconnects{};
+    uint64_t errors{};
+    uint64_t sentMessages{};
+    uint64_t sentBytes{};
+    uint64_t receivedMessages{};
+    LatencyHistogram::Counts latency{};
+};
+
+Totals collect(const std::vector<std::unique_ptr<Worker>> &workers)
+{
+    Totals totals;
+    for (const auto &worker : workers)
+    {
+        totals.connects += worker->stats.connects.load(std::memory_order_relaxed);
+        totals.disconnects += worker->stats.disconnects.load(std::memory_order_relaxed);
+        totals.errors += worker->stats.errors.load(std::memory_order_relaxed);
+        totals.sentMessages += worker->stats.sentMessages.load(std::memory_order_relaxed);
+        totals.sentBytes += worker->stats.sentBytes.load(std::memory_order_relaxed);
+        totals.receivedMessages += worker->stats.receivedMessages.load(std::memory_order_relaxed);
+        worker->stats.latency.mergeInto(totals.latency);
+    }
+    return totals;
+}
+
+std::string formatPercentiles(const LatencyHistogram::Counts &latency)
+{
+    const auto p = [&](double q){ return LatencyHistogram::percentile(latency, q).count(); };
+    return fmt::format("p50={}us p90={}us p99={}us p99.9={}us max={}us", p(.5), p(.9), p(.99), p(.999), p(1.));
+}
+
+// "64:8,512:1" message sizes with their weights
+bool parseMix(std::string_view str, LoadgenSettings &settings)
+{
+    while (!str.empty())
+    {
+        const auto comma = str.find(',');
+        const auto item = str.substr(0, comma);
+        str = comma == std::string_view::npos ? std::string_view{} : str.substr(comma + 1);
+
+        const auto colon = item.find(':');
+        const auto size = cpputils::fromString<std::size_t>(item.substr(0, colon));
+        if (!size)
+            return false;
+
+        double weight{1.};
+        if (colon != std::string_view::npos)
+        {
+            const auto parsed = cpputils::fromString<double>(item.substr(colon + 1));
+            if (!parsed || *parsed < 0.)
+                return false;
+            weight = *parsed;
+        }
+
+        settings.payloads.emplace_back(*size, 'x');
+        settings.weights.push_back(weight);
+    }
+
+    return !settings.payloads.empty();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    qSetMessagePattern(QStringLiteral("%{time dd.MM.yyyy HH:mm:ss.zzz} "
+                                      "["
+                                      "%{if-debug}D%{endif}"
+                                      "%{if-info}I%{endif}"
+                                      "%{if-warning}W%{endif}"
+                                      "%{if-critical}C%{endif}"
+                                      "%{if-fatal}F%{endif}"
+                                      "] "
+                                      "%{function}(): "
+                                      "%{message}"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Opens many websocket connections against webserver_example (/ws echoes every message) "
+                                                    "and reports connect rate, message rate and round trip times."));
+    parser.addHelpOption();
+
+    const QCommandLineOption hostOption{QStringLiteral("host"), QStringLiteral("Server host."), QStringLiteral("host"), QStringLiteral("localhost")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption pathOption{QStringLiteral("path"), QStringLiteral("Websocket path."), QStringLiteral("path"), QStringLiteral("/ws")};
+    const QCommandLineOption connectionsOption{QStringLiteral("connections"), QStringLiteral("Number of connections."), QStringLiteral("count"), QStringLiteral("1000")};
+    const QCommandLineOption threadsOption{QStringLiteral("threads"), QStringLiteral("Worker threads, each runs its own io_context."), QStringLiteral("count"),
+                                           QString::number(std::max(1u, std::thread::hardware_concurrency()))};
+    const QCommandLineOption connectRateOption{QStringLiteral("connect-rate"), QStringLiteral("New connections per second."), QStringLiteral("rate"), QStringLiteral("1000")};
+    const QCommandLineOption rateOption{QStringLiteral("rate"), QStringLiteral("Messages per second and connection."), QStringLiteral("rate"), QStringLiteral("1")};
+    const QCommandLineOption mixOption{QStringLiteral("mix"), QStringLiteral("Message sizes and weights, e.g. 64:8,512:1."), QStringLiteral("mix"), QStringLiteral("64")};
+    const QCommandLineOption durationOption{QStringLiteral("duration"), QStringLiteral("Seconds to run."), QStringLiteral("seconds"), QStringLiteral("30")};
+    const QCommandLineOption tlsOption{QStringLiteral("tls"), QStringLiteral("Connect with TLS.")};
+    const QCommandLineOption caOption{QStringLiteral("ca"), QStringLiteral("CA file, trusted besides the system CA store."), QStringLiteral("file")};
+    const QCommandLineOption insecureOption{QStringLiteral("insecure"), QStringLiteral("Accept any server certificate.")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({hostOption, portOption, pathOption, connectionsOption, threadsOption, connectRateOption,
+                       rateOption, mixOption, durationOption, tlsOption, caOption, insecureOption, verboseOption});
+    parser.process(app);
+
+    // the library logs every callback with info, too much with thousands of connections
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    LoadgenSettings settings {
+        .host = parser.value(hostOption).toStdString(),
+        .port = parser.value(portOption).toStdString(),
+        .path = parser.value(pathOption).toStdString(),
+        .rate = parser.value(rateOption).toDouble()
+    };
+
+    if (!parseMix(parser.value(mixOption).toStdString(), settings))
+    {
+        ESP_LOGE(TAG, "invalid --mix %s", qPrintable(parser.value(mixOption)));
+        return 1;
+    }
+
+    const std::size_t connections = parser.value(connectionsOption).toULongLong();
+    const std::size_t threads = std::max(1ull, parser.value(threadsOption).toULongLong());
+    const double connectRate = std::max(1., parser.value(connectRateOption).toDouble());
+    const std::chrono::seconds duration{parser.value(durationOption).toLongLong()};
+    const bool tls = parser.isSet(tlsOption);
+
+    // one ssl context, CA store and session cache for all connections
+    std::shared_ptr<SslClientContext> sslContext;
+    if (tls)
+    {
+        sslContext = std::make_shared<SslClientContext>();
+        sslContext->setAlpnProtocols({"http/1.1"});
+        if (parser.isSet(caOption))
+        {
+            std::error_code ec;
+            sslContext->loadVerifyFile(parser.value(caOption).toStdString(), ec);
+            if (ec)
+            {
+                ESP_LOGE(TAG, "loading %s failed: %s", qPrintable(parser.value(caOption)), ec.message().c_str());
+                return 1;
+            }
+        }
+        if (parser.isSet(insecureOption))
+            sslContext->disableVerification();
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (std::size_t i = 0; i < threads; i++)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (std::size_t i = 0; i < connections; i++)
+    {
+        Worker &worker = *workers[i % threads];
+        if (tls)
+            worker.connections.push_back(std::make_unique<LoadgenClient<asio::ssl::stream<asio::ip::tcp::socket>>>(
+                worker.io_context, settings, worker.stats, SslWebsocketClient::StreamOptions{ .context = sslContext }));
+        else
+            worker.connections.push_back(std::make_unique<LoadgenClient<asio::ip::tcp::socket>>(
+                worker.io_context, settings, worker.stats));
+    }
+
+    fmt::print("{} {} connections to {}:{}{} on {} threads, {} msg/s each, ramping up with {}/s\n",
+               connections, tls ? "tls" : "plain", settings.host, settings.port, settings.path, threads, settings.rate, connectRate);
+
+    // 100 ramp ticks per second, spread over the workers
+    const std::size_t perTick = std::max<std::size_t>(1, connectRate / 100. / threads);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto &worker : workers)
+    {
+        asio::post(worker->io_context, [worker=worker.get(), perTick](){ worker->rampUp(perTick); });
+        worker->thread = std::thread{[worker=worker.get()](){ worker->io_context.run(); }};
+    }
+
+    Totals last;
+    auto lastTime = start;
+    while (std::chrono::steady_clock::now() - start < duration)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds{1});
+
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(now - lastTime).count();
+        const auto totals = collect(workers);
+
+        LatencyHistogram::Counts interval;
+        for (std::size_t i = 0; i < interval.size(); i++)
+            interval[i] = totals.latency[i] - last.latency[i];
+
+        fmt::print("{:>5.1f}s connected={} connects={:.0f}/s sent={:.0f}/s ({:.1f} MB/s) received={:.0f}/s errors={} {}\n",
+                   std::chrono::duration<double>(now - start).count(),
+                   totals.connects - totals.disconnects,
+                   (totals.connects - last.connects) / seconds,
+                   (totals.sentMessages - last.sentMessages) / seconds,
+                   (totals.sentBytes - last.sentBytes) / seconds / 1e6,
+                   (totals.receivedMessages - last.receivedMessages) / seconds,
+                   totals.errors,
+                   formatPercentiles(interval));
+
+        last = totals;
+        lastTime = now;
+    }
+
+    for (auto &worker : workers)
+        worker->io_context.stop();
+    for (auto &worker : workers)
+        worker->thread.join();
+
+    const auto totals = collect(workers);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fmt::print("total: connects={} disconnects={} errors={} sent={} ({:.0f}/s) received={} ({:.0f}/s)\n",
+               totals.connects, totals.disconnects, totals.errors,
+               totals.sentMessages, totals.sentMessages / seconds,
+               totals.receivedMessages, totals.receivedMessages / seconds);
+    fmt::print("round trips: {}\n", formatPercentiles(totals.latency));
+}
@@ -0,0 +1,9 @@
+HEADERS += \
+    loadgenclient.h \
+    loadgenstats.h
+
+SOURCES += \
+    loadgenstats.cpp \
+    main.cpp
+
+include(../testapp.pri)
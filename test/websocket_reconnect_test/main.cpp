@@ -0,0 +1,160 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+
+// system includes
+#include <chrono>
+#include <memory>
+#include <string>
+
+// esp-idf includes
+#include <esp_log.h>
+#include <asio.hpp>
+
+// 3rdparty lib includes
+#include <fmt/core.h>
+#include <asio_web/clientconnection.h>
+#include <asio_web/responsehandler.h>
+#include <asio_web/webserver.h>
+#include <asio_web/websocketclient.h>
+#include <asio_web/websocketclientconnection.h>
+
+namespace {
+// closes the connection when asked to with a "drop" text message
+class DroppingResponseHandler final : public ResponseHandler
+{
+public:
+    explicit DroppingResponseHandler(ClientConnection &clientConnection) :
+        m_clientConnection{clientConnection}
+    {}
+
+    void requestHeaderReceived(std::string_view key, std::string_view value) final {}
+    void requestBodyReceived(std::string_view body) final {}
+
+    void sendResponse() final
+    {
+        static constexpr std::string_view response{"HTTP/1.1 404 Not Found\r\n"
+                                                   "Content-Length: 0\r\n"
+                                                   "\r\n"};
+        asio::async_write(m_clientConnection.stream(), asio::buffer(response.data(), response.size()),
+                          [this, self=m_clientConnection.shared_from_this()](std::error_code ec, std::size_t length)
+                          { m_clientConnection.responseFinished(ec); });
+    }
+
+    bool acceptsWebsocketUpgrade() const final { return true; }
+
+    void websocketMessageReceived(WebsocketClientConnection &connection, bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final
+    {
+        if (opcode == 1 && payload == "drop")
+            connection.close(1001);
+    }
+
+private:
+    ClientConnection &m_clientConnection;
+};
+
+class DroppingWebserver final : public Webserver
+{
+public:
+    using Webserver::Webserver;
+
+    bool connectionKeepAlive() const final { return true; }
+
+    std::unique_ptr<ResponseHandler> makeResponseHandler(ClientConnection &clientConnection, std::string_view method, std::string_view path, std::string_view protocol) final
+    {
+        return std::make_unique<DroppingResponseHandler>(clientConnection);
+    }
+};
+
+// ends its first connection either with close() or by letting the server drop it
+class ClosingClient final : public WebsocketClient
+{
+public:
+    ClosingClient(asio::io_context &io_context, const std::string &port, bool dropped) :
+        WebsocketClient{io_context, "127.0.0.1", port, "/"}, m_dropped{dropped}
+    {}
+
+    std::size_t connects{};
+    std::size_t disconnects{};
+    std::size_t errors{};
+
+    void handleConnected() final
+    {
+        if (connects++)
+            return;
+
+        if (m_dropped)
+            sendMessage(true, 0, 1, true, "drop");
+        else
+            close(1000);
+    }
+
+    void handleDisconnected() final { disconnects++; }
+    void handleMessage(bool fin, uint8_t reserved, uint8_t opcode, bool mask, std::string_view payload) final {}
+    void handleErrorOccured(const Error &error) final { errors++; }
+
+private:
+    const bool m_dropped;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Connects a WebsocketClient with reconnects enabled to a Webserver and closes it with "
+                                                    "close(), which has to stay closed, then lets the server drop a second client, which "
+                                                    "has to come back. Exits with 1 if either does not."));
+    parser.addHelpOption();
+
+    const QCommandLineOption delayOption{QStringLiteral("delay"), QStringLiteral("Reconnect delay, the test waits three of them."), QStringLiteral("ms"), QStringLiteral("200")};
+    const QCommandLineOption portOption{QStringLiteral("port"), QStringLiteral("Server port."), QStringLiteral("port"), QStringLiteral("8080")};
+    const QCommandLineOption verboseOption{QStringLiteral("verbose"), QStringLiteral("Keep the info logs of the library.")};
+
+    parser.addOptions({delayOption, portOption, verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false\n*.info=false"));
+
+    const std::chrono::milliseconds delay{parser.value(delayOption).toLongLong()};
+    const auto port = parser.value(portOption).toUShort();
+
+    asio::io_context io_context;
+    DroppingWebserver server{io_context, port};
+
+    std::size_t failed{};
+
+    for (const bool dropped : {false, true})
+    {
+        ClosingClient client{io_context, std::to_string(port), dropped};
+        client.setReconnectSettings({ .enabled = true, .initialDelay = delay, .maxDelay = delay });
+        client.start();
+
+        io_context.restart();
+        io_context.run_for(delay * 3);
+
+        const auto &stats = client.stats();
+        fmt::print("{}: {} connects, {} disconnects, {} errors, {} reconnect attempts\n", dropped ? "dropped" : "closed",
+                   client.connects, client.disconnects, client.errors, stats.reconnectAttempts);
+
+        if (!client.connects)
+        {
+            fmt::print("never connected\n");
+            failed++;
+        }
+        else if (!dropped && (client.connects > 1 || client.errors || stats.reconnectAttempts))
+        {
+            fmt::print("reconnected after close()\n");
+            failed++;
+        }
+        else if (dropped && client.connects < 2)
+        {
+            fmt::print("did not reconnect after being dropped\n");
+            failed++;
+        }
+    }
+
+    return failed ? 1 : 0;
+}